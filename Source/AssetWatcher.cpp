@@ -0,0 +1,252 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetwatcher.cpp
+// ============
+// watch shader, texture and scene files for changes on a background thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AssetWatcher.h"
+
+#include <chrono>
+#include <iostream>
+
+#include <sys/stat.h>
+
+/***********************************************************
+ *  AssetWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AssetWatcher::AssetWatcher()
+{
+	m_bStopping = false;
+	m_pollMilliseconds = 250;
+}
+
+/***********************************************************
+ *  ~AssetWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AssetWatcher::~AssetWatcher()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  GetFileStamp()
+ *
+ *  This method is used for reading the time a file was last
+ *  changed and its size.
+ ***********************************************************/
+bool AssetWatcher::GetFileStamp(const std::string& filePath, time_t& modifiedTime, long long& fileSize)
+{
+	struct stat fileInfo;
+
+	if (stat(filePath.c_str(), &fileInfo) != 0)
+	{
+		return(false);
+	}
+
+	modifiedTime = fileInfo.st_mtime;
+	fileSize = (long long)fileInfo.st_size;
+
+	return(true);
+}
+
+/***********************************************************
+ *  WatchFile()
+ *
+ *  This method is used for adding a file to the watched
+ *  files.  The current time and size of the file are taken
+ *  as the loaded version, so only later changes are
+ *  reported.  A file that is already watched with the same
+ *  type and index is not added again.
+ ***********************************************************/
+void AssetWatcher::WatchFile(const std::string& filePath, ASSET_TYPE type, int assetIndex)
+{
+	WATCHED_FILE file;
+
+	file.filePath = filePath;
+	file.type = type;
+	file.assetIndex = assetIndex;
+	file.modifiedTime = 0;
+	file.fileSize = -1;
+	file.pendingTime = 0;
+	file.pendingSize = -1;
+	file.bPending = false;
+	GetFileStamp(filePath, file.modifiedTime, file.fileSize);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if ((m_files[i].filePath == filePath) &&
+			(m_files[i].type == type) &&
+			(m_files[i].assetIndex == assetIndex))
+		{
+			return;
+		}
+	}
+	m_files.push_back(file);
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the watcher thread,
+ *  which checks the files every passed in number of
+ *  milliseconds.
+ ***********************************************************/
+void AssetWatcher::Start(int pollMilliseconds)
+{
+	if (m_thread.joinable() == true)
+	{
+		return;
+	}
+
+	m_pollMilliseconds = (pollMilliseconds > 0) ? pollMilliseconds : 250;
+	m_bStopping = false;
+	m_thread = std::thread(&AssetWatcher::WatchLoop, this);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the watcher thread.
+ ***********************************************************/
+void AssetWatcher::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_stopSignal.notify_all();
+
+	if (m_thread.joinable() == true)
+	{
+		m_thread.join();
+	}
+}
+
+/***********************************************************
+ *  WatchLoop()
+ *
+ *  This method is run by the watcher thread.  It checks the
+ *  files and then sleeps until the next check, or until the
+ *  watcher is stopped.
+ ***********************************************************/
+void AssetWatcher::WatchLoop()
+{
+	while (true)
+	{
+		CheckFiles();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stopSignal.wait_for(lock, std::chrono::milliseconds(m_pollMilliseconds), [this]()
+			{
+				return(m_bStopping == true);
+			});
+		if (m_bStopping == true)
+		{
+			return;
+		}
+	}
+}
+
+/***********************************************************
+ *  CheckFiles()
+ *
+ *  This method is used for checking every watched file
+ *  once.  A file whose time or size is new is only marked
+ *  as pending, and is reported on the next check when it
+ *  has stayed the same.  The files are read without holding
+ *  the lock, so watching a file never waits on a check.
+ ***********************************************************/
+void AssetWatcher::CheckFiles()
+{
+	std::vector<WATCHED_FILE> files;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		files = m_files;
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		WATCHED_FILE& file = files[i];
+		time_t modifiedTime = 0;
+		long long fileSize = -1;
+
+		// a file that is missing, such as while an editor
+		// replaces it, is checked again next time
+		if (GetFileStamp(file.filePath, modifiedTime, fileSize) == false)
+		{
+			continue;
+		}
+		if ((modifiedTime == file.modifiedTime) && (fileSize == file.fileSize))
+		{
+			file.bPending = false;
+			continue;
+		}
+		if ((file.bPending == false) ||
+			(modifiedTime != file.pendingTime) ||
+			(fileSize != file.pendingSize))
+		{
+			file.pendingTime = modifiedTime;
+			file.pendingSize = fileSize;
+			file.bPending = true;
+			continue;
+		}
+
+		file.modifiedTime = modifiedTime;
+		file.fileSize = fileSize;
+		file.bPending = false;
+
+		ASSET_CHANGE change;
+		change.type = file.type;
+		change.filePath = file.filePath;
+		change.assetIndex = file.assetIndex;
+
+		// scene files are read and compiled here, off of the
+		// OpenGL thread
+		if (file.type == ASSET_SCENE)
+		{
+			change.pSceneFile = std::make_shared<SceneFile>();
+			if (change.pSceneFile->Load(file.filePath.c_str()) == false)
+			{
+				std::cout << "Keeping the previous scene, could not reload:" << file.filePath << std::endl;
+				continue;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_changes.push_back(change);
+	}
+
+	// the files are only ever added to, so the checked ones
+	// are at the same place in the list
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		m_files[i].modifiedTime = files[i].modifiedTime;
+		m_files[i].fileSize = files[i].fileSize;
+		m_files[i].pendingTime = files[i].pendingTime;
+		m_files[i].pendingSize = files[i].pendingSize;
+		m_files[i].bPending = files[i].bPending;
+	}
+}
+
+/***********************************************************
+ *  TakeChanges()
+ *
+ *  This method is used for moving the reported changes into
+ *  the passed in list.  This is called on the OpenGL thread
+ *  between frames.
+ ***********************************************************/
+int AssetWatcher::TakeChanges(std::vector<ASSET_CHANGE>& changes)
+{
+	changes.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	changes.swap(m_changes);
+
+	return((int)changes.size());
+}
@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// assetwatcher.h
+// ============
+// watch shader, texture and scene files for changes on a background thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <condition_variable>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  AssetWatcher
+ *
+ *  This class checks the files of the scene assets for
+ *  changes on a background thread, so that a shader,
+ *  texture or scene file can be edited while the program
+ *  runs.  A file is reported once its time and size have
+ *  stopped changing for one check, so a file that an
+ *  editor is still writing is not read half way.
+ *
+ *  The work of a reload that does not need OpenGL is done
+ *  on the watcher thread - a changed scene file is read and
+ *  compiled there.  The changes are taken on the OpenGL
+ *  thread between frames with TakeChanges(), which is where
+ *  the new assets are swapped in.
+ ***********************************************************/
+class AssetWatcher
+{
+public:
+	// constructor
+	AssetWatcher();
+	// destructor
+	~AssetWatcher();
+
+	enum ASSET_TYPE
+	{
+		ASSET_SHADER,
+		ASSET_TEXTURE,
+		ASSET_SCENE
+	};
+
+	// a file that changed, with the index it was watched with
+	struct ASSET_CHANGE
+	{
+		ASSET_TYPE type;
+		std::string filePath;
+		int assetIndex;
+		// the loaded scene of a changed scene file - a scene
+		// file that can not be loaded is not reported
+		std::shared_ptr<SceneFile> pSceneFile;
+	};
+
+private:
+	struct WATCHED_FILE
+	{
+		std::string filePath;
+		ASSET_TYPE type;
+		int assetIndex;
+		// the time and size the file was last loaded with
+		time_t modifiedTime;
+		long long fileSize;
+		// the time and size of a change that is waiting for
+		// the file to stop changing
+		time_t pendingTime;
+		long long pendingSize;
+		bool bPending;
+	};
+
+	// the thread that checks the files
+	std::thread m_thread;
+	// guards the files, the changes and the stopping flag
+	std::mutex m_mutex;
+	// signalled when the watcher stops
+	std::condition_variable m_stopSignal;
+	bool m_bStopping;
+	// the milliseconds between two checks of the files
+	int m_pollMilliseconds;
+	std::vector<WATCHED_FILE> m_files;
+	// the changes that were not taken yet
+	std::vector<ASSET_CHANGE> m_changes;
+
+	// the loop of the watcher thread
+	void WatchLoop();
+	// check the files once and report the changed ones
+	void CheckFiles();
+	// read the time and size of a file
+	static bool GetFileStamp(const std::string& filePath, time_t& modifiedTime, long long& fileSize);
+
+public:
+	// add a file to watch - the passed in index is handed
+	// back with its changes
+	void WatchFile(const std::string& filePath, ASSET_TYPE type, int assetIndex = 0);
+
+	// start and stop the watcher thread
+	void Start(int pollMilliseconds = 250);
+	void Stop();
+
+	// move the changes since the last call into the passed in
+	// list and return their number
+	int TakeChanges(std::vector<ASSET_CHANGE>& changes);
+};
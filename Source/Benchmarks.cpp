@@ -0,0 +1,529 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.cpp
+// ============
+// command line benchmarks for the scene data structures
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmarks.h"
+#include "CameraPath.h"
+#include "FrameProfiler.h"
+#include "FrustumCuller.h"
+#include "SceneBVH.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// the size of the cube the random objects are placed in
+	const float WORLD_SIZE = 1000.0f;
+	// the number of random views and rays that are timed
+	const int QUERY_COUNT = 64;
+	const int RAY_COUNT = 1000;
+
+	// the size of the offscreen framebuffer the scene benchmark
+	// renders into, which matches the window the projection
+	// of the view manager is made for
+	const int BENCHMARK_WIDTH = 1000;
+	const int BENCHMARK_HEIGHT = 800;
+	// the length of the orbit that is used when no camera path
+	// file is passed in, and the number of keys on it
+	const float ORBIT_DURATION = 20.0f;
+	const int ORBIT_KEYS = 8;
+
+	// the frame time at a percentile of the sorted frame times
+	double Percentile(const std::vector<double>& sortedTimes, double percentile)
+	{
+		if (sortedTimes.size() == 0)
+		{
+			return(0.0);
+		}
+
+		size_t index = (size_t)(percentile / 100.0 * (double)(sortedTimes.size() - 1) + 0.5);
+		return(sortedTimes[std::min(index, sortedTimes.size() - 1)]);
+	}
+
+	// milliseconds since the passed in start time
+	double ElapsedMilliseconds(const std::chrono::high_resolution_clock::time_point& start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return(elapsed.count());
+	}
+
+	// brute force ray test against every box - returns the
+	// nearest hit box, or -1
+	int RaycastAll(
+		FrustumCuller& culler,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance)
+	{
+		glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		float nearest = maxDistance;
+		int hitItem = -1;
+
+		for (int i = 0; i < culler.GetBoundsCount(); i++)
+		{
+			culler.GetBounds(i, boundsMin, boundsMax);
+
+			glm::vec3 t1 = (boundsMin - origin) * inverseDirection;
+			glm::vec3 t2 = (boundsMax - origin) * inverseDirection;
+			glm::vec3 tMin = glm::min(t1, t2);
+			glm::vec3 tMax = glm::max(t1, t2);
+			float tNear = glm::max(glm::max(tMin.x, tMin.y), tMin.z);
+			float tFar = glm::min(glm::min(tMax.x, tMax.y), tMax.z);
+
+			if ((tFar >= tNear) && (tFar >= 0.0f) && (tNear <= nearest))
+			{
+				nearest = glm::max(tNear, 0.0f);
+				hitItem = i;
+			}
+		}
+
+		return(hitItem);
+	}
+
+	// the measurements of one run along the camera path
+	struct SCENE_RUN
+	{
+		std::vector<double> frameTimes;
+		double gpuTotal;
+		int gpuFrames;
+		// the GPU time of the depth pre-pass and the lit pass,
+		// the only passes the pre-pass changes
+		double scenePassTotal;
+		int scenePassFrames;
+		long long counterTotals[FrameProfiler::COUNTER_COUNT];
+
+		SCENE_RUN()
+		{
+			gpuTotal = 0.0;
+			gpuFrames = 0;
+			scenePassTotal = 0.0;
+			scenePassFrames = 0;
+			for (int i = 0; i < FrameProfiler::COUNTER_COUNT; i++)
+			{
+				counterTotals[i] = 0;
+			}
+		}
+
+		// the average GPU milliseconds of a frame
+		double GetGpuTime() const
+		{
+			return((gpuFrames > 0) ? gpuTotal / (double)gpuFrames : 0.0);
+		}
+
+		// the average GPU milliseconds of the opaque scene
+		double GetScenePassTime() const
+		{
+			return((scenePassFrames > 0) ? scenePassTotal / (double)scenePassFrames : 0.0);
+		}
+	};
+
+	// render the warm up and measured frames along the camera
+	// path into a framebuffer - every frame moves the same step
+	// along the path and waits for the GPU to finish
+	void RenderSceneRun(
+		const Benchmarks::SCENE_BENCHMARK_SETTINGS& settings,
+		GLuint framebuffer,
+		float timeStep,
+		GLFWwindow* pWindow,
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		FrameProfiler* pProfiler,
+		SCENE_RUN& run)
+	{
+		int totalFrames = settings.warmupFrames + settings.frameCount;
+
+		run.frameTimes.reserve(settings.frameCount);
+		for (int frame = 0; frame < totalFrames; frame++)
+		{
+			int measuredFrame = frame - settings.warmupFrames;
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+			pProfiler->BeginFrame();
+			// the warm up frames stay at the start of the path
+			pViewManager->SetPlaybackTime((measuredFrame > 0) ? timeStep * (float)measuredFrame : 0.0f);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glViewport(0, 0, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			{
+				ProfileScope scope("PrepareSceneView");
+				pViewManager->PrepareSceneView();
+			}
+			{
+				ProfileScope scope("RenderScene");
+				pSceneManager->RenderScene();
+			}
+			{
+				ProfileScope scope("Finish");
+				glFinish();
+			}
+
+			pProfiler->EndFrame();
+			if (NULL != pWindow)
+			{
+				glfwPollEvents();
+			}
+			double frameTime = ElapsedMilliseconds(start);
+
+			if (measuredFrame >= 0)
+			{
+				const FrameProfiler::FRAME_STATS& stats = pProfiler->GetLastFrame();
+
+				run.frameTimes.push_back(frameTime);
+				if (stats.gpuTime >= 0.0)
+				{
+					double scenePassTime = 0.0;
+
+					run.gpuTotal += stats.gpuTime;
+					run.gpuFrames++;
+					for (size_t i = 0; i < stats.gpuPasses.size(); i++)
+					{
+						if ((strcmp(stats.gpuPasses[i].name, "DepthPrepass") == 0) ||
+							(strcmp(stats.gpuPasses[i].name, "Scene") == 0))
+						{
+							scenePassTime += stats.gpuPasses[i].duration;
+						}
+					}
+					run.scenePassTotal += scenePassTime;
+					run.scenePassFrames++;
+				}
+				for (int i = 0; i < FrameProfiler::COUNTER_COUNT; i++)
+				{
+					run.counterTotals[i] += stats.counters[i];
+				}
+			}
+		}
+
+		std::sort(run.frameTimes.begin(), run.frameTimes.end());
+	}
+
+	// print the frame time percentiles and the counters of a run
+	void PrintSceneRun(const SCENE_RUN& run)
+	{
+		const std::vector<double>& frameTimes = run.frameTimes;
+		double totalTime = 0.0;
+		for (size_t i = 0; i < frameTimes.size(); i++)
+		{
+			totalTime += frameTimes[i];
+		}
+
+		double frameCount = (double)frameTimes.size();
+		printf("%10s %10s %10s %10s %10s %10s %10s\n",
+			"avg ms", "p50 ms", "p95 ms", "p99 ms", "max ms", "gpu ms", "fps");
+		printf("%10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.1f\n",
+			totalTime / frameCount,
+			Percentile(frameTimes, 50.0),
+			Percentile(frameTimes, 95.0),
+			Percentile(frameTimes, 99.0),
+			frameTimes.back(),
+			run.GetGpuTime(),
+			(totalTime > 0.0) ? 1000.0 * frameCount / totalTime : 0.0);
+		printf("%10s %10s %10s %10s %10s %10s %10s\n",
+			"draws", "triangles", "uploads", "binds", "allocs", "arena kb", "upload kb");
+		printf("%10.1f %10.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			run.counterTotals[FrameProfiler::COUNTER_DRAW_CALLS] / frameCount,
+			run.counterTotals[FrameProfiler::COUNTER_TRIANGLES] / frameCount,
+			run.counterTotals[FrameProfiler::COUNTER_UNIFORM_UPLOADS] / frameCount,
+			run.counterTotals[FrameProfiler::COUNTER_TEXTURE_BINDS] / frameCount,
+			run.counterTotals[FrameProfiler::COUNTER_HEAP_ALLOCATIONS] / frameCount,
+			run.counterTotals[FrameProfiler::COUNTER_ARENA_BYTES] / frameCount / 1024.0,
+			run.counterTotals[FrameProfiler::COUNTER_UPLOAD_BYTES] / frameCount / 1024.0);
+	}
+}
+
+/***********************************************************
+ *  RunBVHBenchmark()
+ *
+ *  This method is used for timing the bounding volume
+ *  hierarchy against testing every box.  Random boxes are
+ *  placed in a large cube and viewed from random cameras.
+ *  The results of both methods are compared, and the
+ *  times are printed as a table.  EXIT_FAILURE is returned
+ *  when the two methods disagree.
+ ***********************************************************/
+int Benchmarks::RunBVHBenchmark()
+{
+	const int objectCounts[] = { 1000, 10000, 100000 };
+	std::mt19937 random(330);
+	std::uniform_real_distribution<float> position(-WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	bool bMatched = true;
+
+	printf("%8s %10s %10s %12s %12s %8s %12s %12s\n",
+		"objects", "build ms", "refit ms", "cull all ms", "cull bvh ms",
+		"visible", "ray all ms", "ray bvh ms");
+
+	for (int objectCount : objectCounts)
+	{
+		FrustumCuller culler;
+		SceneBVH bvh;
+		glm::vec3 boundsMin(-0.5f, -0.5f, -0.5f);
+		glm::vec3 boundsMax(0.5f, 0.5f, 0.5f);
+		glm::vec3 itemMin;
+		glm::vec3 itemMax;
+
+		culler.SetBoundsCount(objectCount);
+		bvh.SetItemCount(objectCount);
+		for (int i = 0; i < objectCount; i++)
+		{
+			glm::mat4 model = glm::translate(glm::vec3(position(random), position(random), position(random))) *
+				glm::scale(glm::vec3(size(random), size(random), size(random)));
+
+			culler.SetBounds(i, boundsMin, boundsMax, model);
+			culler.GetBounds(i, itemMin, itemMax);
+			bvh.SetItemBounds(i, itemMin, itemMax);
+		}
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		bvh.Build();
+		double buildTime = ElapsedMilliseconds(start);
+
+		// move every object a little and refit
+		for (int i = 0; i < objectCount; i++)
+		{
+			culler.GetBounds(i, itemMin, itemMax);
+			glm::vec3 offset(unit(random), unit(random), unit(random));
+			bvh.SetItemBounds(i, itemMin + offset, itemMax + offset);
+		}
+		start = std::chrono::high_resolution_clock::now();
+		bvh.Refit();
+		double refitTime = ElapsedMilliseconds(start);
+
+		// put the boxes back, so both methods test the same boxes
+		for (int i = 0; i < objectCount; i++)
+		{
+			culler.GetBounds(i, itemMin, itemMax);
+			bvh.SetItemBounds(i, itemMin, itemMax);
+		}
+		bvh.Refit();
+
+		// random cameras looking into the cube
+		std::vector<glm::mat4> views(QUERY_COUNT);
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+		for (int q = 0; q < QUERY_COUNT; q++)
+		{
+			glm::vec3 eye(position(random), position(random), position(random));
+			glm::vec3 target = eye + glm::vec3(unit(random), unit(random), unit(random));
+			views[q] = projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+
+		std::vector<uint8_t> visibleAll;
+		std::vector<uint8_t> visibleBVH;
+		float planes[FrustumCuller::FRUSTUM_PLANES][4];
+		double cullAllTime = 0.0;
+		double cullBVHTime = 0.0;
+		long long visibleTotal = 0;
+
+		for (int q = 0; q < QUERY_COUNT; q++)
+		{
+			culler.SetViewProjection(views[q]);
+			culler.GetPlanes(planes);
+
+			start = std::chrono::high_resolution_clock::now();
+			int visibleCount = culler.CullBounds(visibleAll);
+			cullAllTime += ElapsedMilliseconds(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			int visibleCountBVH = bvh.QueryFrustum(planes, visibleBVH);
+			cullBVHTime += ElapsedMilliseconds(start);
+
+			if ((visibleCount != visibleCountBVH) || (visibleAll != visibleBVH))
+			{
+				bMatched = false;
+			}
+			visibleTotal += visibleCount;
+		}
+
+		// random rays from inside the cube
+		double rayAllTime = 0.0;
+		double rayBVHTime = 0.0;
+		for (int r = 0; r < RAY_COUNT; r++)
+		{
+			glm::vec3 origin(position(random), position(random), position(random));
+			glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.001f));
+			float hitDistance = 0.0f;
+
+			start = std::chrono::high_resolution_clock::now();
+			int hitAll = RaycastAll(culler, origin, direction, WORLD_SIZE);
+			rayAllTime += ElapsedMilliseconds(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			int hitBVH = bvh.Raycast(origin, direction, WORLD_SIZE, hitDistance);
+			rayBVHTime += ElapsedMilliseconds(start);
+
+			// overlapping boxes can tie, so compare by presence
+			if ((hitAll < 0) != (hitBVH < 0))
+			{
+				bMatched = false;
+			}
+		}
+
+		printf("%8d %10.3f %10.3f %12.4f %12.4f %8lld %12.4f %12.4f\n",
+			objectCount, buildTime, refitTime,
+			cullAllTime / QUERY_COUNT, cullBVHTime / QUERY_COUNT,
+			visibleTotal / QUERY_COUNT,
+			rayAllTime / RAY_COUNT, rayBVHTime / RAY_COUNT);
+	}
+
+	if (bMatched == false)
+	{
+		printf("ERROR: the bounding volume hierarchy results do not match testing every box\n");
+		return(EXIT_FAILURE);
+	}
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *  RunSceneBenchmark()
+ *
+ *  This method is used for timing the rendering of the
+ *  prepared scene.  The camera follows a camera path that
+ *  is loaded from a file, or an orbit around the scene, and
+ *  every frame moves the same step along the path, so runs
+ *  with the same settings render the same frames.  The
+ *  frames are drawn into an offscreen framebuffer with
+ *  vsync off, and each frame waits for the GPU to finish
+ *  so the measured time covers all of its work.  The same
+ *  frames can also be rendered without and then with the
+ *  depth pre-pass, to compare the GPU time of the scene.
+ ***********************************************************/
+int Benchmarks::RunSceneBenchmark(
+	const SCENE_BENCHMARK_SETTINGS& settings,
+	GLFWwindow* pWindow,
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	FrameProfiler* pProfiler)
+{
+	CameraPath cameraPath;
+
+	if ((NULL == pViewManager) || (NULL == pSceneManager) || (NULL == pProfiler) || (settings.frameCount <= 0))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	if (NULL != settings.cameraPathFile)
+	{
+		if (cameraPath.LoadFromFile(settings.cameraPathFile) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	else
+	{
+		// circle the scene a little above it, looking at its center
+		glm::vec3 boundsMin(-10.0f, 0.0f, -10.0f);
+		glm::vec3 boundsMax(10.0f, 5.0f, 10.0f);
+		pSceneManager->GetSceneBounds(boundsMin, boundsMax);
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float extent = glm::max(boundsMax.x - boundsMin.x, boundsMax.z - boundsMin.z);
+		cameraPath.CreateOrbit(center, extent * 0.25f + 6.0f, extent * 0.1f + 4.0f, ORBIT_DURATION, ORBIT_KEYS);
+	}
+
+	// the offscreen framebuffer the frames are drawn into
+	GLuint framebuffer = 0;
+	GLuint renderbuffers[2] = { 0, 0 };
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (bComplete == false)
+	{
+		printf("ERROR: the benchmark framebuffer could not be created\n");
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(2, renderbuffers);
+		return(EXIT_FAILURE);
+	}
+
+	// frames are not held back by the display refresh
+	if (NULL != pWindow)
+	{
+		glfwSwapInterval(0);
+	}
+
+	pViewManager->SetCameraPath(&cameraPath);
+
+	float timeStep = (settings.frameCount > 1) ? cameraPath.GetDuration() / (float)(settings.frameCount - 1) : 0.0f;
+	bool bDepthPrepass = pSceneManager->IsDepthPrepassEnabled();
+	SCENE_RUN runs[2];
+	int runCount = 1;
+
+	if (settings.bCompareDepthPrepass == true)
+	{
+		// the same frames are rendered without and then with the
+		// depth pre-pass
+		pSceneManager->SetDepthPrepass(false);
+		RenderSceneRun(settings, framebuffer, timeStep, pWindow, pViewManager, pSceneManager, pProfiler, runs[0]);
+		if (pSceneManager->SetDepthPrepass(true) == true)
+		{
+			RenderSceneRun(settings, framebuffer, timeStep, pWindow, pViewManager, pSceneManager, pProfiler, runs[1]);
+			runCount = 2;
+		}
+		pSceneManager->SetDepthPrepass(bDepthPrepass);
+	}
+	else
+	{
+		RenderSceneRun(settings, framebuffer, timeStep, pWindow, pViewManager, pSceneManager, pProfiler, runs[0]);
+	}
+
+	pViewManager->SetCameraPath(NULL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(2, renderbuffers);
+
+	for (int run = 0; run < runCount; run++)
+	{
+		bool bRunPrepass = (settings.bCompareDepthPrepass == true) ? (run == 1) : bDepthPrepass;
+
+		printf("frames %d (warm up %d) at %dx%d, camera path %s\n",
+			(int)runs[run].frameTimes.size(), settings.warmupFrames, BENCHMARK_WIDTH, BENCHMARK_HEIGHT,
+			(NULL != settings.cameraPathFile) ? settings.cameraPathFile : "orbit");
+		printf("culling %s, transparency %s, depth pre-pass %s\n",
+			SceneManager::GetCullingModeName(pSceneManager->GetCullingMode()),
+			SceneManager::GetTransparencyModeName(pSceneManager->GetTransparencyMode()),
+			(bRunPrepass == true) ? "on" : "off");
+		PrintSceneRun(runs[run]);
+	}
+
+	// the GPU time of the opaque scene with and without the
+	// pre-pass, and how much of it the pre-pass saved
+	if (runCount == 2)
+	{
+		double offTime = runs[0].GetScenePassTime();
+		double onTime = runs[1].GetScenePassTime();
+
+		printf("%16s %10s %10s\n", "depth pre-pass", "scene ms", "gpu ms");
+		printf("%16s %10.3f %10.3f\n", "off", offTime, runs[0].GetGpuTime());
+		printf("%16s %10.3f %10.3f\n", "on", onTime, runs[1].GetGpuTime());
+		printf("%16s %9.1f%%\n", "saved", (offTime > 0.0) ? 100.0 * (offTime - onTime) / offTime : 0.0);
+	}
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.h
+// ============
+// command line benchmarks for the scene data structures and the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+struct GLFWwindow;
+class FrameProfiler;
+class SceneManager;
+class ViewManager;
+
+/***********************************************************
+ *  Benchmarks
+ *
+ *  This class contains benchmarks that run from the command
+ *  line.  The data structure benchmarks run without
+ *  creating a window, so the scene data structures can be
+ *  measured on their own, and the scene benchmark renders
+ *  the prepared scene into an offscreen framebuffer.
+ ***********************************************************/
+class Benchmarks
+{
+public:
+	// the options of a scene benchmark run
+	struct SCENE_BENCHMARK_SETTINGS
+	{
+		// the number of measured frames, and the frames that
+		// are rendered first so loading does not count
+		int frameCount;
+		int warmupFrames;
+		// the camera path file to play back, or NULL to orbit
+		// around the scene
+		const char* cameraPathFile;
+		// render the frames without and then with the depth
+		// pre-pass, and compare their GPU times
+		bool bCompareDepthPrepass;
+
+		SCENE_BENCHMARK_SETTINGS()
+		{
+			frameCount = 1000;
+			warmupFrames = 60;
+			cameraPathFile = nullptr;
+			bCompareDepthPrepass = false;
+		}
+	};
+
+	// compare the bounding volume hierarchy against testing
+	// every box for frustum culling and ray picking, with
+	// 1k, 10k and 100k random objects
+	static int RunBVHBenchmark();
+
+	// render the prepared scene along a camera path into an
+	// offscreen framebuffer with vsync off, and print the
+	// frame time percentiles and the profiler counters, for
+	// each depth pre-pass mode when they are compared - this
+	// needs the OpenGL context of the window
+	static int RunSceneBenchmark(
+		const SCENE_BENCHMARK_SETTINGS& settings,
+		GLFWwindow* pWindow,
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		FrameProfiler* pProfiler);
+};
@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ============
+// record and play back a smooth camera path through the 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// a point on the Catmull-Rom curve between p1 and p2
+	glm::vec3 CatmullRom(
+		const glm::vec3& p0,
+		const glm::vec3& p1,
+		const glm::vec3& p2,
+		const glm::vec3& p3,
+		float t)
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+
+		return(0.5f * ((2.0f * p1) +
+			(p2 - p0) * t +
+			(2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+			(3.0f * p1 - p0 - 3.0f * p2 + p3) * t3));
+	}
+
+	// keys are ordered by their time
+	bool CompareKeys(const CameraPath::CAMERA_KEY& a, const CameraPath::CAMERA_KEY& b)
+	{
+		return(a.time < b.time);
+	}
+}
+
+/***********************************************************
+ *  CameraPath()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPath::CameraPath()
+{
+}
+
+/***********************************************************
+ *  ~CameraPath()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraPath::~CameraPath()
+{
+	m_keys.clear();
+}
+
+/***********************************************************
+ *  AddKey()
+ *
+ *  This method is used for adding a key to the path.
+ ***********************************************************/
+void CameraPath::AddKey(float time, glm::vec3 position, glm::vec3 front)
+{
+	CAMERA_KEY key;
+	key.time = time;
+	key.position = position;
+	key.front = glm::normalize(front);
+
+	m_keys.push_back(key);
+	if ((m_keys.size() > 1) && (m_keys[m_keys.size() - 2].time > time))
+	{
+		std::stable_sort(m_keys.begin(), m_keys.end(), CompareKeys);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the keys.
+ ***********************************************************/
+void CameraPath::Clear()
+{
+	m_keys.clear();
+}
+
+/***********************************************************
+ *  GetKeyCount()
+ *
+ *  This method is used for getting the number of keys.
+ ***********************************************************/
+int CameraPath::GetKeyCount() const
+{
+	return((int)m_keys.size());
+}
+
+/***********************************************************
+ *  GetDuration()
+ *
+ *  This method is used for getting the time of the last key.
+ ***********************************************************/
+float CameraPath::GetDuration() const
+{
+	return((m_keys.size() > 0) ? m_keys.back().time : 0.0f);
+}
+
+/***********************************************************
+ *  Evaluate()
+ *
+ *  This method is used for getting the camera at a time on
+ *  the path.  The two keys around the time and one key on
+ *  either side of them shape the curve, and the end keys
+ *  are repeated at the ends of the path.  The direction is
+ *  blended the same way and normalized again.
+ ***********************************************************/
+bool CameraPath::Evaluate(float time, glm::vec3& position, glm::vec3& front) const
+{
+	if (m_keys.size() == 0)
+	{
+		return(false);
+	}
+
+	int lastKey = (int)m_keys.size() - 1;
+	if ((lastKey == 0) || (time <= m_keys[0].time))
+	{
+		position = m_keys[0].position;
+		front = m_keys[0].front;
+		return(true);
+	}
+	if (time >= m_keys[lastKey].time)
+	{
+		position = m_keys[lastKey].position;
+		front = m_keys[lastKey].front;
+		return(true);
+	}
+
+	// the key the time comes after
+	int key = 0;
+	while ((key < lastKey - 1) && (m_keys[key + 1].time <= time))
+	{
+		key++;
+	}
+
+	const CAMERA_KEY& k0 = m_keys[std::max(key - 1, 0)];
+	const CAMERA_KEY& k1 = m_keys[key];
+	const CAMERA_KEY& k2 = m_keys[key + 1];
+	const CAMERA_KEY& k3 = m_keys[std::min(key + 2, lastKey)];
+	float span = k2.time - k1.time;
+	float t = (span > 0.0f) ? (time - k1.time) / span : 0.0f;
+
+	position = CatmullRom(k0.position, k1.position, k2.position, k3.position, t);
+	front = CatmullRom(k0.front, k1.front, k2.front, k3.front, t);
+	if (glm::length(front) < 0.0001f)
+	{
+		front = k1.front;
+	}
+	front = glm::normalize(front);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateOrbit()
+ *
+ *  This method is used for building a path that circles a
+ *  point once while looking at it.  The first key is added
+ *  again at the end so the circle is closed.
+ ***********************************************************/
+void CameraPath::CreateOrbit(
+	glm::vec3 center,
+	float radius,
+	float height,
+	float duration,
+	int keyCount)
+{
+	m_keys.clear();
+	keyCount = std::max(keyCount, 4);
+
+	for (int i = 0; i <= keyCount; i++)
+	{
+		float angle = 6.2831853f * (float)i / (float)keyCount;
+		glm::vec3 position = center + glm::vec3(cosf(angle) * radius, height, sinf(angle) * radius);
+
+		AddKey(duration * (float)i / (float)keyCount, position, center - position);
+	}
+}
+
+/***********************************************************
+ *  SaveToFile()
+ *
+ *  This method is used for saving the keys into a text file
+ *  with one "time px py pz fx fy fz" key on each line.
+ ***********************************************************/
+bool CameraPath::SaveToFile(const char* filePath) const
+{
+	std::ofstream pathFile(filePath, std::ios::out | std::ios::trunc);
+
+	if (pathFile.is_open() == false)
+	{
+		std::cout << "Could not write the camera path:" << filePath << std::endl;
+		return(false);
+	}
+
+	pathFile << "# time px py pz fx fy fz\n";
+	for (size_t i = 0; i < m_keys.size(); i++)
+	{
+		const CAMERA_KEY& key = m_keys[i];
+		pathFile << key.time << " "
+			<< key.position.x << " " << key.position.y << " " << key.position.z << " "
+			<< key.front.x << " " << key.front.y << " " << key.front.z << "\n";
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadFromFile()
+ *
+ *  This method is used for loading the keys from a text
+ *  file that was saved with SaveToFile().  Empty lines and
+ *  lines that start with # are skipped.
+ ***********************************************************/
+bool CameraPath::LoadFromFile(const char* filePath)
+{
+	std::ifstream pathFile(filePath);
+
+	if (pathFile.is_open() == false)
+	{
+		std::cout << "Could not read the camera path:" << filePath << std::endl;
+		return(false);
+	}
+
+	m_keys.clear();
+
+	std::string line;
+	while (std::getline(pathFile, line))
+	{
+		if ((line.size() == 0) || (line[0] == '#'))
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		float time = 0.0f;
+		glm::vec3 position(0.0f);
+		glm::vec3 front(0.0f);
+
+		if (values >> time >> position.x >> position.y >> position.z >> front.x >> front.y >> front.z)
+		{
+			AddKey(time, position, front);
+		}
+	}
+
+	return(m_keys.size() > 0);
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// record and play back a smooth camera path through the 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class holds a list of camera keys - a time, a
+ *  position and a view direction - and plays them back as a
+ *  Catmull-Rom spline that passes through every key.  The
+ *  same path and the same times always give the same
+ *  camera, so a benchmark that follows a path renders the
+ *  same frames on every run.  Paths are saved as text with
+ *  one key per line.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// constructor
+	CameraPath();
+	// destructor
+	~CameraPath();
+
+	struct CAMERA_KEY
+	{
+		// seconds from the start of the path
+		float time;
+		glm::vec3 position;
+		glm::vec3 front;
+	};
+
+private:
+	// the keys, sorted by time
+	std::vector<CAMERA_KEY> m_keys;
+
+public:
+	// add a key - keys that are added out of order are sorted
+	void AddKey(float time, glm::vec3 position, glm::vec3 front);
+	// remove all of the keys
+	void Clear();
+	int GetKeyCount() const;
+	// the time of the last key
+	float GetDuration() const;
+
+	// get the camera at a time on the path - times outside of
+	// the path are held at the first or the last key
+	bool Evaluate(float time, glm::vec3& position, glm::vec3& front) const;
+
+	// build a closed circle around a point that looks at it
+	void CreateOrbit(
+		glm::vec3 center,
+		float radius,
+		float height,
+		float duration,
+		int keyCount);
+
+	// save the keys to a text file and load them again
+	bool SaveToFile(const char* filePath) const;
+	bool LoadFromFile(const char* filePath);
+};
@@ -0,0 +1,301 @@
+///////////////////////////////////////////////////////////////////////////////
+// ddstexture.cpp
+// ============
+// read and write block compressed textures in the DDS file format
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DDSTexture.h"
+
+#include <cstring>
+#include <fstream>
+
+// declaration of the DDS file layout
+namespace
+{
+	const uint32_t DDS_MAGIC = 0x20534444;  // "DDS "
+
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+	const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+	const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+	const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+	const uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+	struct DDS_PIXELFORMAT
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDS_HEADER
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDS_PIXELFORMAT pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDS_HEADER_DXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DDS_HEADER) == 124, "DDS_HEADER must match the file layout");
+	static_assert(sizeof(DDS_HEADER_DXT10) == 20, "DDS_HEADER_DXT10 must match the file layout");
+
+	uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return((uint32_t)(unsigned char)a |
+			((uint32_t)(unsigned char)b << 8) |
+			((uint32_t)(unsigned char)c << 16) |
+			((uint32_t)(unsigned char)d << 24));
+	}
+}
+
+/***********************************************************
+ *  GetBlockBytes()
+ *
+ *  This method is used for getting the number of bytes in
+ *  one 4x4 block of the passed in format.
+ ***********************************************************/
+int DDSTexture::GetBlockBytes(DDS_FORMAT format)
+{
+	switch (format)
+	{
+	case DDS_FORMAT_BC1:
+		return(8);
+	case DDS_FORMAT_BC3:
+	case DDS_FORMAT_BC7:
+		return(16);
+	default:
+		return(0);
+	}
+}
+
+/***********************************************************
+ *  GetLevelSize()
+ *
+ *  This method is used for getting the number of bytes in
+ *  one level of the passed in format and size.  Levels
+ *  smaller than a block still take up a whole block.
+ ***********************************************************/
+size_t DDSTexture::GetLevelSize(DDS_FORMAT format, int width, int height)
+{
+	size_t blocksWide = (size_t)((width + 3) / 4);
+	size_t blocksHigh = (size_t)((height + 3) / 4);
+
+	if (blocksWide < 1)
+	{
+		blocksWide = 1;
+	}
+	if (blocksHigh < 1)
+	{
+		blocksHigh = 1;
+	}
+
+	return(blocksWide * blocksHigh * GetBlockBytes(format));
+}
+
+/***********************************************************
+ *  CalculateLevels()
+ *
+ *  This method is used for working out where each level is
+ *  stored in the data of the image.  The total number of
+ *  data bytes is returned.
+ ***********************************************************/
+size_t DDSTexture::CalculateLevels(DDS_IMAGE& image)
+{
+	size_t offset = 0;
+	int width = image.width;
+	int height = image.height;
+
+	for (int i = 0; i < image.mipCount; i++)
+	{
+		image.levelOffsets[i] = offset;
+		image.levelSizes[i] = GetLevelSize(image.format, width, height);
+		offset += image.levelSizes[i];
+
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+
+	return(offset);
+}
+
+/***********************************************************
+ *  LoadFile()
+ *
+ *  This method is used for reading a DDS file into the
+ *  passed in image.
+ ***********************************************************/
+bool DDSTexture::LoadFile(const std::string& filename, DDS_IMAGE& image)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	DDS_HEADER header;
+	bool bReturn = false;
+
+	image.format = DDS_FORMAT_UNKNOWN;
+	if (file.read((char*)&magic, sizeof(magic)) &&
+		(magic == DDS_MAGIC) &&
+		file.read((char*)&header, sizeof(header)) &&
+		(header.size == sizeof(DDS_HEADER)) &&
+		((header.pixelFormat.flags & DDPF_FOURCC) != 0))
+	{
+		if (header.pixelFormat.fourCC == MakeFourCC('D', 'X', 'T', '1'))
+		{
+			image.format = DDS_FORMAT_BC1;
+		}
+		else if (header.pixelFormat.fourCC == MakeFourCC('D', 'X', 'T', '5'))
+		{
+			image.format = DDS_FORMAT_BC3;
+		}
+		else if (header.pixelFormat.fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			DDS_HEADER_DXT10 extended;
+
+			if (file.read((char*)&extended, sizeof(extended)) &&
+				(extended.resourceDimension == D3D10_RESOURCE_DIMENSION_TEXTURE2D) &&
+				(extended.arraySize <= 1))
+			{
+				if (extended.dxgiFormat == DXGI_FORMAT_BC1_UNORM)
+				{
+					image.format = DDS_FORMAT_BC1;
+				}
+				else if (extended.dxgiFormat == DXGI_FORMAT_BC3_UNORM)
+				{
+					image.format = DDS_FORMAT_BC3;
+				}
+				else if (extended.dxgiFormat == DXGI_FORMAT_BC7_UNORM)
+				{
+					image.format = DDS_FORMAT_BC7;
+				}
+			}
+		}
+	}
+
+	if ((image.format != DDS_FORMAT_UNKNOWN) &&
+		(header.width > 0) && (header.height > 0))
+	{
+		image.width = (int)header.width;
+		image.height = (int)header.height;
+		image.mipCount = 1;
+		if (((header.flags & DDSD_MIPMAPCOUNT) != 0) && (header.mipMapCount > 1))
+		{
+			image.mipCount = (int)header.mipMapCount;
+		}
+		if (image.mipCount > MAX_MIP_LEVELS)
+		{
+			image.mipCount = MAX_MIP_LEVELS;
+		}
+
+		size_t dataSize = CalculateLevels(image);
+
+		image.data.resize(dataSize);
+		bReturn = (bool)file.read((char*)image.data.data(), (std::streamsize)dataSize);
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  WriteFile()
+ *
+ *  This method is used for writing the passed in image into
+ *  a DDS file.  BC7 images are written with the extended
+ *  DX10 header, since it has no legacy four character code.
+ ***********************************************************/
+bool DDSTexture::WriteFile(const std::string& filename, const DDS_IMAGE& image)
+{
+	DDS_HEADER header;
+	DDS_HEADER_DXT10 extended;
+
+	memset(&header, 0, sizeof(header));
+	memset(&extended, 0, sizeof(extended));
+
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE;
+	header.height = (uint32_t)image.height;
+	header.width = (uint32_t)image.width;
+	header.pitchOrLinearSize = (uint32_t)GetLevelSize(image.format, image.width, image.height);
+	header.mipMapCount = (uint32_t)image.mipCount;
+	header.pixelFormat.size = sizeof(DDS_PIXELFORMAT);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	header.caps = DDSCAPS_TEXTURE;
+	if (image.mipCount > 1)
+	{
+		header.flags |= DDSD_MIPMAPCOUNT;
+		header.caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+	}
+
+	switch (image.format)
+	{
+	case DDS_FORMAT_BC1:
+		header.pixelFormat.fourCC = MakeFourCC('D', 'X', 'T', '1');
+		break;
+	case DDS_FORMAT_BC3:
+		header.pixelFormat.fourCC = MakeFourCC('D', 'X', 'T', '5');
+		break;
+	case DDS_FORMAT_BC7:
+		header.pixelFormat.fourCC = MakeFourCC('D', 'X', '1', '0');
+		extended.dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+		extended.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+		extended.arraySize = 1;
+		break;
+	default:
+		return(false);
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return(false);
+	}
+
+	file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+	file.write((const char*)&header, sizeof(header));
+	if (image.format == DDS_FORMAT_BC7)
+	{
+		file.write((const char*)&extended, sizeof(extended));
+	}
+	if (image.data.empty() == false)
+	{
+		file.write((const char*)image.data.data(), (std::streamsize)image.data.size());
+	}
+
+	return((bool)file);
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// ddstexture.h
+// ============
+// read and write block compressed textures in the DDS file format
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  DDSTexture
+ *
+ *  This class reads and writes block compressed textures,
+ *  with all of their mip levels, in the DDS file format.
+ *  BC1 and BC3 are stored with the legacy DXT1 and DXT5
+ *  headers, and BC7 with the extended DX10 header.  The
+ *  textures written by the texture cooker store the bottom
+ *  row of each image first, which is the order OpenGL
+ *  expects, so the levels can be uploaded without flipping.
+ ***********************************************************/
+class DDSTexture
+{
+public:
+	// the supported block compression formats
+	enum DDS_FORMAT
+	{
+		DDS_FORMAT_UNKNOWN,
+		// RGB with 1 bit alpha, 8 bytes per 4x4 block
+		DDS_FORMAT_BC1,
+		// RGBA with interpolated alpha, 16 bytes per 4x4 block
+		DDS_FORMAT_BC3,
+		// high quality RGBA, 16 bytes per 4x4 block
+		DDS_FORMAT_BC7
+	};
+
+	// the largest number of mip levels in a texture
+	static const int MAX_MIP_LEVELS = 16;
+
+	struct DDS_IMAGE
+	{
+		DDS_FORMAT format;
+		int width;
+		int height;
+		int mipCount;
+		// byte offset and size of each level in the data
+		size_t levelOffsets[MAX_MIP_LEVELS];
+		size_t levelSizes[MAX_MIP_LEVELS];
+		// the compressed blocks of all of the levels
+		std::vector<unsigned char> data;
+	};
+
+	// read a DDS file - returns false when the file is
+	// missing or holds a format that is not supported
+	static bool LoadFile(const std::string& filename, DDS_IMAGE& image);
+	// write a DDS file
+	static bool WriteFile(const std::string& filename, const DDS_IMAGE& image);
+
+	// the number of bytes in one 4x4 block of a format
+	static int GetBlockBytes(DDS_FORMAT format);
+	// the number of bytes in one level of a format
+	static size_t GetLevelSize(DDS_FORMAT format, int width, int height);
+	// work out the offsets and sizes of all of the levels
+	// from the format, size and number of levels
+	static size_t CalculateLevels(DDS_IMAGE& image);
+};
@@ -0,0 +1,753 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// measure where the time of each frame goes on the CPU and on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+#include "MemoryArena.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the frame time that fills the whole width of the overlay
+	const double g_OverlayBudget = 1000.0 / 30.0;
+	// the frame time of a 60 Hz display, marked on the overlay
+	const double g_OverlayTarget = 1000.0 / 60.0;
+	// the size of the overlay bars in pixels
+	const int g_OverlayMargin = 8;
+	const int g_OverlayBarHeight = 10;
+
+	// the colors the scopes and passes are drawn in
+	const float g_OverlayColors[][3] =
+	{
+		{ 0.90f, 0.30f, 0.25f },
+		{ 0.25f, 0.70f, 0.30f },
+		{ 0.25f, 0.45f, 0.90f },
+		{ 0.95f, 0.75f, 0.20f },
+		{ 0.70f, 0.35f, 0.85f },
+		{ 0.20f, 0.80f, 0.80f }
+	};
+	const int g_OverlayColorCount = sizeof(g_OverlayColors) / sizeof(g_OverlayColors[0]);
+
+	// the names of the counters in the trace file
+	const char* g_CounterNames[FrameProfiler::COUNTER_COUNT] =
+	{
+		"drawCalls",
+		"triangles",
+		"uniformUploads",
+		"textureBinds",
+		"heapAllocations",
+		"arenaBytes",
+		"uploadBytes"
+	};
+
+	// fill a rectangle of the viewport with a color - the
+	// scissor test needs to be enabled
+	void FillRect(int x, int y, int width, int height, float red, float green, float blue)
+	{
+		if ((width <= 0) || (height <= 0))
+		{
+			return;
+		}
+
+		glScissor(x, y, width, height);
+		glClearColor(red, green, blue, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+}
+
+FrameProfiler* FrameProfiler::s_pActive = NULL;
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	m_startClock = std::chrono::steady_clock::now();
+	m_frameIndex = 0;
+	m_bInFrame = false;
+	m_frameStartAllocations = 0;
+	m_currentFrame = FRAME_STATS();
+	m_lastFrame = FRAME_STATS();
+	m_lastFrame.gpuTime = -1.0;
+	m_lastGpuTime = -1.0;
+
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		m_queryFrames[i] = QUERY_FRAME();
+	}
+	m_bQueriesCreated = false;
+	m_bGpuPassOpen = false;
+
+	m_traceFramesLeft = 0;
+	m_bTracing = false;
+	m_bOverlayVisible = false;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	if (m_bTracing == true)
+	{
+		StopTrace();
+	}
+	if (s_pActive == this)
+	{
+		s_pActive = NULL;
+	}
+}
+
+/***********************************************************
+ *  MakeActive()
+ *
+ *  This method is used for making this the profiler that
+ *  the scopes and the counters report to.
+ ***********************************************************/
+void FrameProfiler::MakeActive()
+{
+	s_pActive = this;
+}
+
+/***********************************************************
+ *  GetActive()
+ *
+ *  This method is used for getting the active profiler, or
+ *  NULL when there is none.
+ ***********************************************************/
+FrameProfiler* FrameProfiler::GetActive()
+{
+	return(s_pActive);
+}
+
+/***********************************************************
+ *  CreateQueries()
+ *
+ *  This method is used for creating the timer queries of
+ *  the frames in flight.
+ ***********************************************************/
+void FrameProfiler::CreateQueries()
+{
+	if (m_bQueriesCreated == true)
+	{
+		return;
+	}
+
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		glGenQueries(MAX_GPU_PASSES, m_queryFrames[i].queries);
+		m_queryFrames[i].passCount = 0;
+	}
+	m_bQueriesCreated = true;
+}
+
+/***********************************************************
+ *  DestroyQueries()
+ *
+ *  This method is used for freeing the timer queries.
+ ***********************************************************/
+void FrameProfiler::DestroyQueries()
+{
+	if (m_bQueriesCreated == false)
+	{
+		return;
+	}
+
+	for (int i = 0; i < QUERY_FRAMES; i++)
+	{
+		glDeleteQueries(MAX_GPU_PASSES, m_queryFrames[i].queries);
+		m_queryFrames[i].passCount = 0;
+	}
+	m_bQueriesCreated = false;
+}
+
+/***********************************************************
+ *  GetTime()
+ *
+ *  This method is used for getting the number of
+ *  milliseconds since the profiler was created.
+ ***********************************************************/
+double FrameProfiler::GetTime() const
+{
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::steady_clock::now() - m_startClock;
+
+	return(elapsed.count());
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the recording of a
+ *  frame.  The queries that were submitted the last time
+ *  this set of queries was used are read first, which is
+ *  two frames ago, so the GPU is normally done with them.
+ *  Results that are still not ready are dropped instead of
+ *  waiting for them.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	QUERY_FRAME& queryFrame = m_queryFrames[m_frameIndex % QUERY_FRAMES];
+
+	if ((m_bQueriesCreated == true) && (queryFrame.passCount > 0))
+	{
+		ResolveQueries(queryFrame);
+	}
+	queryFrame.passCount = 0;
+	queryFrame.frameIndex = m_frameIndex;
+
+	m_currentFrame.frameIndex = m_frameIndex;
+	m_currentFrame.startTime = GetTime();
+	m_currentFrame.cpuTime = 0.0;
+	m_currentFrame.gpuTime = -1.0;
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		m_currentFrame.counters[i] = 0;
+	}
+	m_currentFrame.scopes.clear();
+	m_currentFrame.gpuPasses.clear();
+	m_openScopes.clear();
+
+	m_frameStartAllocations = HeapCounter::GetAllocationCount();
+	m_bInFrame = true;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the recording of a
+ *  frame.  Any scope or pass that is still open is closed.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	if (m_bInFrame == false)
+	{
+		return;
+	}
+
+	EndGpuPass();
+	while (m_openScopes.size() > 0)
+	{
+		EndScope(m_openScopes.back());
+	}
+
+	m_currentFrame.cpuTime = GetTime() - m_currentFrame.startTime;
+	m_currentFrame.counters[COUNTER_HEAP_ALLOCATIONS] =
+		(int)(HeapCounter::GetAllocationCount() - m_frameStartAllocations);
+	m_currentFrame.gpuPasses = m_lastGpuPasses;
+	m_currentFrame.gpuTime = m_lastGpuTime;
+	m_lastFrame = m_currentFrame;
+	m_bInFrame = false;
+
+	if (m_bTracing == true)
+	{
+		TraceFrame(m_lastFrame);
+		m_traceFramesLeft--;
+		if (m_traceFramesLeft <= 0)
+		{
+			StopTrace();
+		}
+	}
+
+	m_frameIndex++;
+}
+
+/***********************************************************
+ *  BeginScope()
+ *
+ *  This method is used for starting a CPU scope.  The name
+ *  is kept as a pointer, so it needs to be a string that
+ *  stays valid, such as a string literal.
+ ***********************************************************/
+int FrameProfiler::BeginScope(const char* name)
+{
+	if (m_bInFrame == false)
+	{
+		return(-1);
+	}
+
+	CPU_SCOPE scope;
+	scope.name = name;
+	scope.startTime = GetTime();
+	scope.duration = 0.0;
+	scope.depth = (int)m_openScopes.size();
+
+	m_currentFrame.scopes.push_back(scope);
+	m_openScopes.push_back((int)m_currentFrame.scopes.size() - 1);
+
+	return((int)m_currentFrame.scopes.size() - 1);
+}
+
+/***********************************************************
+ *  EndScope()
+ *
+ *  This method is used for ending a CPU scope.  Scopes that
+ *  were started inside of it and are still open are ended
+ *  along with it.
+ ***********************************************************/
+void FrameProfiler::EndScope(int scopeIndex)
+{
+	if ((m_bInFrame == false) ||
+		(scopeIndex < 0) ||
+		(scopeIndex >= (int)m_currentFrame.scopes.size()))
+	{
+		return;
+	}
+
+	double endTime = GetTime();
+
+	while (m_openScopes.size() > 0)
+	{
+		int openIndex = m_openScopes.back();
+		CPU_SCOPE& scope = m_currentFrame.scopes[openIndex];
+
+		scope.duration = endTime - scope.startTime;
+		m_openScopes.pop_back();
+		if (openIndex == scopeIndex)
+		{
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginGpuPass()
+ *
+ *  This method is used for starting the timer query of a
+ *  GPU pass.  Only one GL_TIME_ELAPSED query can be active,
+ *  so an open pass is ended first.
+ ***********************************************************/
+void FrameProfiler::BeginGpuPass(const char* name)
+{
+	if ((m_bInFrame == false) || (m_bQueriesCreated == false))
+	{
+		return;
+	}
+
+	EndGpuPass();
+
+	QUERY_FRAME& queryFrame = m_queryFrames[m_frameIndex % QUERY_FRAMES];
+	if (queryFrame.passCount >= MAX_GPU_PASSES)
+	{
+		return;
+	}
+
+	GPU_PASS& pass = queryFrame.passes[queryFrame.passCount];
+	pass.name = name;
+	pass.submitTime = GetTime();
+	pass.duration = 0.0;
+
+	glBeginQuery(GL_TIME_ELAPSED, queryFrame.queries[queryFrame.passCount]);
+	m_bGpuPassOpen = true;
+}
+
+/***********************************************************
+ *  EndGpuPass()
+ *
+ *  This method is used for ending the open GPU pass.
+ ***********************************************************/
+void FrameProfiler::EndGpuPass()
+{
+	if (m_bGpuPassOpen == false)
+	{
+		return;
+	}
+
+	QUERY_FRAME& queryFrame = m_queryFrames[m_frameIndex % QUERY_FRAMES];
+
+	glEndQuery(GL_TIME_ELAPSED);
+	queryFrame.passCount++;
+	m_bGpuPassOpen = false;
+}
+
+/***********************************************************
+ *  ResolveQueries()
+ *
+ *  This method is used for reading the GPU times of the
+ *  passes of an earlier frame.  The queries finish in
+ *  order, so when the last one is ready all of them are.
+ ***********************************************************/
+void FrameProfiler::ResolveQueries(QUERY_FRAME& queryFrame)
+{
+	GLint available = 0;
+
+	glGetQueryObjectiv(queryFrame.queries[queryFrame.passCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0)
+	{
+		return;
+	}
+
+	m_lastGpuPasses.clear();
+	m_lastGpuTime = 0.0;
+	for (int i = 0; i < queryFrame.passCount; i++)
+	{
+		GLuint64 elapsed = 0;
+
+		glGetQueryObjectui64v(queryFrame.queries[i], GL_QUERY_RESULT, &elapsed);
+		queryFrame.passes[i].duration = (double)elapsed / 1000000.0;
+		m_lastGpuPasses.push_back(queryFrame.passes[i]);
+		m_lastGpuTime += queryFrame.passes[i].duration;
+	}
+
+	if (m_bTracing == true)
+	{
+		TraceGpuPasses(queryFrame);
+	}
+}
+
+/***********************************************************
+ *  AddCount()
+ *
+ *  This method is used for adding to a counter of the frame
+ *  the active profiler is recording.
+ ***********************************************************/
+void FrameProfiler::AddCount(COUNTER counter, int amount)
+{
+	if ((NULL != s_pActive) && (s_pActive->m_bInFrame == true))
+	{
+		s_pActive->m_currentFrame.counters[counter] += amount;
+	}
+}
+
+/***********************************************************
+ *  GetLastFrame()
+ *
+ *  This method is used for getting the last finished frame.
+ ***********************************************************/
+const FrameProfiler::FRAME_STATS& FrameProfiler::GetLastFrame() const
+{
+	return(m_lastFrame);
+}
+
+/***********************************************************
+ *  GetSummary()
+ *
+ *  This method is used for getting a single line summary of
+ *  the last finished frame.
+ ***********************************************************/
+std::string FrameProfiler::GetSummary() const
+{
+	char summary[256];
+
+	snprintf(
+		summary,
+		sizeof(summary),
+		"CPU %.2f ms | GPU %.2f ms | %d draws | %d tris | %d uniforms | %d binds | %d allocs",
+		m_lastFrame.cpuTime,
+		(m_lastFrame.gpuTime >= 0.0) ? m_lastFrame.gpuTime : 0.0,
+		m_lastFrame.counters[COUNTER_DRAW_CALLS],
+		m_lastFrame.counters[COUNTER_TRIANGLES],
+		m_lastFrame.counters[COUNTER_UNIFORM_UPLOADS],
+		m_lastFrame.counters[COUNTER_TEXTURE_BINDS],
+		m_lastFrame.counters[COUNTER_HEAP_ALLOCATIONS]);
+
+	return(std::string(summary));
+}
+
+/***********************************************************
+ *  StartTrace()
+ *
+ *  This method is used for starting the capture of a number
+ *  of frames into a Chrome trace file.  The CPU scopes and
+ *  the GPU passes are shown on separate rows, and the
+ *  counters are shown as graphs.
+ ***********************************************************/
+bool FrameProfiler::StartTrace(const char* filePath, int frameCount)
+{
+	if ((NULL == filePath) || (frameCount <= 0))
+	{
+		return(false);
+	}
+
+	m_traceFile = filePath;
+	m_traceFramesLeft = frameCount;
+	m_traceEvents =
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	m_bTracing = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopTrace()
+ *
+ *  This method is used for writing the captured frames into
+ *  the trace file.
+ ***********************************************************/
+void FrameProfiler::StopTrace()
+{
+	if (m_bTracing == false)
+	{
+		return;
+	}
+
+	m_bTracing = false;
+
+	std::ofstream traceFile(m_traceFile.c_str(), std::ios::out | std::ios::trunc);
+	if (traceFile.is_open() == false)
+	{
+		std::cout << "Could not write the trace file:" << m_traceFile << std::endl;
+		return;
+	}
+
+	traceFile << "{\"traceEvents\":[\n" << m_traceEvents << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	traceFile.close();
+	m_traceEvents.clear();
+
+	std::cout << "Wrote the trace file:" << m_traceFile << std::endl;
+}
+
+/***********************************************************
+ *  IsTracing()
+ *
+ *  This method is used for checking whether frames are being
+ *  captured into a trace file.
+ ***********************************************************/
+bool FrameProfiler::IsTracing() const
+{
+	return(m_bTracing);
+}
+
+/***********************************************************
+ *  AddTraceEvent()
+ *
+ *  This method is used for adding a complete event to the
+ *  trace.  The trace times are in microseconds.
+ ***********************************************************/
+void FrameProfiler::AddTraceEvent(
+	const char* name,
+	const char* category,
+	int threadID,
+	double startTime,
+	double duration)
+{
+	char event[256];
+
+	snprintf(
+		event,
+		sizeof(event),
+		",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+		name,
+		category,
+		threadID,
+		startTime * 1000.0,
+		duration * 1000.0);
+	m_traceEvents += event;
+}
+
+/***********************************************************
+ *  TraceFrame()
+ *
+ *  This method is used for adding the CPU scopes and the
+ *  counters of a finished frame to the trace.
+ ***********************************************************/
+void FrameProfiler::TraceFrame(const FRAME_STATS& frame)
+{
+	AddTraceEvent("Frame", "frame", 1, frame.startTime, frame.cpuTime);
+	for (size_t i = 0; i < frame.scopes.size(); i++)
+	{
+		const CPU_SCOPE& scope = frame.scopes[i];
+		AddTraceEvent(scope.name, "cpu", 1, scope.startTime, scope.duration);
+	}
+
+	char event[128];
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		snprintf(
+			event,
+			sizeof(event),
+			",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%d}}",
+			g_CounterNames[i],
+			frame.startTime * 1000.0,
+			frame.counters[i]);
+		m_traceEvents += event;
+	}
+}
+
+/***********************************************************
+ *  TraceGpuPasses()
+ *
+ *  This method is used for adding the GPU passes of a frame
+ *  to the trace.  The queries only measure how long each
+ *  pass took, so the passes are placed one after another
+ *  from the time the first one was submitted.
+ ***********************************************************/
+void FrameProfiler::TraceGpuPasses(const QUERY_FRAME& queryFrame)
+{
+	double startTime = (queryFrame.passCount > 0) ? queryFrame.passes[0].submitTime : 0.0;
+
+	for (int i = 0; i < queryFrame.passCount; i++)
+	{
+		const GPU_PASS& pass = queryFrame.passes[i];
+
+		startTime = (pass.submitTime > startTime) ? pass.submitTime : startTime;
+		AddTraceEvent(pass.name, "gpu", 2, startTime, pass.duration);
+		startTime += pass.duration;
+	}
+}
+
+/***********************************************************
+ *  SetOverlayVisible()
+ *
+ *  This method is used for showing or hiding the overlay.
+ ***********************************************************/
+void FrameProfiler::SetOverlayVisible(bool bVisible)
+{
+	m_bOverlayVisible = bVisible;
+}
+
+/***********************************************************
+ *  IsOverlayVisible()
+ *
+ *  This method is used for checking whether the overlay is
+ *  shown.
+ ***********************************************************/
+bool FrameProfiler::IsOverlayVisible() const
+{
+	return(m_bOverlayVisible);
+}
+
+/***********************************************************
+ *  DrawOverlay()
+ *
+ *  This method is used for drawing the last frame as two
+ *  bars at the top of the viewport - the top level CPU
+ *  scopes above and the GPU passes below.  The full width
+ *  of the bars is a 30 Hz frame and the white marks show a
+ *  60 Hz frame.  The bars are drawn with scissored clears,
+ *  so no shader or vertex state is touched.
+ ***********************************************************/
+void FrameProfiler::DrawOverlay()
+{
+	if (m_bOverlayVisible == false)
+	{
+		return;
+	}
+
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	GLboolean bScissorEnabled = glIsEnabled(GL_SCISSOR_TEST);
+
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glEnable(GL_SCISSOR_TEST);
+
+	int left = viewport[0] + g_OverlayMargin;
+	int width = viewport[2] - g_OverlayMargin * 2;
+	int cpuTop = viewport[1] + viewport[3] - g_OverlayMargin - g_OverlayBarHeight;
+	int gpuTop = cpuTop - g_OverlayBarHeight - 2;
+	double scale = (double)width / g_OverlayBudget;
+
+	FillRect(left, gpuTop, width, g_OverlayBarHeight * 2 + 2, 0.1f, 0.1f, 0.1f);
+
+	int colorIndex = 0;
+	for (size_t i = 0; i < m_lastFrame.scopes.size(); i++)
+	{
+		const CPU_SCOPE& scope = m_lastFrame.scopes[i];
+
+		if (scope.depth > 0)
+		{
+			continue;
+		}
+
+		const float* color = g_OverlayColors[colorIndex % g_OverlayColorCount];
+		int x = (int)((scope.startTime - m_lastFrame.startTime) * scale);
+		int barWidth = (int)(scope.duration * scale);
+
+		if (x < width)
+		{
+			FillRect(left + x, cpuTop, std::min(barWidth, width - x), g_OverlayBarHeight, color[0], color[1], color[2]);
+		}
+		colorIndex++;
+	}
+
+	int x = 0;
+	for (size_t i = 0; i < m_lastFrame.gpuPasses.size(); i++)
+	{
+		const float* color = g_OverlayColors[i % g_OverlayColorCount];
+		int barWidth = (int)(m_lastFrame.gpuPasses[i].duration * scale);
+
+		if (x < width)
+		{
+			FillRect(left + x, gpuTop, std::min(barWidth, width - x), g_OverlayBarHeight, color[0], color[1], color[2]);
+		}
+		x += barWidth;
+	}
+
+	FillRect(left + (int)(g_OverlayTarget * scale), gpuTop, 2, g_OverlayBarHeight * 2 + 2, 1.0f, 1.0f, 1.0f);
+
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+	if (bScissorEnabled == GL_FALSE)
+	{
+		glDisable(GL_SCISSOR_TEST);
+	}
+}
+
+/***********************************************************
+ *  ProfileScope()
+ *
+ *  The constructor for the class starts the scope.
+ ***********************************************************/
+ProfileScope::ProfileScope(const char* name)
+{
+	FrameProfiler* pProfiler = FrameProfiler::GetActive();
+
+	m_scopeIndex = (NULL != pProfiler) ? pProfiler->BeginScope(name) : -1;
+}
+
+/***********************************************************
+ *  ~ProfileScope()
+ *
+ *  The destructor for the class ends the scope.
+ ***********************************************************/
+ProfileScope::~ProfileScope()
+{
+	FrameProfiler* pProfiler = FrameProfiler::GetActive();
+
+	if ((NULL != pProfiler) && (m_scopeIndex >= 0))
+	{
+		pProfiler->EndScope(m_scopeIndex);
+	}
+}
+
+/***********************************************************
+ *  ProfileGpuScope()
+ *
+ *  The constructor for the class starts the GPU pass.
+ ***********************************************************/
+ProfileGpuScope::ProfileGpuScope(const char* name)
+{
+	FrameProfiler* pProfiler = FrameProfiler::GetActive();
+
+	if (NULL != pProfiler)
+	{
+		pProfiler->BeginGpuPass(name);
+	}
+}
+
+/***********************************************************
+ *  ~ProfileGpuScope()
+ *
+ *  The destructor for the class ends the GPU pass.
+ ***********************************************************/
+ProfileGpuScope::~ProfileGpuScope()
+{
+	FrameProfiler* pProfiler = FrameProfiler::GetActive();
+
+	if (NULL != pProfiler)
+	{
+		pProfiler->EndGpuPass();
+	}
+}
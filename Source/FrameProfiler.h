@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// measure where the time of each frame goes on the CPU and on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class records how long the named parts of each
+ *  frame take.  CPU scopes are timed with a steady clock
+ *  and may be nested.  GPU passes are timed with
+ *  GL_TIME_ELAPSED queries, which can not be nested, and
+ *  the queries of each frame are only read back two frames
+ *  later so that reading them never waits for the GPU.
+ *  Counters for draw calls, triangles, uniform uploads and
+ *  texture binds are added to from anywhere in the renderer,
+ *  and the heap allocations of each frame are counted.
+ *
+ *  The last frame is shown as a bar overlay at the top of
+ *  the window, and a number of frames can be captured into
+ *  a Chrome trace file that chrome://tracing or Perfetto
+ *  can open.  One profiler is made active, and the scopes
+ *  and counters report to it, so code that is not being
+ *  profiled costs next to nothing.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// the counters that are added to during each frame
+	enum COUNTER
+	{
+		COUNTER_DRAW_CALLS = 0,
+		COUNTER_TRIANGLES,
+		COUNTER_UNIFORM_UPLOADS,
+		COUNTER_TEXTURE_BINDS,
+		// the heap allocations every thread made during the
+		// frame, and the bytes taken from the frame arenas
+		COUNTER_HEAP_ALLOCATIONS,
+		COUNTER_ARENA_BYTES,
+		// the bytes written into GPU buffers during the frame
+		COUNTER_UPLOAD_BYTES,
+		COUNTER_COUNT
+	};
+
+	// the largest number of GPU passes in one frame
+	static const int MAX_GPU_PASSES = 8;
+	// the number of frames a GPU query is kept before it is read
+	static const int QUERY_FRAMES = 2;
+
+	// a timed CPU scope of a frame
+	struct CPU_SCOPE
+	{
+		const char* name;
+		// milliseconds since the profiler was created
+		double startTime;
+		double duration;
+		// the number of scopes this one is nested in
+		int depth;
+	};
+
+	// a timed GPU pass of a frame
+	struct GPU_PASS
+	{
+		const char* name;
+		// the CPU time the pass was submitted at
+		double submitTime;
+		double duration;
+	};
+
+	// everything that was recorded for a frame
+	struct FRAME_STATS
+	{
+		uint64_t frameIndex;
+		double startTime;
+		double cpuTime;
+		// the GPU time of all of the passes, or a negative
+		// value when the results were not read back
+		double gpuTime;
+		int counters[COUNTER_COUNT];
+		std::vector<CPU_SCOPE> scopes;
+		std::vector<GPU_PASS> gpuPasses;
+	};
+
+private:
+	// the GPU passes that were submitted in one frame
+	struct QUERY_FRAME
+	{
+		GLuint queries[MAX_GPU_PASSES];
+		GPU_PASS passes[MAX_GPU_PASSES];
+		int passCount;
+		uint64_t frameIndex;
+	};
+
+	// the profiler the scopes and counters report to
+	static FrameProfiler* s_pActive;
+
+	std::chrono::steady_clock::time_point m_startClock;
+	uint64_t m_frameIndex;
+	bool m_bInFrame;
+	// the heap allocations that were made before the frame
+	uint64_t m_frameStartAllocations;
+
+	// the frame being recorded, the last finished one, and the
+	// GPU passes of the last frame whose queries were read
+	FRAME_STATS m_currentFrame;
+	FRAME_STATS m_lastFrame;
+	std::vector<GPU_PASS> m_lastGpuPasses;
+	double m_lastGpuTime;
+	// the scopes that are open, by index into the frame scopes
+	std::vector<int> m_openScopes;
+
+	// the queries of the frames in flight
+	QUERY_FRAME m_queryFrames[QUERY_FRAMES];
+	bool m_bQueriesCreated;
+	bool m_bGpuPassOpen;
+
+	// the trace being captured, and the frames left to capture
+	std::string m_traceFile;
+	std::string m_traceEvents;
+	int m_traceFramesLeft;
+	bool m_bTracing;
+
+	bool m_bOverlayVisible;
+
+	// milliseconds since the profiler was created
+	double GetTime() const;
+	// read the GPU times of a frame that was submitted two
+	// frames ago
+	void ResolveQueries(QUERY_FRAME& queryFrame);
+	// add the events of a frame to the trace being captured
+	void TraceFrame(const FRAME_STATS& frame);
+	void TraceGpuPasses(const QUERY_FRAME& queryFrame);
+	void AddTraceEvent(
+		const char* name,
+		const char* category,
+		int threadID,
+		double startTime,
+		double duration);
+
+public:
+	// make this the profiler the scopes and counters report to
+	void MakeActive();
+	static FrameProfiler* GetActive();
+
+	// create and free the GPU timer queries - this needs an
+	// OpenGL context
+	void CreateQueries();
+	void DestroyQueries();
+
+	// start and finish the recording of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// start a CPU scope and return its index for ending it
+	int BeginScope(const char* name);
+	void EndScope(int scopeIndex);
+
+	// start and end a GPU pass - a pass that is still open
+	// is ended when the next one starts
+	void BeginGpuPass(const char* name);
+	void EndGpuPass();
+
+	// add to a counter of the active profiler, if there is one
+	static void AddCount(COUNTER counter, int amount);
+
+	// the last finished frame, with the GPU passes of the
+	// latest frame whose queries were read
+	const FRAME_STATS& GetLastFrame() const;
+	// a short text summary of the last frame
+	std::string GetSummary() const;
+
+	// capture the passed in number of frames into a Chrome
+	// trace file, which is written when they are done
+	bool StartTrace(const char* filePath, int frameCount);
+	void StopTrace();
+	bool IsTracing() const;
+
+	// show or hide the bar overlay
+	void SetOverlayVisible(bool bVisible);
+	bool IsOverlayVisible() const;
+	// draw the overlay of the last frame into the viewport
+	void DrawOverlay();
+};
+
+/***********************************************************
+ *  ProfileScope
+ *
+ *  This class times the CPU scope it is declared in for the
+ *  active profiler.
+ ***********************************************************/
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name);
+	~ProfileScope();
+
+private:
+	int m_scopeIndex;
+};
+
+/***********************************************************
+ *  ProfileGpuScope
+ *
+ *  This class times the GPU work that is submitted in the
+ *  scope it is declared in for the active profiler.  These
+ *  scopes can not be nested.
+ ***********************************************************/
+class ProfileGpuScope
+{
+public:
+	ProfileGpuScope(const char* name);
+	~ProfileGpuScope();
+};
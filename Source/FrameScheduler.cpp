@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+// framescheduler.cpp
+// ============
+// pace the frames of the main loop - fixed time step updates, vsync, frame cap
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameScheduler.h"
+#include "FrameProfiler.h"
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// the frame time is never counted as more than this, such
+	// as when the window was being dragged
+	const double g_MaxFrameTime = 0.25;
+	// the frame cap sleeps until this long before the frame is
+	// due, then yields, since sleeping can overshoot by about
+	// a scheduler tick
+	const double g_SleepMargin = 0.002;
+	// the longest wait for a frame fence, in nanoseconds
+	const GLuint64 g_FenceTimeout = 100000000;
+
+	// seconds between two clock times
+	double Seconds(
+		const std::chrono::steady_clock::time_point& start,
+		const std::chrono::steady_clock::time_point& end)
+	{
+		std::chrono::duration<double> elapsed = end - start;
+		return(elapsed.count());
+	}
+}
+
+/***********************************************************
+ *  FrameScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameScheduler::FrameScheduler()
+{
+	m_frameTime = 0.0;
+	m_accumulator = 0.0;
+	m_updateSteps = 0;
+	m_bStarted = false;
+	m_fenceCount = 0;
+
+	for (int i = 0; i <= MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		m_frameFences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~FrameScheduler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameScheduler::~FrameScheduler()
+{
+	// the fences are freed with DestroyFences() while the
+	// OpenGL context still exists
+	m_fenceCount = 0;
+}
+
+/***********************************************************
+ *  SetSettings()
+ *
+ *  This method is used for setting the scheduler settings.
+ *  The swap interval is applied to the OpenGL context that
+ *  is current.
+ ***********************************************************/
+void FrameScheduler::SetSettings(const SCHEDULER_SETTINGS& settings)
+{
+	m_settings = settings;
+	if (m_settings.fixedTimeStep <= 0.0f)
+	{
+		m_settings.fixedTimeStep = SCHEDULER_SETTINGS().fixedTimeStep;
+	}
+	if (m_settings.maxUpdateSteps < 1)
+	{
+		m_settings.maxUpdateSteps = 1;
+	}
+
+	glfwSwapInterval(m_settings.swapInterval);
+}
+
+/***********************************************************
+ *  GetSettings()
+ *
+ *  This method is used for getting the scheduler settings.
+ ***********************************************************/
+const FrameScheduler::SCHEDULER_SETTINGS& FrameScheduler::GetSettings() const
+{
+	return(m_settings);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame.  The time since
+ *  the last frame is added to the simulation time that is
+ *  still owed, and as many whole steps as fit are handed
+ *  out to this frame.  When more steps are owed than may
+ *  run in one frame, the rest are dropped so the loop can
+ *  catch up.
+ ***********************************************************/
+int FrameScheduler::BeginFrame()
+{
+	m_frameStart = std::chrono::steady_clock::now();
+
+	if (m_bStarted == false)
+	{
+		m_lastFrameStart = m_frameStart;
+		m_bStarted = true;
+	}
+
+	m_frameTime = Seconds(m_lastFrameStart, m_frameStart);
+	if (m_frameTime > g_MaxFrameTime)
+	{
+		m_frameTime = g_MaxFrameTime;
+	}
+	m_lastFrameStart = m_frameStart;
+	m_accumulator += m_frameTime;
+
+	double timeStep = (double)m_settings.fixedTimeStep;
+	m_updateSteps = 0;
+	while ((m_accumulator >= timeStep) && (m_updateSteps < m_settings.maxUpdateSteps))
+	{
+		m_accumulator -= timeStep;
+		m_updateSteps++;
+	}
+	if (m_accumulator >= timeStep)
+	{
+		m_accumulator = 0.0;
+	}
+
+	return(m_updateSteps);
+}
+
+/***********************************************************
+ *  GetUpdateStepCount()
+ *
+ *  This method is used for getting the number of simulation
+ *  steps of this frame.
+ ***********************************************************/
+int FrameScheduler::GetUpdateStepCount() const
+{
+	return(m_updateSteps);
+}
+
+/***********************************************************
+ *  GetFixedTimeStep()
+ *
+ *  This method is used for getting the length of each
+ *  simulation step in seconds.
+ ***********************************************************/
+float FrameScheduler::GetFixedTimeStep() const
+{
+	return(m_settings.fixedTimeStep);
+}
+
+/***********************************************************
+ *  GetInterpolation()
+ *
+ *  This method is used for getting how far the rendered
+ *  frame is between the last simulation step and the next.
+ ***********************************************************/
+float FrameScheduler::GetInterpolation() const
+{
+	return((float)(m_accumulator / (double)m_settings.fixedTimeStep));
+}
+
+/***********************************************************
+ *  GetFrameTime()
+ *
+ *  This method is used for getting the seconds between the
+ *  start of this frame and the start of the last one.
+ ***********************************************************/
+float FrameScheduler::GetFrameTime() const
+{
+	return((float)m_frameTime);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing a frame after the
+ *  buffers were swapped.  A fence is placed after the
+ *  commands of the frame, and the CPU waits on the oldest
+ *  fence once too many frames are in flight.  Then the
+ *  frame rate cap is waited for.
+ ***********************************************************/
+void FrameScheduler::EndFrame()
+{
+	int framesInFlight = (m_settings.bTripleBuffering == true) ? MAX_FRAMES_IN_FLIGHT : 1;
+
+	m_frameFences[m_fenceCount] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_fenceCount++;
+
+	{
+		ProfileScope scope("WaitForGPU");
+		while (m_fenceCount > framesInFlight)
+		{
+			WaitForOldestFence();
+		}
+	}
+
+	if (m_settings.maxFrameRate > 0.0f)
+	{
+		ProfileScope scope("FrameCap");
+		WaitForFrameCap();
+	}
+}
+
+/***********************************************************
+ *  WaitForOldestFence()
+ *
+ *  This method is used for waiting until the GPU has passed
+ *  the fence of the oldest frame in flight, and removing it.
+ ***********************************************************/
+void FrameScheduler::WaitForOldestFence()
+{
+	if (m_fenceCount == 0)
+	{
+		return;
+	}
+
+	if (NULL != m_frameFences[0])
+	{
+		glClientWaitSync(m_frameFences[0], GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		glDeleteSync(m_frameFences[0]);
+	}
+
+	for (int i = 1; i < m_fenceCount; i++)
+	{
+		m_frameFences[i - 1] = m_frameFences[i];
+	}
+	m_fenceCount--;
+	m_frameFences[m_fenceCount] = NULL;
+}
+
+/***********************************************************
+ *  WaitForFrameCap()
+ *
+ *  This method is used for waiting until the frame rate cap
+ *  allows the next frame to start.  Most of the wait is
+ *  spent asleep, and the last part yields the thread so the
+ *  frame does not start late.
+ ***********************************************************/
+void FrameScheduler::WaitForFrameCap()
+{
+	double targetTime = 1.0 / (double)m_settings.maxFrameRate;
+	double elapsed = Seconds(m_frameStart, std::chrono::steady_clock::now());
+
+	if (elapsed + g_SleepMargin < targetTime)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(targetTime - elapsed - g_SleepMargin));
+	}
+
+	while (Seconds(m_frameStart, std::chrono::steady_clock::now()) < targetTime)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  DestroyFences()
+ *
+ *  This method is used for freeing the fences of the frames
+ *  that are still in flight.
+ ***********************************************************/
+void FrameScheduler::DestroyFences()
+{
+	for (int i = 0; i < m_fenceCount; i++)
+	{
+		if (NULL != m_frameFences[i])
+		{
+			glDeleteSync(m_frameFences[i]);
+			m_frameFences[i] = NULL;
+		}
+	}
+	m_fenceCount = 0;
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// framescheduler.h
+// ============
+// pace the frames of the main loop - fixed time step updates, vsync, frame cap
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+
+/***********************************************************
+ *  FrameScheduler
+ *
+ *  This class decides when each part of a frame of the main
+ *  loop runs.  The elapsed time of each frame is added up
+ *  and handed out as fixed time steps, so the simulation
+ *  moves the same way at any frame rate, and rendering
+ *  happens once per frame with whatever time is left over.
+ *
+ *  After the buffers are swapped, a fence is placed in the
+ *  command stream, and the CPU waits for the fence of an
+ *  earlier frame so it can not run more than one frame, or
+ *  two with triple buffering, ahead of the GPU.  Fewer
+ *  frames in flight means less input latency.  A frame rate
+ *  cap sleeps away the rest of each frame, and the swap
+ *  interval sets vsync on or off.
+ ***********************************************************/
+class FrameScheduler
+{
+public:
+	// constructor
+	FrameScheduler();
+	// destructor
+	~FrameScheduler();
+
+	// the largest number of frames that can be in flight
+	static const int MAX_FRAMES_IN_FLIGHT = 2;
+
+	struct SCHEDULER_SETTINGS
+	{
+		// the number of display refreshes between swaps - 0 turns
+		// vsync off and 1 waits for every refresh
+		int swapInterval;
+		// the largest number of frames each second, or 0 for no cap
+		float maxFrameRate;
+		// the length of a simulation step in seconds
+		float fixedTimeStep;
+		// the most steps run in one frame, so a long stall does
+		// not make the simulation fall further and further behind
+		int maxUpdateSteps;
+		// let the CPU queue a second frame while the GPU is still
+		// drawing the first one
+		bool bTripleBuffering;
+
+		SCHEDULER_SETTINGS()
+		{
+			swapInterval = 1;
+			maxFrameRate = 0.0f;
+			fixedTimeStep = 1.0f / 120.0f;
+			maxUpdateSteps = 8;
+			bTripleBuffering = false;
+		}
+	};
+
+private:
+	SCHEDULER_SETTINGS m_settings;
+
+	// the time the last frame started at and the simulation
+	// time that has not been handed out as steps yet
+	std::chrono::steady_clock::time_point m_lastFrameStart;
+	std::chrono::steady_clock::time_point m_frameStart;
+	double m_frameTime;
+	double m_accumulator;
+	int m_updateSteps;
+	bool m_bStarted;
+
+	// the fences of the frames in flight, oldest first, with
+	// room for the fence of the frame that just ended
+	GLsync m_frameFences[MAX_FRAMES_IN_FLIGHT + 1];
+	int m_fenceCount;
+
+	// wait until the GPU has finished the oldest frame in flight
+	void WaitForOldestFence();
+	// sleep until the frame rate cap allows the next frame
+	void WaitForFrameCap();
+
+public:
+	// set the settings and apply the swap interval to the
+	// current OpenGL context
+	void SetSettings(const SCHEDULER_SETTINGS& settings);
+	const SCHEDULER_SETTINGS& GetSettings() const;
+
+	// start a frame and work out how many simulation steps it
+	// runs - returns the number of steps
+	int BeginFrame();
+	// the number of simulation steps of this frame
+	int GetUpdateStepCount() const;
+	// the length of each simulation step in seconds
+	float GetFixedTimeStep() const;
+	// how far the render time is into the next simulation
+	// step, from 0 to 1
+	float GetInterpolation() const;
+	// the seconds between the start of this frame and the last
+	float GetFrameTime() const;
+
+	// call after the buffers were swapped - waits for the GPU
+	// and the frame rate cap
+	void EndFrame();
+
+	// free the fences of the frames in flight
+	void DestroyFences();
+};
@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.cpp
+// ============
+// test the bounding boxes of the scene objects against the view frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  FrustumCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrustumCuller::FrustumCuller()
+{
+	for (int i = 0; i < FRUSTUM_PLANES; i++)
+	{
+		m_planes[i][0] = 0.0f;
+		m_planes[i][1] = 0.0f;
+		m_planes[i][2] = 0.0f;
+		// until the planes are set nothing is culled
+		m_planes[i][3] = 1.0f;
+	}
+}
+
+/***********************************************************
+ *  ~FrustumCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrustumCuller::~FrustumCuller()
+{
+}
+
+/***********************************************************
+ *  SetBoundsCount()
+ *
+ *  This method is used for setting the number of bounding
+ *  boxes that are tested.
+ ***********************************************************/
+void FrustumCuller::SetBoundsCount(int count)
+{
+	m_centerX.resize(count);
+	m_centerY.resize(count);
+	m_centerZ.resize(count);
+	m_extentX.resize(count);
+	m_extentY.resize(count);
+	m_extentZ.resize(count);
+}
+
+/***********************************************************
+ *  GetBoundsCount()
+ *
+ *  This method is used for getting the number of bounding
+ *  boxes that are tested.
+ ***********************************************************/
+int FrustumCuller::GetBoundsCount() const
+{
+	return((int)m_centerX.size());
+}
+
+/***********************************************************
+ *  SetBounds()
+ *
+ *  This method is used for storing the world space box of
+ *  an object.  The center is moved by the model matrix, and
+ *  the half size is spread over the world axes with the
+ *  absolute values of the matrix, which gives the smallest
+ *  axis aligned box around the rotated and scaled box.
+ ***********************************************************/
+void FrustumCuller::SetBounds(
+	int index,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax,
+	const glm::mat4& model)
+{
+	if ((index < 0) || (index >= (int)m_centerX.size()))
+	{
+		return;
+	}
+
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+	glm::vec4 worldCenter = model * glm::vec4(center, 1.0f);
+
+	m_centerX[index] = worldCenter.x;
+	m_centerY[index] = worldCenter.y;
+	m_centerZ[index] = worldCenter.z;
+	m_extentX[index] = fabsf(model[0][0]) * extent.x + fabsf(model[1][0]) * extent.y + fabsf(model[2][0]) * extent.z;
+	m_extentY[index] = fabsf(model[0][1]) * extent.x + fabsf(model[1][1]) * extent.y + fabsf(model[2][1]) * extent.z;
+	m_extentZ[index] = fabsf(model[0][2]) * extent.x + fabsf(model[1][2]) * extent.y + fabsf(model[2][2]) * extent.z;
+}
+
+/***********************************************************
+ *  GetBounds()
+ *
+ *  This method is used for getting the world space box
+ *  stored at the passed in index.
+ ***********************************************************/
+void FrustumCuller::GetBounds(int index, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	glm::vec3 center(m_centerX[index], m_centerY[index], m_centerZ[index]);
+	glm::vec3 extent(m_extentX[index], m_extentY[index], m_extentZ[index]);
+
+	boundsMin = center - extent;
+	boundsMax = center + extent;
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for extracting the frustum planes
+ *  from the rows of a combined projection and view matrix.
+ *  The planes are normalized so the plane distances are in
+ *  world units.
+ ***********************************************************/
+void FrustumCuller::SetViewProjection(const glm::mat4& viewProjection)
+{
+	// glm matrices are stored by column, so row r is m[0][r]..m[3][r]
+	const glm::mat4& m = viewProjection;
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+	glm::vec4 planes[FRUSTUM_PLANES];
+
+	planes[0] = row3 + row0;  // left
+	planes[1] = row3 - row0;  // right
+	planes[2] = row3 + row1;  // bottom
+	planes[3] = row3 - row1;  // top
+	planes[4] = row3 + row2;  // near
+	planes[5] = row3 - row2;  // far
+
+	for (int i = 0; i < FRUSTUM_PLANES; i++)
+	{
+		float length = sqrtf(planes[i].x * planes[i].x +
+			planes[i].y * planes[i].y +
+			planes[i].z * planes[i].z);
+		if (length > 0.0f)
+		{
+			planes[i] = planes[i] * (1.0f / length);
+		}
+
+		m_planes[i][0] = planes[i].x;
+		m_planes[i][1] = planes[i].y;
+		m_planes[i][2] = planes[i].z;
+		m_planes[i][3] = planes[i].w;
+	}
+}
+
+/***********************************************************
+ *  GetPlanes()
+ *
+ *  This method is used for copying out the frustum planes,
+ *  so the same planes can be used by other spatial queries.
+ ***********************************************************/
+void FrustumCuller::GetPlanes(float planes[FRUSTUM_PLANES][4]) const
+{
+	for (int i = 0; i < FRUSTUM_PLANES; i++)
+	{
+		planes[i][0] = m_planes[i][0];
+		planes[i][1] = m_planes[i][1];
+		planes[i][2] = m_planes[i][2];
+		planes[i][3] = m_planes[i][3];
+	}
+}
+
+/***********************************************************
+ *  CullBounds()
+ *
+ *  This method is used for testing all of the boxes against
+ *  the frustum.  A box is outside when it is entirely
+ *  behind any one of the planes.  The planes are tested one
+ *  at a time over all of the boxes, so the inner loop only
+ *  reads the component arrays in order and has no branches.
+ ***********************************************************/
+int FrustumCuller::CullBounds(std::vector<uint8_t>& visible) const
+{
+	visible.resize(m_centerX.size());
+
+	return(CullBounds(0, (int)m_centerX.size(), visible.data()));
+}
+
+/***********************************************************
+ *  CullBounds()
+ *
+ *  This method is used for testing a range of the boxes
+ *  against the frustum, so separate threads can each test
+ *  their own range of the same array.
+ ***********************************************************/
+int FrustumCuller::CullBounds(int first, int last, uint8_t* visible) const
+{
+	const int count = last - first;
+	const float* centerX = m_centerX.data() + first;
+	const float* centerY = m_centerY.data() + first;
+	const float* centerZ = m_centerZ.data() + first;
+	const float* extentX = m_extentX.data() + first;
+	const float* extentY = m_extentY.data() + first;
+	const float* extentZ = m_extentZ.data() + first;
+	uint8_t* flags = visible + first;
+
+	for (int i = 0; i < count; i++)
+	{
+		flags[i] = 1;
+	}
+
+	for (int p = 0; p < FRUSTUM_PLANES; p++)
+	{
+		const float normalX = m_planes[p][0];
+		const float normalY = m_planes[p][1];
+		const float normalZ = m_planes[p][2];
+		const float distance = m_planes[p][3];
+		const float absoluteX = fabsf(normalX);
+		const float absoluteY = fabsf(normalY);
+		const float absoluteZ = fabsf(normalZ);
+
+		for (int i = 0; i < count; i++)
+		{
+			float centerDistance = centerX[i] * normalX + centerY[i] * normalY + centerZ[i] * normalZ + distance;
+			float radius = extentX[i] * absoluteX + extentY[i] * absoluteY + extentZ[i] * absoluteZ;
+
+			flags[i] &= (uint8_t)(centerDistance + radius >= 0.0f);
+		}
+	}
+
+	int visibleCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		visibleCount += flags[i];
+	}
+
+	return(visibleCount);
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.h
+// ============
+// test the bounding boxes of the scene objects against the view frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  FrustumCuller
+ *
+ *  This class holds the world space bounding boxes of the
+ *  scene objects and tests them against the six planes of
+ *  the view frustum.  The boxes are stored as a center and
+ *  a half size, with each component in its own array, so
+ *  the test runs over many objects at a time in one plane
+ *  loop that the compiler can turn into SIMD code.
+ ***********************************************************/
+class FrustumCuller
+{
+public:
+	// constructor
+	FrustumCuller();
+	// destructor
+	~FrustumCuller();
+
+	// the number of planes of the view frustum
+	static const int FRUSTUM_PLANES = 6;
+
+private:
+	// world space box centers and half sizes of the objects
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	// the frustum planes, as a normal pointing into the
+	// frustum and a distance
+	float m_planes[FRUSTUM_PLANES][4];
+
+public:
+	// set the number of bounding boxes
+	void SetBoundsCount(int count);
+	int GetBoundsCount() const;
+	// transform a local space bounding box by a model matrix
+	// and store it at the passed in index
+	void SetBounds(
+		int index,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		const glm::mat4& model);
+	// get the world space box stored at the passed in index
+	void GetBounds(int index, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+
+	// extract the frustum planes from a combined projection
+	// and view matrix
+	void SetViewProjection(const glm::mat4& viewProjection);
+	// get the frustum planes
+	void GetPlanes(float planes[FRUSTUM_PLANES][4]) const;
+
+	// test all of the bounding boxes against the frustum -
+	// the visible flag of each box is set to 1 when it is at
+	// least partly inside, and the visible count is returned
+	int CullBounds(std::vector<uint8_t>& visible) const;
+	// test a range of the bounding boxes and write their flags
+	// into the matching range of the array, which must hold
+	// a flag for every box
+	int CullBounds(int first, int last, uint8_t* visible) const;
+};
@@ -0,0 +1,542 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// test the instances against the view on the GPU with compute shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// the work group sizes, which must match the local sizes
+	// of the compute shaders
+	const int g_CullGroupSize = 64;
+	const int g_PyramidGroupSize = 8;
+
+	// the passes of the cull shader
+	const int g_ResetCommandsPass = 0;
+	const int g_CullInstancesPass = 1;
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+{
+	m_cullProgram = 0;
+	m_pyramidProgram = 0;
+	m_instanceInfoBuffer = 0;
+	m_instanceInfoCapacity = 0;
+	m_meshBoundsBuffer = 0;
+	m_pStreamBuffer = NULL;
+	m_depthTexture = 0;
+	m_depthPyramid = 0;
+	m_pyramidWidth = 0;
+	m_pyramidHeight = 0;
+	m_pyramidLevels = 0;
+	m_pyramidViewProjection = glm::mat4(1.0f);
+	m_bPyramidValid = false;
+
+	m_cullPassLocation = -1;
+	m_instanceCountLocation = -1;
+	m_firstCommandLocation = -1;
+	m_commandCountLocation = -1;
+	m_frustumPlanesLocation = -1;
+	m_viewPositionLocation = -1;
+	m_projectionScaleLocation = -1;
+	m_perspectiveLocation = -1;
+	m_levelScreenSizesLocation = -1;
+	m_levelHysteresisLocation = -1;
+	m_useOcclusionLocation = -1;
+	m_occlusionMatrixLocation = -1;
+	m_pyramidLevelsLocation = -1;
+	m_depthPyramidLocation = -1;
+	m_fromDepthLocation = -1;
+	m_sourceSizeLocation = -1;
+	m_depthTextureLocation = -1;
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+	DestroyResources();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  run the compute shaders, which are written for GLSL 4.30.
+ ***********************************************************/
+bool GpuCuller::IsSupported()
+{
+	return(GLEW_VERSION_4_3 ? true : false);
+}
+
+/***********************************************************
+ *  ReadSource()
+ *
+ *  This method is used for reading the contents of a shader
+ *  source file.
+ ***********************************************************/
+bool GpuCuller::ReadSource(const char* filePath, std::string& source)
+{
+	std::ifstream file(filePath);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "ERROR::GPU_CULLER::FILE_NOT_READ: " << filePath << std::endl;
+		return(false);
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	source = contents.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for compiling and linking a compute
+ *  program from a source file.  0 is returned when it fails.
+ ***********************************************************/
+GLuint GpuCuller::LoadProgram(const char* filePath)
+{
+	std::string source;
+
+	if (ReadSource(filePath, source) == false)
+	{
+		return(0);
+	}
+
+	GLuint shaderID = glCreateShader(GL_COMPUTE_SHADER);
+	const char* sourceText = source.c_str();
+	GLint success = 0;
+	char infoLog[1024];
+
+	glShaderSource(shaderID, 1, &sourceText, NULL);
+	glCompileShader(shaderID);
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::GPU_CULLER::COMPILATION_FAILED: " << filePath << "\n" << infoLog << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	GLuint programID = glCreateProgram();
+	glAttachShader(programID, shaderID);
+	glLinkProgram(programID);
+	glDetachShader(programID, shaderID);
+	glDeleteShader(shaderID);
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::GPU_CULLER::LINKING_FAILED: " << filePath << "\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for loading the cull and depth
+ *  pyramid programs and creating the buffers the cull
+ *  shader reads.  Nothing is kept when either program can
+ *  not be built.
+ ***********************************************************/
+bool GpuCuller::LoadShaders(const char* cullShaderPath, const char* pyramidShaderPath)
+{
+	DestroyResources();
+
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+
+	m_cullProgram = LoadProgram(cullShaderPath);
+	m_pyramidProgram = LoadProgram(pyramidShaderPath);
+	if ((m_cullProgram == 0) || (m_pyramidProgram == 0))
+	{
+		DestroyResources();
+		return(false);
+	}
+
+	m_cullPassLocation = glGetUniformLocation(m_cullProgram, "cullPass");
+	m_instanceCountLocation = glGetUniformLocation(m_cullProgram, "instanceCount");
+	m_firstCommandLocation = glGetUniformLocation(m_cullProgram, "firstCommand");
+	m_commandCountLocation = glGetUniformLocation(m_cullProgram, "commandCount");
+	m_frustumPlanesLocation = glGetUniformLocation(m_cullProgram, "frustumPlanes");
+	m_viewPositionLocation = glGetUniformLocation(m_cullProgram, "viewPosition");
+	m_projectionScaleLocation = glGetUniformLocation(m_cullProgram, "projectionScale");
+	m_perspectiveLocation = glGetUniformLocation(m_cullProgram, "bPerspective");
+	m_levelScreenSizesLocation = glGetUniformLocation(m_cullProgram, "levelScreenSizes");
+	m_levelHysteresisLocation = glGetUniformLocation(m_cullProgram, "levelHysteresis");
+	m_useOcclusionLocation = glGetUniformLocation(m_cullProgram, "bUseOcclusion");
+	m_occlusionMatrixLocation = glGetUniformLocation(m_cullProgram, "occlusionViewProjection");
+	m_pyramidLevelsLocation = glGetUniformLocation(m_cullProgram, "pyramidLevels");
+	m_depthPyramidLocation = glGetUniformLocation(m_cullProgram, "depthPyramid");
+
+	m_fromDepthLocation = glGetUniformLocation(m_pyramidProgram, "bFromDepth");
+	m_sourceSizeLocation = glGetUniformLocation(m_pyramidProgram, "sourceSize");
+	m_depthTextureLocation = glGetUniformLocation(m_pyramidProgram, "depthTexture");
+
+	glGenBuffers(1, &m_instanceInfoBuffer);
+	glGenBuffers(1, &m_meshBoundsBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyResources()
+ *
+ *  This method is used for freeing the programs, buffers
+ *  and textures.
+ ***********************************************************/
+void GpuCuller::DestroyResources()
+{
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+		m_cullProgram = 0;
+	}
+	if (m_pyramidProgram != 0)
+	{
+		glDeleteProgram(m_pyramidProgram);
+		m_pyramidProgram = 0;
+	}
+	if (m_instanceInfoBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceInfoBuffer);
+		m_instanceInfoBuffer = 0;
+		m_instanceInfoCapacity = 0;
+	}
+	if (m_meshBoundsBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_meshBoundsBuffer);
+		m_meshBoundsBuffer = 0;
+	}
+	DestroyPyramid();
+}
+
+/***********************************************************
+ *  CreatePyramid()
+ *
+ *  This method is used for creating the texture the depth
+ *  buffer is copied into and the depth pyramid for a size.
+ *  The pyramid has levels down to one texel, and each level
+ *  is half of the size of the level before it.
+ ***********************************************************/
+void GpuCuller::CreatePyramid(int width, int height)
+{
+	DestroyPyramid();
+
+	m_pyramidWidth = width;
+	m_pyramidHeight = height;
+	m_pyramidLevels = 1;
+	while ((std::max(width, height) >> m_pyramidLevels) > 0)
+	{
+		m_pyramidLevels++;
+	}
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glGenTextures(1, &m_depthPyramid);
+	glBindTexture(GL_TEXTURE_2D, m_depthPyramid);
+	glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  DestroyPyramid()
+ *
+ *  This method is used for freeing the depth copy and the
+ *  depth pyramid.
+ ***********************************************************/
+void GpuCuller::DestroyPyramid()
+{
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	if (m_depthPyramid != 0)
+	{
+		glDeleteTextures(1, &m_depthPyramid);
+		m_depthPyramid = 0;
+	}
+	m_pyramidWidth = 0;
+	m_pyramidHeight = 0;
+	m_pyramidLevels = 0;
+	m_bPyramidValid = false;
+}
+
+/***********************************************************
+ *  SetStreamBuffer()
+ *
+ *  This method is used for setting the ring that the
+ *  per-instance values of the cull shader are uploaded
+ *  through.
+ ***********************************************************/
+void GpuCuller::SetStreamBuffer(StreamBuffer* pStreamBuffer)
+{
+	m_pStreamBuffer = pStreamBuffer;
+}
+
+/***********************************************************
+ *  SetMeshBounds()
+ *
+ *  This method is used for uploading the local space
+ *  bounding box of each shape, which the cull shader moves
+ *  into world space with the model matrix of each instance.
+ ***********************************************************/
+void GpuCuller::SetMeshBounds(const glm::vec4* bounds, int meshCount)
+{
+	if ((m_meshBoundsBuffer == 0) || (meshCount <= 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshBoundsBuffer);
+	glBufferData(
+		GL_SHADER_STORAGE_BUFFER,
+		meshCount * 2 * sizeof(glm::vec4),
+		bounds,
+		GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UploadInstanceInfo()
+ *
+ *  This method is used for replacing the per-instance
+ *  values of the cull shader.  This is only needed when the
+ *  instances or their draw commands change, not when they
+ *  move.
+ ***********************************************************/
+void GpuCuller::UploadInstanceInfo(const INSTANCE_INFO* infos, int instanceCount)
+{
+	if ((m_instanceInfoBuffer == 0) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceInfoBuffer);
+	if (instanceCount > m_instanceInfoCapacity)
+	{
+		m_instanceInfoCapacity = instanceCount;
+		glBufferData(
+			GL_SHADER_STORAGE_BUFFER,
+			instanceCount * sizeof(INSTANCE_INFO),
+			NULL,
+			GL_DYNAMIC_DRAW);
+	}
+
+	if (NULL != m_pStreamBuffer)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_pStreamBuffer->Upload(m_instanceInfoBuffer, 0, infos, instanceCount * sizeof(INSTANCE_INFO));
+		return;
+	}
+
+	glBufferSubData(
+		GL_SHADER_STORAGE_BUFFER,
+		0,
+		instanceCount * sizeof(INSTANCE_INFO),
+		infos);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for culling the instances on the
+ *  GPU.  The first pass clears the instance counts of the
+ *  scene commands, and the second pass runs one thread for
+ *  each instance, which adds the instance to the command of
+ *  its level of detail when it is visible.  The barrier at
+ *  the end makes the commands and the packed instances
+ *  visible to the draw calls that read them.
+ ***********************************************************/
+void GpuCuller::Cull(
+	GLuint instanceBuffer,
+	int instanceCount,
+	GLuint commandBuffer,
+	int firstCommand,
+	int commandCount,
+	const CULL_VIEW& view,
+	bool bUseOcclusion)
+{
+	if ((m_cullProgram == 0) || (instanceCount <= 0) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	GLint previousProgram = 0;
+	bool bOcclusion = (bUseOcclusion == true) && (m_bPyramidValid == true);
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_cullProgram);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_INFO_BINDING, m_instanceInfoBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BOUNDS_BINDING, m_meshBoundsBuffer);
+
+	glUniform1i(m_instanceCountLocation, instanceCount);
+	glUniform1i(m_firstCommandLocation, firstCommand);
+	glUniform1i(m_commandCountLocation, commandCount);
+	glUniform4fv(m_frustumPlanesLocation, FrustumCuller::FRUSTUM_PLANES, &view.planes[0][0]);
+	glUniform3f(m_viewPositionLocation, view.viewPosition.x, view.viewPosition.y, view.viewPosition.z);
+	glUniform1f(m_projectionScaleLocation, view.projectionScale);
+	glUniform1i(m_perspectiveLocation, (view.bPerspective == true) ? 1 : 0);
+	glUniform1fv(m_levelScreenSizesLocation, ShapeGeometry::LOD_COUNT - 1, view.levelScreenSizes);
+	glUniform1f(m_levelHysteresisLocation, view.levelHysteresis);
+	glUniform1i(m_useOcclusionLocation, (bOcclusion == true) ? 1 : 0);
+	if (bOcclusion == true)
+	{
+		glUniformMatrix4fv(m_occlusionMatrixLocation, 1, GL_FALSE, &m_pyramidViewProjection[0][0]);
+		glUniform1i(m_pyramidLevelsLocation, m_pyramidLevels);
+		glUniform1i(m_depthPyramidLocation, DEPTH_PYRAMID_UNIT);
+		glActiveTexture(GL_TEXTURE0 + DEPTH_PYRAMID_UNIT);
+		glBindTexture(GL_TEXTURE_2D, m_depthPyramid);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	glUniform1i(m_cullPassLocation, g_ResetCommandsPass);
+	glDispatchCompute((commandCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(m_cullPassLocation, g_CullInstancesPass);
+	glDispatchCompute((instanceCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+	glMemoryBarrier(
+		GL_COMMAND_BARRIER_BIT |
+		GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+		GL_SHADER_STORAGE_BARRIER_BIT);
+
+	for (GLuint binding = INSTANCE_BINDING; binding <= MESH_BOUNDS_BINDING; binding++)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+	}
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  BuildDepthPyramid()
+ *
+ *  This method is used for building the depth pyramid from
+ *  the depth buffer of the bound draw framebuffer, after
+ *  the scene was rendered into it.  The depth is copied out
+ *  first, since the depth buffer of the window can not be
+ *  read by a shader, and each level of the pyramid is then
+ *  reduced from the level before it.
+ ***********************************************************/
+void GpuCuller::BuildDepthPyramid(const glm::mat4& viewProjection)
+{
+	if (m_pyramidProgram == 0)
+	{
+		return;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if ((viewport[2] <= 0) || (viewport[3] <= 0))
+	{
+		return;
+	}
+	if ((viewport[2] != m_pyramidWidth) || (viewport[3] != m_pyramidHeight))
+	{
+		CreatePyramid(viewport[2], viewport[3]);
+	}
+
+	// copy the depth of the framebuffer the scene was drawn into
+	GLint drawFramebuffer = 0;
+	GLint readFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)drawFramebuffer);
+	glActiveTexture(GL_TEXTURE0 + DEPTH_PYRAMID_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], viewport[2], viewport[3]);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)readFramebuffer);
+
+	GLint previousProgram = 0;
+	int sourceWidth = m_pyramidWidth;
+	int sourceHeight = m_pyramidHeight;
+	int levelWidth = m_pyramidWidth;
+	int levelHeight = m_pyramidHeight;
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_pyramidProgram);
+	glUniform1i(m_depthTextureLocation, DEPTH_PYRAMID_UNIT);
+
+	for (int level = 0; level < m_pyramidLevels; level++)
+	{
+		glUniform1i(m_fromDepthLocation, (level == 0) ? 1 : 0);
+		glUniform2i(m_sourceSizeLocation, sourceWidth, sourceHeight);
+		glBindImageTexture(0, m_depthPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		if (level > 0)
+		{
+			glBindImageTexture(1, m_depthPyramid, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		}
+
+		glDispatchCompute(
+			(levelWidth + g_PyramidGroupSize - 1) / g_PyramidGroupSize,
+			(levelHeight + g_PyramidGroupSize - 1) / g_PyramidGroupSize,
+			1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram((GLuint)previousProgram);
+
+	m_pyramidViewProjection = viewProjection;
+	m_bPyramidValid = true;
+}
+
+/***********************************************************
+ *  InvalidateDepthPyramid()
+ *
+ *  This method is used for forgetting the depth pyramid, so
+ *  no instance is hidden by an old depth buffer.
+ ***********************************************************/
+void GpuCuller::InvalidateDepthPyramid()
+{
+	m_bPyramidValid = false;
+}
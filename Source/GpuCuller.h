@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// test the instances against the view on the GPU with compute shaders
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrustumCuller.h"
+#include "ShapeGeometry.h"
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class culls the instances with a compute shader, so
+ *  large scenes are culled without any work on the CPU.
+ *  The shader reads the model matrix of each instance from
+ *  the instance buffer, tests its world space box against
+ *  the view frustum, picks its level of detail, and adds it
+ *  to the instance count of its indirect command, copying
+ *  its values into the range of the instance buffer the
+ *  command draws.  The multi-draw of the scene pass then
+ *  draws exactly the instances the shader kept.
+ *
+ *  The instances can also be tested against a depth pyramid
+ *  built from the depth of the last frame.  Each level of
+ *  the pyramid holds the farthest depth of four texels of
+ *  the level before it, so a box whose nearest point is
+ *  behind the farthest depth under it is hidden.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+	// constructor
+	GpuCuller();
+	// destructor
+	~GpuCuller();
+
+	// the shader storage binding points of the cull shader,
+	// which must match the buffers of the shader
+	static const GLuint INSTANCE_BINDING = 0;
+	static const GLuint INSTANCE_INFO_BINDING = 1;
+	static const GLuint COMMAND_BINDING = 2;
+	static const GLuint MESH_BOUNDS_BINDING = 3;
+
+	// the texture unit the depth pyramid is read from, after
+	// the units used by the shadow maps
+	static const int DEPTH_PYRAMID_UNIT = 13;
+
+	// the values the cull shader reads for each instance
+	struct INSTANCE_INFO
+	{
+		// the indirect command of the finest level of detail of
+		// the instance - the other levels follow it
+		GLuint firstCommand;
+		GLuint levelCount;
+		// the level the instance was drawn with, which the
+		// shader keeps from frame to frame
+		GLuint level;
+		GLuint mesh;
+	};
+
+	// the camera values an instance is culled with
+	struct CULL_VIEW
+	{
+		float planes[FrustumCuller::FRUSTUM_PLANES][4];
+		glm::vec3 viewPosition;
+		// the Y scale of the projection, and whether it divides
+		// by depth
+		float projectionScale;
+		bool bPerspective;
+		// the projected sizes the levels of detail switch at
+		float levelScreenSizes[ShapeGeometry::LOD_COUNT - 1];
+		float levelHysteresis;
+	};
+
+private:
+	// the compute programs that cull the instances and build
+	// the depth pyramid
+	GLuint m_cullProgram;
+	GLuint m_pyramidProgram;
+	// the per-instance values and the local bounds of the
+	// shapes the cull shader reads
+	GLuint m_instanceInfoBuffer;
+	int m_instanceInfoCapacity;
+	GLuint m_meshBoundsBuffer;
+	// the ring the per-instance values are uploaded through, or
+	// NULL to write them into their buffer directly
+	StreamBuffer* m_pStreamBuffer;
+	// the copy of the depth buffer and the pyramid built from it
+	GLuint m_depthTexture;
+	GLuint m_depthPyramid;
+	int m_pyramidWidth;
+	int m_pyramidHeight;
+	int m_pyramidLevels;
+	// the view and projection the depth was rendered with
+	glm::mat4 m_pyramidViewProjection;
+	bool m_bPyramidValid;
+
+	// the uniform locations of the cull shader - the shaders
+	// run once a frame, so the values are set directly
+	GLint m_cullPassLocation;
+	GLint m_instanceCountLocation;
+	GLint m_firstCommandLocation;
+	GLint m_commandCountLocation;
+	GLint m_frustumPlanesLocation;
+	GLint m_viewPositionLocation;
+	GLint m_projectionScaleLocation;
+	GLint m_perspectiveLocation;
+	GLint m_levelScreenSizesLocation;
+	GLint m_levelHysteresisLocation;
+	GLint m_useOcclusionLocation;
+	GLint m_occlusionMatrixLocation;
+	GLint m_pyramidLevelsLocation;
+	GLint m_depthPyramidLocation;
+	// the uniform locations of the depth pyramid shader
+	GLint m_fromDepthLocation;
+	GLint m_sourceSizeLocation;
+	GLint m_depthTextureLocation;
+
+	// read the contents of a shader source file
+	static bool ReadSource(const char* filePath, std::string& source);
+	// compile and link a compute program from a source file
+	static GLuint LoadProgram(const char* filePath);
+	// create the depth copy and the pyramid for a size
+	void CreatePyramid(int width, int height);
+	void DestroyPyramid();
+
+public:
+	// whether the driver can run the compute shaders
+	static bool IsSupported();
+
+	// load the cull and depth pyramid shaders
+	bool LoadShaders(const char* cullShaderPath, const char* pyramidShaderPath);
+	// free the programs, buffers and textures
+	void DestroyResources();
+	// set the ring the per-instance values are uploaded through
+	void SetStreamBuffer(StreamBuffer* pStreamBuffer);
+
+	// set the local space bounding box of each shape, as a
+	// minimum and a maximum corner for each
+	void SetMeshBounds(const glm::vec4* bounds, int meshCount);
+	// replace the per-instance values of the cull shader
+	void UploadInstanceInfo(const INSTANCE_INFO* infos, int instanceCount);
+
+	// reset the instance counts of a range of the indirect
+	// commands, and add the visible instances to them
+	void Cull(
+		GLuint instanceBuffer,
+		int instanceCount,
+		GLuint commandBuffer,
+		int firstCommand,
+		int commandCount,
+		const CULL_VIEW& view,
+		bool bUseOcclusion);
+
+	// build the depth pyramid from the depth of the bound draw
+	// framebuffer, which was rendered with the passed in view
+	// and projection - the next Cull() tests against it
+	void BuildDepthPyramid(const glm::mat4& viewProjection);
+	// forget the depth pyramid, such as after the culling
+	// was turned off for a while
+	void InvalidateDepthPyramid();
+};
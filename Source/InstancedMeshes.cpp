@@ -0,0 +1,721 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.cpp
+// ============
+// draw many copies of the basic 3D shapes with single instanced draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedMeshes.h"
+#include "FrameProfiler.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+// declaration of global variables
+namespace
+{
+	// the most vertices one level of a shape can have, so its
+	// indices fit in 16 bits
+	const size_t g_MaxMeshVertices = 65536;
+
+	// the vertices and commands are read by the GPU in the
+	// layout of the structs
+	static_assert(sizeof(InstancedMeshes::PACKED_VERTEX) == 16, "unexpected packed vertex size");
+	static_assert(sizeof(InstancedMeshes::INDIRECT_COMMAND) == 20, "unexpected indirect command size");
+	static_assert(sizeof(InstancedMeshes::INSTANCE_DATA) == 144, "unexpected instance size");
+}
+
+/***********************************************************
+ *  InstancedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedMeshes::InstancedMeshes()
+{
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+		{
+			GLMesh& glMesh = m_meshes[i][level];
+			glMesh.baseVertex = 0;
+			glMesh.firstIndex = 0;
+			glMesh.nIndices = 0;
+			glMesh.boundsMin = glm::vec3(0.0f);
+			glMesh.boundsMax = glm::vec3(0.0f);
+		}
+		m_levelCounts[i] = 0;
+	}
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_indirectBuffer = 0;
+	m_indirectCapacity = 0;
+	m_bBaseInstanceSupported = false;
+	m_bMultiDrawSupported = false;
+	m_pStreamBuffer = NULL;
+}
+
+/***********************************************************
+ *  ~InstancedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstancedMeshes::~InstancedMeshes()
+{
+	DestroyMeshes();
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for generating every tessellation
+ *  level of all of the basic shapes and uploading them into
+ *  the shared vertex and index buffers.  The vertex array
+ *  reads the vertices and the per-instance values, so it is
+ *  the only vertex array that any shape is drawn with.
+ ***********************************************************/
+void InstancedMeshes::LoadMeshes()
+{
+	ShapeGeometry::MESH_DATA data;
+	std::vector<PACKED_VERTEX> vertices;
+	std::vector<uint16_t> indices;
+	const GLsizei stride = sizeof(PACKED_VERTEX);
+
+	// instances can be drawn from an offset in the instance
+	// buffer without re-pointing the instance attributes
+	m_bBaseInstanceSupported = (GLEW_VERSION_4_2 || GLEW_ARB_base_instance);
+	// the multi-draw commands start at their own instances,
+	// which needs the base instance as well
+	m_bMultiDrawSupported = (m_bBaseInstanceSupported == true) &&
+		(GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect);
+
+	if (m_vertexArray == 0)
+	{
+		glGenVertexArrays(1, &m_vertexArray);
+		glGenBuffers(1, &m_vertexBuffer);
+		glGenBuffers(1, &m_indexBuffer);
+	}
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+	if ((m_bMultiDrawSupported == true) && (m_indirectBuffer == 0))
+	{
+		glGenBuffers(1, &m_indirectBuffer);
+	}
+
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		int levelCount = ShapeGeometry::GetLevelCount((MESH_TYPE)i);
+
+		m_levelCounts[i] = 0;
+		for (int level = 0; level < levelCount; level++)
+		{
+			ShapeGeometry::BuildMesh((MESH_TYPE)i, level, data);
+			if (AddMesh((MESH_TYPE)i, level, data, vertices, indices) == false)
+			{
+				break;
+			}
+			m_levelCounts[i]++;
+		}
+	}
+
+	glBindVertexArray(m_vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(
+		GL_ARRAY_BUFFER,
+		vertices.size() * sizeof(PACKED_VERTEX),
+		vertices.data(),
+		GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(
+		GL_ELEMENT_ARRAY_BUFFER,
+		indices.size() * sizeof(uint16_t),
+		indices.data(),
+		GL_STATIC_DRAW);
+
+	// per-vertex position, normal and texture coordinate - the
+	// normal is read as a signed normalized value
+	glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride,
+		(void*)offsetof(PACKED_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+		(void*)offsetof(PACKED_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+		(void*)offsetof(PACKED_VERTEX, textureCoordinate));
+	glEnableVertexAttribArray(2);
+
+	// per-instance values from the shared instance buffer
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+		glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+	}
+	glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+	glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+	glEnableVertexAttribArray(INSTANCE_PARAMS_LOCATION);
+	glVertexAttribDivisor(INSTANCE_PARAMS_LOCATION, 1);
+	for (GLuint column = 0; column < 3; column++)
+	{
+		glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + column);
+		glVertexAttribDivisor(INSTANCE_NORMAL_LOCATION + column, 1);
+	}
+	SetInstanceAttributes(0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for adding the generated data of a
+ *  level of a shape to the end of the shared vertex and
+ *  index data.  The positions and texture coordinates are
+ *  stored as half floats, which keep the detail of the unit
+ *  sized shapes, and the normal is packed into 10 bits for
+ *  each component.  The indices are relative to the first
+ *  vertex of the shape, so they fit in 16 bits.
+ ***********************************************************/
+bool InstancedMeshes::AddMesh(
+	MESH_TYPE mesh,
+	int level,
+	const ShapeGeometry::MESH_DATA& data,
+	std::vector<PACKED_VERTEX>& vertices,
+	std::vector<uint16_t>& indices)
+{
+	if (data.vertices.size() > g_MaxMeshVertices)
+	{
+		return(false);
+	}
+
+	GLMesh& glMesh = m_meshes[mesh][level];
+
+	glMesh.baseVertex = (GLint)vertices.size();
+	glMesh.firstIndex = (GLuint)indices.size();
+	glMesh.nIndices = (GLsizei)data.indices.size();
+	glMesh.boundsMin = data.boundsMin;
+	glMesh.boundsMax = data.boundsMax;
+
+	for (size_t i = 0; i < data.vertices.size(); i++)
+	{
+		const ShapeGeometry::SHAPE_VERTEX& source = data.vertices[i];
+		PACKED_VERTEX vertex;
+
+		vertex.position[0] = glm::packHalf1x16(source.position.x);
+		vertex.position[1] = glm::packHalf1x16(source.position.y);
+		vertex.position[2] = glm::packHalf1x16(source.position.z);
+		vertex.padding = 0;
+		vertex.normal = glm::packSnorm3x10_1x2(glm::vec4(source.normal, 0.0f));
+		vertex.textureCoordinate[0] = glm::packHalf1x16(source.textureCoordinate.x);
+		vertex.textureCoordinate[1] = glm::packHalf1x16(source.textureCoordinate.y);
+		vertices.push_back(vertex);
+	}
+	for (size_t i = 0; i < data.indices.size(); i++)
+	{
+		indices.push_back((uint16_t)data.indices[i]);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetInstanceAttributes()
+ *
+ *  This method is used for pointing the instance attributes
+ *  of the bound vertex array at the passed in first instance
+ *  of the shared instance buffer.
+ ***********************************************************/
+void InstancedMeshes::SetInstanceAttributes(int firstInstance)
+{
+	const GLsizei stride = sizeof(INSTANCE_DATA);
+	const size_t base = (size_t)firstInstance * sizeof(INSTANCE_DATA);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(
+			INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(
+		INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+		(void*)(base + offsetof(INSTANCE_DATA, color)));
+	glVertexAttribPointer(
+		INSTANCE_PARAMS_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+		(void*)(base + offsetof(INSTANCE_DATA, UVscale)));
+	for (GLuint column = 0; column < 3; column++)
+	{
+		glVertexAttribPointer(
+			INSTANCE_NORMAL_LOCATION + column, 3, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(INSTANCE_DATA, normalMatrix) + column * sizeof(glm::vec4)));
+	}
+}
+
+/***********************************************************
+ *  DestroyMeshes()
+ *
+ *  This method is used for freeing all of the GPU buffers.
+ ***********************************************************/
+void InstancedMeshes::DestroyMeshes()
+{
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+		{
+			m_meshes[i][level].nIndices = 0;
+		}
+		m_levelCounts[i] = 0;
+	}
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_vertexArray = 0;
+		m_vertexBuffer = 0;
+		m_indexBuffer = 0;
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+		m_instanceCapacity = 0;
+	}
+	if (m_indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indirectBuffer);
+		m_indirectBuffer = 0;
+		m_indirectCapacity = 0;
+	}
+	m_indirectCommands.clear();
+}
+
+/***********************************************************
+ *  SetStreamBuffer()
+ *
+ *  This method is used for setting the ring that the
+ *  instances and the indirect commands are uploaded through
+ *  while the scene is drawn.
+ ***********************************************************/
+void InstancedMeshes::SetStreamBuffer(StreamBuffer* pStreamBuffer)
+{
+	m_pStreamBuffer = pStreamBuffer;
+}
+
+/***********************************************************
+ *  SetInstanceModel()
+ *
+ *  This method is used for setting the model matrix of an
+ *  instance together with its normal matrix.  The normal
+ *  matrix is the inverse transpose of the model matrix,
+ *  which keeps the normals at a right angle to the surface
+ *  when a copy is scaled unevenly.  It is calculated here
+ *  once for each copy instead of for every vertex.
+ ***********************************************************/
+void InstancedMeshes::SetInstanceModel(INSTANCE_DATA& instance, const glm::mat4& model)
+{
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+	instance.model = model;
+	for (int column = 0; column < 3; column++)
+	{
+		instance.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+	}
+}
+
+/***********************************************************
+ *  UploadBuffer()
+ *
+ *  This method is used for writing bytes into one of the
+ *  buffers, through the ring when there is one.
+ ***********************************************************/
+void InstancedMeshes::UploadBuffer(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	if (NULL != m_pStreamBuffer)
+	{
+		m_pStreamBuffer->Upload(buffer, offset, data, size);
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	glBufferSubData(target, offset, size, data);
+	glBindBuffer(target, 0);
+}
+
+/***********************************************************
+ *  ReserveInstances()
+ *
+ *  This method is used for making room for a number of
+ *  instances in the shared instance buffer.  The buffer only
+ *  grows, so once it is large enough no new GPU memory is
+ *  allocated.  The old contents are lost when it grows, so
+ *  all of the ranges need to be written again after it.
+ ***********************************************************/
+void InstancedMeshes::ReserveInstances(int instanceCount)
+{
+	if ((m_instanceBuffer == 0) || (instanceCount <= m_instanceCapacity))
+	{
+		return;
+	}
+
+	m_instanceCapacity = instanceCount;
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(
+		GL_ARRAY_BUFFER,
+		m_instanceCapacity * sizeof(INSTANCE_DATA),
+		NULL,
+		GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for replacing the contents of the
+ *  shared instance buffer.
+ ***********************************************************/
+void InstancedMeshes::UploadInstances(const INSTANCE_DATA* instances, int instanceCount)
+{
+	UploadInstances(instances, instanceCount, 0);
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for writing instances into the
+ *  shared instance buffer from the passed in first instance
+ *  on.  This keeps the other instances in the buffer, as
+ *  long as ReserveInstances() made room for all of them.
+ ***********************************************************/
+void InstancedMeshes::UploadInstances(const INSTANCE_DATA* instances, int instanceCount, int firstInstance)
+{
+	if ((m_instanceBuffer == 0) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	ReserveInstances(firstInstance + instanceCount);
+
+	UploadBuffer(
+		m_instanceBuffer,
+		GL_ARRAY_BUFFER,
+		(GLintptr)firstInstance * sizeof(INSTANCE_DATA),
+		instanceCount * sizeof(INSTANCE_DATA),
+		instances);
+}
+
+/***********************************************************
+ *  ClampLevel()
+ *
+ *  This method is used for getting the tessellation level
+ *  of a shape that a draw at the passed in level uses.
+ ***********************************************************/
+int InstancedMeshes::ClampLevel(MESH_TYPE mesh, int level) const
+{
+	if (level >= m_levelCounts[mesh])
+	{
+		level = m_levelCounts[mesh] - 1;
+	}
+	if (level < 0)
+	{
+		level = 0;
+	}
+
+	return(level);
+}
+
+/***********************************************************
+ *  GetIndirectCommand()
+ *
+ *  This method is used for filling in the command that
+ *  draws a range of the instances in the shared instance
+ *  buffer with the passed in tessellation level of a shape.
+ ***********************************************************/
+bool InstancedMeshes::GetIndirectCommand(
+	MESH_TYPE mesh,
+	int level,
+	int firstInstance,
+	int instanceCount,
+	INDIRECT_COMMAND& command) const
+{
+	if (m_levelCounts[mesh] == 0)
+	{
+		return(false);
+	}
+
+	const GLMesh& glMesh = m_meshes[mesh][ClampLevel(mesh, level)];
+
+	command.count = (GLuint)glMesh.nIndices;
+	command.instanceCount = (GLuint)std::max(instanceCount, 0);
+	command.firstIndex = glMesh.firstIndex;
+	command.baseVertex = glMesh.baseVertex;
+	command.baseInstance = (GLuint)firstInstance;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DrawCommand()
+ *
+ *  This method is used for submitting one command with a
+ *  draw call of its own, into the bound vertex array.
+ ***********************************************************/
+void InstancedMeshes::DrawCommand(const INDIRECT_COMMAND& command)
+{
+	if ((command.count == 0) || (command.instanceCount == 0))
+	{
+		return;
+	}
+
+	const void* pFirstIndex = (const void*)((size_t)command.firstIndex * sizeof(uint16_t));
+
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS, 1);
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_TRIANGLES, (command.count / 3) * command.instanceCount);
+
+	if (m_bBaseInstanceSupported == true)
+	{
+		glDrawElementsInstancedBaseVertexBaseInstance(
+			GL_TRIANGLES,
+			(GLsizei)command.count,
+			GL_UNSIGNED_SHORT,
+			pFirstIndex,
+			(GLsizei)command.instanceCount,
+			command.baseVertex,
+			command.baseInstance);
+	}
+	else
+	{
+		// without base instance support the instance attributes
+		// are pointed at the first instance of the range instead
+		SetInstanceAttributes((int)command.baseInstance);
+		glDrawElementsInstancedBaseVertex(
+			GL_TRIANGLES,
+			(GLsizei)command.count,
+			GL_UNSIGNED_SHORT,
+			pFirstIndex,
+			(GLsizei)command.instanceCount,
+			command.baseVertex);
+		if (command.baseInstance != 0)
+		{
+			SetInstanceAttributes(0);
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for drawing a range of the instances
+ *  in the shared instance buffer with one draw call, using
+ *  the passed in tessellation level of the shape.
+ ***********************************************************/
+void InstancedMeshes::DrawInstanced(MESH_TYPE mesh, int firstInstance, int instanceCount, int level)
+{
+	INDIRECT_COMMAND command;
+
+	if ((m_vertexArray == 0) ||
+		(GetIndirectCommand(mesh, level, firstInstance, instanceCount, command) == false))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArray);
+	DrawCommand(command);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for uploading the passed in instances
+ *  and drawing all of them with one draw call.
+ ***********************************************************/
+void InstancedMeshes::DrawInstanced(MESH_TYPE mesh, const INSTANCE_DATA* instances, int instanceCount)
+{
+	UploadInstances(instances, instanceCount);
+	DrawInstanced(mesh, 0, instanceCount);
+}
+
+/***********************************************************
+ *  UploadIndirectCommands()
+ *
+ *  This method is used for writing commands into the
+ *  indirect command buffer from the passed in first command
+ *  on.  A copy of the commands is kept, which is drawn from
+ *  one command at a time when multi-draw is not available,
+ *  and which refills the buffer when it has to grow.
+ ***********************************************************/
+void InstancedMeshes::UploadIndirectCommands(const INDIRECT_COMMAND* commands, int commandCount, int firstCommand)
+{
+	if (commandCount <= 0)
+	{
+		return;
+	}
+
+	if ((int)m_indirectCommands.size() < firstCommand + commandCount)
+	{
+		m_indirectCommands.resize(firstCommand + commandCount);
+	}
+	std::copy(commands, commands + commandCount, m_indirectCommands.begin() + firstCommand);
+
+	if (m_indirectBuffer == 0)
+	{
+		return;
+	}
+
+	// a buffer that grows gets new storage, and the kept copy
+	// of every command is written into it
+	if ((int)m_indirectCommands.size() > m_indirectCapacity)
+	{
+		m_indirectCapacity = (int)m_indirectCommands.size();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		glBufferData(
+			GL_DRAW_INDIRECT_BUFFER,
+			m_indirectCapacity * sizeof(INDIRECT_COMMAND),
+			NULL,
+			GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+		firstCommand = 0;
+		commands = m_indirectCommands.data();
+		commandCount = (int)m_indirectCommands.size();
+	}
+
+	UploadBuffer(
+		m_indirectBuffer,
+		GL_DRAW_INDIRECT_BUFFER,
+		(GLintptr)firstCommand * sizeof(INDIRECT_COMMAND),
+		commandCount * sizeof(INDIRECT_COMMAND),
+		commands);
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing a range of the uploaded
+ *  indirect commands.  Every shape is in the same buffers,
+ *  so the whole range is submitted with a single multi-draw
+ *  call, or with one draw call for each command when the
+ *  driver does not have multi-draw.
+ ***********************************************************/
+void InstancedMeshes::DrawIndirect(int firstCommand, int commandCount)
+{
+	if ((m_vertexArray == 0) ||
+		(commandCount <= 0) ||
+		(firstCommand + commandCount > (int)m_indirectCommands.size()))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArray);
+
+	if (m_bMultiDrawSupported == true)
+	{
+		int triangleCount = 0;
+
+		for (int i = firstCommand; i < firstCommand + commandCount; i++)
+		{
+			triangleCount += (m_indirectCommands[i].count / 3) * m_indirectCommands[i].instanceCount;
+		}
+		FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS, 1);
+		FrameProfiler::AddCount(FrameProfiler::COUNTER_TRIANGLES, triangleCount);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+		glMultiDrawElementsIndirect(
+			GL_TRIANGLES,
+			GL_UNSIGNED_SHORT,
+			(const void*)((size_t)firstCommand * sizeof(INDIRECT_COMMAND)),
+			commandCount,
+			0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else
+	{
+		for (int i = firstCommand; i < firstCommand + commandCount; i++)
+		{
+			DrawCommand(m_indirectCommands[i]);
+		}
+	}
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the local space bounding
+ *  box of a shape.  The box of the finest level is used,
+ *  since the coarser levels fit inside of it.
+ ***********************************************************/
+void InstancedMeshes::GetMeshBounds(MESH_TYPE mesh, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	boundsMin = m_meshes[mesh][0].boundsMin;
+	boundsMax = m_meshes[mesh][0].boundsMax;
+}
+
+/***********************************************************
+ *  GetIndexCount()
+ *
+ *  This method is used for getting the number of indices
+ *  that are drawn for one copy of a shape.
+ ***********************************************************/
+int InstancedMeshes::GetIndexCount(MESH_TYPE mesh, int level) const
+{
+	if ((level < 0) || (level >= ShapeGeometry::LOD_COUNT))
+	{
+		return(0);
+	}
+	return((int)m_meshes[mesh][level].nIndices);
+}
+
+/***********************************************************
+ *  GetLevelCount()
+ *
+ *  This method is used for getting the number of
+ *  tessellation levels that were uploaded for a shape.
+ ***********************************************************/
+int InstancedMeshes::GetLevelCount(MESH_TYPE mesh) const
+{
+	return(m_levelCounts[mesh]);
+}
+
+/***********************************************************
+ *  GetInstanceBuffer()
+ *
+ *  This method is used for getting the shared instance
+ *  buffer.
+ ***********************************************************/
+GLuint InstancedMeshes::GetInstanceBuffer() const
+{
+	return(m_instanceBuffer);
+}
+
+/***********************************************************
+ *  GetIndirectBuffer()
+ *
+ *  This method is used for getting the indirect command
+ *  buffer, which is 0 when multi-draw is not available.
+ ***********************************************************/
+GLuint InstancedMeshes::GetIndirectBuffer() const
+{
+	return(m_indirectBuffer);
+}
+
+/***********************************************************
+ *  IsMultiDrawSupported()
+ *
+ *  This method is used for checking whether the indirect
+ *  commands are drawn with one multi-draw call.
+ ***********************************************************/
+bool InstancedMeshes::IsMultiDrawSupported() const
+{
+	return(m_bMultiDrawSupported);
+}
@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.h
+// ============
+// draw many copies of the basic 3D shapes with single instanced draw calls
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeGeometry.h"
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  InstancedMeshes
+ *
+ *  This class contains the GPU buffers of the basic 3D
+ *  shapes and a shared buffer of per-instance values, so
+ *  that any number of copies of a shape can be drawn with
+ *  a single instanced draw call.  The curved shapes are
+ *  uploaded at each of their tessellation levels, and a
+ *  draw picks the level its copies use.
+ *
+ *  Every level of every shape is packed into one vertex
+ *  buffer and one index buffer behind a single vertex
+ *  array, so drawing another shape never binds another
+ *  vertex array.  The vertices are quantized to half of
+ *  the size of the generated ones.  The draws of a pass can
+ *  be written into an indirect command buffer and submitted
+ *  with one glMultiDrawElementsIndirect() call.
+ ***********************************************************/
+class InstancedMeshes
+{
+public:
+	// constructor
+	InstancedMeshes();
+	// destructor
+	~InstancedMeshes();
+
+	// the values that are read by the vertex shader for each
+	// drawn copy - the layout matches the instance attributes
+	// at locations 3 to 11 in the vertex shader
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		float materialIndex;
+		// index into the texture table, or -1 for a solid color
+		float textureIndex;
+		// columns of the inverse transpose of the model matrix,
+		// padded to vec4 so the GPU culler reads the same layout
+		glm::vec4 normalMatrix[3];
+	};
+
+	// the vertex shader attribute locations of the instance values
+	static const GLuint INSTANCE_MODEL_LOCATION = 3;
+	static const GLuint INSTANCE_COLOR_LOCATION = 7;
+	static const GLuint INSTANCE_PARAMS_LOCATION = 8;
+	static const GLuint INSTANCE_NORMAL_LOCATION = 9;
+
+	// one draw of the indirect command buffer, in the layout
+	// glMultiDrawElementsIndirect() reads
+	struct INDIRECT_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// a vertex of the shared vertex buffer - the position and
+	// texture coordinate are half floats and the normal has
+	// 10 bits for each component
+	struct PACKED_VERTEX
+	{
+		uint16_t position[3];
+		uint16_t padding;
+		uint32_t normal;
+		uint16_t textureCoordinate[2];
+	};
+
+private:
+	// the range of the shared buffers one level of a shape uses
+	struct GLMesh
+	{
+		GLint baseVertex;
+		GLuint firstIndex;
+		GLsizei nIndices;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// each tessellation level of each basic shape
+	GLMesh m_meshes[MESH_COUNT][ShapeGeometry::LOD_COUNT];
+	// the number of levels that were uploaded for each shape
+	int m_levelCounts[MESH_COUNT];
+	// the vertex array and the shared vertex and index buffers
+	// of all of the shapes
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	// shared buffer of per-instance values
+	GLuint m_instanceBuffer;
+	// number of instances the instance buffer can hold
+	int m_instanceCapacity;
+	// the indirect command buffer and a copy of its commands,
+	// which is drawn from when multi-draw is not available
+	GLuint m_indirectBuffer;
+	int m_indirectCapacity;
+	std::vector<INDIRECT_COMMAND> m_indirectCommands;
+	// true when glDrawElementsInstancedBaseVertexBaseInstance()
+	// is available
+	bool m_bBaseInstanceSupported;
+	// true when glMultiDrawElementsIndirect() is available
+	bool m_bMultiDrawSupported;
+	// the ring the instances and commands are uploaded through,
+	// or NULL to write them into the buffers directly
+	StreamBuffer* m_pStreamBuffer;
+
+	// write bytes into one of the buffers
+	void UploadBuffer(GLuint buffer, GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+
+	// add the quantized vertices and indices of a level of a
+	// shape to the shared vertex and index data, and return
+	// false when it has too many vertices for 16 bit indices
+	bool AddMesh(
+		MESH_TYPE mesh,
+		int level,
+		const ShapeGeometry::MESH_DATA& data,
+		std::vector<PACKED_VERTEX>& vertices,
+		std::vector<uint16_t>& indices);
+	// point the instance attributes of the vertex array at the
+	// passed in first instance of the instance buffer
+	void SetInstanceAttributes(int firstInstance);
+	// the level of a shape a draw uses - a level the shape does
+	// not have uses the coarsest one
+	int ClampLevel(MESH_TYPE mesh, int level) const;
+	// submit one command with a draw call of its own into the
+	// bound vertex array
+	void DrawCommand(const INDIRECT_COMMAND& command);
+
+public:
+	// generate and upload all of the basic shapes
+	void LoadMeshes();
+	// free all of the GPU buffers
+	void DestroyMeshes();
+	// set the ring the instances and commands are uploaded
+	// through
+	void SetStreamBuffer(StreamBuffer* pStreamBuffer);
+
+	// set the model matrix of an instance together with the
+	// normal matrix that is calculated from it
+	static void SetInstanceModel(INSTANCE_DATA& instance, const glm::mat4& model);
+
+	// make room for a number of instances in the instance
+	// buffer - the contents are lost when the buffer grows
+	void ReserveInstances(int instanceCount);
+	// replace the contents of the instance buffer
+	void UploadInstances(const INSTANCE_DATA* instances, int instanceCount);
+	// write instances into the instance buffer starting at the
+	// passed in first instance, keeping the others
+	void UploadInstances(const INSTANCE_DATA* instances, int instanceCount, int firstInstance);
+	// draw a range of the uploaded instances of a shape at a
+	// tessellation level - a level the shape does not have
+	// draws the coarsest one
+	void DrawInstanced(MESH_TYPE mesh, int firstInstance, int instanceCount, int level = 0);
+	// upload the passed in instances and draw all of them
+	void DrawInstanced(MESH_TYPE mesh, const INSTANCE_DATA* instances, int instanceCount);
+
+	// fill in the indirect command that draws a range of the
+	// uploaded instances of a shape at a tessellation level,
+	// and return false when the shape was not loaded
+	bool GetIndirectCommand(
+		MESH_TYPE mesh,
+		int level,
+		int firstInstance,
+		int instanceCount,
+		INDIRECT_COMMAND& command) const;
+	// write commands into the indirect command buffer starting
+	// at the passed in first command, keeping the others
+	void UploadIndirectCommands(const INDIRECT_COMMAND* commands, int commandCount, int firstCommand);
+	// draw a range of the uploaded indirect commands, with one
+	// multi-draw call when it is available
+	void DrawIndirect(int firstCommand, int commandCount);
+
+	// get the local space bounding box of a shape
+	void GetMeshBounds(MESH_TYPE mesh, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+	// get the number of indices drawn for one copy of a shape
+	int GetIndexCount(MESH_TYPE mesh, int level = 0) const;
+	// get the number of tessellation levels of a shape
+	int GetLevelCount(MESH_TYPE mesh) const;
+
+	// the instance and indirect command buffers, so the GPU
+	// culler can write the visible instances and their counts
+	GLuint GetInstanceBuffer() const;
+	GLuint GetIndirectBuffer() const;
+	// whether the draws can be submitted with multi-draw
+	bool IsMultiDrawSupported() const;
+};
@@ -0,0 +1,337 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// run small jobs on a pool of work stealing worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// the queue of the thread that is running, which is 0 for
+	// the threads outside of the pool
+	thread_local int t_queueIndex = 0;
+	// the number of batches each thread gets from ParallelFor,
+	// so a thread that finishes early can steal the rest
+	const int g_BatchesPerThread = 4;
+	// the number of jobs each queue has room for at the start
+	const size_t g_InitialQueueSize = 64;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(int workerCount)
+{
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+	}
+	if (workerCount < 0)
+	{
+		workerCount = 0;
+	}
+
+	m_nextQueue = 0;
+	m_queuedJobs = 0;
+	m_bStopping = false;
+
+	for (int i = 0; i <= workerCount; i++)
+	{
+		m_queues.push_back(std::unique_ptr<WORK_QUEUE>(new WORK_QUEUE()));
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i + 1));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStopping = true;
+	}
+	m_jobQueued.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+	m_queues.clear();
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by each of the worker threads.  It
+ *  runs jobs while there are any, and sleeps otherwise.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	t_queueIndex = queueIndex;
+
+	while (m_bStopping == false)
+	{
+		JOB job;
+
+		if (PopJob(queueIndex, job) == true)
+		{
+			RunJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_jobQueued.wait(lock, [this]()
+			{
+				return((m_queuedJobs > 0) || (m_bStopping == true));
+			});
+	}
+}
+
+/***********************************************************
+ *  PushBack()
+ *
+ *  This method is used for adding a job after the newest
+ *  job of a queue.  A full ring is copied into one twice as
+ *  large, with the oldest job first.
+ ***********************************************************/
+void JobSystem::WORK_QUEUE::PushBack(const JOB& job)
+{
+	if (jobCount == jobs.size())
+	{
+		std::vector<JOB> grownJobs(std::max(jobs.size() * 2, g_InitialQueueSize));
+
+		for (size_t i = 0; i < jobCount; i++)
+		{
+			grownJobs[i] = std::move(jobs[(firstJob + i) % jobs.size()]);
+		}
+		jobs.swap(grownJobs);
+		firstJob = 0;
+	}
+
+	jobs[(firstJob + jobCount) % jobs.size()] = job;
+	jobCount++;
+}
+
+/***********************************************************
+ *  PopBack()
+ *
+ *  This method is used for taking the newest job of a
+ *  queue.  The slot keeps its storage for the next job.
+ ***********************************************************/
+bool JobSystem::WORK_QUEUE::PopBack(JOB& job)
+{
+	if (jobCount == 0)
+	{
+		return(false);
+	}
+
+	jobCount--;
+	job = std::move(jobs[(firstJob + jobCount) % jobs.size()]);
+	return(true);
+}
+
+/***********************************************************
+ *  PopFront()
+ *
+ *  This method is used for taking the oldest job of a
+ *  queue, which is how other threads steal from it.
+ ***********************************************************/
+bool JobSystem::WORK_QUEUE::PopFront(JOB& job)
+{
+	if (jobCount == 0)
+	{
+		return(false);
+	}
+
+	job = std::move(jobs[firstJob]);
+	firstJob = (firstJob + 1) % jobs.size();
+	jobCount--;
+	return(true);
+}
+
+/***********************************************************
+ *  PopJob()
+ *
+ *  This method is used for taking the newest job from the
+ *  queue of a thread.  When that queue is empty, the oldest
+ *  job of the next queue that has one is stolen instead.
+ ***********************************************************/
+bool JobSystem::PopJob(int queueIndex, JOB& job)
+{
+	int queueCount = (int)m_queues.size();
+
+	if (m_queuedJobs <= 0)
+	{
+		return(false);
+	}
+
+	{
+		WORK_QUEUE& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.PopBack(job) == true)
+		{
+			m_queuedJobs--;
+			return(true);
+		}
+	}
+
+	for (int i = 1; i < queueCount; i++)
+	{
+		WORK_QUEUE& queue = *m_queues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.PopFront(job) == true)
+		{
+			m_queuedJobs--;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used for running a job and counting it as
+ *  done in its group.
+ ***********************************************************/
+void JobSystem::RunJob(JOB& job)
+{
+	job.function();
+	job.pGroup->pendingJobs--;
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding a job to a group.  A job
+ *  submitted from a worker goes into the queue of that
+ *  worker, and jobs from other threads are spread over all
+ *  of the queues.
+ ***********************************************************/
+void JobSystem::Submit(JOB_GROUP& group, const std::function<void()>& function)
+{
+	JOB job;
+	job.function = function;
+	job.pGroup = &group;
+
+	// without workers the job runs right away
+	if (m_workers.empty() == true)
+	{
+		group.pendingJobs++;
+		RunJob(job);
+		return;
+	}
+
+	int queueIndex = t_queueIndex;
+	if (queueIndex == 0)
+	{
+		queueIndex = (int)(m_nextQueue++ % (unsigned int)m_queues.size());
+	}
+
+	group.pendingJobs++;
+	{
+		WORK_QUEUE& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.PushBack(job);
+		m_queuedJobs++;
+	}
+
+	// the sleep mutex is taken so a worker that is about to
+	// sleep can not miss the signal
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_jobQueued.notify_one();
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for waiting until all of the jobs of
+ *  a group are done.  The waiting thread runs queued jobs
+ *  in the meantime, which may be jobs of other groups.
+ ***********************************************************/
+void JobSystem::Wait(JOB_GROUP& group)
+{
+	while (group.pendingJobs > 0)
+	{
+		JOB job;
+
+		if (PopJob(t_queueIndex, job) == true)
+		{
+			RunJob(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a job over a range of
+ *  items.  The range is cut into a few batches for each
+ *  thread, each of at least the passed in size, and the
+ *  call returns when every batch is done.  A range that is
+ *  too small to split runs on the calling thread.
+ ***********************************************************/
+void JobSystem::ParallelFor(int count, int minBatchSize, const RANGE_JOB& job)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	minBatchSize = std::max(minBatchSize, 1);
+	int batchCount = std::min(
+		(count + minBatchSize - 1) / minBatchSize,
+		GetThreadCount() * g_BatchesPerThread);
+
+	if ((batchCount <= 1) || (m_workers.empty() == true))
+	{
+		job(0, count);
+		return;
+	}
+
+	JOB_GROUP group;
+	int batchSize = (count + batchCount - 1) / batchCount;
+
+	for (int first = 0; first < count; first += batchSize)
+	{
+		int last = std::min(first + batchSize, count);
+		Submit(group, [&job, first, last]()
+			{
+				job(first, last);
+			});
+	}
+
+	Wait(group);
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method is used for getting the number of threads
+ *  that run jobs, including the thread that waits for them.
+ ***********************************************************/
+int JobSystem::GetThreadCount() const
+{
+	return((int)m_workers.size() + 1);
+}
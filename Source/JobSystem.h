@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// run small jobs on a pool of work stealing worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs on a pool of worker threads.  Each
+ *  thread has its own queue of jobs and takes the newest
+ *  job from it, and a thread whose queue is empty steals
+ *  the oldest job from another queue, so the work spreads
+ *  out over the threads without one shared queue that all
+ *  of them wait on.  The thread that waits for a group of
+ *  jobs runs jobs too instead of sleeping.
+ *
+ *  ParallelFor() splits a range of items into batches and
+ *  runs them as jobs, which is how the scene update uses
+ *  it.  The jobs must not make OpenGL calls, since only the
+ *  thread that owns the context may make them.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor - a worker count of 0 uses one thread
+	// less than the number of hardware threads
+	JobSystem(int workerCount = 0);
+	// destructor
+	~JobSystem();
+
+	// a range job is passed the first item and one past the
+	// last item of its batch
+	typedef std::function<void(int first, int last)> RANGE_JOB;
+
+	// a group of jobs that can be waited for together
+	struct JOB_GROUP
+	{
+		std::atomic<int> pendingJobs;
+
+		JOB_GROUP()
+		{
+			pendingJobs = 0;
+		}
+	};
+
+private:
+	struct JOB
+	{
+		std::function<void()> function;
+		JOB_GROUP* pGroup;
+	};
+
+	// the jobs of one thread, guarded by their own mutex - the
+	// jobs are kept in a ring that only grows when it is full,
+	// so queueing a job does not go to the heap once the ring
+	// is large enough for a frame
+	struct WORK_QUEUE
+	{
+		std::mutex mutex;
+		std::vector<JOB> jobs;
+		size_t firstJob;
+		size_t jobCount;
+
+		WORK_QUEUE()
+		{
+			firstJob = 0;
+			jobCount = 0;
+		}
+
+		// add a job after the newest one
+		void PushBack(const JOB& job);
+		// take the newest or the oldest job - false is returned
+		// when the queue is empty
+		bool PopBack(JOB& job);
+		bool PopFront(JOB& job);
+	};
+
+	// the worker threads
+	std::vector<std::thread> m_workers;
+	// one queue for the threads that submit jobs, followed by
+	// one queue for each worker thread
+	std::vector<std::unique_ptr<WORK_QUEUE>> m_queues;
+	// the queue the next job from outside the pool is put into
+	std::atomic<unsigned int> m_nextQueue;
+	// the number of jobs in all of the queues
+	std::atomic<int> m_queuedJobs;
+	// the idle workers sleep until a job is queued
+	std::mutex m_sleepMutex;
+	std::condition_variable m_jobQueued;
+	std::atomic<bool> m_bStopping;
+
+	// the loop each worker thread runs
+	void WorkerLoop(int queueIndex);
+	// take a job from a queue, or steal one from another
+	bool PopJob(int queueIndex, JOB& job);
+	// run a job and count it as done in its group
+	void RunJob(JOB& job);
+
+public:
+	// add a job to a group - the job may start right away
+	void Submit(JOB_GROUP& group, const std::function<void()>& function);
+	// run jobs until all of the jobs of the group are done
+	void Wait(JOB_GROUP& group);
+
+	// run a job over count items in batches of at least the
+	// passed in size, and return when all of them are done -
+	// small ranges run on the calling thread
+	void ParallelFor(int count, int minBatchSize, const RANGE_JOB& job);
+
+	// the number of threads that run jobs, including the one
+	// that waits for them
+	int GetThreadCount() const;
+};
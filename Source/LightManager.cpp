@@ -0,0 +1,698 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.cpp
+// ============
+// manage the scene point lights and assign them to view space clusters
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightManager.h"
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// the number of RGBA32F texels each light is stored in
+	const int LIGHT_TEXELS = sizeof(LightManager::POINT_LIGHT) / sizeof(glm::vec4);
+	// the smallest number of lights whose cluster ranges are
+	// found by one job
+	const int g_LightRangeBatch = 64;
+
+	// run a job over a range on the job system, or on this
+	// thread when there is none
+	void RunRange(JobSystem* pJobSystem, int count, int minBatchSize, const JobSystem::RANGE_JOB& job)
+	{
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(count, minBatchSize, job);
+		}
+		else
+		{
+			job(0, count);
+		}
+	}
+
+	// the projected x and y of a view space point, with the
+	// view space z transformed the same way the shader does
+	glm::vec2 ProjectPoint(const glm::mat4& projection, float x, float y, float z)
+	{
+		glm::vec4 clip = projection * glm::vec4(x, y, z, 1.0f);
+		return(glm::vec2(clip.x, clip.y) / clip.w);
+	}
+
+	// the grid cell of a normalized device coordinate
+	int GetTile(float ndc, int gridSize)
+	{
+		int tile = (int)floorf((ndc * 0.5f + 0.5f) * gridSize);
+		return((tile < 0) ? 0 : ((tile >= gridSize) ? gridSize - 1 : tile));
+	}
+
+	// the depth slice of a view space distance
+	int GetSlice(float depth, float sliceScale, float sliceBias)
+	{
+		int slice = (int)floorf(logf(depth) * sliceScale + sliceBias);
+		return((slice < 0) ? 0 : ((slice >= LightManager::CLUSTER_GRID_Z) ? LightManager::CLUSTER_GRID_Z - 1 : slice));
+	}
+}
+
+/***********************************************************
+ *  LightManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightManager::LightManager(UniformBufferManager* pUniformBuffers)
+{
+	m_pUniformBuffers = pUniformBuffers;
+	m_maxLightIndices = 0;
+	m_lightDataBuffer = 0;
+	m_lightDataTexture = 0;
+	m_clusterGridBuffer = 0;
+	m_clusterGridTexture = 0;
+	m_lightIndexBuffer = 0;
+	m_lightIndexTexture = 0;
+	m_lightDataCapacity = 0;
+	m_clusterGridCapacity = 0;
+	m_lightIndexCapacity = 0;
+	m_lastView = glm::mat4(0.0f);
+	m_lastProjection = glm::mat4(0.0f);
+	m_bLightsDirty = true;
+
+	m_clusterGrid.assign(CLUSTER_COUNT * 2, 0);
+	m_clusterCounts.assign(CLUSTER_COUNT, 0);
+	for (int i = 0; i < CLUSTER_GRID_Z; i++)
+	{
+		m_sliceIndexCounts[i] = 0;
+		m_sliceFirstIndices[i] = 0;
+	}
+	CreateBuffers();
+}
+
+/***********************************************************
+ *  ~LightManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightManager::~LightManager()
+{
+	DestroyBuffers();
+	m_pUniformBuffers = NULL;
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the texture buffers.
+ *  The light data buffer is read as RGBA32F texels, the
+ *  cluster grid as the first index and count of each
+ *  cluster, and the light index list as 16 bit indices.
+ ***********************************************************/
+void LightManager::CreateBuffers()
+{
+	GLint maxTexels = 0;
+
+	// the index list can not be larger than a texture buffer
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	m_maxLightIndices = (maxTexels > 0) ? (int)maxTexels : 65536;
+
+	glGenBuffers(1, &m_lightDataBuffer);
+	glGenBuffers(1, &m_clusterGridBuffer);
+	glGenBuffers(1, &m_lightIndexBuffer);
+	glGenTextures(1, &m_lightDataTexture);
+	glGenTextures(1, &m_clusterGridTexture);
+	glGenTextures(1, &m_lightIndexTexture);
+
+	// the buffers can not be empty, so each starts with one entry
+	POINT_LIGHT emptyLight = {};
+	uint16_t emptyIndex = 0;
+	UploadBuffer(m_lightDataBuffer, m_lightDataCapacity, &emptyLight, sizeof(emptyLight));
+	UploadBuffer(m_clusterGridBuffer, m_clusterGridCapacity, m_clusterGrid.data(), m_clusterGrid.size() * sizeof(uint32_t));
+	UploadBuffer(m_lightIndexBuffer, m_lightIndexCapacity, &emptyIndex, sizeof(emptyIndex));
+
+	glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightDataTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_lightDataBuffer);
+	glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_clusterGridTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, m_clusterGridBuffer);
+	glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightIndexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, m_lightIndexBuffer);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the texture buffers.
+ ***********************************************************/
+void LightManager::DestroyBuffers()
+{
+	if (m_lightDataBuffer != 0)
+	{
+		glDeleteTextures(1, &m_lightDataTexture);
+		glDeleteTextures(1, &m_clusterGridTexture);
+		glDeleteTextures(1, &m_lightIndexTexture);
+		glDeleteBuffers(1, &m_lightDataBuffer);
+		glDeleteBuffers(1, &m_clusterGridBuffer);
+		glDeleteBuffers(1, &m_lightIndexBuffer);
+	}
+
+	m_lightDataBuffer = 0;
+	m_lightDataTexture = 0;
+	m_clusterGridBuffer = 0;
+	m_clusterGridTexture = 0;
+	m_lightIndexBuffer = 0;
+	m_lightIndexTexture = 0;
+	m_lightDataCapacity = 0;
+	m_clusterGridCapacity = 0;
+	m_lightIndexCapacity = 0;
+}
+
+/***********************************************************
+ *  BindBuffers()
+ *
+ *  This method is used for binding the light buffers to
+ *  their texture units.
+ ***********************************************************/
+void LightManager::BindBuffers()
+{
+	glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightDataTexture);
+	glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_clusterGridTexture);
+	glActiveTexture(GL_TEXTURE0 + LIGHT_INDEX_UNIT);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightIndexTexture);
+	glActiveTexture(GL_TEXTURE0);
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_TEXTURE_BINDS, 3);
+}
+
+/***********************************************************
+ *  UploadBuffer()
+ *
+ *  This method is used for writing the contents of a
+ *  texture buffer.  The buffer keeps its storage, which is
+ *  only made larger when the contents do not fit, and the
+ *  contents go through the stream buffer so the upload does
+ *  not wait for the draws that still read the last ones.
+ *  The texels past the contents are never read, since the
+ *  lights are only found through the cluster grid.
+ ***********************************************************/
+void LightManager::UploadBuffer(GLuint bufferID, size_t& capacity, const void* data, size_t size)
+{
+	if (size > capacity)
+	{
+		capacity = size + size / 2;
+		glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+		glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)capacity, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->GetStreamBuffer()->Upload(bufferID, 0, data, (GLsizeiptr)size);
+		return;
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)size, data);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  AddPointLight()
+ *
+ *  This method is used for adding a point light.  The light
+ *  fades out smoothly and has no effect past its radius,
+ *  which is what keeps it inside of a few clusters.
+ ***********************************************************/
+int LightManager::AddPointLight(
+	glm::vec3 position,
+	float radius,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular)
+{
+	if ((int)m_pointLights.size() >= MAX_POINT_LIGHTS)
+	{
+		return(-1);
+	}
+
+	POINT_LIGHT light = {};
+	light.position = position;
+	light.radius = radius;
+	light.ambient = ambient;
+	light.shadowIndex = -1.0f;
+	light.diffuse = diffuse;
+	light.specular = specular;
+
+	m_pointLights.push_back(light);
+	m_lightActive.push_back(1);
+	m_bLightsDirty = true;
+
+	return((int)m_pointLights.size() - 1);
+}
+
+/***********************************************************
+ *  SetPointLightPosition()
+ *
+ *  This method is used for moving a point light.
+ ***********************************************************/
+void LightManager::SetPointLightPosition(int index, glm::vec3 position)
+{
+	if ((index < 0) || (index >= (int)m_pointLights.size()))
+	{
+		return;
+	}
+
+	m_pointLights[index].position = position;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  SetPointLightColor()
+ *
+ *  This method is used for changing the colors of a point
+ *  light.
+ ***********************************************************/
+void LightManager::SetPointLightColor(
+	int index,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular)
+{
+	if ((index < 0) || (index >= (int)m_pointLights.size()))
+	{
+		return;
+	}
+
+	m_pointLights[index].ambient = ambient;
+	m_pointLights[index].diffuse = diffuse;
+	m_pointLights[index].specular = specular;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  SetPointLightActive()
+ *
+ *  This method is used for switching a point light on or
+ *  off.  Switched off lights are left out of the clusters.
+ ***********************************************************/
+void LightManager::SetPointLightActive(int index, bool bActive)
+{
+	if ((index < 0) || (index >= (int)m_pointLights.size()))
+	{
+		return;
+	}
+
+	m_lightActive[index] = (bActive == true) ? 1 : 0;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  SetPointLightShadow()
+ *
+ *  This method is used for setting the point shadow map
+ *  that a light is shadowed by.  The index is stored with
+ *  the light so the shader can find the map of each light
+ *  that lights a fragment.
+ ***********************************************************/
+void LightManager::SetPointLightShadow(int index, int shadowIndex)
+{
+	if ((index < 0) || (index >= (int)m_pointLights.size()))
+	{
+		return;
+	}
+
+	m_pointLights[index].shadowIndex = (float)shadowIndex;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetPointLight()
+ *
+ *  This method is used for getting a point light.  The
+ *  index must be below the point light count.
+ ***********************************************************/
+const LightManager::POINT_LIGHT& LightManager::GetPointLight(int index) const
+{
+	return(m_pointLights[index]);
+}
+
+/***********************************************************
+ *  ClearPointLights()
+ *
+ *  This method is used for removing all of the point lights.
+ ***********************************************************/
+void LightManager::ClearPointLights()
+{
+	m_pointLights.clear();
+	m_lightActive.clear();
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetPointLightCount()
+ *
+ *  This method is used for getting the number of point
+ *  lights, including the switched off ones.
+ ***********************************************************/
+int LightManager::GetPointLightCount() const
+{
+	return((int)m_pointLights.size());
+}
+
+/***********************************************************
+ *  GetLightIndexCount()
+ *
+ *  This method is used for getting the number of light
+ *  indices in the cluster lists after the last assignment.
+ ***********************************************************/
+int LightManager::GetLightIndexCount() const
+{
+	return((int)m_lightIndices.size());
+}
+
+/***********************************************************
+ *  GetDepthRange()
+ *
+ *  This method is used for reading the near and far
+ *  distances of a projection matrix.  A perspective
+ *  projection has -1 at [2][3] and an orthographic one has
+ *  0 there, and each stores the distances differently.
+ ***********************************************************/
+void LightManager::GetDepthRange(const glm::mat4& projection, float& zNear, float& zFar)
+{
+	if (projection[2][3] != 0.0f)
+	{
+		zNear = projection[3][2] / (projection[2][2] - 1.0f);
+		zFar = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		zNear = (projection[3][2] + 1.0f) / projection[2][2];
+		zFar = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+}
+
+/***********************************************************
+ *  FindClusterRange()
+ *
+ *  This method is used for finding the clusters that the
+ *  sphere of a light touches.  The view space box around
+ *  the sphere is clipped to the near and far distances, and
+ *  its corners are projected to find the screen tiles.  The
+ *  projection of a box is always bounded by its corners
+ *  when the box is in front of the camera, so the range
+ *  never misses a cluster the light reaches.
+ ***********************************************************/
+bool LightManager::FindClusterRange(
+	const POINT_LIGHT& light,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	float zNear,
+	float zFar,
+	float sliceScale,
+	float sliceBias,
+	CLUSTER_RANGE& range) const
+{
+	glm::vec4 center = view * glm::vec4(light.position, 1.0f);
+	float radius = light.radius;
+
+	// the view looks down the negative z axis
+	float frontZ = fminf(center.z + radius, -zNear);
+	float backZ = fmaxf(center.z - radius, -zFar);
+	if (backZ > frontZ)
+	{
+		return(false);
+	}
+
+	glm::vec2 ndcMin(FLT_MAX, FLT_MAX);
+	glm::vec2 ndcMax(-FLT_MAX, -FLT_MAX);
+	const float cornerX[2] = { center.x - radius, center.x + radius };
+	const float cornerY[2] = { center.y - radius, center.y + radius };
+	const float cornerZ[2] = { frontZ, backZ };
+
+	for (int x = 0; x < 2; x++)
+	{
+		for (int y = 0; y < 2; y++)
+		{
+			for (int z = 0; z < 2; z++)
+			{
+				glm::vec2 ndc = ProjectPoint(projection, cornerX[x], cornerY[y], cornerZ[z]);
+				ndcMin = glm::min(ndcMin, ndc);
+				ndcMax = glm::max(ndcMax, ndc);
+			}
+		}
+	}
+
+	if ((ndcMax.x < -1.0f) || (ndcMin.x > 1.0f) ||
+		(ndcMax.y < -1.0f) || (ndcMin.y > 1.0f))
+	{
+		return(false);
+	}
+
+	range.minX = GetTile(ndcMin.x, CLUSTER_GRID_X);
+	range.maxX = GetTile(ndcMax.x, CLUSTER_GRID_X);
+	range.minY = GetTile(ndcMin.y, CLUSTER_GRID_Y);
+	range.maxY = GetTile(ndcMax.y, CLUSTER_GRID_Y);
+	range.minZ = GetSlice(-frontZ, sliceScale, sliceBias);
+	range.maxZ = GetSlice(-backZ, sliceScale, sliceBias);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CountSliceLights()
+ *
+ *  This method is used for counting the lights that touch
+ *  each cluster of one depth slice.  Each count is limited
+ *  to the largest cluster light count, and the counts of the
+ *  slice are added up, so the slices can be given their
+ *  first light index before any of the lists are filled.
+ *  Only the counts of the slice are written.
+ ***********************************************************/
+void LightManager::CountSliceLights(int slice)
+{
+	uint32_t* pCounts = &m_clusterCounts[slice * CLUSTER_GRID_Y * CLUSTER_GRID_X];
+	uint32_t sliceCount = 0;
+
+	std::fill(pCounts, pCounts + CLUSTER_GRID_Y * CLUSTER_GRID_X, 0);
+	for (size_t i = 0; i < m_lightRanges.size(); i++)
+	{
+		const CLUSTER_RANGE& range = m_lightRanges[i];
+
+		if ((slice < range.minZ) || (slice > range.maxZ))
+		{
+			continue;
+		}
+
+		for (int y = range.minY; y <= range.maxY; y++)
+		{
+			for (int x = range.minX; x <= range.maxX; x++)
+			{
+				pCounts[y * CLUSTER_GRID_X + x]++;
+			}
+		}
+	}
+
+	for (int i = 0; i < CLUSTER_GRID_Y * CLUSTER_GRID_X; i++)
+	{
+		if (pCounts[i] > (uint32_t)MAX_CLUSTER_LIGHTS)
+		{
+			pCounts[i] = MAX_CLUSTER_LIGHTS;
+		}
+		sliceCount += pCounts[i];
+	}
+	m_sliceIndexCounts[slice] = sliceCount;
+}
+
+/***********************************************************
+ *  FillSliceLights()
+ *
+ *  This method is used for filling the light lists of the
+ *  clusters of one depth slice.  The lists of the slice
+ *  start at its first light index, and are cut short where
+ *  the index buffer is full, so every slice writes its own
+ *  part of the index list and its own part of the grid.
+ *  The lights are visited in order, so each list is sorted.
+ ***********************************************************/
+void LightManager::FillSliceLights(int slice)
+{
+	int firstCluster = slice * CLUSTER_GRID_Y * CLUSTER_GRID_X;
+	uint32_t indexCount = m_sliceFirstIndices[slice];
+
+	// turn the counts into the first index of each list
+	for (int i = firstCluster; i < firstCluster + CLUSTER_GRID_Y * CLUSTER_GRID_X; i++)
+	{
+		uint32_t count = m_clusterCounts[i];
+
+		if (indexCount + count > (uint32_t)m_maxLightIndices)
+		{
+			count = (uint32_t)m_maxLightIndices - indexCount;
+		}
+
+		m_clusterGrid[i * 2] = indexCount;
+		m_clusterGrid[i * 2 + 1] = 0;
+		m_clusterCounts[i] = count;
+		indexCount += count;
+	}
+
+	// fill the lists, counting each cluster back up
+	for (size_t i = 0; i < m_lightRanges.size(); i++)
+	{
+		const CLUSTER_RANGE& range = m_lightRanges[i];
+
+		if ((slice < range.minZ) || (slice > range.maxZ))
+		{
+			continue;
+		}
+
+		for (int y = range.minY; y <= range.maxY; y++)
+		{
+			int cluster = firstCluster + y * CLUSTER_GRID_X;
+			for (int x = range.minX; x <= range.maxX; x++)
+			{
+				uint32_t* entry = &m_clusterGrid[(cluster + x) * 2];
+
+				if (entry[1] < m_clusterCounts[cluster + x])
+				{
+					m_lightIndices[entry[0] + entry[1]] = (uint16_t)i;
+					entry[1]++;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  AssignLights()
+ *
+ *  This method is used for sorting the lights into the
+ *  clusters of the passed in view.  The cluster range of
+ *  each light is found, the lights are counted into the
+ *  clusters of each depth slice, the slice totals are
+ *  turned into the first index of each slice, and the lists
+ *  of each slice are then filled, so the lists are built
+ *  without any sorting or per-cluster allocations.  Each
+ *  step only writes the values of its own lights or its own
+ *  slice, so with a job system the steps are split over the
+ *  lights and over the slices without any locking.  The
+ *  near and far distances are read from the projection
+ *  matrix, so the clusters follow both perspective and
+ *  orthographic views.
+ ***********************************************************/
+void LightManager::AssignLights(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	JobSystem* pJobSystem)
+{
+	if ((m_bLightsDirty == false) &&
+		(view == m_lastView) &&
+		(projection == m_lastProjection))
+	{
+		return;
+	}
+
+	float zNear = 0.0f;
+	float zFar = 0.0f;
+	GetDepthRange(projection, zNear, zFar);
+	// the depth slices start at the near distance, which must
+	// be in front of the camera for the logarithm
+	zNear = fmaxf(zNear, 0.01f);
+	zFar = fmaxf(zFar, zNear * 2.0f);
+
+	float sliceScale = CLUSTER_GRID_Z / logf(zFar / zNear);
+	float sliceBias = -logf(zNear) * sliceScale;
+
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->SetClusterGrid(
+			CLUSTER_GRID_X,
+			CLUSTER_GRID_Y,
+			CLUSTER_GRID_Z,
+			zNear,
+			zFar,
+			sliceScale,
+			sliceBias);
+	}
+
+	// upload the switched on lights when any light has changed
+	if (m_bLightsDirty == true)
+	{
+		m_activeLights.clear();
+		for (size_t i = 0; i < m_pointLights.size(); i++)
+		{
+			if (m_lightActive[i] != 0)
+			{
+				m_activeLights.push_back(m_pointLights[i]);
+			}
+		}
+
+		if (m_activeLights.empty() == false)
+		{
+			UploadBuffer(m_lightDataBuffer, m_lightDataCapacity, m_activeLights.data(), m_activeLights.size() * sizeof(POINT_LIGHT));
+		}
+	}
+
+	// find the clusters each light touches
+	m_lightRanges.resize(m_activeLights.size());
+	RunRange(pJobSystem, (int)m_activeLights.size(), g_LightRangeBatch,
+		[this, &view, &projection, zNear, zFar, sliceScale, sliceBias](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				CLUSTER_RANGE& range = m_lightRanges[i];
+
+				if (FindClusterRange(m_activeLights[i], view, projection, zNear, zFar, sliceScale, sliceBias, range) == false)
+				{
+					// an empty range, so the light is skipped below
+					range.minZ = 1;
+					range.maxZ = 0;
+				}
+			}
+		});
+
+	// count the lights that touch each cluster of each slice
+	RunRange(pJobSystem, CLUSTER_GRID_Z, 1, [this](int first, int last)
+		{
+			for (int slice = first; slice < last; slice++)
+			{
+				CountSliceLights(slice);
+			}
+		});
+
+	// give each slice the first index of its lists, with all
+	// of the lists limited to the size of the index buffer
+	uint32_t indexCount = 0;
+	for (int slice = 0; slice < CLUSTER_GRID_Z; slice++)
+	{
+		m_sliceFirstIndices[slice] = indexCount;
+		indexCount += m_sliceIndexCounts[slice];
+		if (indexCount > (uint32_t)m_maxLightIndices)
+		{
+			indexCount = (uint32_t)m_maxLightIndices;
+		}
+	}
+
+	// fill the lists of each slice
+	m_lightIndices.resize(indexCount);
+	RunRange(pJobSystem, CLUSTER_GRID_Z, 1, [this](int first, int last)
+		{
+			for (int slice = first; slice < last; slice++)
+			{
+				FillSliceLights(slice);
+			}
+		});
+
+	UploadBuffer(m_clusterGridBuffer, m_clusterGridCapacity, m_clusterGrid.data(), m_clusterGrid.size() * sizeof(uint32_t));
+	if (m_lightIndices.empty() == false)
+	{
+		UploadBuffer(m_lightIndexBuffer, m_lightIndexCapacity, m_lightIndices.data(), m_lightIndices.size() * sizeof(uint16_t));
+	}
+
+	m_lastView = view;
+	m_lastProjection = projection;
+	m_bLightsDirty = false;
+}
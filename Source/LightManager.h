@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.h
+// ============
+// manage the scene point lights and assign them to view space clusters
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+#include "UniformBuffers.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  LightManager
+ *
+ *  This class holds the point lights of the scene and
+ *  sorts them into a grid of clusters that divides the
+ *  view frustum into screen tiles and depth slices.  The
+ *  depth slices get deeper with distance, so clusters
+ *  near the camera stay small.  Each fragment only lights
+ *  itself with the lights of its own cluster, so the cost
+ *  of a fragment depends on the number of lights near it
+ *  instead of the number of lights in the scene.
+ *
+ *  The lights, the light range of each cluster and the
+ *  list of light indices are stored in texture buffers,
+ *  which the fragment shader reads with texelFetch().
+ *  They stay bound to the texture units after the scene
+ *  texture arrays.
+ ***********************************************************/
+class LightManager
+{
+public:
+	// constructor
+	LightManager(UniformBufferManager* pUniformBuffers);
+	// destructor
+	~LightManager();
+
+	// the size of the cluster grid - these must match the
+	// cluster block values read by fragmentShader.glsl
+	static const int CLUSTER_GRID_X = 16;
+	static const int CLUSTER_GRID_Y = 9;
+	static const int CLUSTER_GRID_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+	// the largest number of point lights
+	static const int MAX_POINT_LIGHTS = 4096;
+	// the largest number of lights that light one cluster,
+	// which bounds the cost of each fragment
+	static const int MAX_CLUSTER_LIGHTS = 128;
+
+	// the texture units the light buffers are bound to, after
+	// the units used by the scene texture arrays
+	static const int LIGHT_DATA_UNIT = 8;
+	static const int CLUSTER_GRID_UNIT = 9;
+	static const int LIGHT_INDEX_UNIT = 10;
+
+	// a point light as it is stored in the light data buffer,
+	// which is read as four RGBA32F texels per light
+	struct POINT_LIGHT
+	{
+		glm::vec3 position;
+		// the distance at which the light fades out completely
+		float radius;
+		glm::vec3 ambient;
+		// the point shadow map of the light, or -1 for none
+		float shadowIndex;
+		glm::vec3 diffuse;
+		float pad1;
+		glm::vec3 specular;
+		float pad2;
+	};
+
+private:
+	// the range of clusters a light touches
+	struct CLUSTER_RANGE
+	{
+		int minX;
+		int maxX;
+		int minY;
+		int maxY;
+		int minZ;
+		int maxZ;
+	};
+
+	// pointer to the shared uniform buffers
+	UniformBufferManager* m_pUniformBuffers;
+	// every point light, and whether it is switched on
+	std::vector<POINT_LIGHT> m_pointLights;
+	std::vector<uint8_t> m_lightActive;
+	// the lights that are switched on, as they are uploaded
+	std::vector<POINT_LIGHT> m_activeLights;
+	// the cluster range of each switched on light this frame
+	std::vector<CLUSTER_RANGE> m_lightRanges;
+	// the number of lights that touch each cluster
+	std::vector<uint32_t> m_clusterCounts;
+	// the number of light indices of each depth slice, and the
+	// first light index of each slice
+	uint32_t m_sliceIndexCounts[CLUSTER_GRID_Z];
+	uint32_t m_sliceFirstIndices[CLUSTER_GRID_Z];
+	// the first light index and light count of each cluster
+	std::vector<uint32_t> m_clusterGrid;
+	// the light indices of all of the clusters
+	std::vector<uint16_t> m_lightIndices;
+	// the largest number of light indices the index buffer
+	// can hold on this device
+	int m_maxLightIndices;
+
+	// the texture buffers and their textures
+	GLuint m_lightDataBuffer;
+	GLuint m_lightDataTexture;
+	GLuint m_clusterGridBuffer;
+	GLuint m_clusterGridTexture;
+	GLuint m_lightIndexBuffer;
+	GLuint m_lightIndexTexture;
+	// the bytes each texture buffer has room for - the buffers
+	// only grow, and the lists are written into their start
+	size_t m_lightDataCapacity;
+	size_t m_clusterGridCapacity;
+	size_t m_lightIndexCapacity;
+
+	// the view the clusters were last built for
+	glm::mat4 m_lastView;
+	glm::mat4 m_lastProjection;
+	// set when any light changed since the last assignment
+	bool m_bLightsDirty;
+
+	// create the texture buffers
+	void CreateBuffers();
+	// find the clusters a light touches - false is returned
+	// when the light is outside of the view
+	bool FindClusterRange(
+		const POINT_LIGHT& light,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		float zNear,
+		float zFar,
+		float sliceScale,
+		float sliceBias,
+		CLUSTER_RANGE& range) const;
+	// write the contents of a texture buffer, making it larger
+	// first when they do not fit
+	void UploadBuffer(GLuint bufferID, size_t& capacity, const void* data, size_t size);
+	// count the lights of the clusters of one depth slice, and
+	// fill the light lists of the slice
+	void CountSliceLights(int slice);
+	void FillSliceLights(int slice);
+
+public:
+	// add a point light and return its index, or -1 when the
+	// largest number of lights has been reached
+	int AddPointLight(
+		glm::vec3 position,
+		float radius,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular);
+	// move a point light
+	void SetPointLightPosition(int index, glm::vec3 position);
+	// change the colors of a point light
+	void SetPointLightColor(
+		int index,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular);
+	// switch a point light on or off
+	void SetPointLightActive(int index, bool bActive);
+	// set the point shadow map a light is shadowed by, or -1
+	// when the light does not cast shadows
+	void SetPointLightShadow(int index, int shadowIndex);
+	// get a point light
+	const POINT_LIGHT& GetPointLight(int index) const;
+	// remove all of the point lights
+	void ClearPointLights();
+	// the number of point lights, including the switched off ones
+	int GetPointLightCount() const;
+
+	// sort the switched on lights into the clusters of the
+	// passed in view and upload the cluster lists - nothing is
+	// done when the view and the lights have not changed, and
+	// the depth slices are sorted on the job system when one
+	// is passed in
+	void AssignLights(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		JobSystem* pJobSystem = NULL);
+
+	// bind the light buffers to their texture units
+	void BindBuffers();
+	// free the light buffers
+	void DestroyBuffers();
+
+	// the number of light indices in the cluster lists
+	int GetLightIndexCount() const;
+
+	// read the near and far distances of a perspective or an
+	// orthographic projection matrix
+	static void GetDepthRange(const glm::mat4& projection, float& zNear, float& zFar);
+};
@@ -9,6 +9,7 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -22,6 +23,11 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "UniformBuffers.h"
+#include "Benchmarks.h"
+#include "FrameProfiler.h"
+#include "FrameScheduler.h"
+#include "RenderTargets.h"
 
 // Namespace for declaring global variables
 namespace
@@ -38,6 +44,27 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// uniform buffers for the camera, lights and materials
+	UniformBufferManager* g_UniformBuffers = nullptr;
+	// profiler that times the parts of each frame
+	FrameProfiler* g_FrameProfiler = nullptr;
+	// scheduler that paces the frames of the main loop
+	FrameScheduler* g_FrameScheduler = nullptr;
+	// offscreen target the scene is drawn into at the render
+	// resolution before it is presented to the window
+	RenderTargets* g_RenderTargets = nullptr;
+
+	// the number of frames captured by --trace, and how often
+	// the window title shows the profiler summary
+	const int TRACE_FRAME_COUNT = 300;
+	const int TITLE_UPDATE_FRAMES = 30;
+
+	// the size of the generated scene used by --benchmark when
+	// no object count is passed in
+	const int BENCHMARK_OBJECT_COUNT = 1000;
+
+	// the scene file that is loaded when --scene is not passed in
+	const char* DEFAULT_SCENE_FILE = "scenes/desk.scene";
 }
 
 // Function declarations - all functions that are called manually
@@ -54,12 +81,133 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the benchmarks run without a window or an OpenGL context
+	if ((argc > 1) && (strcmp(argv[1], "--bench-bvh") == 0))
+	{
+		return(Benchmarks::RunBVHBenchmark());
+	}
+
+	// --benchmark [frames] [objects] [camera path file] renders
+	// a generated scene along a camera path and prints the
+	// frame times instead of showing the window - the values
+	// end at the first option after them
+	bool bBenchmark = ((argc > 1) && (strcmp(argv[1], "--benchmark") == 0));
+	Benchmarks::SCENE_BENCHMARK_SETTINGS benchmarkSettings;
+	int benchmarkObjects = BENCHMARK_OBJECT_COUNT;
+	if (bBenchmark == true)
+	{
+		int valueCount = 0;
+		while ((valueCount < 3) && (2 + valueCount < argc) &&
+			(strncmp(argv[2 + valueCount], "--", 2) != 0))
+		{
+			valueCount++;
+		}
+		if (valueCount > 0)
+		{
+			benchmarkSettings.frameCount = atoi(argv[2]);
+		}
+		if (valueCount > 1)
+		{
+			benchmarkObjects = atoi(argv[3]);
+		}
+		if (valueCount > 2)
+		{
+			benchmarkSettings.cameraPathFile = argv[4];
+		}
+	}
+
+	// --swap-interval <n>, --max-fps <n> and --triple-buffer
+	// set how the frames of the main loop are paced, and
+	// --scene <file> picks the scene file that is loaded -
+	// --no-hot-reload stops the asset files being watched,
+	// --cull <cpu|gpu|occlusion> picks where objects are culled,
+	// --transparency <sorted|weighted> picks how the
+	// transparent objects are blended, --depth-prepass writes
+	// the depth of the opaque objects before they are lit, and
+	// --compare-prepass has the benchmark time both ways -
+	// --render-scale <scale> draws the scene at a fraction of
+	// the window size, --target-frame-ms <ms> lets the scale
+	// follow the GPU time of the frames, and --sharpness <0-1>
+	// sets how much the scaled up scene is sharpened -
+	// --trace <file> captures the frames into a Chrome trace
+	FrameScheduler::SCHEDULER_SETTINGS schedulerSettings;
+	RenderTargets::RESOLUTION_SETTINGS resolutionSettings;
+	std::string sceneFile = DEFAULT_SCENE_FILE;
+	bool bHotReload = (bBenchmark == false);
+	const char* cullingMode = NULL;
+	const char* transparencyMode = NULL;
+	bool bDepthPrepass = false;
+	const char* traceFile = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--scene") == 0) && (i + 1 < argc))
+		{
+			sceneFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--cull") == 0) && (i + 1 < argc))
+		{
+			cullingMode = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--transparency") == 0) && (i + 1 < argc))
+		{
+			transparencyMode = argv[++i];
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			bDepthPrepass = true;
+		}
+		else if (strcmp(argv[i], "--compare-prepass") == 0)
+		{
+			benchmarkSettings.bCompareDepthPrepass = true;
+		}
+		else if (strcmp(argv[i], "--no-hot-reload") == 0)
+		{
+			bHotReload = false;
+		}
+		else if ((strcmp(argv[i], "--swap-interval") == 0) && (i + 1 < argc))
+		{
+			schedulerSettings.swapInterval = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--max-fps") == 0) && (i + 1 < argc))
+		{
+			schedulerSettings.maxFrameRate = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--triple-buffer") == 0)
+		{
+			schedulerSettings.bTripleBuffering = true;
+		}
+		else if ((strcmp(argv[i], "--render-scale") == 0) && (i + 1 < argc))
+		{
+			resolutionSettings.renderScale = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--target-frame-ms") == 0) && (i + 1 < argc))
+		{
+			resolutionSettings.bDynamicResolution = true;
+			resolutionSettings.targetFrameTime = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--sharpness") == 0) && (i + 1 < argc))
+		{
+			resolutionSettings.sharpness = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+		{
+			traceFile = argv[++i];
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// the benchmark still needs a window for its OpenGL context,
+	// but the window is never shown
+	if (bBenchmark == true)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
@@ -75,39 +223,195 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// the profiler times the frames from here on, and captures
+	// them into the trace file when one was passed in
+	g_FrameProfiler = new FrameProfiler();
+	g_FrameProfiler->MakeActive();
+	g_FrameProfiler->CreateQueries();
+	if (NULL != traceFile)
+	{
+		g_FrameProfiler->StartTrace(traceFile, TRACE_FRAME_COUNT);
+	}
+
+	// the swap interval is set on the context of the window
+	g_FrameScheduler = new FrameScheduler();
+	g_FrameScheduler->SetSettings(schedulerSettings);
+
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
 		"shaders/vertexShader.glsl",
 		"shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
+	// create the uniform buffers that are shared by the shader
+	// programs and connect them to the loaded program
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	g_UniformBuffers = new UniformBufferManager();
+	g_UniformBuffers->CreateBuffers();
+	g_UniformBuffers->BindProgram((GLuint)programID);
+	g_ViewManager->SetUniformBuffers(g_UniformBuffers);
+
+	// the scene is drawn into the window directly when the
+	// present program can not be loaded
+	g_RenderTargets = new RenderTargets(g_UniformBuffers);
+	g_RenderTargets->SetSettings(resolutionSettings);
+	g_RenderTargets->LoadShaders(
+		"shaders/fullscreenVertexShader.glsl",
+		"shaders/presentFragmentShader.glsl");
+
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_UniformBuffers);
+	if (bBenchmark == true)
+	{
+		g_SceneManager->SetSyntheticSceneSize(benchmarkObjects);
+	}
+	g_SceneManager->SetSceneFile(sceneFile);
 	g_SceneManager->PrepareScene();
+	if (bHotReload == true)
+	{
+		g_SceneManager->EnableHotReload();
+	}
+	if (NULL != cullingMode)
+	{
+		int mode = 0;
+		while ((mode < SceneManager::CULL_MODE_COUNT) &&
+			(strcmp(cullingMode, SceneManager::GetCullingModeName((SceneManager::CULLING_MODE)mode)) != 0))
+		{
+			mode++;
+		}
+		if (mode < SceneManager::CULL_MODE_COUNT)
+		{
+			g_SceneManager->SetCullingMode((SceneManager::CULLING_MODE)mode);
+		}
+		else
+		{
+			std::cout << "Unknown culling mode:" << cullingMode << std::endl;
+		}
+	}
+	if (NULL != transparencyMode)
+	{
+		int mode = 0;
+		while ((mode < SceneManager::TRANSPARENCY_MODE_COUNT) &&
+			(strcmp(transparencyMode, SceneManager::GetTransparencyModeName((SceneManager::TRANSPARENCY_MODE)mode)) != 0))
+		{
+			mode++;
+		}
+		if (mode < SceneManager::TRANSPARENCY_MODE_COUNT)
+		{
+			g_SceneManager->SetTransparencyMode((SceneManager::TRANSPARENCY_MODE)mode);
+		}
+		else
+		{
+			std::cout << "Unknown transparency mode:" << transparencyMode << std::endl;
+		}
+	}
+	if (bDepthPrepass == true)
+	{
+		g_SceneManager->SetDepthPrepass(true);
+	}
+	g_ViewManager->SetSceneManager(g_SceneManager);
+
+	int exitCode = EXIT_SUCCESS;
+	if (bBenchmark == true)
+	{
+		exitCode = Benchmarks::RunSceneBenchmark(
+			benchmarkSettings,
+			g_Window,
+			g_ViewManager,
+			g_SceneManager,
+			g_FrameProfiler);
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	int frameCount = 0;
+	while ((bBenchmark == false) && !glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		g_FrameProfiler->BeginFrame();
+		int updateSteps = g_FrameScheduler->BeginFrame();
+
+		// query the latest GLFW events at the start of the frame,
+		// so the frame is drawn with the newest input
+		{
+			ProfileScope scope("PollEvents");
+			glfwPollEvents();
+			g_ViewManager->ProcessInput();
+		}
+
+		// move the simulation forward in fixed time steps
+		{
+			ProfileScope scope("Update");
+			for (int step = 0; step < updateSteps; step++)
+			{
+				g_ViewManager->UpdateCamera(g_FrameScheduler->GetFixedTimeStep());
+			}
+			g_ViewManager->SetInterpolation(g_FrameScheduler->GetInterpolation());
+		}
+
+		// swap in the shaders, textures and scene files that
+		// were changed while the program runs
+		{
+			ProfileScope scope("AssetReload");
+			g_SceneManager->ProcessAssetChanges();
+		}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		// the scene is drawn offscreen at a render resolution that
+		// follows the size of the window and the GPU time of the
+		// last frames that were read back
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+		g_RenderTargets->SetDisplaySize(framebufferWidth, framebufferHeight);
+		g_RenderTargets->UpdateRenderScale(g_FrameProfiler->GetLastFrame().gpuTime);
+		g_RenderTargets->BeginScene();
+
+		// Clear the frame and z buffers - the depth test and the
+		// clear color are set once when the window is created
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		{
+			ProfileScope scope("PrepareSceneView");
+			g_ViewManager->PrepareSceneView();
+		}
 
 		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		{
+			ProfileScope scope("RenderScene");
+			g_SceneManager->RenderScene();
+		}
+
+		// scale the scene up to the window and sharpen it
+		{
+			ProfileScope scope("Present");
+			ProfileGpuScope gpuScope("Present");
+			g_RenderTargets->PresentScene();
+		}
 
+		// draw the timings of the last frame over the scene
+		g_FrameProfiler->DrawOverlay();
 
 		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		{
+			ProfileScope scope("SwapBuffers");
+			glfwSwapBuffers(g_Window);
+		}
+
+		// wait for the GPU and the frame rate cap
+		g_FrameScheduler->EndFrame();
 
-		// query the latest GLFW events
-		glfwPollEvents();
+		g_FrameProfiler->EndFrame();
+
+		// the numbers go into the window title while the
+		// overlay is shown
+		frameCount++;
+		if ((g_FrameProfiler->IsOverlayVisible() == true) &&
+			((frameCount % TITLE_UPDATE_FRAMES) == 0))
+		{
+			std::string title = std::string(WINDOW_TITLE) + " - " + g_FrameProfiler->GetSummary();
+			glfwSetWindowTitle(g_Window, title.c_str());
+		}
 	}
 
 	// clear the allocated manager objects from memory
@@ -121,14 +425,36 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_RenderTargets)
+	{
+		delete g_RenderTargets;
+		g_RenderTargets = NULL;
+	}
+	if (NULL != g_UniformBuffers)
+	{
+		delete g_UniformBuffers;
+		g_UniformBuffers = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_FrameScheduler)
+	{
+		g_FrameScheduler->DestroyFences();
+		delete g_FrameScheduler;
+		g_FrameScheduler = NULL;
+	}
+	if (NULL != g_FrameProfiler)
+	{
+		g_FrameProfiler->DestroyQueries();
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program with the result of the run
+	exit(exitCode); 
 }
 
 /***********************************************************
@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////
+// memoryarena.cpp
+// ============
+// hand out the per-frame scratch memory and the pooled objects without
+// going to the heap
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MemoryArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+// declaration of global variables
+namespace
+{
+	// the number of allocations made with the global operator
+	// new - this is set before any constructor runs, so the
+	// allocations of the static objects are counted as well
+	std::atomic<uint64_t> g_HeapAllocations(0);
+	// the extra blocks of a frame that overflowed are at
+	// least this large, so a frame does not make many of them
+	const size_t g_MinOverflowBlock = 64 * 1024;
+}
+
+/***********************************************************
+ *  operator new()
+ *
+ *  The global operator new is replaced so the allocations
+ *  of every thread can be counted.  The array and nothrow
+ *  forms call this one, so they are counted too.
+ ***********************************************************/
+void* operator new(std::size_t size)
+{
+	g_HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (size == 0)
+	{
+		size = 1;
+	}
+
+	void* pMemory = std::malloc(size);
+	while (NULL == pMemory)
+	{
+		std::new_handler handler = std::get_new_handler();
+		if (NULL == handler)
+		{
+			throw std::bad_alloc();
+		}
+		handler();
+		pMemory = std::malloc(size);
+	}
+
+	return(pMemory);
+}
+
+/***********************************************************
+ *  operator delete()
+ *
+ *  The global operator delete that frees the memory of the
+ *  replaced operator new.  The sized form is replaced along
+ *  with it, so every delete goes to the same heap.
+ ***********************************************************/
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+	std::free(pMemory);
+}
+
+/***********************************************************
+ *  GetAllocationCount()
+ *
+ *  This method is used for getting the number of heap
+ *  allocations that every thread has made so far.
+ ***********************************************************/
+uint64_t HeapCounter::GetAllocationCount()
+{
+	return(g_HeapAllocations.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t capacity)
+{
+	m_pBlock = NULL;
+	m_capacity = capacity;
+	m_usedBytes = 0;
+	m_overflowBytes = 0;
+	m_peakBytes = 0;
+	m_overflowCount = 0;
+
+	if (m_capacity > 0)
+	{
+		m_pBlock = new unsigned char[m_capacity];
+	}
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	FreeOverflowBlocks();
+	delete[] m_pBlock;
+	m_pBlock = NULL;
+}
+
+/***********************************************************
+ *  FreeOverflowBlocks()
+ *
+ *  This method is used for freeing the extra blocks that
+ *  were made when a frame did not fit in the block.
+ ***********************************************************/
+void FrameArena::FreeOverflowBlocks()
+{
+	for (size_t i = 0; i < m_overflowBlocks.size(); i++)
+	{
+		delete[] m_overflowBlocks[i];
+	}
+	m_overflowBlocks.clear();
+	m_overflowBytes = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for allocating bytes that stay
+ *  valid until the next reset.  The allocation is taken
+ *  from the block while it fits, and from an extra block on
+ *  the heap otherwise.  NULL is returned for zero bytes.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+	{
+		return(NULL);
+	}
+
+	if (NULL != m_pBlock)
+	{
+		uintptr_t start = (uintptr_t)(m_pBlock + m_usedBytes);
+		size_t padding = (size_t)((alignment - (start & (alignment - 1))) & (alignment - 1));
+
+		if (m_usedBytes + padding + size <= m_capacity)
+		{
+			m_usedBytes += padding + size;
+			return(m_pBlock + m_usedBytes - size);
+		}
+	}
+
+	// the memory that new hands out is aligned for any plain
+	// value, and the padding covers larger alignments
+	size_t blockSize = std::max(size + alignment, g_MinOverflowBlock);
+	unsigned char* pOverflow = new unsigned char[blockSize];
+	uintptr_t start = (uintptr_t)pOverflow;
+	size_t padding = (size_t)((alignment - (start & (alignment - 1))) & (alignment - 1));
+
+	m_overflowBlocks.push_back(pOverflow);
+	m_overflowBytes += size + alignment;
+	return(pOverflow + padding);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for freeing everything that was
+ *  allocated since the last reset.  When the frame did not
+ *  fit in the block, the block is made large enough for it
+ *  with some room to spare, so it fits the next time.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	size_t frameBytes = m_usedBytes + m_overflowBytes;
+
+	m_peakBytes = std::max(m_peakBytes, frameBytes);
+	if (m_overflowBlocks.empty() == false)
+	{
+		FreeOverflowBlocks();
+		m_overflowCount++;
+
+		delete[] m_pBlock;
+		m_capacity = m_peakBytes + m_peakBytes / 2;
+		m_pBlock = new unsigned char[m_capacity];
+	}
+	m_usedBytes = 0;
+}
+
+/***********************************************************
+ *  GetUsedBytes()
+ *
+ *  This method is used for getting the number of bytes that
+ *  were allocated since the last reset.
+ ***********************************************************/
+size_t FrameArena::GetUsedBytes() const
+{
+	return(m_usedBytes + m_overflowBytes);
+}
+
+/***********************************************************
+ *  GetCapacity()
+ *
+ *  This method is used for getting the size of the block
+ *  the frames are allocated from.
+ ***********************************************************/
+size_t FrameArena::GetCapacity() const
+{
+	return(m_capacity);
+}
+
+/***********************************************************
+ *  GetPeakBytes()
+ *
+ *  This method is used for getting the most bytes that one
+ *  frame has allocated.
+ ***********************************************************/
+size_t FrameArena::GetPeakBytes() const
+{
+	return(m_peakBytes);
+}
+
+/***********************************************************
+ *  GetOverflowCount()
+ *
+ *  This method is used for getting the number of frames
+ *  that needed more memory than the block held.
+ ***********************************************************/
+int FrameArena::GetOverflowCount() const
+{
+	return(m_overflowCount);
+}
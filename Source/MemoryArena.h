@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+// memoryarena.h
+// ============
+// hand out the per-frame scratch memory and the pooled objects without
+// going to the heap
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/***********************************************************
+ *  HeapCounter
+ *
+ *  This class counts the allocations that are made with
+ *  the global operator new, from every thread, so the
+ *  profiler can show how many allocations each frame made.
+ ***********************************************************/
+class HeapCounter
+{
+public:
+	// the number of allocations since the program started
+	static uint64_t GetAllocationCount();
+};
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class hands out scratch memory that only lives
+ *  until the end of a frame.  Each allocation moves an
+ *  offset through one block, and Reset() frees everything
+ *  at once by moving the offset back to the start.  When a
+ *  frame needs more than the block holds, the rest comes
+ *  from extra blocks on the heap, and the next Reset()
+ *  replaces the block with one that is large enough for the
+ *  largest frame so far, so once the scene has settled the
+ *  frames make no heap allocations at all.
+ *
+ *  Nothing that is allocated is constructed or destroyed,
+ *  so only arrays of plain values should be kept in it.
+ *  The arena is not locked, so it is only allocated from on
+ *  one thread, while the jobs may read and write the arrays.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t capacity = 0);
+	// destructor
+	~FrameArena();
+
+private:
+	// the block the frames are allocated from, and how much
+	// of it is used
+	unsigned char* m_pBlock;
+	size_t m_capacity;
+	size_t m_usedBytes;
+	// the extra blocks of a frame that did not fit, and the
+	// bytes that were allocated from them
+	std::vector<unsigned char*> m_overflowBlocks;
+	size_t m_overflowBytes;
+	// the most bytes that one frame allocated, and the number
+	// of frames that did not fit in the block
+	size_t m_peakBytes;
+	int m_overflowCount;
+
+	// free the extra blocks of the last frame
+	void FreeOverflowBlocks();
+
+	// the arena owns its memory, so it is not copied
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+public:
+	// allocate bytes at an alignment that is a power of two
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	// allocate an array of plain values, which are not set
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value,
+			"the frame arena never destroys what is allocated from it");
+		return(static_cast<T*>(Allocate(count * sizeof(T), alignof(T))));
+	}
+
+	// free everything that was allocated since the last reset
+	void Reset();
+
+	// the bytes allocated since the last reset, the size of the
+	// block, and the most that one frame allocated
+	size_t GetUsedBytes() const;
+	size_t GetCapacity() const;
+	size_t GetPeakBytes() const;
+	// the number of frames that needed more than the block
+	int GetOverflowCount() const;
+};
+
+/***********************************************************
+ *  BlockPool
+ *
+ *  This class keeps objects of one type in fixed size
+ *  blocks of slots.  A freed slot goes onto a list that the
+ *  next object is taken from, so objects that are made and
+ *  freed over and over only go to the heap when every slot
+ *  of every block is in use.  The blocks are only freed
+ *  with the pool, and objects never move once they are
+ *  made.  The pool is not locked, so the owner locks it
+ *  when it is used from more than one thread.
+ ***********************************************************/
+template <typename T, int BLOCK_SLOTS = 32>
+class BlockPool
+{
+public:
+	// constructor
+	BlockPool()
+	{
+		m_pFreeSlots = NULL;
+		m_liveCount = 0;
+	}
+	// destructor - the objects that are still alive are not
+	// destroyed, only their memory is freed
+	~BlockPool()
+	{
+		for (size_t i = 0; i < m_blocks.size(); i++)
+		{
+			delete[] m_blocks[i];
+		}
+	}
+
+private:
+	// a slot holds an object while it is alive, and the next
+	// free slot while it is free
+	union SLOT
+	{
+		SLOT* pNextFree;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	std::vector<SLOT*> m_blocks;
+	SLOT* m_pFreeSlots;
+	int m_liveCount;
+
+	// add a block of slots to the free list
+	void AddBlock()
+	{
+		SLOT* pBlock = new SLOT[BLOCK_SLOTS];
+
+		for (int i = 0; i < BLOCK_SLOTS - 1; i++)
+		{
+			pBlock[i].pNextFree = &pBlock[i + 1];
+		}
+		pBlock[BLOCK_SLOTS - 1].pNextFree = m_pFreeSlots;
+		m_pFreeSlots = pBlock;
+		m_blocks.push_back(pBlock);
+	}
+
+	// the pool owns its blocks, so it is not copied
+	BlockPool(const BlockPool&);
+	BlockPool& operator=(const BlockPool&);
+
+public:
+	// make an object in a free slot
+	template <typename... ARGS>
+	T* Create(ARGS&&... args)
+	{
+		if (NULL == m_pFreeSlots)
+		{
+			AddBlock();
+		}
+
+		// the slot is taken off the list before the object is
+		// made over the link to the next free slot
+		SLOT* pSlot = m_pFreeSlots;
+		m_pFreeSlots = pSlot->pNextFree;
+
+		T* pObject = new (pSlot->storage) T(std::forward<ARGS>(args)...);
+		m_liveCount++;
+		return(pObject);
+	}
+
+	// destroy an object and put its slot back on the free list
+	void Destroy(T* pObject)
+	{
+		if (NULL == pObject)
+		{
+			return;
+		}
+
+		pObject->~T();
+
+		SLOT* pSlot = reinterpret_cast<SLOT*>(pObject);
+		pSlot->pNextFree = m_pFreeSlots;
+		m_pFreeSlots = pSlot;
+		m_liveCount--;
+	}
+
+	// the number of objects that are alive, and the number of
+	// slots in all of the blocks
+	int GetLiveCount() const
+	{
+		return(m_liveCount);
+	}
+	int GetCapacity() const
+	{
+		return((int)m_blocks.size() * BLOCK_SLOTS);
+	}
+};
@@ -0,0 +1,296 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.cpp
+// ============
+// store linked shader programs on disk as program binaries
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// "SPBC" - marks a file as a shader program binary cache file
+	const uint32_t CACHE_MAGIC = 0x43425053;
+	// changed whenever the layout of the cache files changes
+	const uint32_t CACHE_VERSION = 1;
+
+	// the FNV-1a 64 bit hash constants
+	const uint64_t HASH_OFFSET = 0xcbf29ce484222325ULL;
+	const uint64_t HASH_PRIME = 0x100000001b3ULL;
+
+	// read one of the driver strings, which may be NULL
+	std::string GetDriverString(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return((NULL != value) ? std::string((const char*)value) : std::string());
+	}
+}
+
+/***********************************************************
+ *  ProgramCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProgramCache::ProgramCache(const char* cacheDirectory)
+{
+	GLint formatCount = 0;
+
+	m_cacheDirectory = cacheDirectory;
+	m_hitCount = 0;
+	m_missCount = 0;
+	m_bSupported = ((GLEW_VERSION_4_1 == GL_TRUE) || (GLEW_ARB_get_program_binary == GL_TRUE));
+
+	// some drivers expose the functions without any formats
+	if (m_bSupported == true)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		m_bSupported = (formatCount > 0);
+	}
+
+	m_driverName = GetDriverString(GL_VENDOR) + "|" +
+		GetDriverString(GL_RENDERER) + "|" +
+		GetDriverString(GL_VERSION);
+}
+
+/***********************************************************
+ *  ~ProgramCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ProgramCache::~ProgramCache()
+{
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  save and load program binaries.
+ ***********************************************************/
+bool ProgramCache::IsSupported() const
+{
+	return(m_bSupported);
+}
+
+/***********************************************************
+ *  HashString()
+ *
+ *  This method is used for adding the characters of a
+ *  string to a running FNV-1a hash.
+ ***********************************************************/
+uint64_t ProgramCache::HashString(const std::string& text, uint64_t hash)
+{
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		hash ^= (uint8_t)text[i];
+		hash *= HASH_PRIME;
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  BuildKey()
+ *
+ *  This method is used for building the key of a program.
+ *  The key is a hash of the shader sources, the defines and
+ *  the driver strings, so any change to one of them gives
+ *  a new cache file instead of loading a stale binary.
+ ***********************************************************/
+std::string ProgramCache::BuildKey(
+	const std::string& vertexSource,
+	const std::string& fragmentSource,
+	const std::string& defines) const
+{
+	uint64_t hash = HASH_OFFSET;
+	char key[17];
+
+	// the separators keep moved text from hashing the same
+	hash = HashString(m_driverName, hash);
+	hash = HashString("\x01", hash);
+	hash = HashString(defines, hash);
+	hash = HashString("\x01", hash);
+	hash = HashString(vertexSource, hash);
+	hash = HashString("\x01", hash);
+	hash = HashString(fragmentSource, hash);
+
+	snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+
+	return(std::string(key));
+}
+
+/***********************************************************
+ *  GetFilePath()
+ *
+ *  This method is used for getting the path of the cache
+ *  file for a key.
+ ***********************************************************/
+std::string ProgramCache::GetFilePath(const std::string& key) const
+{
+	return(m_cacheDirectory + "/" + key + ".bin");
+}
+
+/***********************************************************
+ *  CreateCacheDirectory()
+ *
+ *  This method is used for creating the cache directory.
+ *  Nothing happens when it already exists.
+ ***********************************************************/
+void ProgramCache::CreateCacheDirectory() const
+{
+#ifdef _WIN32
+	_mkdir(m_cacheDirectory.c_str());
+#else
+	mkdir(m_cacheDirectory.c_str(), 0755);
+#endif
+}
+
+/***********************************************************
+ *  PrepareProgram()
+ *
+ *  This method is used for setting the hint that lets the
+ *  driver hand back the binary of a program after it has
+ *  been linked.
+ ***********************************************************/
+void ProgramCache::PrepareProgram(GLuint programID) const
+{
+	if (m_bSupported == true)
+	{
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for creating a program from the
+ *  cache file of a key.  The driver may reject a binary,
+ *  such as one from another driver version, and then 0 is
+ *  returned so the program is compiled from source and the
+ *  file is written again.
+ ***********************************************************/
+GLuint ProgramCache::LoadProgram(const std::string& key)
+{
+	if (m_bSupported == false)
+	{
+		return(0);
+	}
+
+	std::ifstream file(GetFilePath(key).c_str(), std::ios::binary);
+	CACHE_HEADER header = {};
+
+	if ((file.is_open() == false) ||
+		(file.read((char*)&header, sizeof(header)).good() == false) ||
+		(header.magic != CACHE_MAGIC) ||
+		(header.version != CACHE_VERSION) ||
+		(header.binaryLength == 0))
+	{
+		m_missCount++;
+		return(0);
+	}
+
+	std::vector<char> binary(header.binaryLength);
+	if (file.read(binary.data(), header.binaryLength).good() == false)
+	{
+		m_missCount++;
+		return(0);
+	}
+
+	GLuint programID = glCreateProgram();
+	GLint success = 0;
+
+	glProgramBinary(programID, (GLenum)header.binaryFormat, binary.data(), (GLsizei)header.binaryLength);
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+
+	if (success == GL_FALSE)
+	{
+		glDeleteProgram(programID);
+		m_missCount++;
+		return(0);
+	}
+
+	m_hitCount++;
+
+	return(programID);
+}
+
+/***********************************************************
+ *  StoreProgram()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program to the cache file of its key.
+ ***********************************************************/
+bool ProgramCache::StoreProgram(const std::string& key, GLuint programID)
+{
+	if ((m_bSupported == false) || (programID == 0))
+	{
+		return(false);
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return(false);
+	}
+
+	std::vector<char> binary(binaryLength);
+	GLenum binaryFormat = 0;
+	GLsizei writtenLength = 0;
+	glGetProgramBinary(programID, binaryLength, &writtenLength, &binaryFormat, binary.data());
+	if (writtenLength <= 0)
+	{
+		return(false);
+	}
+
+	CreateCacheDirectory();
+
+	std::ofstream file(GetFilePath(key).c_str(), std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.binaryFormat = (uint32_t)binaryFormat;
+	header.binaryLength = (uint32_t)writtenLength;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), writtenLength);
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  GetHitCount()
+ *
+ *  This method is used for getting the number of programs
+ *  that were loaded from the cache.
+ ***********************************************************/
+int ProgramCache::GetHitCount() const
+{
+	return(m_hitCount);
+}
+
+/***********************************************************
+ *  GetMissCount()
+ *
+ *  This method is used for getting the number of programs
+ *  that had to be compiled from source.
+ ***********************************************************/
+int ProgramCache::GetMissCount() const
+{
+	return(m_missCount);
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.h
+// ============
+// store linked shader programs on disk as program binaries
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ProgramCache
+ *
+ *  This class saves linked shader programs to disk with
+ *  glGetProgramBinary() and loads them back with
+ *  glProgramBinary(), so the shaders are not compiled from
+ *  source on every launch.  Each program is stored in its
+ *  own file, named by a hash of its source code, its
+ *  defines and the driver that built it.  A driver update
+ *  changes the hash, and a binary the driver rejects is
+ *  simply compiled from source again.
+ ***********************************************************/
+class ProgramCache
+{
+public:
+	// constructor
+	ProgramCache(const char* cacheDirectory);
+	// destructor
+	~ProgramCache();
+
+private:
+	// the header at the start of each cache file
+	struct CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t binaryFormat;
+		uint32_t binaryLength;
+	};
+
+	// the directory the cache files are written to
+	std::string m_cacheDirectory;
+	// the vendor, renderer and version strings of the driver
+	std::string m_driverName;
+	// whether the driver can save and load program binaries
+	bool m_bSupported;
+	// the number of programs loaded from and added to the cache
+	int m_hitCount;
+	int m_missCount;
+
+	// hash a string into a running 64 bit hash
+	static uint64_t HashString(const std::string& text, uint64_t hash);
+	// get the path of the cache file for a key
+	std::string GetFilePath(const std::string& key) const;
+	// create the cache directory when it does not exist
+	void CreateCacheDirectory() const;
+
+public:
+	// whether the driver can save and load program binaries
+	bool IsSupported() const;
+
+	// build the key of a program from its shader sources
+	// and defines
+	std::string BuildKey(
+		const std::string& vertexSource,
+		const std::string& fragmentSource,
+		const std::string& defines) const;
+
+	// create a program from a cache file - 0 is returned when
+	// there is no usable binary for the key
+	GLuint LoadProgram(const std::string& key);
+	// write a linked program to its cache file - the program
+	// must have been linked with the retrievable hint set
+	bool StoreProgram(const std::string& key, GLuint programID);
+
+	// set the hint that lets a program's binary be read back,
+	// which must be done before the program is linked
+	void PrepareProgram(GLuint programID) const;
+
+	// the number of programs loaded from the cache, and the
+	// number that had to be compiled from source
+	int GetHitCount() const;
+	int GetMissCount() const;
+};
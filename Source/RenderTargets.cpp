@@ -0,0 +1,496 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertargets.cpp
+// ============
+// render the scene offscreen at a resolution that follows the frame time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderTargets.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the sampler and the uniforms of the present program
+	const char* g_SceneColorName = "sceneColor";
+	const char* g_DisplaySizeName = "displaySize";
+	const char* g_SourceScaleName = "sourceScale";
+	const char* g_SourceMaxName = "sourceMax";
+	const char* g_SourceTexelName = "sourceTexel";
+	const char* g_SharpnessName = "sharpness";
+
+	// how quickly the smoothed GPU time follows the frames, and
+	// the frames the scale is kept for after it changed - the
+	// GPU timings are read back a few frames late, so the
+	// frames at the new scale need time to show up
+	const double GPU_TIME_SMOOTHING = 0.1;
+	const int SCALE_CHANGE_FRAMES = 30;
+	// the scale is lowered when the frames take longer than the
+	// target with some headroom, and raised when they take less
+	// than a part of it, so the scale does not go back and forth
+	const double SLOW_FRAME_RATIO = 1.05;
+	const double FAST_FRAME_RATIO = 0.8;
+	// the scale moves in steps, so small changes in the frame
+	// time do not change the viewport
+	const float SCALE_STEP = 0.05f;
+
+	// a size scaled by the render scale, which is at least one
+	// pixel
+	int ScaleSize(int size, float scale)
+	{
+		return(std::max(1, (int)((float)size * scale + 0.5f)));
+	}
+}
+
+/***********************************************************
+ *  RenderTargets()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderTargets::RenderTargets(UniformBufferManager* pUniformBuffers)
+	: m_shaderVariants(pUniformBuffers)
+{
+	m_presentVariant = -1;
+	m_sceneColorHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_displaySizeHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_sourceScaleHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_sourceMaxHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_sourceTexelHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_sharpnessHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthRenderbuffer = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_vertexArray = 0;
+	m_displayWidth = 0;
+	m_displayHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_renderScale = m_settings.renderScale;
+	m_smoothedGpuTime = -1.0;
+	m_framesSinceChange = 0;
+	m_bSceneInTarget = false;
+}
+
+/***********************************************************
+ *  ~RenderTargets()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderTargets::~RenderTargets()
+{
+	DestroyResources();
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for compiling the program that
+ *  scales the scene up to the window and sharpens it.
+ ***********************************************************/
+bool RenderTargets::LoadShaders(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	if (m_shaderVariants.LoadSources(vertexShaderPath, fragmentShaderPath) == false)
+	{
+		return(false);
+	}
+
+	m_presentVariant = m_shaderVariants.GetVariant(0);
+	if (m_presentVariant < 0)
+	{
+		return(false);
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_shaderVariants.GetProgram(m_presentVariant));
+	m_presentUniforms.SetProgram(m_shaderVariants.GetProgram(m_presentVariant));
+	m_sceneColorHandle = m_presentUniforms.GetHandle(g_SceneColorName);
+	m_displaySizeHandle = m_presentUniforms.GetHandle(g_DisplaySizeName);
+	m_sourceScaleHandle = m_presentUniforms.GetHandle(g_SourceScaleName);
+	m_sourceMaxHandle = m_presentUniforms.GetHandle(g_SourceMaxName);
+	m_sourceTexelHandle = m_presentUniforms.GetHandle(g_SourceTexelName);
+	m_sharpnessHandle = m_presentUniforms.GetHandle(g_SharpnessName);
+	m_presentUniforms.SetInt(m_sceneColorHandle, SCENE_COLOR_UNIT);
+	glUseProgram((GLuint)previousProgram);
+
+	if (m_vertexArray == 0)
+	{
+		glGenVertexArrays(1, &m_vertexArray);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyResources()
+ *
+ *  This method is used for freeing the program, the target
+ *  and the vertex array.
+ ***********************************************************/
+void RenderTargets::DestroyResources()
+{
+	DestroyTarget();
+	m_shaderVariants.DestroyPrograms();
+	m_presentVariant = -1;
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for creating the target for a size.
+ *  The color is filtered when it is scaled up, and the depth
+ *  is a renderbuffer, since it is only copied out by the
+ *  passes that read it.
+ ***********************************************************/
+bool RenderTargets::CreateTarget(int width, int height)
+{
+	DestroyTarget();
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+	bool bComplete = (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	if (bComplete == false)
+	{
+		std::cout << "ERROR::RENDER_TARGETS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		DestroyTarget();
+		return(false);
+	}
+
+	m_targetWidth = width;
+	m_targetHeight = height;
+	UpdateRenderSize();
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the framebuffer and the
+ *  target.
+ ***********************************************************/
+void RenderTargets::DestroyTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorTexture != 0)
+	{
+		glDeleteTextures(1, &m_colorTexture);
+		m_colorTexture = 0;
+	}
+	if (m_depthRenderbuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+		m_depthRenderbuffer = 0;
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  UpdateRenderSize()
+ *
+ *  This method is used for working out the part of the
+ *  target the scene is drawn into at the render scale.
+ ***********************************************************/
+void RenderTargets::UpdateRenderSize()
+{
+	m_renderWidth = ScaleSize(m_displayWidth, m_renderScale);
+	m_renderHeight = ScaleSize(m_displayHeight, m_renderScale);
+	if (m_targetWidth > 0)
+	{
+		m_renderWidth = std::min(m_renderWidth, m_targetWidth);
+		m_renderHeight = std::min(m_renderHeight, m_targetHeight);
+	}
+}
+
+/***********************************************************
+ *  SetDisplaySize()
+ *
+ *  This method is used for setting the size of the
+ *  framebuffer of the window.  The target is made again
+ *  for the new size the next time the scene is drawn.
+ ***********************************************************/
+void RenderTargets::SetDisplaySize(int width, int height)
+{
+	if ((width == m_displayWidth) && (height == m_displayHeight))
+	{
+		return;
+	}
+
+	m_displayWidth = width;
+	m_displayHeight = height;
+	UpdateRenderSize();
+}
+
+/***********************************************************
+ *  GetDisplayWidth()
+ *
+ *  This method is used for getting the width of the
+ *  framebuffer of the window.
+ ***********************************************************/
+int RenderTargets::GetDisplayWidth() const
+{
+	return(m_displayWidth);
+}
+
+/***********************************************************
+ *  GetDisplayHeight()
+ *
+ *  This method is used for getting the height of the
+ *  framebuffer of the window.
+ ***********************************************************/
+int RenderTargets::GetDisplayHeight() const
+{
+	return(m_displayHeight);
+}
+
+/***********************************************************
+ *  GetRenderWidth()
+ *
+ *  This method is used for getting the width the scene is
+ *  drawn at.
+ ***********************************************************/
+int RenderTargets::GetRenderWidth() const
+{
+	return(m_renderWidth);
+}
+
+/***********************************************************
+ *  GetRenderHeight()
+ *
+ *  This method is used for getting the height the scene is
+ *  drawn at.
+ ***********************************************************/
+int RenderTargets::GetRenderHeight() const
+{
+	return(m_renderHeight);
+}
+
+/***********************************************************
+ *  SetSettings()
+ *
+ *  This method is used for setting the render resolution
+ *  settings.  The render scale starts again from the scale
+ *  of the settings.
+ ***********************************************************/
+void RenderTargets::SetSettings(const RESOLUTION_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_settings.minScale = std::max(m_settings.minScale, SCALE_STEP);
+	m_settings.maxScale = std::max(m_settings.maxScale, m_settings.minScale);
+	m_settings.sharpness = std::min(std::max(m_settings.sharpness, 0.0f), 1.0f);
+
+	m_renderScale = std::max(m_settings.renderScale, SCALE_STEP);
+	if (m_settings.bDynamicResolution == true)
+	{
+		m_renderScale = std::min(std::max(m_renderScale, m_settings.minScale), m_settings.maxScale);
+	}
+	m_smoothedGpuTime = -1.0;
+	m_framesSinceChange = 0;
+	UpdateRenderSize();
+}
+
+/***********************************************************
+ *  GetSettings()
+ *
+ *  This method is used for getting the render resolution
+ *  settings.
+ ***********************************************************/
+const RenderTargets::RESOLUTION_SETTINGS& RenderTargets::GetSettings() const
+{
+	return(m_settings);
+}
+
+/***********************************************************
+ *  GetRenderScale()
+ *
+ *  This method is used for getting the fraction of the
+ *  window size the scene is drawn at.
+ ***********************************************************/
+float RenderTargets::GetRenderScale() const
+{
+	return(m_renderScale);
+}
+
+/***********************************************************
+ *  UpdateRenderScale()
+ *
+ *  This method is used for adapting the render scale to the
+ *  GPU time of the frames.  The GPU time of a frame mostly
+ *  follows the number of pixels, which goes with the square
+ *  of the scale, so a slow frame lowers the scale right
+ *  away by the square root of how far over the target it
+ *  is.  The scale is only raised one step at a time, since
+ *  a frame that is too slow is worse than one that is a
+ *  little soft.
+ ***********************************************************/
+void RenderTargets::UpdateRenderScale(double gpuTime)
+{
+	if ((m_settings.bDynamicResolution == false) || (gpuTime < 0.0))
+	{
+		return;
+	}
+
+	if (m_smoothedGpuTime < 0.0)
+	{
+		m_smoothedGpuTime = gpuTime;
+	}
+	else
+	{
+		m_smoothedGpuTime += (gpuTime - m_smoothedGpuTime) * GPU_TIME_SMOOTHING;
+	}
+
+	m_framesSinceChange++;
+	if ((m_framesSinceChange < SCALE_CHANGE_FRAMES) || (m_smoothedGpuTime <= 0.0))
+	{
+		return;
+	}
+
+	double targetTime = (double)m_settings.targetFrameTime;
+	float scale = m_renderScale;
+	if (m_smoothedGpuTime > targetTime * SLOW_FRAME_RATIO)
+	{
+		float fittedScale = m_renderScale * (float)std::sqrt(targetTime / m_smoothedGpuTime);
+		scale = std::floor(fittedScale / SCALE_STEP) * SCALE_STEP;
+	}
+	else if (m_smoothedGpuTime < targetTime * FAST_FRAME_RATIO)
+	{
+		scale = m_renderScale + SCALE_STEP;
+	}
+	scale = std::min(std::max(scale, m_settings.minScale), m_settings.maxScale);
+
+	if (std::fabs(scale - m_renderScale) < SCALE_STEP * 0.5f)
+	{
+		return;
+	}
+
+	m_renderScale = scale;
+	m_framesSinceChange = 0;
+	UpdateRenderSize();
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method is used for binding the target and the part
+ *  of it the scene is drawn into.  The target covers the
+ *  largest scale the scene can be drawn at, and it is made
+ *  again when the window size changes.  When there is no
+ *  target, the scene is drawn straight into the window.
+ ***********************************************************/
+bool RenderTargets::BeginScene()
+{
+	m_bSceneInTarget = false;
+
+	if ((m_presentVariant >= 0) && (m_displayWidth > 0) && (m_displayHeight > 0))
+	{
+		float targetScale = m_renderScale;
+		if (m_settings.bDynamicResolution == true)
+		{
+			targetScale = std::max(m_settings.maxScale, m_renderScale);
+		}
+
+		int width = ScaleSize(m_displayWidth, targetScale);
+		int height = ScaleSize(m_displayHeight, targetScale);
+		if (((width == m_targetWidth) && (height == m_targetHeight)) ||
+			(CreateTarget(width, height) == true))
+		{
+			m_bSceneInTarget = true;
+		}
+	}
+
+	if (m_bSceneInTarget == false)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, m_displayWidth, m_displayHeight);
+		return(false);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	return(true);
+}
+
+/***********************************************************
+ *  PresentScene()
+ *
+ *  This method is used for drawing the scene into the
+ *  window.  A full screen triangle reads the part of the
+ *  target the scene was drawn into with filtering, which
+ *  scales it up, and sharpens the edges that the scaling
+ *  softened.
+ ***********************************************************/
+void RenderTargets::PresentScene()
+{
+	if (m_bSceneInTarget == false)
+	{
+		return;
+	}
+	m_bSceneInTarget = false;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_displayWidth, m_displayHeight);
+
+	GLint previousProgram = 0;
+	GLint previousVertexArray = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+
+	glm::vec2 targetSize((float)m_targetWidth, (float)m_targetHeight);
+	glm::vec2 renderSize((float)m_renderWidth, (float)m_renderHeight);
+
+	glUseProgram(m_shaderVariants.GetProgram(m_presentVariant));
+	m_presentUniforms.SetVec2(m_displaySizeHandle, glm::vec2((float)m_displayWidth, (float)m_displayHeight));
+	m_presentUniforms.SetVec2(m_sourceScaleHandle, renderSize / targetSize);
+	m_presentUniforms.SetVec2(m_sourceMaxHandle, (renderSize - 0.5f) / targetSize);
+	m_presentUniforms.SetVec2(m_sourceTexelHandle, 1.0f / targetSize);
+	m_presentUniforms.SetFloat(m_sharpnessHandle, m_settings.sharpness);
+	glActiveTexture(GL_TEXTURE0 + SCENE_COLOR_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray((GLuint)previousVertexArray);
+	glEnable(GL_DEPTH_TEST);
+
+	glUseProgram((GLuint)previousProgram);
+}
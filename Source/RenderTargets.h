@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertargets.h
+// ============
+// render the scene offscreen at a resolution that follows the frame time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderVariants.h"
+#include "UniformBuffers.h"
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  RenderTargets
+ *
+ *  This class holds the offscreen target the scene is drawn
+ *  into, and presents it to the window.  The target follows
+ *  the size of the framebuffer of the window, which on high
+ *  DPI displays is larger than the window, and the scene is
+ *  drawn into a part of it that is scaled down by the
+ *  render scale.  The present pass scales that part back up
+ *  to the window and sharpens it.
+ *
+ *  With the dynamic resolution on, the render scale follows
+ *  the GPU time of the frames - it is lowered when the
+ *  frames take longer than the target frame time and raised
+ *  again when there is time to spare.  The target is made
+ *  at the largest scale, so changing the scale only changes
+ *  the viewport.
+ ***********************************************************/
+class RenderTargets
+{
+public:
+	// constructor
+	RenderTargets(UniformBufferManager* pUniformBuffers);
+	// destructor
+	~RenderTargets();
+
+	// the texture unit the scene color is read from by the
+	// present pass, shared with the transparency targets that
+	// are bound again every time they are used
+	static const int SCENE_COLOR_UNIT = 14;
+
+	// the settings of the render resolution
+	struct RESOLUTION_SETTINGS
+	{
+		// the fraction of the window size the scene is drawn at,
+		// which is the starting scale of the dynamic resolution
+		float renderScale;
+		// whether the scale follows the GPU time, the GPU time
+		// each frame should take in milliseconds, and the range
+		// the scale is kept in
+		bool bDynamicResolution;
+		float targetFrameTime;
+		float minScale;
+		float maxScale;
+		// how much the present pass sharpens, from 0 for none to
+		// 1 for the most
+		float sharpness;
+
+		RESOLUTION_SETTINGS()
+		{
+			renderScale = 1.0f;
+			bDynamicResolution = false;
+			targetFrameTime = 16.0f;
+			minScale = 0.5f;
+			maxScale = 1.0f;
+			sharpness = 0.25f;
+		}
+	};
+
+private:
+	// the program that scales up and sharpens the scene
+	ShaderVariants m_shaderVariants;
+	int m_presentVariant;
+	ShaderUniformCache m_presentUniforms;
+	int m_sceneColorHandle;
+	int m_displaySizeHandle;
+	int m_sourceScaleHandle;
+	int m_sourceMaxHandle;
+	int m_sourceTexelHandle;
+	int m_sharpnessHandle;
+	// the framebuffer of the target, its color texture and
+	// depth buffer, and the size it was made at
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthRenderbuffer;
+	int m_targetWidth;
+	int m_targetHeight;
+	// the empty vertex array the full screen triangle of the
+	// present pass is drawn with
+	GLuint m_vertexArray;
+	// the size of the framebuffer of the window, and the part
+	// of the target the scene is drawn into
+	int m_displayWidth;
+	int m_displayHeight;
+	int m_renderWidth;
+	int m_renderHeight;
+	// the settings, the current scale, the smoothed GPU time
+	// it is picked from, and the frames since it was changed
+	RESOLUTION_SETTINGS m_settings;
+	float m_renderScale;
+	double m_smoothedGpuTime;
+	int m_framesSinceChange;
+	// set while the scene is drawn into the target
+	bool m_bSceneInTarget;
+
+	// create the target for a size
+	bool CreateTarget(int width, int height);
+	void DestroyTarget();
+	// work out the part of the target the scene is drawn into
+	void UpdateRenderSize();
+
+public:
+	// load the present program
+	bool LoadShaders(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// free the program, the target and the vertex array
+	void DestroyResources();
+
+	// set the size of the framebuffer of the window, such as
+	// after it was resized
+	void SetDisplaySize(int width, int height);
+	int GetDisplayWidth() const;
+	int GetDisplayHeight() const;
+	// the size the scene is drawn at
+	int GetRenderWidth() const;
+	int GetRenderHeight() const;
+
+	void SetSettings(const RESOLUTION_SETTINGS& settings);
+	const RESOLUTION_SETTINGS& GetSettings() const;
+	float GetRenderScale() const;
+
+	// adapt the render scale to the GPU time of the last frame
+	// whose timings were read back, in milliseconds - a
+	// negative time is ignored
+	void UpdateRenderScale(double gpuTime);
+
+	// bind the target and its viewport for the scene - the
+	// window is bound instead when there is no target, and
+	// false is returned
+	bool BeginScene();
+	// scale the scene up to the window and sharpen it, and
+	// leave the window bound
+	void PresentScene();
+};
@@ -0,0 +1,657 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the bounding boxes of the scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// the number of bins the surface area heuristic sorts into
+	const int SAH_BINS = 8;
+
+	// half of the surface area of a box
+	float HalfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = boundsMax - boundsMin;
+
+		return(size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	float GetAxis(const glm::vec3& value, int axis)
+	{
+		return((axis == 0) ? value.x : ((axis == 1) ? value.y : value.z));
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+}
+
+/***********************************************************
+ *  ~SceneBVH()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBVH::~SceneBVH()
+{
+}
+
+/***********************************************************
+ *  SetItemCount()
+ *
+ *  This method is used for setting the number of items.
+ *  The tree needs to be built again after the count changes.
+ ***********************************************************/
+void SceneBVH::SetItemCount(int count)
+{
+	if (count != (int)m_itemMin.size())
+	{
+		m_itemMin.resize(count);
+		m_itemMax.resize(count);
+		m_nodes.clear();
+	}
+}
+
+/***********************************************************
+ *  GetItemCount()
+ *
+ *  This method is used for getting the number of items.
+ ***********************************************************/
+int SceneBVH::GetItemCount() const
+{
+	return((int)m_itemMin.size());
+}
+
+/***********************************************************
+ *  SetItemBounds()
+ *
+ *  This method is used for setting the world space box of
+ *  an item.  Refit() or Build() needs to be called before
+ *  the tree is queried again.
+ ***********************************************************/
+void SceneBVH::SetItemBounds(int item, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	if ((item >= 0) && (item < (int)m_itemMin.size()))
+	{
+		m_itemMin[item] = boundsMin;
+		m_itemMax[item] = boundsMax;
+	}
+}
+
+/***********************************************************
+ *  IsBuilt()
+ *
+ *  This method is used for checking whether the tree has
+ *  been built for the current items.
+ ***********************************************************/
+bool SceneBVH::IsBuilt() const
+{
+	return((m_nodes.empty() == false) || (m_itemMin.empty() == true));
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes.
+ ***********************************************************/
+int SceneBVH::GetNodeCount() const
+{
+	return((int)m_nodes.size());
+}
+
+/***********************************************************
+ *  UpdateNodeBounds()
+ *
+ *  This method is used for setting the bounds of a leaf
+ *  node to the union of the boxes of its items.
+ ***********************************************************/
+void SceneBVH::UpdateNodeBounds(int nodeIndex)
+{
+	BVH_NODE& node = m_nodes[nodeIndex];
+
+	node.boundsMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (int i = 0; i < node.count; i++)
+	{
+		int item = m_itemOrder[node.leftFirst + i];
+
+		node.boundsMin = glm::min(node.boundsMin, m_itemMin[item]);
+		node.boundsMax = glm::max(node.boundsMax, m_itemMax[item]);
+	}
+}
+
+/***********************************************************
+ *  FindSplit()
+ *
+ *  This method is used for finding where to split a node.
+ *  The item centers are sorted into bins along each axis,
+ *  and the split between bins with the lowest surface area
+ *  cost is picked.  False is returned when no split is
+ *  cheaper than keeping the node as a leaf.
+ ***********************************************************/
+bool SceneBVH::FindSplit(const BVH_NODE& node, int& axis, float& position) const
+{
+	float bestCost = FLT_MAX;
+	glm::vec3 centerMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	glm::vec3 centerMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (int i = 0; i < node.count; i++)
+	{
+		int item = m_itemOrder[node.leftFirst + i];
+		glm::vec3 center = (m_itemMin[item] + m_itemMax[item]) * 0.5f;
+
+		centerMin = glm::min(centerMin, center);
+		centerMax = glm::max(centerMax, center);
+	}
+
+	for (int a = 0; a < 3; a++)
+	{
+		float axisMin = GetAxis(centerMin, a);
+		float axisMax = GetAxis(centerMax, a);
+		if (axisMax <= axisMin)
+		{
+			continue;
+		}
+
+		glm::vec3 binMin[SAH_BINS];
+		glm::vec3 binMax[SAH_BINS];
+		int binCount[SAH_BINS];
+		float scale = SAH_BINS / (axisMax - axisMin);
+
+		for (int b = 0; b < SAH_BINS; b++)
+		{
+			binMin[b] = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+			binMax[b] = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			binCount[b] = 0;
+		}
+
+		for (int i = 0; i < node.count; i++)
+		{
+			int item = m_itemOrder[node.leftFirst + i];
+			float center = GetAxis(m_itemMin[item] + m_itemMax[item], a) * 0.5f;
+			int bin = (int)((center - axisMin) * scale);
+			if (bin >= SAH_BINS)
+			{
+				bin = SAH_BINS - 1;
+			}
+
+			binCount[bin]++;
+			binMin[bin] = glm::min(binMin[bin], m_itemMin[item]);
+			binMax[bin] = glm::max(binMax[bin], m_itemMax[item]);
+		}
+
+		// sweep from both sides to get the cost of each split
+		float leftArea[SAH_BINS - 1];
+		int leftCount[SAH_BINS - 1];
+		glm::vec3 sweepMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		glm::vec3 sweepMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		int sweepCount = 0;
+
+		for (int b = 0; b < SAH_BINS - 1; b++)
+		{
+			sweepCount += binCount[b];
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			leftCount[b] = sweepCount;
+			leftArea[b] = (sweepCount > 0) ? HalfArea(sweepMin, sweepMax) : 0.0f;
+		}
+
+		sweepMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		sweepCount = 0;
+		for (int b = SAH_BINS - 1; b > 0; b--)
+		{
+			sweepCount += binCount[b];
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+
+			float rightArea = (sweepCount > 0) ? HalfArea(sweepMin, sweepMax) : 0.0f;
+			float cost = leftCount[b - 1] * leftArea[b - 1] + sweepCount * rightArea;
+			if ((leftCount[b - 1] > 0) && (sweepCount > 0) && (cost < bestCost))
+			{
+				bestCost = cost;
+				axis = a;
+				position = axisMin + b / scale;
+			}
+		}
+	}
+
+	float leafCost = node.count * HalfArea(node.boundsMin, node.boundsMax);
+
+	return(bestCost < leafCost);
+}
+
+/***********************************************************
+ *  Subdivide()
+ *
+ *  This method is used for splitting a node into two child
+ *  nodes, and then splitting the children in turn.
+ ***********************************************************/
+void SceneBVH::Subdivide(int nodeIndex)
+{
+	if (m_nodes[nodeIndex].count <= MAX_LEAF_ITEMS)
+	{
+		return;
+	}
+
+	int axis = 0;
+	float position = 0.0f;
+	if (FindSplit(m_nodes[nodeIndex], axis, position) == false)
+	{
+		return;
+	}
+
+	// partition the items of the node around the split
+	int first = m_nodes[nodeIndex].leftFirst;
+	int count = m_nodes[nodeIndex].count;
+	int i = first;
+	int j = first + count - 1;
+	while (i <= j)
+	{
+		int item = m_itemOrder[i];
+		float center = GetAxis(m_itemMin[item] + m_itemMax[item], axis) * 0.5f;
+
+		if (center < position)
+		{
+			i++;
+		}
+		else
+		{
+			m_itemOrder[i] = m_itemOrder[j];
+			m_itemOrder[j] = item;
+			j--;
+		}
+	}
+
+	int leftCount = i - first;
+	if ((leftCount == 0) || (leftCount == count))
+	{
+		return;
+	}
+
+	int leftIndex = (int)m_nodes.size();
+	BVH_NODE child;
+	child.leftFirst = first;
+	child.count = leftCount;
+	m_nodes.push_back(child);
+	child.leftFirst = i;
+	child.count = count - leftCount;
+	m_nodes.push_back(child);
+
+	m_nodes[nodeIndex].leftFirst = leftIndex;
+	m_nodes[nodeIndex].count = 0;
+
+	UpdateNodeBounds(leftIndex);
+	UpdateNodeBounds(leftIndex + 1);
+	Subdivide(leftIndex);
+	Subdivide(leftIndex + 1);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  current item bounds.
+ ***********************************************************/
+void SceneBVH::Build()
+{
+	int itemCount = (int)m_itemMin.size();
+
+	m_nodes.clear();
+	m_itemOrder.resize(itemCount);
+	for (int i = 0; i < itemCount; i++)
+	{
+		m_itemOrder[i] = i;
+	}
+	if (itemCount == 0)
+	{
+		return;
+	}
+
+	// a binary tree with single item leaves has 2n-1 nodes
+	m_nodes.reserve(itemCount * 2);
+
+	BVH_NODE root;
+	root.leftFirst = 0;
+	root.count = itemCount;
+	m_nodes.push_back(root);
+	UpdateNodeBounds(0);
+	Subdivide(0);
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating the bounds of all of the
+ *  nodes after items have moved.  Children are always stored
+ *  after their parent, so walking the nodes backwards
+ *  updates every child before its parent.  The tree gets
+ *  less efficient when objects move far, and can then be
+ *  built again.
+ ***********************************************************/
+void SceneBVH::Refit()
+{
+	if (m_nodes.empty() == true)
+	{
+		Build();
+		return;
+	}
+
+	for (int i = (int)m_nodes.size() - 1; i >= 0; i--)
+	{
+		BVH_NODE& node = m_nodes[i];
+
+		if (node.count > 0)
+		{
+			UpdateNodeBounds(i);
+		}
+		else
+		{
+			const BVH_NODE& left = m_nodes[node.leftFirst];
+			const BVH_NODE& right = m_nodes[node.leftFirst + 1];
+
+			node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+			node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		}
+	}
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for finding the items inside the
+ *  frustum.  Nodes outside of any plane are skipped with
+ *  all of their items.  Once a node is entirely inside a
+ *  plane its children are not tested against that plane
+ *  again, and nodes entirely inside all of the planes have
+ *  their items marked visible without further tests.
+ ***********************************************************/
+int SceneBVH::QueryFrustum(const float planes[6][4], std::vector<uint8_t>& visible) const
+{
+	int visibleCount = 0;
+
+	visible.assign(m_itemMin.size(), 0);
+	if (m_nodes.empty() == true)
+	{
+		return(0);
+	}
+
+	const int allPlanes = 0x3F;
+
+	// each stack entry holds a node and the planes it still
+	// needs to be tested against
+	m_stack.clear();
+	m_stack.push_back(0);
+	m_stack.push_back(allPlanes);
+
+	while (m_stack.empty() == false)
+	{
+		int planeMask = m_stack.back();
+		m_stack.pop_back();
+		int nodeIndex = m_stack.back();
+		m_stack.pop_back();
+
+		const BVH_NODE& node = m_nodes[nodeIndex];
+		glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+		glm::vec3 extent = (node.boundsMax - node.boundsMin) * 0.5f;
+		bool bOutside = false;
+
+		for (int p = 0; p < 6; p++)
+		{
+			if ((planeMask & (1 << p)) == 0)
+			{
+				continue;
+			}
+
+			float distance = center.x * planes[p][0] + center.y * planes[p][1] + center.z * planes[p][2] + planes[p][3];
+			float radius = extent.x * fabsf(planes[p][0]) + extent.y * fabsf(planes[p][1]) + extent.z * fabsf(planes[p][2]);
+
+			if (distance + radius < 0.0f)
+			{
+				bOutside = true;
+				break;
+			}
+			if (distance - radius >= 0.0f)
+			{
+				planeMask &= ~(1 << p);
+			}
+		}
+
+		if (bOutside == true)
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; i++)
+			{
+				int item = m_itemOrder[node.leftFirst + i];
+				bool bVisible = true;
+
+				if (planeMask != 0)
+				{
+					glm::vec3 itemCenter = (m_itemMin[item] + m_itemMax[item]) * 0.5f;
+					glm::vec3 itemExtent = (m_itemMax[item] - m_itemMin[item]) * 0.5f;
+
+					for (int p = 0; (p < 6) && (bVisible == true); p++)
+					{
+						if ((planeMask & (1 << p)) != 0)
+						{
+							float distance = itemCenter.x * planes[p][0] + itemCenter.y * planes[p][1] + itemCenter.z * planes[p][2] + planes[p][3];
+							float radius = itemExtent.x * fabsf(planes[p][0]) + itemExtent.y * fabsf(planes[p][1]) + itemExtent.z * fabsf(planes[p][2]);
+
+							bVisible = (distance + radius >= 0.0f);
+						}
+					}
+				}
+
+				if (bVisible == true)
+				{
+					visible[item] = 1;
+					visibleCount++;
+				}
+			}
+		}
+		else
+		{
+			m_stack.push_back(node.leftFirst);
+			m_stack.push_back(planeMask);
+			m_stack.push_back(node.leftFirst + 1);
+			m_stack.push_back(planeMask);
+		}
+	}
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  IntersectBox()
+ *
+ *  This method is used for intersecting a ray with a box
+ *  using the slab test.  The distance to the box is
+ *  returned, 0 when the ray starts inside it, or -1 when
+ *  the box is missed or further away than the max distance.
+ ***********************************************************/
+float SceneBVH::IntersectBox(
+	const glm::vec3& origin,
+	const glm::vec3& inverseDirection,
+	const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax,
+	float maxDistance)
+{
+	float tx1 = (boundsMin.x - origin.x) * inverseDirection.x;
+	float tx2 = (boundsMax.x - origin.x) * inverseDirection.x;
+	float tNear = fminf(tx1, tx2);
+	float tFar = fmaxf(tx1, tx2);
+	float ty1 = (boundsMin.y - origin.y) * inverseDirection.y;
+	float ty2 = (boundsMax.y - origin.y) * inverseDirection.y;
+	tNear = fmaxf(tNear, fminf(ty1, ty2));
+	tFar = fminf(tFar, fmaxf(ty1, ty2));
+	float tz1 = (boundsMin.z - origin.z) * inverseDirection.z;
+	float tz2 = (boundsMax.z - origin.z) * inverseDirection.z;
+	tNear = fmaxf(tNear, fminf(tz1, tz2));
+	tFar = fminf(tFar, fmaxf(tz1, tz2));
+
+	if ((tFar >= tNear) && (tFar >= 0.0f) && (tNear <= maxDistance))
+	{
+		return(fmaxf(tNear, 0.0f));
+	}
+
+	return(-1.0f);
+}
+
+/***********************************************************
+ *  Raycast()
+ *
+ *  This method is used for finding the nearest item whose
+ *  box is hit by a ray, such as a ray from the camera
+ *  through the mouse position.  The nearer child of each
+ *  node is visited first, and nodes that start further away
+ *  than the nearest hit so far are skipped.
+ ***********************************************************/
+int SceneBVH::Raycast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& hitDistance) const
+{
+	int hitItem = -1;
+
+	hitDistance = maxDistance;
+	if (m_nodes.empty() == true)
+	{
+		return(-1);
+	}
+
+	// a zero direction component gives an infinite inverse,
+	// which the slab test handles
+	glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	if (IntersectBox(origin, inverseDirection, m_nodes[0].boundsMin, m_nodes[0].boundsMax, hitDistance) < 0.0f)
+	{
+		return(-1);
+	}
+
+	m_stack.clear();
+	m_stack.push_back(0);
+	while (m_stack.empty() == false)
+	{
+		int nodeIndex = m_stack.back();
+		m_stack.pop_back();
+		const BVH_NODE& node = m_nodes[nodeIndex];
+
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; i++)
+			{
+				int item = m_itemOrder[node.leftFirst + i];
+				float distance = IntersectBox(origin, inverseDirection, m_itemMin[item], m_itemMax[item], hitDistance);
+
+				if ((distance >= 0.0f) && ((distance < hitDistance) || (hitItem < 0)))
+				{
+					hitDistance = distance;
+					hitItem = item;
+				}
+			}
+			continue;
+		}
+
+		int nearChild = node.leftFirst;
+		int farChild = node.leftFirst + 1;
+		float nearDistance = IntersectBox(origin, inverseDirection, m_nodes[nearChild].boundsMin, m_nodes[nearChild].boundsMax, hitDistance);
+		float farDistance = IntersectBox(origin, inverseDirection, m_nodes[farChild].boundsMin, m_nodes[farChild].boundsMax, hitDistance);
+
+		if ((farDistance >= 0.0f) && ((nearDistance < 0.0f) || (farDistance < nearDistance)))
+		{
+			int swapChild = nearChild;
+			float swapDistance = nearDistance;
+			nearChild = farChild;
+			nearDistance = farDistance;
+			farChild = swapChild;
+			farDistance = swapDistance;
+		}
+
+		// the near child is pushed last so it is visited first
+		if (farDistance >= 0.0f)
+		{
+			m_stack.push_back(farChild);
+		}
+		if (nearDistance >= 0.0f)
+		{
+			m_stack.push_back(nearChild);
+		}
+	}
+
+	return(hitItem);
+}
+
+/***********************************************************
+ *  QuerySphere()
+ *
+ *  This method is used for adding every item whose box
+ *  touches a sphere to the passed in list, such as the
+ *  objects that are within the range of a point light.
+ *  The number of added items is returned.
+ ***********************************************************/
+int SceneBVH::QuerySphere(const glm::vec3& center, float radius, std::vector<int>& items) const
+{
+	int addedCount = 0;
+	float radiusSquared = radius * radius;
+
+	if (m_nodes.empty() == true)
+	{
+		return(0);
+	}
+
+	m_stack.clear();
+	m_stack.push_back(0);
+	while (m_stack.empty() == false)
+	{
+		int nodeIndex = m_stack.back();
+		m_stack.pop_back();
+		const BVH_NODE& node = m_nodes[nodeIndex];
+
+		// the squared distance from the center to the box
+		glm::vec3 closest = glm::clamp(center, node.boundsMin, node.boundsMax);
+		glm::vec3 offset = closest - center;
+		if (offset.x * offset.x + offset.y * offset.y + offset.z * offset.z > radiusSquared)
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; i++)
+			{
+				int item = m_itemOrder[node.leftFirst + i];
+				glm::vec3 itemClosest = glm::clamp(center, m_itemMin[item], m_itemMax[item]);
+				glm::vec3 itemOffset = itemClosest - center;
+
+				if (itemOffset.x * itemOffset.x + itemOffset.y * itemOffset.y + itemOffset.z * itemOffset.z <= radiusSquared)
+				{
+					items.push_back(item);
+					addedCount++;
+				}
+			}
+		}
+		else
+		{
+			m_stack.push_back(node.leftFirst);
+			m_stack.push_back(node.leftFirst + 1);
+		}
+	}
+
+	return(addedCount);
+}
@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the bounding boxes of the scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class builds a bounding volume hierarchy over the
+ *  world space bounding boxes of the scene objects.  The
+ *  tree is split with a binned surface area heuristic and
+ *  stored as one flat array of nodes, with the two children
+ *  of a node next to each other.  When objects move, the
+ *  tree is refitted from the bottom up instead of being
+ *  built again.  It answers frustum queries for culling,
+ *  ray queries for picking, and sphere queries for finding
+ *  the objects a light reaches.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+	// destructor
+	~SceneBVH();
+
+	// the largest number of objects in a leaf node
+	static const int MAX_LEAF_ITEMS = 4;
+
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		// first child for interior nodes, first entry in the
+		// item order for leaf nodes
+		int leftFirst;
+		glm::vec3 boundsMax;
+		// number of items in a leaf node, 0 for interior nodes
+		int count;
+	};
+
+private:
+	// the bounds of each item, indexed by item
+	std::vector<glm::vec3> m_itemMin;
+	std::vector<glm::vec3> m_itemMax;
+	// item indices ordered so each leaf covers a range
+	std::vector<int> m_itemOrder;
+	// the flat array of nodes, the root is node 0
+	std::vector<BVH_NODE> m_nodes;
+	// stack used by the queries
+	mutable std::vector<int> m_stack;
+
+	// update the bounds of a node from the items it covers
+	void UpdateNodeBounds(int nodeIndex);
+	// split a node into two children
+	void Subdivide(int nodeIndex);
+	// find the best split of a node with the surface area
+	// heuristic - returns false when splitting does not help
+	bool FindSplit(const BVH_NODE& node, int& axis, float& position) const;
+	// the distance along a ray to a box, or a negative value
+	// when the ray misses it
+	static float IntersectBox(
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		float maxDistance);
+
+public:
+	// set the number of items and the bounds of one item
+	void SetItemCount(int count);
+	int GetItemCount() const;
+	void SetItemBounds(int item, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	// build the tree over the current item bounds
+	void Build();
+	// update the node bounds after item bounds have changed,
+	// keeping the structure of the tree
+	void Refit();
+	// whether the tree was built for the current items
+	bool IsBuilt() const;
+
+	// set the visible flag of every item whose box is at
+	// least partly inside the frustum planes - the planes
+	// point into the frustum - and return the visible count
+	int QueryFrustum(const float planes[6][4], std::vector<uint8_t>& visible) const;
+	// find the nearest item whose box is hit by a ray - the
+	// item index is returned, or -1 when nothing is hit
+	int Raycast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& hitDistance) const;
+	// add every item whose box touches a sphere to the list
+	int QuerySphere(const glm::vec3& center, float radius, std::vector<int>& items) const;
+
+	// the number of nodes in the tree
+	int GetNodeCount() const;
+};
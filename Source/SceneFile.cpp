@@ -0,0 +1,803 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read scene descriptions from text files and compiled binary files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// "SCNB" - marks a file as a compiled scene file
+	const uint32_t SCENE_MAGIC = 0x424E4353;
+	// changed whenever the layout of the compiled files changes
+	const uint32_t SCENE_VERSION = 1;
+	// every section of a compiled file starts on this boundary
+	const uint32_t g_SectionAlignment = 16;
+
+	// the names of the meshes in the text files, in the order
+	// of the mesh types
+	const char* g_MeshNames[] =
+	{
+		"plane",
+		"box",
+		"cylinder",
+		"tapered_cylinder",
+		"cone",
+		"sphere",
+		"torus"
+	};
+
+	// the records are read in place from the mapped file, so
+	// their layout must not depend on the compiler
+	static_assert(sizeof(g_MeshNames) / sizeof(g_MeshNames[0]) == MESH_COUNT, "a mesh name is missing");
+	static_assert(sizeof(SceneFile::SCENE_HEADER) == 52, "unexpected scene header size");
+	static_assert(sizeof(SceneFile::SCENE_TEXTURE) == 8, "unexpected scene texture size");
+	static_assert(sizeof(SceneFile::SCENE_MATERIAL) == 32, "unexpected scene material size");
+	static_assert(sizeof(SceneFile::SCENE_NODE) == 40, "unexpected scene node size");
+	static_assert(sizeof(SceneFile::SCENE_OBJECT) == 40, "unexpected scene object size");
+
+	// round an offset up to the start of the next section
+	uint32_t AlignSection(uint32_t offset)
+	{
+		return((offset + g_SectionAlignment - 1) & ~(g_SectionAlignment - 1));
+	}
+
+	// check that a section of a mapped file lies inside of it
+	bool IsSectionInFile(uint64_t offset, uint64_t count, uint64_t recordSize, uint64_t fileSize)
+	{
+		return(((offset % 4) == 0) && (offset + (count * recordSize) <= fileSize));
+	}
+
+	// read a number of floats from a record line
+	bool ReadFloats(std::istringstream& stream, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (!(stream >> values[i]))
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pMapped = NULL;
+	m_mappedSize = 0;
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#endif
+	m_pTextures = NULL;
+	m_pMaterials = NULL;
+	m_pNodes = NULL;
+	m_pObjects = NULL;
+	m_pStrings = NULL;
+	m_textureCount = 0;
+	m_materialCount = 0;
+	m_nodeCount = 0;
+	m_objectCount = 0;
+	m_stringSize = 0;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene from its text
+ *  file.  When the compiled file next to it is newer than
+ *  the text file, the compiled file is mapped instead of
+ *  reading the text.  Otherwise the text file is read and
+ *  the compiled file is written for the next run.
+ ***********************************************************/
+bool SceneFile::Load(const char* filePath)
+{
+	std::string compiledPath = GetCompiledPath(filePath);
+	struct stat textInfo;
+	struct stat compiledInfo;
+	bool bHasText = (stat(filePath, &textInfo) == 0);
+	bool bHasCompiled = (stat(compiledPath.c_str(), &compiledInfo) == 0);
+
+	if ((bHasCompiled == true) &&
+		((bHasText == false) || (compiledInfo.st_mtime > textInfo.st_mtime)))
+	{
+		if (LoadBinary(compiledPath.c_str()) == true)
+		{
+			return(true);
+		}
+	}
+
+	if (LoadText(filePath) == false)
+	{
+		return(false);
+	}
+
+	if (WriteBinary(compiledPath.c_str()) == false)
+	{
+		std::cout << "Could not write compiled scene file:" << compiledPath << std::endl;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadText()
+ *
+ *  This method is used for reading the records of a text
+ *  scene file.  The tags of the textures, materials and
+ *  groups are resolved to record indices here, so the
+ *  compiled records only hold indices.
+ ***********************************************************/
+bool SceneFile::LoadText(const char* filePath)
+{
+	std::ifstream file(filePath);
+	std::unordered_map<std::string, int> textureLookup;
+	std::unordered_map<std::string, int> materialLookup;
+	std::unordered_map<std::string, int> groupLookup;
+	std::string line;
+	int lineNumber = 0;
+
+	Close();
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not open scene file:" << filePath << std::endl;
+		return(false);
+	}
+
+	m_strings.push_back('\0');
+
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string record;
+		bool bValid = true;
+
+		lineNumber++;
+		if ((!(stream >> record)) || (record[0] == '#'))
+		{
+			continue;
+		}
+
+		if (record == "texture")
+		{
+			std::string tag;
+			std::string path;
+			bValid = ((stream >> tag >> path) && (textureLookup.count(tag) == 0));
+			if (bValid == true)
+			{
+				SCENE_TEXTURE texture;
+				texture.tag = AddString(tag);
+				texture.path = AddString(path);
+				textureLookup[tag] = (int)m_textures.size();
+				m_textures.push_back(texture);
+			}
+		}
+		else if (record == "material")
+		{
+			SCENE_MATERIAL material;
+			std::string tag;
+			bValid = ((stream >> tag) &&
+				(ReadFloats(stream, material.diffuseColor, 3) == true) &&
+				(ReadFloats(stream, material.specularColor, 3) == true) &&
+				(ReadFloats(stream, &material.shininess, 1) == true) &&
+				(materialLookup.count(tag) == 0));
+			if (bValid == true)
+			{
+				material.tag = AddString(tag);
+				materialLookup[tag] = (int)m_materials.size();
+				m_materials.push_back(material);
+			}
+		}
+		else if (record == "group")
+		{
+			SCENE_NODE node;
+			std::string name;
+			std::string parent;
+			bValid = ((stream >> name >> parent) &&
+				((parent == "-") || (groupLookup.count(parent) > 0)) &&
+				(ReadFloats(stream, node.position, 3) == true) &&
+				(groupLookup.count(name) == 0));
+			if (bValid == true)
+			{
+				node.scale[0] = node.scale[1] = node.scale[2] = 1.0f;
+				node.rotation[0] = node.rotation[1] = node.rotation[2] = 0.0f;
+				node.parent = (parent == "-") ? -1 : groupLookup[parent];
+				groupLookup[name] = (int)m_nodes.size();
+				m_nodes.push_back(node);
+			}
+		}
+		else if (record == "object")
+		{
+			SCENE_NODE node;
+			SCENE_OBJECT object;
+			std::string meshName;
+			std::string parent;
+			std::string textureTag;
+			std::string materialTag;
+			std::string option;
+			MESH_TYPE mesh = MESH_PLANE;
+
+			bValid = ((stream >> meshName >> parent) &&
+				(FindMesh(meshName, mesh) == true) &&
+				((parent == "-") || (groupLookup.count(parent) > 0)) &&
+				(ReadFloats(stream, node.scale, 3) == true) &&
+				(ReadFloats(stream, node.rotation, 3) == true) &&
+				(ReadFloats(stream, node.position, 3) == true) &&
+				(stream >> textureTag >> materialTag) &&
+				((textureTag == "-") || (textureLookup.count(textureTag) > 0)) &&
+				((materialTag == "-") || (materialLookup.count(materialTag) > 0)));
+
+			object.color[0] = object.color[1] = object.color[2] = object.color[3] = 1.0f;
+			object.UVscale[0] = object.UVscale[1] = 1.0f;
+
+			// the optional values may follow in any order
+			while ((bValid == true) && (stream >> option))
+			{
+				if (option == "uv")
+				{
+					bValid = ReadFloats(stream, object.UVscale, 2);
+				}
+				else if (option == "color")
+				{
+					bValid = ReadFloats(stream, object.color, 4);
+				}
+				else
+				{
+					bValid = false;
+				}
+			}
+
+			if (bValid == true)
+			{
+				node.parent = (parent == "-") ? -1 : groupLookup[parent];
+				object.node = (int32_t)m_nodes.size();
+				object.mesh = (int32_t)mesh;
+				object.texture = (textureTag == "-") ? -1 : textureLookup[textureTag];
+				object.material = (materialTag == "-") ? -1 : materialLookup[materialTag];
+				m_nodes.push_back(node);
+				m_objects.push_back(object);
+			}
+		}
+		else
+		{
+			bValid = false;
+		}
+
+		if (bValid == false)
+		{
+			std::cout << "Invalid scene record:" << filePath << "(" << lineNumber << "): " << line << std::endl;
+			Close();
+			return(false);
+		}
+	}
+
+	UseParsedRecords();
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddString()
+ *
+ *  This method is used for adding a string to the string
+ *  table of a text scene file and getting its offset.
+ ***********************************************************/
+uint32_t SceneFile::AddString(const std::string& value)
+{
+	uint32_t offset = (uint32_t)m_strings.size();
+
+	m_strings.insert(m_strings.end(), value.begin(), value.end());
+	m_strings.push_back('\0');
+
+	return(offset);
+}
+
+/***********************************************************
+ *  UseParsedRecords()
+ *
+ *  This method is used for pointing the records in use at
+ *  the records that were read from a text file.
+ ***********************************************************/
+void SceneFile::UseParsedRecords()
+{
+	m_pTextures = m_textures.data();
+	m_pMaterials = m_materials.data();
+	m_pNodes = m_nodes.data();
+	m_pObjects = m_objects.data();
+	m_pStrings = m_strings.data();
+	m_textureCount = (int)m_textures.size();
+	m_materialCount = (int)m_materials.size();
+	m_nodeCount = (int)m_nodes.size();
+	m_objectCount = (int)m_objects.size();
+	m_stringSize = (uint32_t)m_strings.size();
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for mapping a compiled scene file.
+ *  The records are used in place from the mapped memory, so
+ *  nothing is read or copied - the sections and indices are
+ *  checked once so a damaged file can not be read outside
+ *  of its bounds.
+ ***********************************************************/
+bool SceneFile::LoadBinary(const char* filePath)
+{
+	Close();
+
+	if (MapFile(filePath) == false)
+	{
+		return(false);
+	}
+
+	if (ValidateMappedFile() == false)
+	{
+		std::cout << "Invalid compiled scene file:" << filePath << std::endl;
+		Close();
+		return(false);
+	}
+
+	const SCENE_HEADER* pHeader = (const SCENE_HEADER*)m_pMapped;
+	m_pTextures = (const SCENE_TEXTURE*)(m_pMapped + pHeader->textureOffset);
+	m_pMaterials = (const SCENE_MATERIAL*)(m_pMapped + pHeader->materialOffset);
+	m_pNodes = (const SCENE_NODE*)(m_pMapped + pHeader->nodeOffset);
+	m_pObjects = (const SCENE_OBJECT*)(m_pMapped + pHeader->objectOffset);
+	m_pStrings = (const char*)(m_pMapped + pHeader->stringOffset);
+	m_textureCount = (int)pHeader->textureCount;
+	m_materialCount = (int)pHeader->materialCount;
+	m_nodeCount = (int)pHeader->nodeCount;
+	m_objectCount = (int)pHeader->objectCount;
+	m_stringSize = pHeader->stringSize;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ValidateMappedFile()
+ *
+ *  This method is used for checking that the header of the
+ *  mapped file matches this version, that every section is
+ *  inside of the file, and that every index and string
+ *  offset of the records is in range.
+ ***********************************************************/
+bool SceneFile::ValidateMappedFile()
+{
+	if (m_mappedSize < sizeof(SCENE_HEADER))
+	{
+		return(false);
+	}
+
+	const SCENE_HEADER* pHeader = (const SCENE_HEADER*)m_pMapped;
+	uint64_t fileSize = (uint64_t)m_mappedSize;
+
+	if ((pHeader->magic != SCENE_MAGIC) ||
+		(pHeader->version != SCENE_VERSION) ||
+		(pHeader->fileSize != fileSize) ||
+		(IsSectionInFile(pHeader->textureOffset, pHeader->textureCount, sizeof(SCENE_TEXTURE), fileSize) == false) ||
+		(IsSectionInFile(pHeader->materialOffset, pHeader->materialCount, sizeof(SCENE_MATERIAL), fileSize) == false) ||
+		(IsSectionInFile(pHeader->nodeOffset, pHeader->nodeCount, sizeof(SCENE_NODE), fileSize) == false) ||
+		(IsSectionInFile(pHeader->objectOffset, pHeader->objectCount, sizeof(SCENE_OBJECT), fileSize) == false) ||
+		(IsSectionInFile(pHeader->stringOffset, pHeader->stringSize, 1, fileSize) == false) ||
+		(pHeader->stringSize == 0))
+	{
+		return(false);
+	}
+
+	const char* pStrings = (const char*)(m_pMapped + pHeader->stringOffset);
+	if (pStrings[pHeader->stringSize - 1] != '\0')
+	{
+		return(false);
+	}
+
+	const SCENE_TEXTURE* pTextures = (const SCENE_TEXTURE*)(m_pMapped + pHeader->textureOffset);
+	for (uint32_t i = 0; i < pHeader->textureCount; i++)
+	{
+		if ((pTextures[i].tag >= pHeader->stringSize) || (pTextures[i].path >= pHeader->stringSize))
+		{
+			return(false);
+		}
+	}
+
+	const SCENE_MATERIAL* pMaterials = (const SCENE_MATERIAL*)(m_pMapped + pHeader->materialOffset);
+	for (uint32_t i = 0; i < pHeader->materialCount; i++)
+	{
+		if (pMaterials[i].tag >= pHeader->stringSize)
+		{
+			return(false);
+		}
+	}
+
+	// a parent must come before its children
+	const SCENE_NODE* pNodes = (const SCENE_NODE*)(m_pMapped + pHeader->nodeOffset);
+	for (uint32_t i = 0; i < pHeader->nodeCount; i++)
+	{
+		if ((pNodes[i].parent < -1) || (pNodes[i].parent >= (int32_t)i))
+		{
+			return(false);
+		}
+	}
+
+	const SCENE_OBJECT* pObjects = (const SCENE_OBJECT*)(m_pMapped + pHeader->objectOffset);
+	for (uint32_t i = 0; i < pHeader->objectCount; i++)
+	{
+		const SCENE_OBJECT& object = pObjects[i];
+		if ((object.node < 0) || (object.node >= (int32_t)pHeader->nodeCount) ||
+			(object.mesh < 0) || (object.mesh >= MESH_COUNT) ||
+			(object.texture < -1) || (object.texture >= (int32_t)pHeader->textureCount) ||
+			(object.material < -1) || (object.material >= (int32_t)pHeader->materialCount))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteBinary()
+ *
+ *  This method is used for writing the records in use into
+ *  a compiled scene file.  Each section starts on an
+ *  aligned offset so the records can be read in place once
+ *  the file is mapped.
+ ***********************************************************/
+bool SceneFile::WriteBinary(const char* filePath) const
+{
+	SCENE_HEADER header = {};
+	uint32_t offset = AlignSection((uint32_t)sizeof(SCENE_HEADER));
+
+	header.magic = SCENE_MAGIC;
+	header.version = SCENE_VERSION;
+	header.textureCount = (uint32_t)m_textureCount;
+	header.textureOffset = offset;
+	offset = AlignSection(offset + header.textureCount * (uint32_t)sizeof(SCENE_TEXTURE));
+	header.materialCount = (uint32_t)m_materialCount;
+	header.materialOffset = offset;
+	offset = AlignSection(offset + header.materialCount * (uint32_t)sizeof(SCENE_MATERIAL));
+	header.nodeCount = (uint32_t)m_nodeCount;
+	header.nodeOffset = offset;
+	offset = AlignSection(offset + header.nodeCount * (uint32_t)sizeof(SCENE_NODE));
+	header.objectCount = (uint32_t)m_objectCount;
+	header.objectOffset = offset;
+	offset = AlignSection(offset + header.objectCount * (uint32_t)sizeof(SCENE_OBJECT));
+	header.stringSize = m_stringSize;
+	header.stringOffset = offset;
+	header.fileSize = offset + m_stringSize;
+
+	if (m_stringSize == 0)
+	{
+		return(false);
+	}
+
+	// the file is built in memory so it is written with one call
+	std::vector<char> data(header.fileSize, 0);
+	memcpy(data.data(), &header, sizeof(header));
+	if (m_textureCount > 0)
+	{
+		memcpy(data.data() + header.textureOffset, m_pTextures, header.textureCount * sizeof(SCENE_TEXTURE));
+	}
+	if (m_materialCount > 0)
+	{
+		memcpy(data.data() + header.materialOffset, m_pMaterials, header.materialCount * sizeof(SCENE_MATERIAL));
+	}
+	if (m_nodeCount > 0)
+	{
+		memcpy(data.data() + header.nodeOffset, m_pNodes, header.nodeCount * sizeof(SCENE_NODE));
+	}
+	if (m_objectCount > 0)
+	{
+		memcpy(data.data() + header.objectOffset, m_pObjects, header.objectCount * sizeof(SCENE_OBJECT));
+	}
+	memcpy(data.data() + header.stringOffset, m_pStrings, m_stringSize);
+
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if ((file.is_open() == false) ||
+		(file.write(data.data(), data.size()).good() == false))
+	{
+		file.close();
+		remove(filePath);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  MapFile()
+ *
+ *  This method is used for mapping a whole file into memory
+ *  for reading.
+ ***********************************************************/
+bool SceneFile::MapFile(const char* filePath)
+{
+#ifdef _WIN32
+	LARGE_INTEGER fileSize;
+
+	m_fileHandle = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	if ((GetFileSizeEx(m_fileHandle, &fileSize) == FALSE) || (fileSize.QuadPart <= 0))
+	{
+		UnmapFile();
+		return(false);
+	}
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == m_mappingHandle)
+	{
+		UnmapFile();
+		return(false);
+	}
+
+	m_pMapped = (const unsigned char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (NULL == m_pMapped)
+	{
+		UnmapFile();
+		return(false);
+	}
+	m_mappedSize = (size_t)fileSize.QuadPart;
+#else
+	struct stat fileInfo;
+	int fileHandle = open(filePath, O_RDONLY);
+
+	if (fileHandle < 0)
+	{
+		return(false);
+	}
+
+	if ((fstat(fileHandle, &fileInfo) != 0) || (fileInfo.st_size <= 0))
+	{
+		close(fileHandle);
+		return(false);
+	}
+
+	// the mapping stays valid after the file is closed
+	void* pMapped = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileHandle, 0);
+	close(fileHandle);
+	if (pMapped == MAP_FAILED)
+	{
+		return(false);
+	}
+	m_pMapped = (const unsigned char*)pMapped;
+	m_mappedSize = (size_t)fileInfo.st_size;
+#endif
+
+	return(true);
+}
+
+/***********************************************************
+ *  UnmapFile()
+ *
+ *  This method is used for unmapping the mapped file.
+ ***********************************************************/
+void SceneFile::UnmapFile()
+{
+#ifdef _WIN32
+	if (NULL != m_pMapped)
+	{
+		UnmapViewOfFile(m_pMapped);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (NULL != m_pMapped)
+	{
+		munmap((void*)m_pMapped, m_mappedSize);
+	}
+#endif
+	m_pMapped = NULL;
+	m_mappedSize = 0;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for freeing the records that were
+ *  read and unmapping the compiled file.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	UnmapFile();
+
+	m_textures.clear();
+	m_materials.clear();
+	m_nodes.clear();
+	m_objects.clear();
+	m_strings.clear();
+
+	m_pTextures = NULL;
+	m_pMaterials = NULL;
+	m_pNodes = NULL;
+	m_pObjects = NULL;
+	m_pStrings = NULL;
+	m_textureCount = 0;
+	m_materialCount = 0;
+	m_nodeCount = 0;
+	m_objectCount = 0;
+	m_stringSize = 0;
+}
+
+/***********************************************************
+ *  GetCompiledPath()
+ *
+ *  This method is used for getting the name of the compiled
+ *  file of a text scene file, which is the same name with a
+ *  .sceneb extension.
+ ***********************************************************/
+std::string SceneFile::GetCompiledPath(const char* filePath)
+{
+	std::string compiledPath = filePath;
+	size_t extension = compiledPath.find_last_of("./\\");
+
+	if ((extension != std::string::npos) && (compiledPath[extension] == '.'))
+	{
+		compiledPath.erase(extension);
+	}
+	compiledPath += ".sceneb";
+
+	return(compiledPath);
+}
+
+/***********************************************************
+ *  FindMesh()
+ *
+ *  This method is used for finding the mesh type of a mesh
+ *  name in a text scene file.
+ ***********************************************************/
+bool SceneFile::FindMesh(const std::string& name, MESH_TYPE& mesh)
+{
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		if (name == g_MeshNames[i])
+		{
+			mesh = (MESH_TYPE)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures.
+ ***********************************************************/
+int SceneFile::GetTextureCount() const
+{
+	return(m_textureCount);
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method is used for getting the number of materials.
+ ***********************************************************/
+int SceneFile::GetMaterialCount() const
+{
+	return(m_materialCount);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of transform
+ *  nodes, which includes one node for each object.
+ ***********************************************************/
+int SceneFile::GetNodeCount() const
+{
+	return(m_nodeCount);
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects.
+ ***********************************************************/
+int SceneFile::GetObjectCount() const
+{
+	return(m_objectCount);
+}
+
+/***********************************************************
+ *  GetTextures()
+ *
+ *  This method is used for getting the texture records.
+ ***********************************************************/
+const SceneFile::SCENE_TEXTURE* SceneFile::GetTextures() const
+{
+	return(m_pTextures);
+}
+
+/***********************************************************
+ *  GetMaterials()
+ *
+ *  This method is used for getting the material records.
+ ***********************************************************/
+const SceneFile::SCENE_MATERIAL* SceneFile::GetMaterials() const
+{
+	return(m_pMaterials);
+}
+
+/***********************************************************
+ *  GetNodes()
+ *
+ *  This method is used for getting the transform nodes.
+ ***********************************************************/
+const SceneFile::SCENE_NODE* SceneFile::GetNodes() const
+{
+	return(m_pNodes);
+}
+
+/***********************************************************
+ *  GetObjects()
+ *
+ *  This method is used for getting the object records.
+ ***********************************************************/
+const SceneFile::SCENE_OBJECT* SceneFile::GetObjects() const
+{
+	return(m_pObjects);
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting a string of the string
+ *  table.  An offset outside the table gives an empty string.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+	if ((NULL == m_pStrings) || (offset >= m_stringSize))
+	{
+		return("");
+	}
+	return(m_pStrings + offset);
+}
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read scene descriptions from text files and compiled binary files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeGeometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class holds the textures, materials, transform
+ *  nodes and objects of a scene.  A scene is written as a
+ *  text file with one record on each line:
+ *
+ *    texture  <tag> <image file>
+ *    material <tag> <diffuse r g b> <specular r g b> <shininess>
+ *    group    <name> <parent group or -> <x y z>
+ *    object   <mesh> <parent group or -> <scale x y z>
+ *             <rotation x y z> <position x y z>
+ *             <texture tag or -> <material tag>
+ *             [uv <u> <v>] [color <r> <g> <b> <a>]
+ *
+ *  Lines that start with # are comments.  A compiled copy
+ *  of the text file is written next to it with a .sceneb
+ *  extension.  The compiled file holds the records as flat
+ *  arrays of fixed size structs, with the tags in a string
+ *  table, so it is mapped into memory and read in place
+ *  with no parsing and no allocation for each object.  The
+ *  compiled file is used whenever it is newer than the text.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// the records of the compiled file - the strings are byte
+	// offsets into the string table
+	struct SCENE_TEXTURE
+	{
+		uint32_t tag;
+		uint32_t path;
+	};
+
+	struct SCENE_MATERIAL
+	{
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+		uint32_t tag;
+	};
+
+	// a transform node - parents are stored before children
+	struct SCENE_NODE
+	{
+		float scale[3];
+		// rotation around the X, Y and Z axis in degrees
+		float rotation[3];
+		float position[3];
+		// index of the parent node, or -1 for a root node
+		int32_t parent;
+	};
+
+	struct SCENE_OBJECT
+	{
+		int32_t node;
+		int32_t mesh;
+		// index of the texture record, or -1 for a solid color
+		int32_t texture;
+		// index of the material record, or -1 for none
+		int32_t material;
+		float color[4];
+		float UVscale[2];
+	};
+
+	// the header at the start of the compiled file
+	struct SCENE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t fileSize;
+		uint32_t textureCount;
+		uint32_t textureOffset;
+		uint32_t materialCount;
+		uint32_t materialOffset;
+		uint32_t nodeCount;
+		uint32_t nodeOffset;
+		uint32_t objectCount;
+		uint32_t objectOffset;
+		uint32_t stringSize;
+		uint32_t stringOffset;
+	};
+
+private:
+	// the records parsed from a text file
+	std::vector<SCENE_TEXTURE> m_textures;
+	std::vector<SCENE_MATERIAL> m_materials;
+	std::vector<SCENE_NODE> m_nodes;
+	std::vector<SCENE_OBJECT> m_objects;
+	std::vector<char> m_strings;
+
+	// the mapped compiled file
+	const unsigned char* m_pMapped;
+	size_t m_mappedSize;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	// the records in use, which point into the parsed arrays
+	// or into the mapped file
+	const SCENE_TEXTURE* m_pTextures;
+	const SCENE_MATERIAL* m_pMaterials;
+	const SCENE_NODE* m_pNodes;
+	const SCENE_OBJECT* m_pObjects;
+	const char* m_pStrings;
+	int m_textureCount;
+	int m_materialCount;
+	int m_nodeCount;
+	int m_objectCount;
+	uint32_t m_stringSize;
+
+	// add a string to the string table and return its offset
+	uint32_t AddString(const std::string& value);
+	// point the records in use at the parsed arrays
+	void UseParsedRecords();
+	// map a file into memory for reading
+	bool MapFile(const char* filePath);
+	void UnmapFile();
+	// check that the records of the mapped file are in range
+	bool ValidateMappedFile();
+
+public:
+	// load a scene - the compiled file next to the text file
+	// is used when it is up to date, otherwise the text is
+	// read and compiled again
+	bool Load(const char* filePath);
+	// read a text scene file
+	bool LoadText(const char* filePath);
+	// map a compiled scene file
+	bool LoadBinary(const char* filePath);
+	// write the records into a compiled scene file
+	bool WriteBinary(const char* filePath) const;
+	// free the records and unmap the file
+	void Close();
+
+	// the name of the compiled file of a text scene file
+	static std::string GetCompiledPath(const char* filePath);
+	// the mesh of a mesh name in a text file
+	static bool FindMesh(const std::string& name, MESH_TYPE& mesh);
+
+	int GetTextureCount() const;
+	int GetMaterialCount() const;
+	int GetNodeCount() const;
+	int GetObjectCount() const;
+	const SCENE_TEXTURE* GetTextures() const;
+	const SCENE_MATERIAL* GetMaterials() const;
+	const SCENE_NODE* GetNodes() const;
+	const SCENE_OBJECT* GetObjects() const;
+	// a string of the string table
+	const char* GetString(uint32_t offset) const;
+};
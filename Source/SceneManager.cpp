@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "FrameProfiler.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +17,123 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
+	const char* g_NormalMatrixName = "normalMatrix";
 	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
+	const char* g_TextureValueName = "objectTextureIndex";
+	const char* g_TextureArrayName = "textureArrays";
+	const char* g_VertexShaderPath = "shaders/vertexShader.glsl";
+	const char* g_FragmentShaderPath = "shaders/fragmentShader.glsl";
+	const char* g_LightDataName = "pointLightData";
+	const char* g_ClusterGridName = "clusterLightGrid";
+	const char* g_LightIndexName = "clusterLightIndices";
+	const char* g_ShadowVertexShaderPath = "shaders/shadowVertexShader.glsl";
+	const char* g_ShadowFragmentShaderPath = "shaders/shadowFragmentShader.glsl";
+	const char* g_CullComputeShaderPath = "shaders/cullComputeShader.glsl";
+	const char* g_DepthPyramidShaderPath = "shaders/depthPyramidComputeShader.glsl";
+	const char* g_FullscreenVertexShaderPath = "shaders/fullscreenVertexShader.glsl";
+	const char* g_TransparencyFragmentShaderPath = "shaders/transparencyFragmentShader.glsl";
+	const char* g_CascadeShadowName = "cascadeShadowMap";
+	const char* g_PointShadowName = "pointShadowMaps";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UseInstancingName = "bUseInstancing";
+	const char* g_UVscaleName = "UVscale";
+	const char* g_MaterialDiffuseName = "material.diffuseColor";
+	const char* g_MaterialSpecularName = "material.specularColor";
+	const char* g_MaterialShininessName = "material.shininess";
+
+	// the indices the shader files are watched with
+	const int g_SceneShaderAsset = 0;
+	const int g_ShadowShaderAsset = 1;
+
+	// the number of materials the shader material table holds
+	const int MAX_SHADER_MATERIALS = UniformBufferManager::MAX_MATERIALS;
+
+	// the widths of the sort key fields below the shader and
+	// mesh - the largest value of the texture and material
+	// fields stands for no texture or no material, and the
+	// render item index is in the lowest bits
+	const int g_SortTextureBits = 12;
+	const int g_SortMaterialBits = 12;
+	const int g_SortItemBits = 24;
+	const uint64_t g_SortNoTexture = (1 << g_SortTextureBits) - 1;
+	const uint64_t g_SortNoMaterial = (1 << g_SortMaterialBits) - 1;
+	const uint64_t g_SortItemMask = (1 << g_SortItemBits) - 1;
+	// the most render items the sort keys can tell apart
+	const int MAX_SORTED_ITEMS = 1 << g_SortItemBits;
+	static_assert(UniformBufferManager::MAX_TEXTURES < (1 << g_SortTextureBits),
+		"every texture slot needs a sort key value below the no texture value");
+
+	// below this many instances the frustum test over every
+	// box is faster than walking the bounding volume hierarchy
+	const int g_BVHCullThreshold = 1024;
+
+	// the fewest instances each job updates, tests or packs,
+	// below which splitting the work costs more than it saves
+	const int g_InstanceJobBatch = 256;
+	// the size of the blocks the visible instances are packed
+	// in - each block is packed by one job
+	const int g_VisibleBlockSize = 1024;
+	// the starting size of the scratch memory of each frame,
+	// which grows to fit the largest frame
+	const size_t g_FrameArenaSize = 256 * 1024;
+
+	// the names of the culling modes on the command line
+	const char* g_CullingModeNames[SceneManager::CULL_MODE_COUNT] = { "cpu", "gpu", "occlusion" };
+	// the names of the transparency modes on the command line
+	const char* g_TransparencyModeNames[SceneManager::TRANSPARENCY_MODE_COUNT] = { "sorted", "weighted" };
+
+	// the projected size of an instance's bounding sphere,
+	// as a fraction of the view height, below which the next
+	// coarser level of detail is drawn
+	const float g_LevelScreenSizes[ShapeGeometry::LOD_COUNT - 1] = { 0.15f, 0.05f };
+	// how far past a switch size an instance has to go before
+	// it changes level again, so objects near the switch
+	// distance do not flicker between two levels
+	const float g_LevelHysteresis = 0.2f;
+
+	// the level of detail for a projected size, starting from
+	// the level the instance was drawn with last frame
+	int SelectDetailLevel(float screenSize, int currentLevel, int levelCount)
+	{
+		int level = std::min(currentLevel, levelCount - 1);
+
+		while ((level > 0) &&
+			(screenSize > g_LevelScreenSizes[level - 1] * (1.0f + g_LevelHysteresis)))
+		{
+			level--;
+		}
+		while ((level < levelCount - 1) &&
+			(screenSize < g_LevelScreenSizes[level] * (1.0f - g_LevelHysteresis)))
+		{
+			level++;
+		}
+
+		return(level);
+	}
+
+	// the generated scenes always use the same random seed so
+	// that every run builds the same objects
+	const unsigned int g_SyntheticSceneSeed = 330;
+	// the distance between the cells of the generated scene
+	const float g_SyntheticSpacing = 3.0f;
+
+	// a random value from 0 to 1 - the raw generator output is
+	// used because the standard distributions may give other
+	// values with another standard library
+	float RandomUnit(std::mt19937& random)
+	{
+		return((float)(random() >> 8) / 16777216.0f);
+	}
 }
 
 /***********************************************************
@@ -31,10 +141,63 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(
+	ShaderManager *pShaderManager,
+	UniformBufferManager* pUniformBuffers)
 {
 	m_pShaderManager = pShaderManager;
+	m_pUniformBuffers = pUniformBuffers;
 	m_basicMeshes = new ShapeMeshes();
+	m_instancedMeshes = new InstancedMeshes();
+	m_textureManager = new TextureManager(m_pUniformBuffers);
+	m_textureLoader = new TextureLoader(m_textureManager);
+	m_jobSystem = new JobSystem();
+	m_lightManager = new LightManager(m_pUniformBuffers);
+	m_shaderVariants = new ShaderVariants(m_pUniformBuffers);
+	m_shadowManager = new ShadowManager(m_pUniformBuffers);
+	m_gpuCuller = new GpuCuller();
+	m_weightedTransparency = new WeightedTransparency(m_pUniformBuffers);
+	m_frameArena = new FrameArena(g_FrameArenaSize);
+	// the instances, commands and cull values are uploaded
+	// through the same ring as the uniform blocks
+	if (NULL != m_pUniformBuffers)
+	{
+		m_instancedMeshes->SetStreamBuffer(m_pUniformBuffers->GetStreamBuffer());
+		m_gpuCuller->SetStreamBuffer(m_pUniformBuffers->GetStreamBuffer());
+	}
+	m_assetWatcher = NULL;
+	m_lightingVariantFlags = 0;
+	m_loadedTextures = 0;
+	m_visibleInstanceCount = 0;
+	m_pVisibleBlockOffsets = NULL;
+	m_visibleLevelStride = 0;
+	m_shadowCommandCount = 0;
+	m_cullingMode = CULL_CPU;
+	m_bGpuCullingSupported = false;
+	m_bGpuCommandsDirty = false;
+	m_sortedCommandFirst = 0;
+	m_firstTransparentInstance = 0;
+	m_sortPosition = glm::vec3(0.0f);
+	m_transparencyMode = TRANSPARENCY_SORTED;
+	m_bWeightedTransparencySupported = false;
+	m_bDepthPrepass = false;
+	m_depthPrepassVariant = -1;
+	m_bInstancesDirty = false;
+	m_bShadowCastersDirty = true;
+	m_bShadowsEnabled = false;
+	m_syntheticObjectCount = 0;
+	m_uniforms.model = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.normalMatrix = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.objectColor = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.objectTextureIndex = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.useTexture = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.useLighting = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.useInstancing = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.UVscale = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.materialDiffuse = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.materialSpecular = ShaderUniformCache::INVALID_HANDLE;
+	m_uniforms.materialShininess = ShaderUniformCache::INVALID_HANDLE;
+	InvalidateShaderState();
 }
 
 /***********************************************************
@@ -45,114 +208,102 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
+	m_pUniformBuffers = NULL;
+	// the watcher thread is stopped before the assets it
+	// reports are freed
+	delete m_assetWatcher;
+	m_assetWatcher = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_instancedMeshes;
+	m_instancedMeshes = NULL;
+	delete m_jobSystem;
+	m_jobSystem = NULL;
+	delete m_textureLoader;
+	m_textureLoader = NULL;
+	delete m_textureManager;
+	m_textureManager = NULL;
+	delete m_lightManager;
+	m_lightManager = NULL;
+	delete m_shaderVariants;
+	m_shaderVariants = NULL;
+	delete m_shadowManager;
+	m_shadowManager = NULL;
+	delete m_gpuCuller;
+	m_gpuCuller = NULL;
+	delete m_weightedTransparency;
+	m_weightedTransparency = NULL;
+	delete m_frameArena;
+	m_frameArena = NULL;
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+ *  This method is used for requesting a texture to be loaded
+ *  from an image file into the next slot of the texture
+ *  table.  The image file is decoded in the background,
+ *  and the texture shows a placeholder image until the
+ *  decoded image has been uploaded in RenderScene().
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
+{
+	int textureIndex = -1;
 
-		return true;
+	if (NULL != m_textureLoader)
+	{
+		textureIndex = m_textureLoader->RequestTexture(filename);
+	}
+	if (textureIndex < 0)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
-
-	// Error loading the image
-	return false;
-
+	// register the texture and associate it with the special tag string
+	TEXTURE_INFO textureInfo;
+	textureInfo.tag = tag;
+	textureInfo.ID = (uint32_t)textureIndex;
+	textureInfo.filename = filename;
+	m_textureIDs.push_back(textureInfo);
+	m_textureSlotLookup[tag] = m_loadedTextures;
+	if (NULL != m_assetWatcher)
+	{
+		m_assetWatcher->WatchFile(filename, AssetWatcher::ASSET_TEXTURE, m_loadedTextures);
+	}
+	m_loadedTextures++;
 
+	return true;
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for binding the texture arrays that
+ *  hold the loaded textures to their texture units.  Each
+ *  array holds every texture of one size and format, so
+ *  the number of textures is not limited by the number of
+ *  texture units.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
-	}
+	m_textureManager->BindTextures();
 }
 
 /***********************************************************
  *  DestroyGLTextures()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for freeing the texture arrays and
+ *  the layers they hand out, and forgetting the textures
+ *  that were requested, so the next texture is given the
+ *  first entry of the texture table again.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glGenTextures(1, &m_textureIDs[i].ID);
-	}
+	m_textureManager->DestroyTextures();
+	m_textureIDs.clear();
+	m_textureSlotLookup.clear();
+	m_loadedTextures = 0;
 }
 
 /***********************************************************
@@ -161,21 +312,14 @@ void SceneManager::DestroyGLTextures()
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const std::string& tag)
 {
 	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	int textureSlot = FindTextureSlot(tag);
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	if (textureSlot >= 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		textureID = m_textureIDs[textureSlot].ID;
 	}
 
 	return(textureID);
@@ -185,23 +329,19 @@ int SceneManager::FindTextureID(std::string tag)
  *  FindTextureSlot()
  *
  *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  loaded texture bitmap associated with the passed in tag.  The
+ *  tags are interned when the textures are loaded, so the lookup
+ *  does not depend on the number of loaded textures.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const std::string& tag)
 {
 	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	std::unordered_map<std::string, int>::const_iterator found =
+		m_textureSlotLookup.find(tag);
+	if (found != m_textureSlotLookup.end())
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		textureSlot = found->second;
 	}
 
 	return(textureSlot);
@@ -213,40 +353,130 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	int materialIndex = FindMaterialIndex(tag);
+
+	if (materialIndex < 0)
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	material.diffuseColor = m_objectMaterials[materialIndex].diffuseColor;
+	material.specularColor = m_objectMaterials[materialIndex].specularColor;
+	material.shininess = m_objectMaterials[materialIndex].shininess;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material
+ *  in the previously defined materials list that is
+ *  associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	int materialIndex = -1;
+
+	std::unordered_map<std::string, int>::const_iterator found =
+		m_materialLookup.find(tag);
+	if (found != m_materialLookup.end())
+	{
+		materialIndex = found->second;
+	}
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  BuildMaterialLookup()
+ *
+ *  This method is used for interning the tags of all the
+ *  defined materials so they can be found without scanning
+ *  the materials list.  When a tag is defined more than
+ *  once, the first definition is used.  A reloaded scene
+ *  mostly has the same tags, so the entries are updated in
+ *  place and only the new tags are added, which keeps the
+ *  reload from making the whole table again.
+ ***********************************************************/
+void SceneManager::BuildMaterialLookup()
+{
+	std::unordered_map<std::string, int>::iterator entry;
+
+	for (entry = m_materialLookup.begin(); entry != m_materialLookup.end(); ++entry)
+	{
+		entry->second = -1;
+	}
+
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		entry = m_materialLookup.find(m_objectMaterials[index].tag);
+		if (entry == m_materialLookup.end())
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			m_materialLookup.insert(
+				std::make_pair(m_objectMaterials[index].tag, index));
+		}
+		else if (entry->second < 0)
+		{
+			entry->second = index;
+		}
+	}
+
+	// forget the tags that are no longer defined
+	for (entry = m_materialLookup.begin(); entry != m_materialLookup.end();)
+	{
+		if (entry->second < 0)
+		{
+			entry = m_materialLookup.erase(entry);
 		}
 		else
 		{
-			index++;
+			++entry;
 		}
 	}
+}
+
+/***********************************************************
+ *  UploadMaterialTable()
+ *
+ *  This method is used for passing all of the defined
+ *  materials into the material table uniform buffer, where
+ *  the instanced draws select them by index.
+ ***********************************************************/
+void SceneManager::UploadMaterialTable()
+{
+	if (NULL == m_pUniformBuffers)
+	{
+		return;
+	}
 
-	return(true);
+	int materialCount = (int)m_objectMaterials.size();
+	if (materialCount > MAX_SHADER_MATERIALS)
+	{
+		std::cout << "Only the first " << MAX_SHADER_MATERIALS << " of " << materialCount
+			<< " materials can be used by the instanced draws" << std::endl;
+		materialCount = MAX_SHADER_MATERIALS;
+	}
+
+	for (int i = 0; i < materialCount; i++)
+	{
+		m_pUniformBuffers->SetMaterial(
+			i,
+			m_objectMaterials[i].diffuseColor,
+			m_objectMaterials[i].specularColor,
+			m_objectMaterials[i].shininess);
+	}
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  BuildModelMatrix()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values.
  ***********************************************************/
-void SceneManager::SetTransformations(
+glm::mat4 SceneManager::BuildModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -254,7 +484,6 @@ void SceneManager::SetTransformations(
 	glm::vec3 positionXYZ)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -270,11 +499,37 @@ void SceneManager::SetTransformations(
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	modelView = BuildModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_uniformCache.SetMat4(m_uniforms.model, modelView);
+		m_uniformCache.SetMat3(m_uniforms.normalMatrix,
+			glm::transpose(glm::inverse(glm::mat3(modelView))));
 	}
 }
 
@@ -300,8 +555,8 @@ void SceneManager::SetShaderColor(
 
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_uniformCache.SetBool(m_uniforms.useTexture, false);
+		m_uniformCache.SetVec4(m_uniforms.objectColor, currentColor);
 	}
 }
 
@@ -312,15 +567,25 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const std::string& textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	SetShaderTexture(FindTextureSlot(textureTag));
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture in the passed
+ *  in slot of the texture table into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureSlot)
+{
+	if ((NULL != m_pShaderManager) &&
+		(textureSlot >= 0) && (textureSlot < m_loadedTextures))
+	{
+		m_uniformCache.SetBool(m_uniforms.useTexture, true);
+		m_uniformCache.SetInt(m_uniforms.objectTextureIndex, (int)m_textureIDs[textureSlot].ID);
 	}
 }
 
@@ -334,7 +599,7 @@ void SceneManager::SetTextureUVScale(float u, float v)
 {
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_uniformCache.SetVec2(m_uniforms.UVscale, glm::vec2(u, v));
 	}
 }
 
@@ -345,642 +610,2573 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-		std::string textureTag)
+		const std::string& materialTag)
 {
-	if (NULL != m_pShaderManager)
+	SetShaderMaterial(FindMaterialIndex(materialTag));
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the values of the
+ *  material at the passed in index into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+		int materialIndex)
+{
+	if ((NULL != m_pShaderManager) &&
+		(materialIndex >= 0) &&
+		(materialIndex < (int)m_objectMaterials.size()) &&
+		(materialIndex != m_currentMaterial))
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+		m_uniformCache.SetVec3(m_uniforms.materialDiffuse, material.diffuseColor);
+		m_uniformCache.SetVec3(m_uniforms.materialSpecular, material.specularColor);
+		m_uniformCache.SetFloat(m_uniforms.materialShininess, material.shininess);
+		m_currentMaterial = materialIndex;
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
 /***********************************************************
-*LoadSceneTextures()
-*
-* This method is used for preparing the 3D scene by loading
-* the shapes, textures in memory to support the 3D scene
-* rendering
-* **********************************************************/
-void SceneManager::LoadSceneTextures()
+ *  InvalidateShaderState()
+ *
+ *  This method is used for forgetting the values that were
+ *  last passed into the shader, so that the next values are
+ *  always sent.  This needs to be called whenever the shader
+ *  values may have been changed outside of this class.
+ ***********************************************************/
+void SceneManager::InvalidateShaderState()
 {
-	bool bReturn = false;
-
-	bReturn = CreateGLTexture(
-		"textures/glasscup.jpg",
-		"glasscup");
-	bReturn = CreateGLTexture(
-		"textures/wood.jpg",
-		"wood");
-	
-	bReturn = CreateGLTexture(
-		"textures/vinous-liquid-with-foam-blobs.jpg",
-		"coffee");
-
-	bReturn = CreateGLTexture(
-		"textures/lamp.jpg",
-		"lamp");
-
-	bReturn = CreateGLTexture(
-		"textures/gold.jpg",
-		"gold");
-
-	bReturn = CreateGLTexture(
-		"textures/keyboard.png",
-		"keyboard");
-
-	bReturn = CreateGLTexture(
-		"textures/aluminum.png",
-		"aluminum");
+	m_uniformCache.Invalidate();
+	m_currentMaterial = -1;
+}
 
-	bReturn = CreateGLTexture(
-		"textures/login.jpg",
-		"login");
+/***********************************************************
+ *  ResolveUniformHandles()
+ *
+ *  This method is used for looking up the locations of the
+ *  uniforms that are set while rendering.  The locations
+ *  are cached for the shader program that is in use, so no
+ *  uniform names are looked up when the scene is drawn.
+ ***********************************************************/
+void SceneManager::ResolveUniformHandles()
+{
+	GLint programID = 0;
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	m_uniformCache.SetProgram((GLuint)programID);
+
+	m_uniforms.model = m_uniformCache.GetHandle(g_ModelName);
+	m_uniforms.normalMatrix = m_uniformCache.GetHandle(g_NormalMatrixName);
+	m_uniforms.objectColor = m_uniformCache.GetHandle(g_ColorValueName);
+	m_uniforms.objectTextureIndex = m_uniformCache.GetHandle(g_TextureValueName);
+	m_uniforms.useTexture = m_uniformCache.GetHandle(g_UseTextureName);
+	m_uniforms.useLighting = m_uniformCache.GetHandle(g_UseLightingName);
+	m_uniforms.useInstancing = m_uniformCache.GetHandle(g_UseInstancingName);
+	m_uniforms.UVscale = m_uniformCache.GetHandle(g_UVscaleName);
+	m_uniforms.materialDiffuse = m_uniformCache.GetHandle(g_MaterialDiffuseName);
+	m_uniforms.materialSpecular = m_uniformCache.GetHandle(g_MaterialSpecularName);
+	m_uniforms.materialShininess = m_uniformCache.GetHandle(g_MaterialShininessName);
+
+	BindSamplerUnits(m_uniformCache);
+
+	InvalidateShaderState();
+}
 
-	bReturn = CreateGLTexture(
-		"textures/leather.jpg",
-		"leather");
+/***********************************************************
+ *  BindSamplerUnits()
+ *
+ *  This method is used for pointing the samplers of the
+ *  program in use at the texture units their textures stay
+ *  bound to.
+ ***********************************************************/
+void SceneManager::BindSamplerUnits(ShaderUniformCache& uniformCache)
+{
+	// each texture array sampler reads from the texture unit
+	// its array stays bound to
+	for (int i = 0; i < TextureManager::MAX_TEXTURE_ARRAYS; i++)
+	{
+		uniformCache.SetInt(
+			uniformCache.GetHandle(std::string(g_TextureArrayName) + "[" + std::to_string(i) + "]"),
+			i);
+	}
 
-	bReturn = CreateGLTexture(
-		"textures/pen.jpg",
-		"pen");
+	// the light buffers stay bound to the units after the arrays
+	uniformCache.SetInt(uniformCache.GetHandle(g_LightDataName), LightManager::LIGHT_DATA_UNIT);
+	uniformCache.SetInt(uniformCache.GetHandle(g_ClusterGridName), LightManager::CLUSTER_GRID_UNIT);
+	uniformCache.SetInt(uniformCache.GetHandle(g_LightIndexName), LightManager::LIGHT_INDEX_UNIT);
 
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
+	// and the shadow maps after the light buffers
+	uniformCache.SetInt(uniformCache.GetHandle(g_CascadeShadowName), ShadowManager::CASCADE_SHADOW_UNIT);
+	for (int i = 0; i < ShadowManager::MAX_POINT_SHADOWS; i++)
+	{
+		uniformCache.SetInt(
+			uniformCache.GetHandle(std::string(g_PointShadowName) + "[" + std::to_string(i) + "]"),
+			ShadowManager::POINT_SHADOW_UNIT + i);
+	}
 }
+
 /***********************************************************
- *  DefineObjectMaterials()
+ *  SelectShaderVariant()
  *
- *  This method is used for configuring the various material
- *  settings for all of the objects within the 3D scene.
+ *  This method is used for finding the shader variant that
+ *  a render item is drawn with.  The retained objects are
+ *  always instanced and lit by the scene lights, and only
+ *  the textured objects sample a texture.  The transparent
+ *  objects of the weighted blending write into its targets.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+int SceneManager::SelectShaderVariant(const RENDER_ITEM& item)
 {
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.diffuseColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	woodMaterial.specularColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	woodMaterial.shininess = 64.0;
-	woodMaterial.tag = "wood";
-	m_objectMaterials.push_back(woodMaterial);
+	unsigned int flags = ShaderVariants::VARIANT_INSTANCING | m_lightingVariantFlags;
 
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.diffuseColor = glm::vec3(0.7f, 0.7f, 0.8f);
-	glassMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	glassMaterial.shininess = 128.0;
-	glassMaterial.tag = "glass";
-	m_objectMaterials.push_back(glassMaterial);
-
-	OBJECT_MATERIAL goldMaterial;
-	goldMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	goldMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.6f);
-	goldMaterial.shininess = 52.0;
-	goldMaterial.tag = "metal";
+	if (item.textureSlot >= 0)
+	{
+		flags |= ShaderVariants::VARIANT_TEXTURE;
+	}
+	if ((IsTransparent(item) == true) && (m_transparencyMode == TRANSPARENCY_WEIGHTED))
+	{
+		flags |= ShaderVariants::VARIANT_WEIGHTED_TRANSPARENCY;
+	}
 
-	m_objectMaterials.push_back(goldMaterial);
+	return(GetShaderVariant(flags));
+}
 
-	OBJECT_MATERIAL leatherMaterial;
-	leatherMaterial.diffuseColor = glm::vec3(0.5f, 0.4f, 0.3f);
-	leatherMaterial.specularColor = glm::vec3(0.01f, 0.01f, 0.01f);
-	leatherMaterial.shininess = 0.001;
-	leatherMaterial.tag = "leather";
+/***********************************************************
+ *  GetShaderVariant()
+ *
+ *  This method is used for finding the shader variant with
+ *  a set of flags.  A variant is compiled the first time it
+ *  is needed, and its samplers are set up once.
+ ***********************************************************/
+int SceneManager::GetShaderVariant(unsigned int flags)
+{
+	int variantIndex = m_shaderVariants->GetVariant(flags);
 
-	m_objectMaterials.push_back(leatherMaterial);
+	while ((variantIndex >= 0) && ((int)m_variantUniforms.size() <= variantIndex))
+	{
+		int newIndex = (int)m_variantUniforms.size();
 
-	OBJECT_MATERIAL canvasMaterial;
-	canvasMaterial.diffuseColor = glm::vec3(0.7f, 0.6f, 0.5f);
-	canvasMaterial.specularColor = glm::vec3(0.02f, 0.02f, 0.02f);
-	canvasMaterial.shininess = 0.001;
-	canvasMaterial.tag = "canvas";
+		m_variantUniforms.push_back(ShaderUniformCache());
+		glUseProgram(m_shaderVariants->GetProgram(newIndex));
+		m_variantUniforms[newIndex].SetProgram(m_shaderVariants->GetProgram(newIndex));
+		BindSamplerUnits(m_variantUniforms[newIndex]);
+		glUseProgram(m_uniformCache.GetProgram());
+	}
 
-	m_objectMaterials.push_back(canvasMaterial);
+	return(variantIndex);
 }
+
 /***********************************************************
- *  SetupSceneLights()
+ *  UseShaderVariant()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene. 
+ *  This method is used for switching to the program of a
+ *  shader variant.  When no variant could be compiled, the
+ *  program that selects the paths with uniforms is used
+ *  with instancing switched on instead.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::UseShaderVariant(int variantIndex)
 {
-	// Enable lighting
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-	//Directional Light
-	m_pShaderManager->setVec3Value("directionalLight.direction", glm::vec3(-0.3f, -1.0f, -0.2f));
-	m_pShaderManager->setVec3Value("directionalLight.ambient", glm::vec3(0.4f, 0.4f, 0.4f));
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", glm::vec3(0.6f, 0.6f, 0.6f));
-	m_pShaderManager->setVec3Value("directionalLight.specular", glm::vec3(0.3f, 0.3f, 0.3f));
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
-
-	//Secondary Light
-	m_pShaderManager->setVec3Value("pointLights[0].position", glm::vec3(2.0f, 3.0f, 2.0f));
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", glm::vec3(0.2f, 0.2f, 0.2f));
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", glm::vec3(1.0f, 0.8f, 0.7f));
-	m_pShaderManager->setVec3Value("pointLights[0].specular", glm::vec3(0.9f, 0.8f, 0.7f));
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	if (variantIndex >= 0)
+	{
+		glUseProgram(m_shaderVariants->GetProgram(variantIndex));
+	}
+	else
+	{
+		glUseProgram(m_uniformCache.GetProgram());
+		m_uniformCache.SetBool(m_uniforms.useInstancing, true);
+	}
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  IsTransparent()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for finding whether a render item is
+ *  blended over the scene, which is set by the alpha of its
+ *  color.
  ***********************************************************/
-void SceneManager::PrepareScene()
+bool SceneManager::IsTransparent(const RENDER_ITEM& item)
 {
-	// load the texture image files for the textures applied
-	// to objects in the 3D scene
-	LoadSceneTextures();
-	// define the materials that will be used for the objects
-	// in the 3D scene
-	DefineObjectMaterials();
-	// add and defile the light sources for the 3D scene
-	SetupSceneLights();
-	
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	return(item.color.a < 1.0f);
+}
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadTorusMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
+/***********************************************************
+ *  BuildSortKey()
+ *
+ *  This method is used for packing the shader state of a
+ *  render item into a sort key.  The top bit puts the
+ *  transparent objects after all of the opaque ones, and
+ *  from there down the key holds the shader program, the
+ *  mesh, the texture slot and the material, with the item
+ *  index in the low 24 bits to keep the sort stable.  The
+ *  texture and the material are read per instance, so they
+ *  are sorted below the mesh to keep the instanced draw
+ *  calls as long as possible.  Every slot of the texture
+ *  table fits in the texture field, and the materials past
+ *  the field share its last value, which only changes their
+ *  order.
+ ***********************************************************/
+uint64_t SceneManager::BuildSortKey(const RENDER_ITEM& item, uint32_t itemIndex) const
+{
+	uint64_t transparentBits = (IsTransparent(item) == true) ? 1 : 0;
+	// the objects without a variant are drawn last
+	uint64_t shaderBits = (item.shaderVariant >= 0) ? (uint64_t)item.shaderVariant : 0x7F;
+	// solid colored objects are sorted after the textured ones
+	uint64_t textureBits = (item.textureSlot >= 0) ? (uint64_t)item.textureSlot : g_SortNoTexture;
+	uint64_t materialBits = (item.materialIndex >= 0) ? (uint64_t)item.materialIndex : g_SortNoMaterial;
+	uint64_t meshBits = (uint64_t)item.mesh;
+
+	textureBits = std::min(textureBits, g_SortNoTexture);
+	materialBits = std::min(materialBits, g_SortNoMaterial);
+
+	return(transparentBits << 63 |
+		(shaderBits & 0x7F) << 56 |
+		(meshBits & 0xFF) << 48 |
+		textureBits << (g_SortMaterialBits + g_SortItemBits) |
+		materialBits << g_SortItemBits |
+		((uint64_t)itemIndex & g_SortItemMask));
+}
+
+/***********************************************************
+ *  BuildDrawOrder()
+ *
+ *  This method is used for sorting the retained objects by
+ *  their packed sort keys, so that objects sharing the same
+ *  texture and material are drawn one after another and the
+ *  shader values only need to be sent once for the group.
+ ***********************************************************/
+void SceneManager::BuildDrawOrder()
+{
+	// the sort keys only have room for so many item indices
+	if ((int)m_renderItems.size() > MAX_SORTED_ITEMS)
+	{
+		std::cout << "Only the first " << MAX_SORTED_ITEMS << " of " << m_renderItems.size()
+			<< " render items are drawn" << std::endl;
+		m_renderItems.resize(MAX_SORTED_ITEMS);
+	}
+
+	m_drawOrder.resize(m_renderItems.size());
+
+	// selecting a variant may compile it, which needs the
+	// OpenGL thread, and the keys are then built in parallel
+	for (uint32_t i = 0; i < (uint32_t)m_renderItems.size(); i++)
+	{
+		m_renderItems[i].shaderVariant = SelectShaderVariant(m_renderItems[i]);
+	}
+	m_jobSystem->ParallelFor((int)m_renderItems.size(), g_InstanceJobBatch, [this](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				m_drawOrder[i] = BuildSortKey(m_renderItems[i], (uint32_t)i);
+			}
+		});
+
+	std::sort(m_drawOrder.begin(), m_drawOrder.end());
+}
+
+/***********************************************************
+ *  BuildDrawBatches()
+ *
+ *  This method is used for grouping the sorted objects into
+ *  instanced draw calls.  Consecutive objects that share a
+ *  shader variant and a mesh become a single draw call.
+ *  The per-instance values of the visible objects are
+ *  uploaded in CullInstances().  The transparent objects
+ *  are sorted to the end, so they are never in the same
+ *  batch as the opaque ones.
+ ***********************************************************/
+void SceneManager::BuildDrawBatches()
+{
+	m_drawBatches.clear();
+	m_firstTransparentInstance = (int)m_drawOrder.size();
+	m_instanceData.resize(m_drawOrder.size());
+	m_instanceItems.resize(m_drawOrder.size());
+
+	for (size_t i = 0; i < m_drawOrder.size(); i++)
+	{
+		uint32_t itemIndex = (uint32_t)(m_drawOrder[i] & g_SortItemMask);
+		const RENDER_ITEM& item = m_renderItems[itemIndex];
+		InstancedMeshes::INSTANCE_DATA& instance = m_instanceData[i];
+
+		InstancedMeshes::SetInstanceModel(instance, m_sceneTransforms.GetWorldMatrix(item.transformNode));
+		instance.color = item.color;
+		instance.UVscale = item.UVscale;
+		instance.materialIndex = (float)item.materialIndex;
+		instance.textureIndex = (item.textureSlot >= 0) ? (float)m_textureIDs[item.textureSlot].ID : -1.0f;
+		m_instanceItems[i] = itemIndex;
+
+		bool bTransparent = IsTransparent(item);
+		if ((bTransparent == true) && (m_firstTransparentInstance > (int)i))
+		{
+			m_firstTransparentInstance = (int)i;
+		}
+
+		if ((m_drawBatches.size() == 0) ||
+			(m_drawBatches.back().shaderVariant != item.shaderVariant) ||
+			(m_drawBatches.back().mesh != item.mesh) ||
+			(m_drawBatches.back().bTransparent != bTransparent))
+		{
+			DRAW_BATCH batch;
+			batch.shaderVariant = item.shaderVariant;
+			batch.mesh = item.mesh;
+			batch.bTransparent = bTransparent;
+			batch.firstInstance = (int)i;
+			batch.instanceCount = 0;
+			for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+			{
+				batch.visibleFirst[level] = 0;
+				batch.visibleCount[level] = 0;
+			}
+			m_drawBatches.push_back(batch);
+		}
+		m_drawBatches.back().instanceCount++;
+	}
+
+	// the instances are in a new order, so the levels they
+	// were drawn with are picked again
+	m_instanceLevels.assign(m_drawOrder.size(), 0);
+
+	UpdateInstanceBounds(true);
+	m_bInstancesDirty = true;
+	m_bGpuCommandsDirty = true;
+	m_bShadowCastersDirty = true;
+	ResetPointShadowCasters();
+}
+
+/***********************************************************
+ *  RefreshInstanceTransforms()
+ *
+ *  This method is used for copying the current model
+ *  matrices of the objects into the instance values after
+ *  any object has moved, so they are uploaded again.
+ ***********************************************************/
+void SceneManager::RefreshInstanceTransforms()
+{
+	m_jobSystem->ParallelFor((int)m_instanceData.size(), g_InstanceJobBatch, [this](int first, int last)
+		{
+			for (int i = first; i < last; i++)
+			{
+				const RENDER_ITEM& item = m_renderItems[m_instanceItems[i]];
+				InstancedMeshes::SetInstanceModel(m_instanceData[i], m_sceneTransforms.GetWorldMatrix(item.transformNode));
+			}
+		});
+
+	UpdateInstanceBounds(false);
+	m_bInstancesDirty = true;
+	m_bShadowCastersDirty = true;
+}
+
+/***********************************************************
+ *  UpdateInstanceBounds()
+ *
+ *  This method is used for moving the local space bounding
+ *  box of each instance's mesh into world space with the
+ *  instance model matrix.  The same world space boxes are
+ *  passed into the bounding volume hierarchy, which is only
+ *  refitted when objects have just moved.  Every instance
+ *  only writes its own boxes, so they are moved in parallel.
+ ***********************************************************/
+void SceneManager::UpdateInstanceBounds(bool bRebuild)
+{
+	m_frustumCuller.SetBoundsCount((int)m_instanceData.size());
+	m_sceneBVH.SetItemCount((int)m_instanceData.size());
+
+	m_jobSystem->ParallelFor((int)m_instanceData.size(), g_InstanceJobBatch, [this](int first, int last)
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+
+			for (int i = first; i < last; i++)
+			{
+				const RENDER_ITEM& item = m_renderItems[m_instanceItems[i]];
+
+				m_instancedMeshes->GetMeshBounds(item.mesh, boundsMin, boundsMax);
+				m_frustumCuller.SetBounds(i, boundsMin, boundsMax, m_instanceData[i].model);
+				m_frustumCuller.GetBounds(i, boundsMin, boundsMax);
+				m_sceneBVH.SetItemBounds(i, boundsMin, boundsMax);
+			}
+		});
+
+	if ((bRebuild == true) || (m_sceneBVH.IsBuilt() == false))
+	{
+		m_sceneBVH.Build();
+	}
+	else
+	{
+		m_sceneBVH.Refit();
+	}
+}
+
+/***********************************************************
+ *  CullInstances()
+ *
+ *  This method is used for testing the instances against
+ *  the view frustum of the current camera.  The visible
+ *  instances of each draw batch are packed together and
+ *  uploaded after all of the instances, so objects outside
+ *  of the view are never submitted to the camera, while
+ *  the shadow passes can still draw every object.  The
+ *  uploads are skipped when the same objects are visible at
+ *  the same levels of detail as in the last frame and none
+ *  have moved, and only the commands are recorded again
+ *  when the camera moved.
+ *  Small scenes test every box, which is faster than walking
+ *  a tree, and large scenes use the bounding volume
+ *  hierarchy to skip whole groups of objects at a time.
+ *  The box tests and the packing of the visible instances
+ *  are split over the job system.
+ ***********************************************************/
+void SceneManager::CullInstances()
+{
+	if (NULL != m_pUniformBuffers)
+	{
+		const UniformBufferManager::CAMERA_BLOCK& camera = m_pUniformBuffers->GetCamera();
+		m_frustumCuller.SetViewProjection(camera.projection * camera.view);
+	}
+
+	if (m_cullingMode != CULL_CPU)
+	{
+		CullInstancesOnGpu();
+		return;
+	}
+
+	if ((int)m_instanceData.size() >= g_BVHCullThreshold)
+	{
+		float planes[FrustumCuller::FRUSTUM_PLANES][4];
+
+		m_frustumCuller.GetPlanes(planes);
+		m_visibleInstanceCount = m_sceneBVH.QueryFrustum(planes, m_instanceVisible);
+	}
+	else
+	{
+		std::atomic<int> visibleCount(0);
+
+		m_instanceVisible.resize(m_instanceData.size());
+		m_jobSystem->ParallelFor((int)m_instanceData.size(), g_InstanceJobBatch, [this, &visibleCount](int first, int last)
+			{
+				visibleCount += m_frustumCuller.CullBounds(first, last, m_instanceVisible.data());
+			});
+		m_visibleInstanceCount = visibleCount;
+	}
+
+	SelectInstanceLevels();
+
+	if ((m_bInstancesDirty == false) &&
+		(m_instanceVisible == m_lastInstanceVisible))
+	{
+		// the same instances are drawn, but in the order of the
+		// new camera position
+		if ((NULL != m_pUniformBuffers) &&
+			(glm::vec3(m_pUniformBuffers->GetCamera().viewPosition) != m_sortPosition))
+		{
+			BuildDrawCommands();
+			m_instancedMeshes->UploadIndirectCommands(m_indirectCommands.data(), (int)m_indirectCommands.size(), 0);
+		}
+		return;
+	}
+
+	// the buffer holds every instance, followed by the visible
+	// instances of this frame
+	int instanceCount = (int)m_instanceData.size();
+
+	if (m_bInstancesDirty == true)
+	{
+		m_instancedMeshes->ReserveInstances(instanceCount * 2);
+		m_instancedMeshes->UploadInstances(m_instanceData.data(), instanceCount, 0);
+	}
+
+	// the visible instances are packed by level of detail,
+	// and in instance order within each level, so each batch
+	// stays together at every level - each block first counts
+	// its visible instances of each level, and then copies
+	// them to where the blocks before it end
+	int blockCount = (instanceCount + g_VisibleBlockSize - 1) / g_VisibleBlockSize;
+	int levelStride = blockCount + 1;
+
+	m_visibleInstanceData.resize(m_visibleInstanceCount);
+	m_pVisibleBlockOffsets = m_frameArena->AllocateArray<int>(ShapeGeometry::LOD_COUNT * levelStride);
+	m_visibleLevelStride = levelStride;
+	m_jobSystem->ParallelFor(blockCount, 1, [this, instanceCount, levelStride](int firstBlock, int lastBlock)
+		{
+			for (int block = firstBlock; block < lastBlock; block++)
+			{
+				int last = std::min((block + 1) * g_VisibleBlockSize, instanceCount);
+				int counts[ShapeGeometry::LOD_COUNT] = { 0 };
+
+				for (int instance = block * g_VisibleBlockSize; instance < last; instance++)
+				{
+					if (m_instanceVisible[instance] != 0)
+					{
+						counts[m_instanceVisible[instance] - 1]++;
+					}
+				}
+				for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+				{
+					m_pVisibleBlockOffsets[level * levelStride + block + 1] = counts[level];
+				}
+			}
+		});
+
+	// each level starts where the level before it ends
+	int levelStart = 0;
+
+	for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+	{
+		int* pOffsets = &m_pVisibleBlockOffsets[level * levelStride];
+
+		pOffsets[0] = levelStart;
+		for (int block = 0; block < blockCount; block++)
+		{
+			pOffsets[block + 1] += pOffsets[block];
+		}
+		levelStart = pOffsets[blockCount];
+	}
+
+	m_jobSystem->ParallelFor(blockCount, 1, [this, instanceCount, levelStride](int firstBlock, int lastBlock)
+		{
+			for (int block = firstBlock; block < lastBlock; block++)
+			{
+				int last = std::min((block + 1) * g_VisibleBlockSize, instanceCount);
+				int visibleIndex[ShapeGeometry::LOD_COUNT];
+
+				for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+				{
+					visibleIndex[level] = m_pVisibleBlockOffsets[level * levelStride + block];
+				}
+				for (int instance = block * g_VisibleBlockSize; instance < last; instance++)
+				{
+					if (m_instanceVisible[instance] != 0)
+					{
+						m_visibleInstanceData[visibleIndex[m_instanceVisible[instance] - 1]++] = m_instanceData[instance];
+					}
+				}
+			}
+		});
+
+	for (size_t i = 0; i < m_drawBatches.size(); i++)
+	{
+		DRAW_BATCH& batch = m_drawBatches[i];
+
+		for (int level = 0; level < ShapeGeometry::LOD_COUNT; level++)
+		{
+			int visibleFirst = CountVisibleBefore(batch.firstInstance, level);
+
+			batch.visibleCount[level] = CountVisibleBefore(batch.firstInstance + batch.instanceCount, level) - visibleFirst;
+			batch.visibleFirst[level] = visibleFirst + instanceCount;
+		}
+	}
+	BuildDrawCommands();
+	m_instancedMeshes->UploadIndirectCommands(m_indirectCommands.data(), (int)m_indirectCommands.size(), 0);
+
+	if (m_visibleInstanceCount > 0)
+	{
+		m_instancedMeshes->UploadInstances(m_visibleInstanceData.data(), m_visibleInstanceCount, instanceCount);
+	}
+	m_lastInstanceVisible = m_instanceVisible;
+	m_bInstancesDirty = false;
+}
+
+/***********************************************************
+ *  CullInstancesOnGpu()
+ *
+ *  This method is used for culling the instances with the
+ *  compute shader.  The CPU only uploads the instance
+ *  values when objects have moved, and the commands and the
+ *  per-instance values of the culler when the batches have
+ *  changed.  The shader picks the levels of detail and
+ *  packs the visible instances, so each command draws its
+ *  own range of the instance buffer after every instance.
+ ***********************************************************/
+void SceneManager::CullInstancesOnGpu()
+{
+	int instanceCount = (int)m_instanceData.size();
+
+	if (instanceCount == 0)
+	{
+		return;
+	}
+
+	if (m_bInstancesDirty == true)
+	{
+		// every level of detail of a batch has a range that can
+		// hold all of the instances of the batch
+		m_instancedMeshes->ReserveInstances(instanceCount * (ShapeGeometry::LOD_COUNT + 1));
+		m_instancedMeshes->UploadInstances(m_instanceData.data(), instanceCount, 0);
+		m_bInstancesDirty = false;
+	}
+
+	// the compute shader can not sort, so the transparent
+	// instances are tested and ordered here when they are
+	// sorted, which is cheap for the few that there are
+	bool bSortTransparent = (m_transparencyMode == TRANSPARENCY_SORTED) &&
+		(m_firstTransparentInstance < instanceCount);
+	if (bSortTransparent == true)
+	{
+		m_instanceVisible.resize(instanceCount);
+		m_frustumCuller.CullBounds(m_firstTransparentInstance, instanceCount, m_instanceVisible.data());
+	}
+
+	if (m_bGpuCommandsDirty == true)
+	{
+		BuildDrawCommands();
+		m_instancedMeshes->UploadIndirectCommands(m_indirectCommands.data(), (int)m_indirectCommands.size(), 0);
+		m_gpuCuller->UploadInstanceInfo(m_gpuInstanceInfo.data(), (int)m_gpuInstanceInfo.size());
+		m_bGpuCommandsDirty = false;
+	}
+	else if (bSortTransparent == true)
+	{
+		UpdateDrawDistances(m_firstTransparentInstance, instanceCount);
+		BuildSortedTransparentCommands();
+		m_instancedMeshes->UploadIndirectCommands(
+			m_indirectCommands.data() + m_sortedCommandFirst,
+			(int)m_indirectCommands.size() - m_sortedCommandFirst,
+			m_sortedCommandFirst);
+	}
+
+	GpuCuller::CULL_VIEW view;
+
+	m_frustumCuller.GetPlanes(view.planes);
+	view.viewPosition = glm::vec3(0.0f);
+	view.projectionScale = 1.0f;
+	view.bPerspective = true;
+	if (NULL != m_pUniformBuffers)
+	{
+		const UniformBufferManager::CAMERA_BLOCK& camera = m_pUniformBuffers->GetCamera();
+		view.viewPosition = glm::vec3(camera.viewPosition);
+		view.projectionScale = camera.projection[1][1];
+		view.bPerspective = (camera.projection[2][3] != 0.0f);
+	}
+	for (int i = 0; i < ShapeGeometry::LOD_COUNT - 1; i++)
+	{
+		view.levelScreenSizes[i] = g_LevelScreenSizes[i];
+	}
+	view.levelHysteresis = g_LevelHysteresis;
+
+	m_gpuCuller->Cull(
+		m_instancedMeshes->GetInstanceBuffer(),
+		instanceCount,
+		m_instancedMeshes->GetIndirectBuffer(),
+		m_shadowCommandCount,
+		m_sortedCommandFirst - m_shadowCommandCount,
+		view,
+		(m_cullingMode == CULL_GPU_OCCLUSION));
+}
+
+/***********************************************************
+ *  SelectInstanceLevels()
+ *
+ *  This method is used for picking the level of detail of
+ *  each visible instance.  The bounding sphere around the
+ *  world space box of the instance is projected with the
+ *  camera, which includes the zoom of the field of view,
+ *  and objects that cover less of the view are drawn with
+ *  fewer triangles.  The level is stored in the visible
+ *  flag, so a change of level uploads the instances again
+ *  just like a change of visibility.
+ ***********************************************************/
+void SceneManager::SelectInstanceLevels()
+{
+	int instanceCount = (int)m_instanceData.size();
+	glm::vec3 viewPosition(0.0f);
+	float projectionScale = 1.0f;
+	bool bPerspective = true;
+
+	if (NULL != m_pUniformBuffers)
+	{
+		const UniformBufferManager::CAMERA_BLOCK& camera = m_pUniformBuffers->GetCamera();
+		viewPosition = glm::vec3(camera.viewPosition);
+		projectionScale = camera.projection[1][1];
+		// an orthographic projection has no divide by depth,
+		// so the size of an object does not change with distance
+		bPerspective = (camera.projection[2][3] != 0.0f);
+	}
+
+	m_instanceLevels.resize(instanceCount, 0);
+	m_jobSystem->ParallelFor(instanceCount, g_InstanceJobBatch, [this, viewPosition, projectionScale, bPerspective](int first, int last)
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+
+			for (int i = first; i < last; i++)
+			{
+				if (m_instanceVisible[i] == 0)
+				{
+					continue;
+				}
+
+				const RENDER_ITEM& item = m_renderItems[m_instanceItems[i]];
+				int levelCount = m_instancedMeshes->GetLevelCount(item.mesh);
+				int level = 0;
+
+				if (levelCount > 1)
+				{
+					m_frustumCuller.GetBounds(i, boundsMin, boundsMax);
+
+					float radius = 0.5f * glm::length(boundsMax - boundsMin);
+					float screenSize = radius * projectionScale;
+
+					if (bPerspective == true)
+					{
+						float distance = glm::length(0.5f * (boundsMin + boundsMax) - viewPosition);
+
+						// the camera inside of the sphere always
+						// sees the finest level
+						screenSize = (distance > radius) ? screenSize / distance : g_LevelScreenSizes[0] * 2.0f;
+					}
+					level = SelectDetailLevel(screenSize, m_instanceLevels[i], levelCount);
+				}
+
+				m_instanceLevels[i] = (uint8_t)level;
+				m_instanceVisible[i] = (uint8_t)(level + 1);
+			}
+		});
+}
+
+/***********************************************************
+ *  CountVisibleBefore()
+ *
+ *  This method is used for getting the packed position of
+ *  the visible instances of a level of detail before an
+ *  instance, from the packed offset of its block at that
+ *  level and the flags before it in the block.
+ ***********************************************************/
+int SceneManager::CountVisibleBefore(int instance, int level) const
+{
+	int block = instance / g_VisibleBlockSize;
+	int count = m_pVisibleBlockOffsets[level * m_visibleLevelStride + block];
+
+	for (int i = block * g_VisibleBlockSize; i < instance; i++)
+	{
+		if (m_instanceVisible[i] == level + 1)
+		{
+			count++;
+		}
+	}
+
+	return(count);
+}
+
+/***********************************************************
+ *  BuildDrawCommands()
+ *
+ *  This method is used for recording the indirect commands
+ *  of a frame.  The shadow passes draw every instance of
+ *  each batch at the finest level of detail.  The scene
+ *  pass draws each level of detail of a batch with its own
+ *  command, levels without visible instances are left out,
+ *  and the commands of each shader variant are grouped into
+ *  one multi-draw, so replaying the scene pass only
+ *  switches the program and submits each group.  Within a
+ *  group the opaque batches go from front to back, so the
+ *  nearer objects hide the fragments of the farther ones
+ *  before they are shaded.
+ *  For the GPU culler every level of every batch gets a
+ *  command with no instances, which the compute shader
+ *  fills in, and each instance is told where the commands
+ *  of its batch start.  The transparent instances that are
+ *  sorted are left to BuildSortedTransparentCommands().
+ ***********************************************************/
+void SceneManager::BuildDrawCommands()
+{
+	InstancedMeshes::INDIRECT_COMMAND indirect;
+	bool bGpuCulling = (m_cullingMode != CULL_CPU);
+	bool bSortTransparent = (m_transparencyMode == TRANSPARENCY_SORTED);
+	int instanceCount = (int)m_instanceData.size();
+
+	m_indirectCommands.clear();
+	for (size_t i = 0; i < m_drawBatches.size(); i++)
+	{
+		const DRAW_BATCH& batch = m_drawBatches[i];
+
+		if (m_instancedMeshes->GetIndirectCommand(batch.mesh, 0, batch.firstInstance, batch.instanceCount, indirect) == true)
+		{
+			m_indirectCommands.push_back(indirect);
+		}
+	}
+	m_shadowCommandCount = (int)m_indirectCommands.size();
+
+	UpdateDrawDistances(0, instanceCount);
+	SortDrawBatches();
+
+	m_drawCommands.clear();
+	m_transparentCommands.clear();
+	if (bGpuCulling == true)
+	{
+		m_gpuInstanceInfo.resize(instanceCount);
+	}
+	for (size_t i = 0; i < m_batchOrder.size(); i++)
+	{
+		const DRAW_BATCH& batch = m_drawBatches[m_batchOrder[i]];
+		std::vector<DRAW_COMMAND>& drawCommands = (batch.bTransparent == true) ? m_transparentCommands : m_drawCommands;
+		int levelCount = m_instancedMeshes->GetLevelCount(batch.mesh);
+		int firstCommand = (int)m_indirectCommands.size();
+
+		// the sorted transparent instances get a command each
+		if ((batch.bTransparent == true) && (bSortTransparent == true))
+		{
+			levelCount = 0;
+		}
+
+		for (int level = 0; level < levelCount; level++)
+		{
+			int firstInstance = batch.visibleFirst[level];
+			int visibleCount = batch.visibleCount[level];
+
+			if (bGpuCulling == true)
+			{
+				firstInstance = instanceCount * (level + 1) + batch.firstInstance;
+				visibleCount = 0;
+			}
+			else if (visibleCount == 0)
+			{
+				continue;
+			}
+			if (m_instancedMeshes->GetIndirectCommand(batch.mesh, level, firstInstance, visibleCount, indirect) == false)
+			{
+				continue;
+			}
+
+			if ((drawCommands.size() == 0) ||
+				(drawCommands.back().shaderVariant != batch.shaderVariant))
+			{
+				DRAW_COMMAND command;
+				command.shaderVariant = batch.shaderVariant;
+				command.firstCommand = (int)m_indirectCommands.size();
+				command.commandCount = 0;
+				drawCommands.push_back(command);
+			}
+			m_indirectCommands.push_back(indirect);
+			drawCommands.back().commandCount++;
+		}
+
+		if (bGpuCulling == true)
+		{
+			for (int instance = batch.firstInstance; instance < batch.firstInstance + batch.instanceCount; instance++)
+			{
+				GpuCuller::INSTANCE_INFO& info = m_gpuInstanceInfo[instance];
+				info.firstCommand = (GLuint)firstCommand;
+				info.levelCount = (GLuint)levelCount;
+				info.level = 0;
+				info.mesh = (GLuint)batch.mesh;
+			}
+		}
+	}
+
+	m_sortedCommandFirst = (int)m_indirectCommands.size();
+	if (bSortTransparent == true)
+	{
+		BuildSortedTransparentCommands();
+	}
+}
+
+/***********************************************************
+ *  UpdateDrawDistances()
+ *
+ *  This method is used for measuring how far a range of the
+ *  instances is from the camera.  The opaque instances are
+ *  ordered by the nearest point of their boxes, which is
+ *  where they start hiding other objects, and the
+ *  transparent ones by the centers of their boxes.
+ ***********************************************************/
+void SceneManager::UpdateDrawDistances(int firstInstance, int lastInstance)
+{
+	glm::vec3 viewPosition(0.0f);
+
+	if (NULL != m_pUniformBuffers)
+	{
+		viewPosition = glm::vec3(m_pUniformBuffers->GetCamera().viewPosition);
+	}
+	m_sortPosition = viewPosition;
+	m_instanceDistances.resize(m_instanceData.size());
+	if (lastInstance <= firstInstance)
+	{
+		return;
+	}
+
+	m_jobSystem->ParallelFor(lastInstance - firstInstance, g_InstanceJobBatch, [this, firstInstance, viewPosition](int first, int last)
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+
+			for (int i = firstInstance + first; i < firstInstance + last; i++)
+			{
+				m_frustumCuller.GetBounds(i, boundsMin, boundsMax);
+				if (i >= m_firstTransparentInstance)
+				{
+					m_instanceDistances[i] = glm::length((boundsMin + boundsMax) * 0.5f - viewPosition);
+				}
+				else
+				{
+					m_instanceDistances[i] = glm::length(glm::clamp(viewPosition, boundsMin, boundsMax) - viewPosition);
+				}
+			}
+		});
+}
+
+/***********************************************************
+ *  SortDrawBatches()
+ *
+ *  This method is used for ordering the batches from front
+ *  to back by their nearest instance that is drawn.  The
+ *  batches stay grouped by shader variant, so the program
+ *  still changes as few times as before, and only the
+ *  batches within each group are ordered.
+ ***********************************************************/
+void SceneManager::SortDrawBatches()
+{
+	bool bGpuCulling = (m_cullingMode != CULL_CPU);
+	int batchCount = (int)m_drawBatches.size();
+
+	// the distances and groups are only needed for the sort
+	float* pBatchDistances = m_frameArena->AllocateArray<float>(batchCount);
+	int* pBatchGroups = m_frameArena->AllocateArray<int>(batchCount);
+
+	m_batchOrder.resize(batchCount);
+	for (int i = 0; i < batchCount; i++)
+	{
+		const DRAW_BATCH& batch = m_drawBatches[i];
+		float nearestDistance = std::numeric_limits<float>::max();
+
+		// the GPU culler only knows what is visible on the GPU
+		for (int instance = batch.firstInstance; instance < batch.firstInstance + batch.instanceCount; instance++)
+		{
+			if ((bGpuCulling == true) || (m_instanceVisible[instance] != 0))
+			{
+				nearestDistance = std::min(nearestDistance, m_instanceDistances[instance]);
+			}
+		}
+		m_batchOrder[i] = i;
+		pBatchDistances[i] = nearestDistance;
+
+		// the batches of a group are next to each other in the
+		// draw order, with the transparent groups at the end
+		pBatchGroups[i] = i;
+		if ((i > 0) &&
+			(m_drawBatches[i - 1].shaderVariant == batch.shaderVariant) &&
+			(m_drawBatches[i - 1].bTransparent == batch.bTransparent))
+		{
+			pBatchGroups[i] = pBatchGroups[i - 1];
+		}
+	}
+
+	std::sort(m_batchOrder.begin(), m_batchOrder.end(), [pBatchDistances, pBatchGroups](int first, int second)
+		{
+			if (pBatchGroups[first] != pBatchGroups[second])
+			{
+				return(pBatchGroups[first] < pBatchGroups[second]);
+			}
+			return(pBatchDistances[first] < pBatchDistances[second]);
+		});
+}
+
+/***********************************************************
+ *  BuildSortedTransparentCommands()
+ *
+ *  This method is used for recording a command for each
+ *  visible transparent instance, from the farthest to the
+ *  nearest, after the commands of the batches.  Blending
+ *  each instance over the ones behind it only looks right
+ *  in that order, so the commands are recorded again when
+ *  the camera moves.  A multi-draw keeps the order of its
+ *  commands, so the instances that share a shader variant
+ *  are still drawn together.
+ ***********************************************************/
+void SceneManager::BuildSortedTransparentCommands()
+{
+	InstancedMeshes::INDIRECT_COMMAND indirect;
+	int instanceCount = (int)m_instanceData.size();
+
+	// the visible transparent instances from back to front,
+	// which are only needed while the commands are recorded
+	int* pSortedInstances = m_frameArena->AllocateArray<int>(std::max(instanceCount - m_firstTransparentInstance, 0));
+	int sortedCount = 0;
+
+	m_indirectCommands.resize(m_sortedCommandFirst);
+	m_transparentCommands.clear();
+	for (int i = m_firstTransparentInstance; i < instanceCount; i++)
+	{
+		if (m_instanceVisible[i] != 0)
+		{
+			pSortedInstances[sortedCount++] = i;
+		}
+	}
+	std::sort(pSortedInstances, pSortedInstances + sortedCount, [this](int first, int second)
+		{
+			return(m_instanceDistances[first] > m_instanceDistances[second]);
+		});
+
+	for (int i = 0; i < sortedCount; i++)
+	{
+		int instance = pSortedInstances[i];
+		const RENDER_ITEM& item = m_renderItems[m_instanceItems[instance]];
+
+		// every instance is also at its own index in the buffer
+		if (m_instancedMeshes->GetIndirectCommand(item.mesh, 0, instance, 1, indirect) == false)
+		{
+			continue;
+		}
+		if ((m_transparentCommands.size() == 0) ||
+			(m_transparentCommands.back().shaderVariant != item.shaderVariant))
+		{
+			DRAW_COMMAND command;
+			command.shaderVariant = item.shaderVariant;
+			command.firstCommand = (int)m_indirectCommands.size();
+			command.commandCount = 0;
+			m_transparentCommands.push_back(command);
+		}
+		m_indirectCommands.push_back(indirect);
+		m_transparentCommands.back().commandCount++;
+	}
+}
+
+/***********************************************************
+ *  DrawDepthPrepass()
+ *
+ *  This method is used for writing the depth of the visible
+ *  opaque instances before they are lit.  The same indirect
+ *  commands as the lit pass are drawn, from front to back,
+ *  with a variant that does no shading and with the color
+ *  writes masked.  Both variants are compiled from the same
+ *  vertex shader with an invariant position, so the lit
+ *  pass can keep only the fragments whose depth is equal.
+ ***********************************************************/
+void SceneManager::DrawDepthPrepass()
+{
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	UseShaderVariant(m_depthPrepassVariant);
+
+	for (size_t i = 0; i < m_drawCommands.size(); i++)
+	{
+		const DRAW_COMMAND& command = m_drawCommands[i];
+
+		m_instancedMeshes->DrawIndirect(command.firstCommand, command.commandCount);
+	}
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/***********************************************************
+ *  DrawTransparentObjects()
+ *
+ *  This method is used for blending the visible transparent
+ *  instances over the opaque scene.  They are tested
+ *  against the depth of the opaque objects without writing
+ *  their own, so they do not hide each other.  The weighted
+ *  blending draws them into its own targets, and the
+ *  objects are not drawn at all when the targets could not
+ *  be created, since the weighted variants only write into
+ *  those targets.
+ ***********************************************************/
+void SceneManager::DrawTransparentObjects()
+{
+	if (m_transparentCommands.size() == 0)
+	{
+		return;
+	}
+
+	ProfileScope scope("TransparentPass");
+	bool bWeighted = (m_transparencyMode == TRANSPARENCY_WEIGHTED);
+
+	if (bWeighted == true)
+	{
+		if (m_weightedTransparency->BeginTransparency() == false)
+		{
+			return;
+		}
+	}
+	else
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);
+	}
+
+	for (size_t i = 0; i < m_transparentCommands.size(); i++)
+	{
+		const DRAW_COMMAND& command = m_transparentCommands[i];
+
+		UseShaderVariant(command.shaderVariant);
+		m_instancedMeshes->DrawIndirect(command.firstCommand, command.commandCount);
+	}
+
+	if (bWeighted == true)
+	{
+		m_weightedTransparency->EndTransparency();
+	}
+	else
+	{
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+}
+
+/***********************************************************
+ *  DrawShadowCasters()
+ *
+ *  This method is used for rendering the shadow maps that
+ *  are out of date.  The shadow maps are fitted to the
+ *  current view first, and each pass that needs rendering
+ *  draws the same instanced batches as the camera with one
+ *  multi-draw, using all of the instances instead of only
+ *  the visible ones, since objects outside of the view can
+ *  still cast shadows into it.  Nothing is drawn while the
+ *  scene is still, and a point shadow is only drawn when an
+ *  object moved inside of the range of its light.
+ ***********************************************************/
+void SceneManager::DrawShadowCasters()
+{
+	if (NULL == m_pUniformBuffers)
+	{
+		return;
+	}
+
+	const UniformBufferManager::CAMERA_BLOCK& camera = m_pUniformBuffers->GetCamera();
+	const UniformBufferManager::LIGHT_BLOCK& lights = m_pUniformBuffers->GetLights();
+
+	if (m_bShadowCastersDirty == true)
+	{
+		FindMovedPointShadows();
+	}
+
+	m_shadowManager->BeginFrame(
+		camera.view,
+		camera.projection,
+		lights.directionalLight.direction,
+		m_bShadowCastersDirty);
+	m_bShadowCastersDirty = false;
+
+	for (int pass = 0; pass < m_shadowManager->GetPassCount(); pass++)
+	{
+		if (m_shadowManager->BeginPass(pass) == false)
+		{
+			continue;
+		}
+
+		m_instancedMeshes->DrawIndirect(0, m_shadowCommandCount);
+	}
+
+	m_shadowManager->EndPasses();
+	m_shadowManager->BindTextures();
+}
+
+/***********************************************************
+ *  FindMovedPointShadows()
+ *
+ *  This method is used for finding the point shadows whose
+ *  shadow casters moved.  The render items in the range of
+ *  each light are gathered from the bounding volume
+ *  hierarchy and compared with the ones that were found the
+ *  last time, along with the world versions of their
+ *  transforms, so a cube map is only rendered again when an
+ *  object moved inside of its range, or into or out of it.
+ ***********************************************************/
+void SceneManager::FindMovedPointShadows()
+{
+	glm::vec3 position;
+	float farPlane = 0.0f;
+
+	for (int i = 0; i < m_shadowManager->GetPointShadowCount(); i++)
+	{
+		if (m_shadowManager->GetPointShadow(i, position, farPlane) == false)
+		{
+			continue;
+		}
+
+		// the items are sorted, so the order the hierarchy
+		// visits them in does not matter
+		m_pointShadowQuery.clear();
+		QueryRenderItems(position, farPlane, m_pointShadowQuery);
+		std::sort(m_pointShadowQuery.begin(), m_pointShadowQuery.end());
+
+		std::vector<int>& casters = m_pointShadowCasters[i];
+		std::vector<unsigned int>& versions = m_pointShadowVersions[i];
+		bool bMoved = (casters != m_pointShadowQuery);
+
+		versions.resize(m_pointShadowQuery.size(), 0);
+		for (size_t c = 0; c < m_pointShadowQuery.size(); c++)
+		{
+			const RENDER_ITEM& item = m_renderItems[m_pointShadowQuery[c]];
+			unsigned int version = m_sceneTransforms.GetWorldVersion(item.transformNode);
+
+			if (version != versions[c])
+			{
+				versions[c] = version;
+				bMoved = true;
+			}
+		}
+
+		if (bMoved == true)
+		{
+			casters = m_pointShadowQuery;
+			m_shadowManager->MarkPointShadowDirty(i);
+		}
+	}
+}
+
+/***********************************************************
+ *  ResetPointShadowCasters()
+ *
+ *  This method is used for forgetting the shadow casters
+ *  that were found in the range of each point shadow.  The
+ *  render items are numbered again when they are rebuilt,
+ *  so every point shadow is rendered again as well.
+ ***********************************************************/
+void SceneManager::ResetPointShadowCasters()
+{
+	for (int i = 0; i < ShadowManager::MAX_POINT_SHADOWS; i++)
+	{
+		m_pointShadowCasters[i].clear();
+		m_pointShadowVersions[i].clear();
+		m_shadowManager->MarkPointShadowDirty(i);
+	}
+}
+
+/***********************************************************
+ *  AddTransformGroup()
+ *
+ *  This method is used for adding a group node to the scene
+ *  transforms.  Render items that are attached to the group
+ *  are positioned relative to it and move along with it.
+ ***********************************************************/
+int SceneManager::AddTransformGroup(
+	glm::vec3 positionXYZ,
+	int parentNode)
+{
+	return(m_sceneTransforms.AddNode(
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		0.0f, 0.0f, 0.0f,
+		positionXYZ,
+		parentNode));
 }
 
 /***********************************************************
- *  RenderScene()
+ *  AddRenderItem()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for adding a textured object to the
+ *  retained list of render items.  The transform node,
+ *  texture slot and material index are resolved when the
+ *  item is added so that no lookups are needed while
+ *  rendering.  An alpha below one blends the texture over
+ *  the objects behind it.
  ***********************************************************/
-void SceneManager::RenderScene()
+int SceneManager::AddRenderItem(
+	MESH_TYPE mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	const std::string& textureTag,
+	const std::string& materialTag,
+	int parentNode,
+	glm::vec2 UVscale,
+	float alpha)
 {
-	// declare the variables for the transformations
-		glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
+	RENDER_ITEM item;
+
+	item.mesh = mesh;
+	item.transformNode = m_sceneTransforms.AddNode(
 		scaleXYZ,
 		XrotationDegrees,
 		YrotationDegrees,
 		ZrotationDegrees,
-		positionXYZ);
+		positionXYZ,
+		parentNode);
+	item.textureSlot = FindTextureSlot(textureTag);
+	item.materialIndex = FindMaterialIndex(materialTag);
+	item.UVscale = UVscale;
+	item.color = glm::vec4(1.0f, 1.0f, 1.0f, alpha);
+	item.shaderVariant = -1;
 
-	//SetShaderColor(1, 1, 1, 1);
-	//set texture
-	SetShaderTexture("wood");
+	m_renderItems.push_back(item);
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
-
-	SetShaderMaterial("wood");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	return(item.transformNode);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
+/***********************************************************
+ *  AddColoredRenderItem()
+ *
+ *  This method is used for adding an object that is drawn
+ *  with a solid color instead of a texture to the retained
+ *  list of render items.
+ ***********************************************************/
+int SceneManager::AddColoredRenderItem(
+	MESH_TYPE mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	const std::string& materialTag,
+	int parentNode)
+{
+	RENDER_ITEM item;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
+	item.mesh = mesh;
+	item.transformNode = m_sceneTransforms.AddNode(
 		scaleXYZ,
 		XrotationDegrees,
 		YrotationDegrees,
 		ZrotationDegrees,
-		positionXYZ);
+		positionXYZ,
+		parentNode);
+	item.textureSlot = -1;
+	item.materialIndex = FindMaterialIndex(materialTag);
+	item.UVscale = glm::vec2(1.0f, 1.0f);
+	item.color = color;
+	item.shaderVariant = -1;
+
+	m_renderItems.push_back(item);
+
+	return(item.transformNode);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the basic mesh that is
+ *  associated with the passed in mesh type.
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE mesh)
+{
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_DRAW_CALLS, 1);
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_TAPERED_CYLINDER:
+		m_basicMeshes->DrawTaperedCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	default:
+		break;
+	}
+}
 
-	SetShaderColor(1, 1, 1, 1);
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
+/***********************************************************
+*LoadSceneTextures()
+*
+* This method is used for preparing the 3D scene by loading
+* the shapes, textures in memory to support the 3D scene
+* rendering
+* **********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	CreateGLTexture(
+		"textures/glasscup.jpg",
+		"glasscup");
+	CreateGLTexture(
+		"textures/wood.jpg",
+		"wood");
 	
-	//cylinder for coffee cup
-	scaleXYZ = glm::vec3(1.0f, 2.0f, 1.0f);
+	CreateGLTexture(
+		"textures/vinous-liquid-with-foam-blobs.jpg",
+		"coffee");
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	CreateGLTexture(
+		"textures/lamp.jpg",
+		"lamp");
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 0.0f, 3.0f);
+	CreateGLTexture(
+		"textures/gold.jpg",
+		"gold");
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	CreateGLTexture(
+		"textures/keyboard.png",
+		"keyboard");
 
-	//SetShaderColor(0.5, 0.5, 0.5, 1);
-	//set texture
-	SetShaderTexture("glasscup");
+	CreateGLTexture(
+		"textures/aluminum.png",
+		"aluminum");
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	CreateGLTexture(
+		"textures/login.jpg",
+		"login");
 
-	SetShaderMaterial("glass");
+	CreateGLTexture(
+		"textures/leather.jpg",
+		"leather");
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
+	CreateGLTexture(
+		"textures/pen.jpg",
+		"pen");
 
-	//torus for coffee cup handle
-	scaleXYZ = glm::vec3(.8f, 0.8f, 1.0f);
+	// each texture is given a layer of the texture array that
+	// matches its size and format, and the arrays are bound to
+	// their texture units - the texture table holds up to
+	// UniformBufferManager::MAX_TEXTURES textures
+	BindGLTextures();
+}
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for configuring the various material
+ *  settings for all of the objects within the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	OBJECT_MATERIAL woodMaterial;
+	woodMaterial.diffuseColor = glm::vec3(0.6f, 0.5f, 0.4f);
+	woodMaterial.specularColor = glm::vec3(0.5f, 0.5f, 0.5f);
+	woodMaterial.shininess = 64.0;
+	woodMaterial.tag = "wood";
+	m_objectMaterials.push_back(woodMaterial);
+
+	OBJECT_MATERIAL glassMaterial;
+	glassMaterial.diffuseColor = glm::vec3(0.7f, 0.7f, 0.8f);
+	glassMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
+	glassMaterial.shininess = 128.0;
+	glassMaterial.tag = "glass";
+	m_objectMaterials.push_back(glassMaterial);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	OBJECT_MATERIAL goldMaterial;
+	goldMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	goldMaterial.specularColor = glm::vec3(0.7f, 0.7f, 0.6f);
+	goldMaterial.shininess = 52.0;
+	goldMaterial.tag = "metal";
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(6.0f, 1.0f, 3.5f);
+	m_objectMaterials.push_back(goldMaterial);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	OBJECT_MATERIAL leatherMaterial;
+	leatherMaterial.diffuseColor = glm::vec3(0.5f, 0.4f, 0.3f);
+	leatherMaterial.specularColor = glm::vec3(0.01f, 0.01f, 0.01f);
+	leatherMaterial.shininess = 0.001;
+	leatherMaterial.tag = "leather";
+
+	m_objectMaterials.push_back(leatherMaterial);
+
+	OBJECT_MATERIAL canvasMaterial;
+	canvasMaterial.diffuseColor = glm::vec3(0.7f, 0.6f, 0.5f);
+	canvasMaterial.specularColor = glm::vec3(0.02f, 0.02f, 0.02f);
+	canvasMaterial.shininess = 0.001;
+	canvasMaterial.tag = "canvas";
+
+	m_objectMaterials.push_back(canvasMaterial);
+}
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  Point lights are added to the
+ *  light manager, which only lights each fragment with the
+ *  point lights that reach it.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	// Enable lighting
+	m_uniformCache.SetBool(m_uniforms.useLighting, true);
 
-	//SetShaderColor(0.5, 0.5, 0.5, 1);
-	//set texture
-	SetShaderTexture("glasscup");
+	// the light values are written into the light uniform
+	// buffer, which is uploaded in one call when it changes
+	if (NULL == m_pUniformBuffers)
+	{
+		return;
+	}
 
-	//set scale
-	SetTextureUVScale(5.0, 1.0);
+	//Directional Light
+	m_pUniformBuffers->SetDirectionalLight(
+		glm::vec3(-0.3f, -1.0f, -0.2f),
+		glm::vec3(0.4f, 0.4f, 0.4f),
+		glm::vec3(0.6f, 0.6f, 0.6f),
+		glm::vec3(0.3f, 0.3f, 0.3f),
+		true);
+
+	//Secondary Light - the radius covers the whole desk scene
+	int pointLight = m_lightManager->AddPointLight(
+		glm::vec3(2.0f, 3.0f, 2.0f),
+		60.0f,
+		glm::vec3(0.2f, 0.2f, 0.2f),
+		glm::vec3(1.0f, 0.8f, 0.7f),
+		glm::vec3(0.9f, 0.8f, 0.7f));
+
+	// the secondary light casts shadows through a cube map
+	if (pointLight >= 0)
+	{
+		m_shadowManager->SetPointShadowCount(1);
+		m_shadowManager->SetPointShadow(0, glm::vec3(2.0f, 3.0f, 2.0f), 60.0f);
+		m_lightManager->SetPointLightShadow(pointLight, 0);
+	}
 
-	SetShaderMaterial("glass");
+	// the lit shader variants are compiled for the lights that
+	// were switched on above
+	m_lightingVariantFlags =
+		ShaderVariants::VARIANT_LIGHTING |
+		ShaderVariants::VARIANT_DIRECTIONAL_LIGHT;
+	if (m_lightManager->GetPointLightCount() > 0)
+	{
+		m_lightingVariantFlags |= ShaderVariants::VARIANT_POINT_LIGHTS;
+	}
+	if (m_bShadowsEnabled == true)
+	{
+		m_lightingVariantFlags |= ShaderVariants::VARIANT_SHADOWS;
+	}
+}
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTorusMesh();
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// look up the uniform locations once for the shader program
+	ResolveUniformHandles();
+	// the specialized variants are built from the same shader
+	// source files as the program in use
+	m_shaderVariants->LoadSources(g_VertexShaderPath, g_FragmentShaderPath);
+	// the shadow casters are drawn with their own programs
+	m_bShadowsEnabled = m_shadowManager->LoadShaders(g_ShadowVertexShaderPath, g_ShadowFragmentShaderPath);
+	// the weighted blending composites the transparent objects
+	// with its own program
+	m_bWeightedTransparencySupported = m_weightedTransparency->LoadShaders(
+		g_FullscreenVertexShaderPath,
+		g_TransparencyFragmentShaderPath);
+	// the scene file is mapped while the scene is built and
+	// closed again at the end of this method
+	SceneFile sceneFile;
+	bool bUseSceneFile = false;
+	if ((m_syntheticObjectCount == 0) && (m_sceneFilePath.empty() == false))
+	{
+		bUseSceneFile = sceneFile.Load(m_sceneFilePath.c_str());
+		if (bUseSceneFile == false)
+		{
+			std::cout << "Using the built in scene instead of:" << m_sceneFilePath << std::endl;
+		}
+	}
 
-	/****************************************************************/
-	// Coffee surface (thin cylinder on top of the cup)
-	scaleXYZ = glm::vec3(0.95f, 0.05f, 0.95f);  // Slightly smaller than the cup and very thin
+	// load the texture image files for the textures applied
+	// to objects in the 3D scene, and define the materials
+	// that will be used for the objects in the 3D scene
+	if (bUseSceneFile == true)
+	{
+		LoadSceneFileTextures(sceneFile);
+		DefineSceneFileMaterials(sceneFile);
+	}
+	else
+	{
+		LoadSceneTextures();
+		DefineObjectMaterials();
+	}
+	BuildMaterialLookup();
+	UploadMaterialTable();
+	// add and defile the light sources for the 3D scene
+	SetupSceneLights();
+	
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
 
-	// No rotation needed
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadTorusMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadConeMesh();
+	m_basicMeshes->LoadSphereMesh();
+	m_basicMeshes->LoadTaperedCylinderMesh();
+	// the retained objects are drawn with the instanced shapes
+	m_instancedMeshes->LoadMeshes();
+	// the GPU culler needs multi-draw to draw the instance
+	// counts it writes, and reads the bounds of the same shapes
+	m_bGpuCullingSupported = (m_instancedMeshes->IsMultiDrawSupported() == true) &&
+		(m_gpuCuller->LoadShaders(g_CullComputeShaderPath, g_DepthPyramidShaderPath) == true);
+	if (m_bGpuCullingSupported == true)
+	{
+		glm::vec4 meshBounds[MESH_COUNT * 2];
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
 
-	// Position it slightly above the cup
-	positionXYZ = glm::vec3(5.0f, 2.0f, 3.0f); // Adjust Y position just inside the cup
+		for (int i = 0; i < MESH_COUNT; i++)
+		{
+			m_instancedMeshes->GetMeshBounds((MESH_TYPE)i, boundsMin, boundsMax);
+			meshBounds[i * 2] = glm::vec4(boundsMin, 1.0f);
+			meshBounds[i * 2 + 1] = glm::vec4(boundsMax, 1.0f);
+		}
+		m_gpuCuller->SetMeshBounds(meshBounds, MESH_COUNT);
+	}
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// build the retained list of render items - the objects
+	// are transformed and resolved once here instead of being
+	// rebuilt every time the scene is rendered
+	if (m_syntheticObjectCount > 0)
+	{
+		DefineSyntheticSceneObjects(m_syntheticObjectCount);
+	}
+	else if (bUseSceneFile == true)
+	{
+		DefineSceneFileObjects(sceneFile);
+	}
+	else
+	{
+		DefineSceneObjects();
+	}
+}
 
-	// Apply coffee texture
-	SetShaderTexture("coffee");
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method is used for loading the scene from a text
+ *  scene file, or from its compiled file, when the scene
+ *  is prepared.  The scene defined in code is used when the
+ *  file can not be loaded.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const std::string& filePath)
+{
+	m_sceneFilePath = filePath;
+}
 
-	// Adjust texture scale
-	SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  LoadSceneFileTextures()
+ *
+ *  This method is used for loading the textures that are
+ *  listed in a scene file.
+ ***********************************************************/
+void SceneManager::LoadSceneFileTextures(const SceneFile& sceneFile)
+{
+	const SceneFile::SCENE_TEXTURE* pTextures = sceneFile.GetTextures();
 
-	// Draw the thin cylinder as the coffee surface
-	m_basicMeshes->DrawCylinderMesh();
+	for (int i = 0; i < sceneFile.GetTextureCount(); i++)
+	{
+		CreateGLTexture(
+			sceneFile.GetString(pTextures[i].path),
+			sceneFile.GetString(pTextures[i].tag));
+	}
 
-	/****************************************************************/
-	//Laptop Screen
-	scaleXYZ = glm::vec3(4.0f, 0.0f, 2.5f); 
+	BindGLTextures();
+}
 
-	// No rotation needed
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  DefineSceneFileMaterials()
+ *
+ *  This method is used for replacing the defined materials
+ *  with the ones that are listed in a scene file.  The
+ *  materials are written over the old ones in place, so a
+ *  reload of the scene reuses the memory of their tags.
+ ***********************************************************/
+void SceneManager::DefineSceneFileMaterials(const SceneFile& sceneFile)
+{
+	const SceneFile::SCENE_MATERIAL* pMaterials = sceneFile.GetMaterials();
 
-	
-	positionXYZ = glm::vec3(-1.0f, 2.0f, -5.5f);
+	m_objectMaterials.resize(sceneFile.GetMaterialCount());
+	for (int i = 0; i < sceneFile.GetMaterialCount(); i++)
+	{
+		OBJECT_MATERIAL& material = m_objectMaterials[i];
+		material.diffuseColor = glm::vec3(
+			pMaterials[i].diffuseColor[0],
+			pMaterials[i].diffuseColor[1],
+			pMaterials[i].diffuseColor[2]);
+		material.specularColor = glm::vec3(
+			pMaterials[i].specularColor[0],
+			pMaterials[i].specularColor[1],
+			pMaterials[i].specularColor[2]);
+		material.shininess = pMaterials[i].shininess;
+		material.tag.assign(sceneFile.GetString(pMaterials[i].tag));
+	}
+}
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  DefineSceneFileObjects()
+ *
+ *  This method is used for building the retained list of
+ *  render items from the records of a scene file.  The
+ *  texture and material records are resolved to slots and
+ *  indices once, so the objects themselves are copied
+ *  straight from the records without any tag lookups.  The
+ *  resolved slots and indices are only needed while the
+ *  objects are built, so they are kept in the scratch
+ *  memory of the frame, and the render items and the
+ *  transforms are rebuilt in the capacity they already have.
+ ***********************************************************/
+void SceneManager::DefineSceneFileObjects(const SceneFile& sceneFile)
+{
+	const SceneFile::SCENE_TEXTURE* pTextures = sceneFile.GetTextures();
+	const SceneFile::SCENE_MATERIAL* pMaterials = sceneFile.GetMaterials();
+	const SceneFile::SCENE_NODE* pNodes = sceneFile.GetNodes();
+	const SceneFile::SCENE_OBJECT* pObjects = sceneFile.GetObjects();
+	int* textureSlots = m_frameArena->AllocateArray<int>(sceneFile.GetTextureCount());
+	int* materialIndices = m_frameArena->AllocateArray<int>(sceneFile.GetMaterialCount());
+
+	for (int i = 0; i < sceneFile.GetTextureCount(); i++)
+	{
+		textureSlots[i] = FindTextureSlot(sceneFile.GetString(pTextures[i].tag));
+	}
+	for (int i = 0; i < sceneFile.GetMaterialCount(); i++)
+	{
+		materialIndices[i] = FindMaterialIndex(sceneFile.GetString(pMaterials[i].tag));
+	}
+
+	m_renderItems.clear();
+	m_sceneTransforms.Clear();
+	m_renderItems.reserve(sceneFile.GetObjectCount());
+	m_sceneTransforms.Reserve(sceneFile.GetNodeCount());
+
+	// the nodes are stored with parents first, so they keep
+	// their indices when they are added in order
+	for (int i = 0; i < sceneFile.GetNodeCount(); i++)
+	{
+		const SceneFile::SCENE_NODE& node = pNodes[i];
+		m_sceneTransforms.AddNode(
+			glm::vec3(node.scale[0], node.scale[1], node.scale[2]),
+			node.rotation[0], node.rotation[1], node.rotation[2],
+			glm::vec3(node.position[0], node.position[1], node.position[2]),
+			node.parent);
+	}
+
+	for (int i = 0; i < sceneFile.GetObjectCount(); i++)
+	{
+		const SceneFile::SCENE_OBJECT& object = pObjects[i];
+		RENDER_ITEM item;
+
+		item.mesh = (MESH_TYPE)object.mesh;
+		item.transformNode = object.node;
+		item.textureSlot = (object.texture >= 0) ? textureSlots[object.texture] : -1;
+		item.materialIndex = (object.material >= 0) ? materialIndices[object.material] : -1;
+		item.UVscale = glm::vec2(object.UVscale[0], object.UVscale[1]);
+		item.color = glm::vec4(object.color[0], object.color[1], object.color[2], object.color[3]);
+		item.shaderVariant = -1;
+
+		m_renderItems.push_back(item);
+	}
+
+	// calculate the initial matrices for all of the objects
+	m_sceneTransforms.UpdateTransforms(m_jobSystem);
+	// sort the objects by their shader state and group them
+	// into instanced draw calls
+	BuildDrawOrder();
+	BuildDrawBatches();
+}
+
+/***********************************************************
+ *  EnableHotReload()
+ *
+ *  This method is used for watching the files the scene was
+ *  built from, so that edits to the shaders, the textures
+ *  or the scene file show up without starting the program
+ *  again.  The textures that are loaded later are watched
+ *  as they are loaded.
+ ***********************************************************/
+void SceneManager::EnableHotReload()
+{
+	if (NULL != m_assetWatcher)
+	{
+		return;
+	}
+
+	m_assetWatcher = new AssetWatcher();
+	m_assetWatcher->WatchFile(g_VertexShaderPath, AssetWatcher::ASSET_SHADER, g_SceneShaderAsset);
+	m_assetWatcher->WatchFile(g_FragmentShaderPath, AssetWatcher::ASSET_SHADER, g_SceneShaderAsset);
+	m_assetWatcher->WatchFile(g_ShadowVertexShaderPath, AssetWatcher::ASSET_SHADER, g_ShadowShaderAsset);
+	m_assetWatcher->WatchFile(g_ShadowFragmentShaderPath, AssetWatcher::ASSET_SHADER, g_ShadowShaderAsset);
+	for (int i = 0; i < (int)m_textureIDs.size(); i++)
+	{
+		m_assetWatcher->WatchFile(m_textureIDs[i].filename, AssetWatcher::ASSET_TEXTURE, i);
+	}
+	// the generated scenes are not read from a file
+	if ((m_syntheticObjectCount == 0) && (m_sceneFilePath.empty() == false))
+	{
+		m_assetWatcher->WatchFile(m_sceneFilePath, AssetWatcher::ASSET_SCENE);
+	}
+	m_assetWatcher->Start();
+}
+
+/***********************************************************
+ *  ProcessAssetChanges()
+ *
+ *  This method is used for swapping in the assets whose
+ *  files changed.  It is called between frames, so a frame
+ *  is always drawn with either the old or the new asset.
+ *  Changed textures are decoded on the loader threads and
+ *  show their old image until they are uploaded, and a
+ *  changed scene has already been read by the watcher.
+ ***********************************************************/
+void SceneManager::ProcessAssetChanges()
+{
+	std::vector<AssetWatcher::ASSET_CHANGE> changes;
 
-	//set texture
-	SetShaderTexture("login");
+	if ((NULL == m_assetWatcher) || (m_assetWatcher->TakeChanges(changes) == 0))
+	{
+		return;
+	}
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	bool bSceneShadersChanged = false;
+	bool bShadowShadersChanged = false;
+	std::shared_ptr<SceneFile> pSceneFile;
 
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		const AssetWatcher::ASSET_CHANGE& change = changes[i];
 
+		switch (change.type)
+		{
+		case AssetWatcher::ASSET_SHADER:
+			if (change.assetIndex == g_ShadowShaderAsset)
+			{
+				bShadowShadersChanged = true;
+			}
+			else
+			{
+				bSceneShadersChanged = true;
+			}
+			break;
+		case AssetWatcher::ASSET_TEXTURE:
+			if ((change.assetIndex >= 0) && (change.assetIndex < (int)m_textureIDs.size()))
+			{
+				std::cout << "Reloading image:" << change.filePath << std::endl;
+				m_textureLoader->ReloadTexture(m_textureIDs[change.assetIndex].ID, change.filePath);
+			}
+			break;
+		case AssetWatcher::ASSET_SCENE:
+			// only the newest version of the scene is used
+			pSceneFile = change.pSceneFile;
+			break;
+		default:
+			break;
+		}
+	}
 
-	// Draw plane as laptop screen
-	m_basicMeshes->DrawPlaneMesh();
+	if (NULL != pSceneFile)
+	{
+		uint64_t allocationCount = HeapCounter::GetAllocationCount();
 
-	/****************************************************************/
-	// Laptop Keyboard
-	scaleXYZ = glm::vec3(8.1f, 0.5f, 6.0f);
+		std::cout << "Reloading scene:" << m_sceneFilePath << std::endl;
+		ApplySceneFile(*pSceneFile);
+		std::cout << "Reloaded the scene with " << (HeapCounter::GetAllocationCount() - allocationCount)
+			<< " heap allocations" << std::endl;
+	}
 
-	// No rotation needed
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (bShadowShadersChanged == true)
+	{
+		std::cout << "Reloading shadow shaders" << std::endl;
+		if (m_shadowManager->ReloadShaders(g_ShadowVertexShaderPath, g_ShadowFragmentShaderPath) == true)
+		{
+			m_bShadowsEnabled = true;
+			m_bShadowCastersDirty = true;
+			ResetPointShadowCasters();
+		}
+	}
 
+	if (bSceneShadersChanged == true)
+	{
+		std::cout << "Reloading scene shaders" << std::endl;
+		ReloadSceneShaders();
+	}
+}
 
-	positionXYZ = glm::vec3(-1.0f, 0.0f, -2.5f);
+/***********************************************************
+ *  ReloadSceneShaders()
+ *
+ *  This method is used for building the shader variants
+ *  again after the scene shader files changed.  The
+ *  variants keep their indices, so only their samplers need
+ *  to be set up again, and the draw order is built again so
+ *  the variants that failed before are tried again.
+ ***********************************************************/
+bool SceneManager::ReloadSceneShaders()
+{
+	if (m_shaderVariants->ReloadSources(g_VertexShaderPath, g_FragmentShaderPath) == false)
+	{
+		return(false);
+	}
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	for (int i = 0; i < (int)m_variantUniforms.size(); i++)
+	{
+		glUseProgram(m_shaderVariants->GetProgram(i));
+		m_variantUniforms[i].SetProgram(m_shaderVariants->GetProgram(i));
+		BindSamplerUnits(m_variantUniforms[i]);
+	}
+	glUseProgram(m_uniformCache.GetProgram());
+	InvalidateShaderState();
 
-	//set texture
-	SetShaderTexture("keyboard");
+	BuildDrawOrder();
+	BuildDrawBatches();
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	return(true);
+}
 
-	// Draw box for keyboard
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  ApplySceneFile()
+ *
+ *  This method is used for replacing the retained objects
+ *  and the materials with the records of a scene file that
+ *  was changed.  The textures that are already loaded keep
+ *  their slots, and only the new ones are loaded.
+ ***********************************************************/
+void SceneManager::ApplySceneFile(const SceneFile& sceneFile)
+{
+	const SceneFile::SCENE_TEXTURE* pTextures = sceneFile.GetTextures();
+	bool bNewTextures = false;
 
-	/****************************************************************/
-	// Laptop base
-	scaleXYZ = glm::vec3(8.1f, 0.49f, 6.1f);
+	for (int i = 0; i < sceneFile.GetTextureCount(); i++)
+	{
+		if (FindTextureSlot(sceneFile.GetString(pTextures[i].tag)) < 0)
+		{
+			CreateGLTexture(
+				sceneFile.GetString(pTextures[i].path),
+				sceneFile.GetString(pTextures[i].tag));
+			bNewTextures = true;
+		}
+	}
+	if (bNewTextures == true)
+	{
+		BindGLTextures();
+	}
 
-	// No rotation needed
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	DefineSceneFileMaterials(sceneFile);
+	BuildMaterialLookup();
+	UploadMaterialTable();
+	InvalidateShaderState();
 
+	DefineSceneFileObjects(sceneFile);
+}
 
-	positionXYZ = glm::vec3(-1.0f, 0.0f, -2.5f);
+/***********************************************************
+ *  SetSyntheticSceneSize()
+ *
+ *  This method is used for replacing the defined scene with
+ *  a generated scene of the passed in number of objects,
+ *  which is built when the scene is prepared.
+ ***********************************************************/
+void SceneManager::SetSyntheticSceneSize(int objectCount)
+{
+	m_syntheticObjectCount = (objectCount > 0) ? objectCount : 0;
+}
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  DefineSyntheticSceneObjects()
+ *
+ *  This method is used for building a scene of random
+ *  primitives on a square grid over a ground plane, for
+ *  measuring the renderer with scenes of any size.  The
+ *  random numbers come from a fixed seed, so the same
+ *  object count always gives the same scene.  About half
+ *  of the objects are textured and the rest are colored.
+ ***********************************************************/
+void SceneManager::DefineSyntheticSceneObjects(int objectCount)
+{
+	const char* textureTags[] = { "glasscup", "wood", "coffee", "lamp", "gold", "keyboard", "aluminum", "leather" };
+	const char* materialTags[] = { "wood", "glass", "metal", "leather", "canvas" };
+	const int textureTagCount = sizeof(textureTags) / sizeof(textureTags[0]);
+	const int materialTagCount = sizeof(materialTags) / sizeof(materialTags[0]);
+
+	m_renderItems.clear();
+	m_sceneTransforms.Clear();
+
+	std::mt19937 random(g_SyntheticSceneSeed);
+
+	int gridSize = (int)ceilf(sqrtf((float)objectCount));
+	float halfExtent = 0.5f * (float)gridSize * g_SyntheticSpacing;
+
+	// ground plane under the whole grid
+	AddRenderItem(
+		MESH_PLANE,
+		glm::vec3(halfExtent + g_SyntheticSpacing, 1.0f, halfExtent + g_SyntheticSpacing),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"wood", "wood",
+		-1,
+		glm::vec2((float)gridSize, (float)gridSize));
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		// any mesh other than the plane
+		MESH_TYPE mesh = (MESH_TYPE)(MESH_BOX + (int)(random() % (MESH_COUNT - MESH_BOX)));
+		float scale = 0.4f + RandomUnit(random) * 0.8f;
+		float yRotation = RandomUnit(random) * 360.0f;
+		// the values are drawn one per statement, since the
+		// order function arguments are evaluated in may differ
+		float xJitter = RandomUnit(random) - 0.5f;
+		float zJitter = RandomUnit(random) - 0.5f;
+		glm::vec3 position(
+			((float)(i % gridSize) + 0.5f) * g_SyntheticSpacing - halfExtent + xJitter,
+			scale,
+			((float)(i / gridSize) + 0.5f) * g_SyntheticSpacing - halfExtent + zJitter);
+		const char* materialTag = materialTags[random() % materialTagCount];
+
+		if (RandomUnit(random) < 0.5f)
+		{
+			AddRenderItem(
+				mesh,
+				glm::vec3(scale, scale, scale),
+				0.0f, yRotation, 0.0f,
+				position,
+				textureTags[random() % textureTagCount],
+				materialTag);
+		}
+		else
+		{
+			glm::vec4 color(1.0f);
+			color.r = RandomUnit(random);
+			color.g = RandomUnit(random);
+			color.b = RandomUnit(random);
+			AddColoredRenderItem(
+				mesh,
+				glm::vec3(scale, scale, scale),
+				0.0f, yRotation, 0.0f,
+				position,
+				color,
+				materialTag);
+		}
+	}
 
-	//set texture
-	SetShaderTexture("gold");
+	// calculate the initial matrices for all of the objects
+	m_sceneTransforms.UpdateTransforms();
+	// sort the objects by their shader state and group them
+	// into instanced draw calls
+	BuildDrawOrder();
+	BuildDrawBatches();
+}
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  GetSceneBounds()
+ *
+ *  This method is used for getting the world space box
+ *  around the bounds of every object in the scene, such as
+ *  for fitting a camera path around the scene.
+ ***********************************************************/
+bool SceneManager::GetSceneBounds(glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	glm::vec3 itemMin;
+	glm::vec3 itemMax;
 
-	SetShaderMaterial("metal");
+	if (m_frustumCuller.GetBoundsCount() == 0)
+	{
+		return(false);
+	}
 
-	// Draw box for keyboard
-	m_basicMeshes->DrawBoxMesh();
+	m_frustumCuller.GetBounds(0, boundsMin, boundsMax);
+	for (int i = 1; i < m_frustumCuller.GetBoundsCount(); i++)
+	{
+		m_frustumCuller.GetBounds(i, itemMin, itemMax);
+		boundsMin = glm::min(boundsMin, itemMin);
+		boundsMax = glm::max(boundsMax, itemMax);
+	}
 
-	/****************************************************************/
-	// Box for lamp
-	scaleXYZ = glm::vec3(3.0f, 1.0f, 2.0f);
+	return(true);
+}
 
-	// No rotation needed
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  SetCullingMode()
+ *
+ *  This method is used for picking where the instances are
+ *  culled.  The two cullers lay out the instance buffer and
+ *  the commands differently, so both are written again on
+ *  the next frame.
+ ***********************************************************/
+bool SceneManager::SetCullingMode(CULLING_MODE mode)
+{
+	if ((mode != CULL_CPU) && (m_bGpuCullingSupported == false))
+	{
+		std::cout << "GPU culling is not supported, keeping the " << GetCullingModeName(m_cullingMode) << " culler" << std::endl;
+		return(false);
+	}
+	if (mode == m_cullingMode)
+	{
+		return(true);
+	}
 
-	// Position to the left
-	positionXYZ = glm::vec3(-10.0f, 0.0f, -3.0f);
+	m_cullingMode = mode;
+	m_bInstancesDirty = true;
+	m_bGpuCommandsDirty = true;
+	m_gpuCuller->InvalidateDepthPyramid();
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	return(true);
+}
+
+/***********************************************************
+ *  GetCullingMode()
+ *
+ *  This method is used for getting where the instances are
+ *  culled.
+ ***********************************************************/
+SceneManager::CULLING_MODE SceneManager::GetCullingMode() const
+{
+	return(m_cullingMode);
+}
 
-	//set texture
-	SetShaderTexture("gold");
+/***********************************************************
+ *  GetCullingModeName()
+ *
+ *  This method is used for getting the name of a culling
+ *  mode, which is also the name --cull takes.
+ ***********************************************************/
+const char* SceneManager::GetCullingModeName(CULLING_MODE mode)
+{
+	if ((mode < 0) || (mode >= CULL_MODE_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_CullingModeNames[mode]);
+}
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  SetTransparencyMode()
+ *
+ *  This method is used for picking how the transparent
+ *  objects are blended.  The weighted blending draws them
+ *  with their own shader variants, so the draw order is
+ *  built again.
+ ***********************************************************/
+bool SceneManager::SetTransparencyMode(TRANSPARENCY_MODE mode)
+{
+	if ((mode == TRANSPARENCY_WEIGHTED) && (m_bWeightedTransparencySupported == false))
+	{
+		std::cout << "Weighted transparency is not supported, keeping the " << GetTransparencyModeName(m_transparencyMode) << " transparency" << std::endl;
+		return(false);
+	}
+	if (mode == m_transparencyMode)
+	{
+		return(true);
+	}
 
-	// Draw box as lamp stand
-	m_basicMeshes->DrawBoxMesh();
+	m_transparencyMode = mode;
+	BuildDrawOrder();
+	BuildDrawBatches();
 
-	SetShaderMaterial("metal");
+	return(true);
+}
 
-	/****************************************************************/
-	// stand for lamp
-	scaleXYZ = glm::vec3(0.5f, 7.0f, 0.5f);
+/***********************************************************
+ *  GetTransparencyMode()
+ *
+ *  This method is used for getting how the transparent
+ *  objects are blended.
+ ***********************************************************/
+SceneManager::TRANSPARENCY_MODE SceneManager::GetTransparencyMode() const
+{
+	return(m_transparencyMode);
+}
 
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for switching the depth pre-pass on
+ *  or off.  The pre-pass costs a second pass over the
+ *  vertices of the opaque objects, and saves lighting the
+ *  fragments that are hidden by nearer ones.
+ ***********************************************************/
+bool SceneManager::SetDepthPrepass(bool bEnabled)
+{
+	if ((bEnabled == true) && (m_depthPrepassVariant < 0))
+	{
+		m_depthPrepassVariant = GetShaderVariant(
+			ShaderVariants::VARIANT_INSTANCING |
+			ShaderVariants::VARIANT_DEPTH_ONLY);
+		if (m_depthPrepassVariant < 0)
+		{
+			std::cout << "The depth pre-pass variant could not be compiled, keeping the pre-pass off" << std::endl;
+			return(false);
+		}
+	}
 
-	// Position to the left
-	positionXYZ = glm::vec3(-10.0f, 0.0f, -3.0f);
+	m_bDepthPrepass = bEnabled;
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	return(true);
+}
 
-	
-	SetShaderTexture("gold");
+/***********************************************************
+ *  IsDepthPrepassEnabled()
+ *
+ *  This method is used for getting whether the depth of the
+ *  opaque objects is written before they are lit.
+ ***********************************************************/
+bool SceneManager::IsDepthPrepassEnabled() const
+{
+	return(m_bDepthPrepass);
+}
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+/***********************************************************
+ *  GetTransparencyModeName()
+ *
+ *  This method is used for getting the name of a
+ *  transparency mode, which is also the name --transparency
+ *  takes.
+ ***********************************************************/
+const char* SceneManager::GetTransparencyModeName(TRANSPARENCY_MODE mode)
+{
+	if ((mode < 0) || (mode >= TRANSPARENCY_MODE_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_TransparencyModeNames[mode]);
+}
 
-	SetShaderMaterial("metal");
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for building the retained list of
+ *  render items for the 3D scene.  The transformations,
+ *  textures and materials of every object are resolved a
+ *  single time here instead of on every rendered frame.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+	int groupNode = -1;
 
-	// Draw cylinder as lamp stand
-	m_basicMeshes->DrawCylinderMesh();
+	m_renderItems.clear();
+	m_sceneTransforms.Clear();
 
 	/****************************************************************/
-	// shade for lamp
-	scaleXYZ = glm::vec3(3.0f, 3.0f, 1.0f);
+	// desk surface
+	AddRenderItem(
+		MESH_PLANE,
+		glm::vec3(20.0f, 1.0f, 10.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"wood", "wood");
 
-	// No rotation needed
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	/****************************************************************/
+	// the coffee cup parts are positioned relative to the cup
+	groupNode = AddTransformGroup(glm::vec3(5.0f, 0.0f, 3.0f));
 
-	// to the left
-	positionXYZ = glm::vec3(-10.0f, 6.0f, -3.0f);
+	//cylinder for coffee cup
+	AddRenderItem(
+		MESH_CYLINDER,
+		glm::vec3(1.0f, 2.0f, 1.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"glasscup", "glass",
+		groupNode,
+		glm::vec2(1.0f, 1.0f),
+		0.45f);
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	//torus for coffee cup handle
+	AddRenderItem(
+		MESH_TORUS,
+		glm::vec3(0.8f, 0.8f, 1.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(1.0f, 1.0f, 0.5f),
+		"glasscup", "glass",
+		groupNode,
+		glm::vec2(5.0f, 1.0f),
+		0.45f);
 
+	// Coffee surface (thin cylinder on top of the cup)
+	AddRenderItem(
+		MESH_CYLINDER,
+		glm::vec3(0.95f, 0.05f, 0.95f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 2.0f, 0.0f),
+		"coffee", "glass",
+		groupNode,
+		glm::vec2(1.0f, 1.0f),
+		0.85f);
 
-	//set texture
-	SetShaderTexture("lamp");
+	/****************************************************************/
+	// the laptop parts are positioned relative to the laptop base
+	groupNode = AddTransformGroup(glm::vec3(-1.0f, 0.0f, -2.5f));
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	//Laptop Screen
+	AddRenderItem(
+		MESH_PLANE,
+		glm::vec3(4.0f, 0.0f, 2.5f),
+		90.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 2.0f, -3.0f),
+		"login", "glass",
+		groupNode);
 
-	SetShaderMaterial("canvas");
+	// Laptop Keyboard
+	AddRenderItem(
+		MESH_BOX,
+		glm::vec3(8.1f, 0.5f, 6.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"keyboard", "glass",
+		groupNode);
 
-	// Draw cone as lampshade 
-	m_basicMeshes->DrawConeMesh();
+	// Laptop base
+	AddRenderItem(
+		MESH_BOX,
+		glm::vec3(8.1f, 0.49f, 6.1f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"gold", "metal",
+		groupNode);
 
 	/****************************************************************/
-	// Pen
-	scaleXYZ = glm::vec3(0.2f, 1.0f, 0.2f);
+	// the lamp base, stand and shade move together
+	groupNode = AddTransformGroup(glm::vec3(-10.0f, 0.0f, -3.0f));
+
+	// Box for lamp
+	AddRenderItem(
+		MESH_BOX,
+		glm::vec3(3.0f, 1.0f, 2.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"gold", "metal",
+		groupNode);
 
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 130.0f;
-	ZrotationDegrees = 0.0f;
+	// stand for lamp
+	AddRenderItem(
+		MESH_CYLINDER,
+		glm::vec3(0.5f, 7.0f, 0.5f),
+		0.0f, 90.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"gold", "metal",
+		groupNode);
 
-	// Position to the left
-	positionXYZ = glm::vec3(-6.0f, 0.5f, 4.0f);
+	// shade for lamp
+	AddRenderItem(
+		MESH_CONE,
+		glm::vec3(3.0f, 3.0f, 1.0f),
+		0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 6.0f, 0.0f),
+		"lamp", "canvas",
+		groupNode);
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	/****************************************************************/
+	// the pen body and tip move together
+	groupNode = AddTransformGroup(glm::vec3(-6.0f, 0.5f, 4.0f));
+
+	// Pen
+	AddRenderItem(
+		MESH_CYLINDER,
+		glm::vec3(0.2f, 1.0f, 0.2f),
+		90.0f, 130.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"pen", "metal",
+		groupNode);
+
+	// Pen tip
+	AddRenderItem(
+		MESH_TAPERED_CYLINDER,
+		glm::vec3(0.16f, 0.2f, 0.16f),
+		270.0f, 130.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"aluminum", "metal",
+		groupNode);
+
+	/****************************************************************/
+	// the book cover and pages move together
+	groupNode = AddTransformGroup(glm::vec3(-8.0f, 0.5f, 4.0f));
+
+	//Book cover
+	AddRenderItem(
+		MESH_BOX,
+		glm::vec3(4.0f, 2.0f, 0.3f),
+		270.0f, 130.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		"leather", "leather",
+		groupNode);
+
+	//Book pages - drawn with a solid color instead of a texture
+	AddColoredRenderItem(
+		MESH_BOX,
+		glm::vec3(4.0f, 1.98f, 0.2f),
+		270.0f, 130.0f, 0.0f,
+		glm::vec3(0.07f, 0.0f, 0.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+		"leather",
+		groupNode);
+
+	// calculate the initial matrices for all of the objects
+	m_sceneTransforms.UpdateTransforms();
+	// sort the objects by their shader state and group them
+	// into instanced draw calls
+	BuildDrawOrder();
+	BuildDrawBatches();
+}
 
-	//set texture
-	SetShaderTexture("pen");
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by walking
+ *  the retained list of render items that was built when
+ *  the scene was prepared, in state sorted order, with one
+ *  instanced draw call for each run of objects that share a
+ *  mesh and a texture.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	// upload any texture images that finished loading - the
+	// textures keep their names, so the bound slots stay valid
+	{
+		ProfileScope scope("TextureUploads");
+		m_textureLoader->ProcessUploads();
+	}
 
-	SetShaderMaterial("metal");
+	// the scratch memory of the last frame is no longer used
+	m_frameArena->Reset();
 
-	// Draw the thin cylinder for pen
-	m_basicMeshes->DrawCylinderMesh();
+	// only the objects that were moved since the last frame
+	// have their matrices recalculated and uploaded again
+	{
+		ProfileScope scope("UpdateTransforms");
+		if (m_sceneTransforms.UpdateTransforms(m_jobSystem) > 0)
+		{
+			RefreshInstanceTransforms();
+		}
+	}
 
-	/****************************************************************/
-	// Pen
-	scaleXYZ = glm::vec3(0.16f, 0.2f, 0.16f);
+	// sort the point lights into the clusters of the current
+	// view, before the cluster grid values are written below
+	if (NULL != m_pUniformBuffers)
+	{
+		ProfileScope scope("AssignLights");
+		const UniformBufferManager::CAMERA_BLOCK& camera = m_pUniformBuffers->GetCamera();
+		m_lightManager->AssignLights(camera.view, camera.projection, m_jobSystem);
+	}
 
-	XrotationDegrees = 270.0f;
-	YrotationDegrees = 130.0f;
-	ZrotationDegrees = 0.0f;
+	// only the objects inside the view frustum are submitted
+	{
+		ProfileScope scope("CullInstances");
+		CullInstances();
+	}
 
-	// Position to the left
-	positionXYZ = glm::vec3(-6.0f, 0.5f, 4.0f);
+	// render the shadow maps that are out of date, before the
+	// shadow matrices are written below
+	if (m_bShadowsEnabled == true)
+	{
+		ProfileScope scope("ShadowPasses");
+		ProfileGpuScope gpuScope("Shadows");
+		DrawShadowCasters();
+	}
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// write any changed lights or materials into their buffers
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->UpdateBuffers();
+	}
 
-	//set texture
-	SetShaderTexture("aluminum");
+	// the shader values may have been changed since the last frame
+	InvalidateShaderState();
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	// the depth of the opaque objects is written first, so the
+	// lit pass below only shades the fragments that are seen
+	bool bDepthPrepass = (m_bDepthPrepass == true) && (m_depthPrepassVariant >= 0);
+	if (bDepthPrepass == true)
+	{
+		ProfileScope prepassScope("DepthPrepass");
+		ProfileGpuScope prepassGpuScope("DepthPrepass");
+		DrawDepthPrepass();
+	}
 
-	SetShaderMaterial("metal");
+	ProfileScope scope("ScenePass");
+	ProfileGpuScope gpuScope("Scene");
 
-	// Draw the taperd cylinder as pen tip
-	m_basicMeshes->DrawTaperedCylinderMesh();
+	// after the pre-pass only the nearest fragment of each pixel
+	// has the depth that is already in the depth buffer
+	if (bDepthPrepass == true)
+	{
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
 
-	/****************************************************************/
-	//Book
-	scaleXYZ = glm::vec3(4.0f, 2.0f, 0.3f);
+	// the model matrix, color, UV scale, material and texture
+	// of each object are read from the instance values, and
+	// the batches are sorted by shader variant, so the program
+	// only changes a few times per frame - the indirect
+	// commands were recorded when the visible instances were
+	// packed, and every shape is in the same buffers, so each
+	// shader variant is a single multi-draw - the opaque
+	// objects are drawn without blending
+	for (size_t i = 0; i < m_drawCommands.size(); i++)
+	{
+		const DRAW_COMMAND& command = m_drawCommands[i];
 
-	XrotationDegrees = 270.0f;
-	YrotationDegrees = 130.0f;
-	ZrotationDegrees = 0.0f;
+		UseShaderVariant(command.shaderVariant);
+		m_instancedMeshes->DrawIndirect(command.firstCommand, command.commandCount);
+	}
 
-	// Position to the left
-	positionXYZ = glm::vec3(-8.0f, 0.5f, 4.0f);
+	if (bDepthPrepass == true)
+	{
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// the depth of this frame hides the instances of the next
+	if ((m_cullingMode == CULL_GPU_OCCLUSION) && (NULL != m_pUniformBuffers))
+	{
+		ProfileScope pyramidScope("DepthPyramid");
+		const UniformBufferManager::CAMERA_BLOCK& camera = m_pUniformBuffers->GetCamera();
+		m_gpuCuller->BuildDepthPyramid(camera.projection * camera.view);
+	}
 
-	//set texture
-	SetShaderTexture("leather");
+	// the transparent objects are blended over everything above
+	DrawTransparentObjects();
 
-	//set scale
-	SetTextureUVScale(1.0, 1.0);
+	// go back to the program the other shader methods set
+	// their values into
+	glUseProgram(m_uniformCache.GetProgram());
+	m_uniformCache.SetBool(m_uniforms.useInstancing, false);
 
-	SetShaderMaterial("leather");
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_ARENA_BYTES, (int)m_frameArena->GetUsedBytes());
+}
 
-	// Draw the box as cover
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  PickRenderItem()
+ *
+ *  This method is used for finding the nearest render item
+ *  whose world space bounds are hit by a ray, such as a ray
+ *  from the camera through the mouse position.  The render
+ *  item index is returned, or -1 when nothing is hit.
+ ***********************************************************/
+int SceneManager::PickRenderItem(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance)
+{
+	float hitDistance = 0.0f;
+	int instance = m_sceneBVH.Raycast(origin, direction, maxDistance, hitDistance);
 
-	/****************************************************************/
-	//Book
-	scaleXYZ = glm::vec3(4.0f, 1.98f, 0.2f);
+	if (instance < 0)
+	{
+		return(-1);
+	}
 
-	XrotationDegrees = 270.0f;
-	YrotationDegrees = 130.0f;
-	ZrotationDegrees = 0.0f;
+	return((int)m_instanceItems[instance]);
+}
 
-	// Position to the left
-	positionXYZ = glm::vec3(-7.93f, 0.5f, 4.0f);
+/***********************************************************
+ *  QueryRenderItems()
+ *
+ *  This method is used for adding the render items whose
+ *  world space bounds touch a sphere to the passed in list,
+ *  such as the objects within the range of a light.  The
+ *  number of added items is returned.
+ ***********************************************************/
+int SceneManager::QueryRenderItems(
+	const glm::vec3& center,
+	float radius,
+	std::vector<int>& items)
+{
+	size_t firstAdded = items.size();
+	int addedCount = m_sceneBVH.QuerySphere(center, radius, items);
 
-	// Apply transformations
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// the hierarchy returns instance indices
+	for (size_t i = firstAdded; i < items.size(); i++)
+	{
+		items[i] = (int)m_instanceItems[items[i]];
+	}
 
-	SetShaderColor(1.0, 1.0, 1.0, 1);
-	
-	// Draw smaller box for pages
-	m_basicMeshes->DrawBoxMesh();
+	return(addedCount);
 }
@@ -11,8 +11,27 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "AssetWatcher.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include "InstancedMeshes.h"
+#include "JobSystem.h"
+#include "LightManager.h"
+#include "MemoryArena.h"
+#include "SceneBVH.h"
+#include "SceneFile.h"
+#include "ShaderVariants.h"
+#include "ShadowManager.h"
+#include "TextureLoader.h"
+#include "TextureManager.h"
+#include "TransformHierarchy.h"
+#include "UniformBuffers.h"
+#include "UniformCache.h"
+#include "WeightedTransparency.h"
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -25,14 +44,40 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(
+		ShaderManager *pShaderManager,
+		UniformBufferManager* pUniformBuffers);
 	// destructor
 	~SceneManager();
 
+	// where the instances are tested against the view - the
+	// GPU culler can also hide the instances that were behind
+	// the depth of the last frame
+	enum CULLING_MODE
+	{
+		CULL_CPU,
+		CULL_GPU,
+		CULL_GPU_OCCLUSION,
+		CULL_MODE_COUNT
+	};
+
+	// how the transparent objects are blended over the scene -
+	// sorted from back to front every frame, or in any order
+	// with weighted blended transparency
+	enum TRANSPARENCY_MODE
+	{
+		TRANSPARENCY_SORTED,
+		TRANSPARENCY_WEIGHTED,
+		TRANSPARENCY_MODE_COUNT
+	};
+
 	struct TEXTURE_INFO
 	{
 		std::string tag;
+		// index of the texture in the texture table
 		uint32_t ID;
+		// the image file the texture was loaded from
+		std::string filename;
 	};
 
 	struct OBJECT_MATERIAL
@@ -43,32 +88,259 @@ public:
 		std::string tag;
 	};
 
+	// a single object in the retained scene - everything
+	// that is needed for drawing the object is resolved
+	// when the item is added to the scene
+	struct RENDER_ITEM
+	{
+		MESH_TYPE mesh;
+		// node in the scene transforms that holds the cached
+		// model matrix for the object
+		int transformNode;
+		// slot of the loaded texture, or -1 when drawn with
+		// a solid color
+		int textureSlot;
+		// index into the defined materials, or -1 for none
+		int materialIndex;
+		glm::vec2 UVscale;
+		glm::vec4 color;
+		// the shader variant the item is drawn with, or -1 for
+		// the program that selects the paths with uniforms -
+		// resolved when the draw order is built
+		int shaderVariant;
+	};
+
+	// handles of the uniforms that are set while rendering,
+	// resolved once so no name lookups are done per frame
+	struct UNIFORM_HANDLES
+	{
+		int model;
+		int normalMatrix;
+		int objectColor;
+		int objectTextureIndex;
+		int useTexture;
+		int useLighting;
+		int useInstancing;
+		int UVscale;
+		int materialDiffuse;
+		int materialSpecular;
+		int materialShininess;
+	};
+
+	// a run of sorted render items that share a shader variant
+	// and a mesh and are drawn with one instanced draw call
+	struct DRAW_BATCH
+	{
+		int shaderVariant;
+		MESH_TYPE mesh;
+		// whether the instances are blended over the scene
+		bool bTransparent;
+		int firstInstance;
+		int instanceCount;
+		// the instances that passed the frustum test this frame
+		// at each level of detail, in the visible part of the
+		// instance buffer
+		int visibleFirst[ShapeGeometry::LOD_COUNT];
+		int visibleCount[ShapeGeometry::LOD_COUNT];
+	};
+
+	// one recorded multi-draw of the scene pass, replayed on
+	// the OpenGL thread without looking at the batches again -
+	// it draws the indirect commands of one shader variant
+	struct DRAW_COMMAND
+	{
+		int shaderVariant;
+		int firstCommand;
+		int commandCount;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the shared uniform buffers
+	UniformBufferManager* m_pUniformBuffers;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// pointer to the instanced shapes object
+	InstancedMeshes* m_instancedMeshes;
+	// pointer to the texture arrays the textures are stored in
+	TextureManager* m_textureManager;
+	// pointer to the background texture loader
+	TextureLoader* m_textureLoader;
+	// pointer to the worker threads the per-object updates,
+	// culling and sort keys run on
+	JobSystem* m_jobSystem;
+	// pointer to the point lights and their cluster lists
+	LightManager* m_lightManager;
+	// pointer to the specialized shader programs
+	ShaderVariants* m_shaderVariants;
+	// pointer to the shadow maps of the scene lights
+	ShadowManager* m_shadowManager;
+	// pointer to the watcher of the asset files, or NULL when
+	// the assets are not reloaded while the program runs
+	AssetWatcher* m_assetWatcher;
+	// pointer to the compute shader culler
+	GpuCuller* m_gpuCuller;
+	// pointer to the weighted blended transparency targets
+	WeightedTransparency* m_weightedTransparency;
+	// pointer to the scratch memory of the frame, which is
+	// freed when the next frame is rendered
+	FrameArena* m_frameArena;
+	// the uniform values of each shader variant
+	std::vector<ShaderUniformCache> m_variantUniforms;
+	// the variant flags of the scene lights, shared by all of
+	// the lit objects
+	unsigned int m_lightingVariantFlags;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	std::vector<TEXTURE_INFO> m_textureIDs;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// tags interned to texture slots and material indices
+	std::unordered_map<std::string, int> m_textureSlotLookup;
+	std::unordered_map<std::string, int> m_materialLookup;
+	// retained list of objects in the 3D scene
+	std::vector<RENDER_ITEM> m_renderItems;
+	// cached transformations for the retained objects
+	TransformHierarchy m_sceneTransforms;
+	// packed sort keys of the retained objects in draw order -
+	// the low 24 bits of each key hold the render item index
+	std::vector<uint64_t> m_drawOrder;
+	// cached uniform locations and last values applied to the shader
+	ShaderUniformCache m_uniformCache;
+	UNIFORM_HANDLES m_uniforms;
+	// material that was last passed into the shader, or -1
+	int m_currentMaterial;
+	// instanced draw calls for the sorted objects
+	std::vector<DRAW_BATCH> m_drawBatches;
+	// per-instance values of the sorted objects
+	std::vector<InstancedMeshes::INSTANCE_DATA> m_instanceData;
+	// render item index of each instance
+	std::vector<uint32_t> m_instanceItems;
+	// world space bounds of the instances, tested against the
+	// view frustum every frame
+	FrustumCuller m_frustumCuller;
+	// bounding volume hierarchy over the same bounds, used for
+	// culling large scenes, picking and range queries
+	SceneBVH m_sceneBVH;
+	// visible flag of each instance this frame and last frame,
+	// which is one more than the level of detail it is drawn
+	// with, or 0 when it is outside of the view
+	std::vector<uint8_t> m_instanceVisible;
+	std::vector<uint8_t> m_lastInstanceVisible;
+	// the per-instance values of the visible instances
+	std::vector<InstancedMeshes::INSTANCE_DATA> m_visibleInstanceData;
+	int m_visibleInstanceCount;
+	// the level of detail each instance was drawn with, kept
+	// from frame to frame so the levels do not flicker
+	std::vector<uint8_t> m_instanceLevels;
+	// where the visible instances of each level of detail in
+	// each fixed size block of instances are packed to, used
+	// to pack them in parallel - kept in the frame arena
+	int* m_pVisibleBlockOffsets;
+	int m_visibleLevelStride;
+	// the multi-draws of the scene pass for the visible opaque
+	// instances, and for the transparent ones drawn after them
+	std::vector<DRAW_COMMAND> m_drawCommands;
+	std::vector<DRAW_COMMAND> m_transparentCommands;
+	// the indirect commands of the shadow passes, which draw
+	// every instance of each batch, followed by the commands of
+	// the scene pass, and the one command for each transparent
+	// instance that is sorted every frame
+	std::vector<InstancedMeshes::INDIRECT_COMMAND> m_indirectCommands;
+	int m_shadowCommandCount;
+	int m_sortedCommandFirst;
+	// the transparent instances follow the opaque ones
+	int m_firstTransparentInstance;
+	// the distance from the camera to each instance, and the
+	// order the batches are drawn in
+	std::vector<float> m_instanceDistances;
+	std::vector<int> m_batchOrder;
+	// the camera position the distances were measured from
+	glm::vec3 m_sortPosition;
+	// how the transparent objects are blended, and whether the
+	// weighted blending could be started
+	TRANSPARENCY_MODE m_transparencyMode;
+	bool m_bWeightedTransparencySupported;
+	// whether the opaque objects write their depth before they
+	// are lit, and the variant the depth is written with
+	bool m_bDepthPrepass;
+	int m_depthPrepassVariant;
+	// where the instances are culled, and whether the GPU
+	// culler could be started
+	CULLING_MODE m_cullingMode;
+	bool m_bGpuCullingSupported;
+	// the per-instance values of the GPU culler, and whether
+	// they and the commands need to be uploaded again
+	std::vector<GpuCuller::INSTANCE_INFO> m_gpuInstanceInfo;
+	bool m_bGpuCommandsDirty;
+	// set when the instance values changed since the last upload
+	bool m_bInstancesDirty;
+	// set when objects moved since the shadow maps were fitted
+	bool m_bShadowCastersDirty;
+	// set when the shadow programs could be compiled
+	bool m_bShadowsEnabled;
+	// the render items in the range of each point shadow, and
+	// the world versions of their transforms, from the last
+	// time the point shadows were checked for moved casters
+	std::vector<int> m_pointShadowCasters[ShadowManager::MAX_POINT_SHADOWS];
+	std::vector<unsigned int> m_pointShadowVersions[ShadowManager::MAX_POINT_SHADOWS];
+	// the render items found in the range of a point shadow
+	std::vector<int> m_pointShadowQuery;
+	// the number of generated objects that replace the
+	// defined scene, or 0 for the defined scene
+	int m_syntheticObjectCount;
+	// the text scene file the scene is loaded from, or empty
+	// for the scene that is defined in code
+	std::string m_sceneFilePath;
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	bool CreateGLTexture(const char* filename, const std::string& tag);
 	void LoadSceneTextures();
 	void DefineObjectMaterials();
+	// load the textures and materials of a scene file
+	void LoadSceneFileTextures(const SceneFile& sceneFile);
+	void DefineSceneFileMaterials(const SceneFile& sceneFile);
+	// replace the scene with the records of a reloaded scene file
+	void ApplySceneFile(const SceneFile& sceneFile);
+	// build the shader variants again from changed sources
+	bool ReloadSceneShaders();
+	// intern the defined material tags for fast lookups
+	void BuildMaterialLookup();
+	// pass all of the defined materials into the material
+	// table uniform buffer
+	void UploadMaterialTable();
 	void SetupSceneLights();
-	// bind loaded OpenGL textures to slots in memory
+	// resolve the handles of the uniforms set while rendering
+	void ResolveUniformHandles();
+	// point the samplers of a program at their texture units
+	void BindSamplerUnits(ShaderUniformCache& uniformCache);
+	// find or compile the shader variant for a render item
+	int SelectShaderVariant(const RENDER_ITEM& item);
+	// find or compile a shader variant and set up its samplers
+	int GetShaderVariant(unsigned int flags);
+	// switch to the program of a shader variant
+	void UseShaderVariant(int variantIndex);
+	// bind the texture arrays of the loaded textures to their
+	// texture units
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const std::string& tag);
+	int FindTextureSlot(const std::string& tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
+
+	// calculate the model matrix from the transformation values
+	glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -88,7 +360,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const std::string& textureTag);
+	void SetShaderTexture(
+		int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -96,13 +370,158 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const std::string& materialTag);
+	void SetShaderMaterial(
+		int materialIndex);
+
+	// add a group node that child objects can be attached to
+	// so that they are moved together
+	int AddTransformGroup(
+		glm::vec3 positionXYZ,
+		int parentNode = -1);
+
+	// add a textured object to the retained scene - the
+	// returned transform node can be used to move the object
+	int AddRenderItem(
+		MESH_TYPE mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		const std::string& textureTag,
+		const std::string& materialTag,
+		int parentNode = -1,
+		glm::vec2 UVscale = glm::vec2(1.0f, 1.0f),
+		float alpha = 1.0f);
+
+	// add a solid colored object to the retained scene
+	int AddColoredRenderItem(
+		MESH_TYPE mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		const std::string& materialTag,
+		int parentNode = -1);
+
+	// whether a retained object is blended over the scene
+	static bool IsTransparent(const RENDER_ITEM& item);
+	// build the packed sort key for a retained object
+	uint64_t BuildSortKey(const RENDER_ITEM& item, uint32_t itemIndex) const;
+	// sort the retained objects to minimize shader state changes
+	void BuildDrawOrder();
+	// group the sorted objects into instanced draw calls
+	void BuildDrawBatches();
+	// copy the current model matrices into the instance values
+	void RefreshInstanceTransforms();
+	// update the world space bounds of the instances - the
+	// hierarchy is built again when the instance order changed
+	void UpdateInstanceBounds(bool bRebuild);
+	// test the instances against the view frustum and upload
+	// the visible ones when they changed
+	void CullInstances();
+	// cull the instances with the compute shader, which writes
+	// the instance counts of the scene commands
+	void CullInstancesOnGpu();
+	// pick the level of detail of each visible instance from
+	// its size on the screen
+	void SelectInstanceLevels();
+	// the packed position of the visible instances of a level
+	// of detail before an instance
+	int CountVisibleBefore(int instance, int level) const;
+	// record the indirect commands of the shadow casters and of
+	// the visible batches, or of every batch for the GPU culler
+	void BuildDrawCommands();
+	// measure the distance from the camera to a range of the
+	// instances
+	void UpdateDrawDistances(int firstInstance, int lastInstance);
+	// order the opaque batches of each shader variant from
+	// front to back
+	void SortDrawBatches();
+	// record one command for each visible transparent instance,
+	// from back to front
+	void BuildSortedTransparentCommands();
+	// write the depth of the visible opaque instances
+	void DrawDepthPrepass();
+	// blend the visible transparent instances over the scene
+	void DrawTransparentObjects();
+	// render the shadow maps that are out of date with every
+	// shadow casting instance
+	void DrawShadowCasters();
+	// mark the point shadows whose casters moved in their range
+	void FindMovedPointShadows();
+	// forget the casters of the point shadows and render them
+	// all again, after the render items were rebuilt
+	void ResetPointShadowCasters();
+	// forget the last applied shader values
+	void InvalidateShaderState();
+
+	// draw the basic mesh for the passed in mesh type
+	void DrawMesh(MESH_TYPE mesh);
 
 public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
+	void DefineSceneObjects();
 	void RenderScene();
 
+	// replace the defined scene with a generated one of the
+	// passed in number of objects - call before PrepareScene()
+	void SetSyntheticSceneSize(int objectCount);
+	// build a reproducible scene of random primitives
+	void DefineSyntheticSceneObjects(int objectCount);
+	// load the scene from a scene file instead of the scene
+	// defined in code - call before PrepareScene()
+	void SetSceneFile(const std::string& filePath);
+	// build the retained objects from the records of a scene file
+	void DefineSceneFileObjects(const SceneFile& sceneFile);
+
+	// watch the shader, texture and scene files and reload
+	// them when they change - call after PrepareScene()
+	void EnableHotReload();
+	// swap in the assets that changed - call on the OpenGL
+	// thread between frames
+	void ProcessAssetChanges();
+	// the world space box around every object of the scene
+	bool GetSceneBounds(glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+	// pick where the instances are culled - false is returned
+	// and the CPU culler is kept when the driver can not run
+	// the GPU culler, call after PrepareScene()
+	bool SetCullingMode(CULLING_MODE mode);
+	CULLING_MODE GetCullingMode() const;
+	// the name of a culling mode, as used on the command line
+	static const char* GetCullingModeName(CULLING_MODE mode);
+	// pick how the transparent objects are blended - false is
+	// returned and the sorted blending is kept when the driver
+	// can not run the weighted blending, call after PrepareScene()
+	bool SetTransparencyMode(TRANSPARENCY_MODE mode);
+	TRANSPARENCY_MODE GetTransparencyMode() const;
+	// the name of a transparency mode, as used on the command line
+	static const char* GetTransparencyModeName(TRANSPARENCY_MODE mode);
+	// write the depth of the opaque objects before they are lit,
+	// so each pixel is only lit once - false is returned when
+	// the depth variant could not be compiled, call after
+	// PrepareScene()
+	bool SetDepthPrepass(bool bEnabled);
+	bool IsDepthPrepassEnabled() const;
+
+	// find the nearest render item hit by a ray, such as a ray
+	// from the camera through the mouse - returns -1 on a miss
+	int PickRenderItem(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance = 1000.0f);
+	// add the render items whose bounds touch a sphere, such
+	// as the range of a light, to the passed in list
+	int QueryRenderItems(
+		const glm::vec3& center,
+		float radius,
+		std::vector<int>& items);
+
 };
\ No newline at end of file
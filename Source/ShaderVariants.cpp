@@ -0,0 +1,456 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.cpp
+// ============
+// compile and cache specialized variants of the scene shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderVariants.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// the define that tells the shaders the flags below are
+	// compile time constants instead of uniforms
+	const char* g_VariantDefine = "SHADER_VARIANT";
+	// the directory the program binaries are saved in
+	const char* g_ProgramCacheDirectory = "shadercache";
+
+	// the define that is added for each of the variant flags
+	struct FLAG_DEFINE
+	{
+		unsigned int flag;
+		const char* name;
+	};
+
+	const FLAG_DEFINE g_FlagDefines[] =
+	{
+		{ ShaderVariants::VARIANT_LIGHTING, "USE_LIGHTING" },
+		{ ShaderVariants::VARIANT_TEXTURE, "USE_TEXTURE" },
+		{ ShaderVariants::VARIANT_INSTANCING, "USE_INSTANCING" },
+		{ ShaderVariants::VARIANT_DIRECTIONAL_LIGHT, "USE_DIRECTIONAL_LIGHT" },
+		{ ShaderVariants::VARIANT_POINT_LIGHTS, "USE_POINT_LIGHTS" },
+		{ ShaderVariants::VARIANT_SPOT_LIGHT, "USE_SPOT_LIGHT" },
+		{ ShaderVariants::VARIANT_SHADOWS, "USE_SHADOWS" },
+		{ ShaderVariants::VARIANT_SHADOW_DISTANCE, "USE_SHADOW_DISTANCE" },
+		{ ShaderVariants::VARIANT_WEIGHTED_TRANSPARENCY, "USE_WEIGHTED_TRANSPARENCY" },
+		{ ShaderVariants::VARIANT_DEPTH_ONLY, "USE_DEPTH_ONLY" },
+	};
+}
+
+/***********************************************************
+ *  ShaderVariants()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderVariants::ShaderVariants(UniformBufferManager* pUniformBuffers)
+	: m_programCache(g_ProgramCacheDirectory)
+{
+	m_pUniformBuffers = pUniformBuffers;
+}
+
+/***********************************************************
+ *  ~ShaderVariants()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderVariants::~ShaderVariants()
+{
+	DestroyPrograms();
+	m_pUniformBuffers = NULL;
+}
+
+/***********************************************************
+ *  ReadSource()
+ *
+ *  This method is used for reading the contents of a shader
+ *  source file.
+ ***********************************************************/
+bool ShaderVariants::ReadSource(const char* filePath, std::string& source)
+{
+	std::ifstream file(filePath);
+
+	if (file.is_open() == false)
+	{
+		std::cout << "ERROR::SHADER_VARIANTS::FILE_NOT_READ: " << filePath << std::endl;
+		return(false);
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	source = contents.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadSources()
+ *
+ *  This method is used for loading the shader source files
+ *  the variants are built from.  Any variants that were
+ *  compiled from the old source are freed.
+ ***********************************************************/
+bool ShaderVariants::LoadSources(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if ((ReadSource(vertexShaderPath, vertexSource) == false) ||
+		(ReadSource(fragmentShaderPath, fragmentSource) == false))
+	{
+		return(false);
+	}
+
+	DestroyPrograms();
+	m_vertexSource = vertexSource;
+	m_fragmentSource = fragmentSource;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadSources()
+ *
+ *  This method is used for building all of the compiled
+ *  variants again after their source files were changed.
+ *  The new programs only replace the old ones when every
+ *  variant compiled and linked, so a mistake in the source
+ *  leaves the scene drawn with the previous programs.  The
+ *  variants keep their indices, so the draw order that was
+ *  built with them stays valid.
+ ***********************************************************/
+bool ShaderVariants::ReloadSources(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if ((ReadSource(vertexShaderPath, vertexSource) == false) ||
+		(ReadSource(fragmentShaderPath, fragmentSource) == false))
+	{
+		return(false);
+	}
+
+	std::string oldVertexSource = m_vertexSource;
+	std::string oldFragmentSource = m_fragmentSource;
+	std::vector<GLuint> programs;
+
+	m_vertexSource = vertexSource;
+	m_fragmentSource = fragmentSource;
+
+	for (size_t i = 0; i < m_variants.size(); i++)
+	{
+		GLuint programID = CompileProgram(m_variants[i].flags);
+		if (programID == 0)
+		{
+			for (size_t j = 0; j < programs.size(); j++)
+			{
+				glDeleteProgram(programs[j]);
+			}
+			m_vertexSource = oldVertexSource;
+			m_fragmentSource = oldFragmentSource;
+			std::cout << "Keeping the previous shader programs" << std::endl;
+			return(false);
+		}
+		programs.push_back(programID);
+	}
+
+	for (size_t i = 0; i < m_variants.size(); i++)
+	{
+		glDeleteProgram(m_variants[i].programID);
+		m_variants[i].programID = programs[i];
+	}
+
+	// the variants that failed with the old source are tried
+	// again the next time they are asked for
+	std::unordered_map<unsigned int, int>::iterator entry = m_variantLookup.begin();
+	while (entry != m_variantLookup.end())
+	{
+		if (entry->second < 0)
+		{
+			entry = m_variantLookup.erase(entry);
+		}
+		else
+		{
+			++entry;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildDefines()
+ *
+ *  This method is used for building the #define lines for
+ *  a set of variant flags.
+ ***********************************************************/
+std::string ShaderVariants::BuildDefines(unsigned int flags)
+{
+	std::string defines = std::string("#define ") + g_VariantDefine + "\n";
+
+	for (const FLAG_DEFINE& flagDefine : g_FlagDefines)
+	{
+		if ((flags & flagDefine.flag) != 0)
+		{
+			defines += std::string("#define ") + flagDefine.name + "\n";
+		}
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  InsertDefines()
+ *
+ *  This method is used for adding the #define lines after
+ *  the #version line, which has to stay first.  A #line
+ *  directive follows them, so compile errors still report
+ *  the line numbers of the source file.
+ ***********************************************************/
+std::string ShaderVariants::InsertDefines(const std::string& source, const std::string& defines)
+{
+	size_t versionStart = source.find("#version");
+	if (versionStart == std::string::npos)
+	{
+		return(defines + "#line 1\n" + source);
+	}
+
+	size_t lineEnd = source.find('\n', versionStart);
+	if (lineEnd == std::string::npos)
+	{
+		return(source + "\n" + defines);
+	}
+
+	return(source.substr(0, lineEnd + 1) + defines + "#line 2\n" + source.substr(lineEnd + 1));
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling one shader stage.  The
+ *  compile log is written out when it fails.
+ ***********************************************************/
+GLuint ShaderVariants::CompileShader(GLenum shaderType, const std::string& source)
+{
+	GLuint shaderID = glCreateShader(shaderType);
+	const char* sourceText = source.c_str();
+	GLint success = 0;
+
+	glShaderSource(shaderID, 1, &sourceText, NULL);
+	glCompileShader(shaderID);
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+
+	if (success == GL_FALSE)
+	{
+		char infoLog[1024];
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "ERROR::SHADER_VARIANTS::COMPILATION_FAILED\n" << infoLog << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	return(shaderID);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method is used for compiling and linking a program
+ *  from its shader sources.  0 is returned when it fails.
+ ***********************************************************/
+GLuint ShaderVariants::LinkProgram(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	GLuint programID = 0;
+
+	if ((vertexShader != 0) && (fragmentShader != 0))
+	{
+		GLint success = 0;
+
+		programID = glCreateProgram();
+		// the binary can only be read back with this hint set
+		m_programCache.PrepareProgram(programID);
+		glAttachShader(programID, vertexShader);
+		glAttachShader(programID, fragmentShader);
+		glLinkProgram(programID);
+		glGetProgramiv(programID, GL_LINK_STATUS, &success);
+
+		if (success == GL_FALSE)
+		{
+			char infoLog[1024];
+			glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "ERROR::SHADER_VARIANTS::LINKING_FAILED\n" << infoLog << std::endl;
+			glDeleteProgram(programID);
+			programID = 0;
+		}
+		else
+		{
+			glDetachShader(programID, vertexShader);
+			glDetachShader(programID, fragmentShader);
+		}
+	}
+
+	if (vertexShader != 0)
+	{
+		glDeleteShader(vertexShader);
+	}
+	if (fragmentShader != 0)
+	{
+		glDeleteShader(fragmentShader);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  CompileProgram()
+ *
+ *  This method is used for getting the program of a variant
+ *  and connecting it to the shared uniform buffers.  The
+ *  program is loaded from the program binary cache when it
+ *  has a binary for the same sources, defines and driver,
+ *  and is otherwise compiled and added to the cache.  The
+ *  uniform block bindings are not part of a binary, so they
+ *  are set in both cases.  0 is returned when it fails.
+ ***********************************************************/
+GLuint ShaderVariants::CompileProgram(unsigned int flags)
+{
+	std::string defines = BuildDefines(flags);
+	std::string key = m_programCache.BuildKey(m_vertexSource, m_fragmentSource, defines);
+	GLuint programID = m_programCache.LoadProgram(key);
+
+	if (programID == 0)
+	{
+		programID = LinkProgram(
+			InsertDefines(m_vertexSource, defines),
+			InsertDefines(m_fragmentSource, defines));
+		if (programID != 0)
+		{
+			m_programCache.StoreProgram(key, programID);
+		}
+	}
+
+	if ((programID != 0) && (NULL != m_pUniformBuffers))
+	{
+		m_pUniformBuffers->BindProgram(programID);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  GetVariant()
+ *
+ *  This method is used for getting the index of the variant
+ *  for a set of flags.  The variant is compiled the first
+ *  time it is asked for.  -1 is returned when the variant
+ *  could not be compiled, so the caller can fall back to
+ *  the program that selects the paths with uniforms.
+ ***********************************************************/
+int ShaderVariants::GetVariant(unsigned int flags)
+{
+	std::unordered_map<unsigned int, int>::const_iterator found = m_variantLookup.find(flags);
+	if (found != m_variantLookup.end())
+	{
+		return(found->second);
+	}
+
+	if ((m_vertexSource.empty() == true) ||
+		((int)m_variants.size() >= MAX_VARIANTS))
+	{
+		return(-1);
+	}
+
+	GLuint programID = CompileProgram(flags);
+	if (programID == 0)
+	{
+		// remember the failure so it is not compiled every time
+		m_variantLookup[flags] = -1;
+		return(-1);
+	}
+
+	SHADER_VARIANT variant;
+	variant.flags = flags;
+	variant.programID = programID;
+	m_variants.push_back(variant);
+
+	int variantIndex = (int)m_variants.size() - 1;
+	m_variantLookup[flags] = variantIndex;
+
+	return(variantIndex);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the linked program of a
+ *  variant.
+ ***********************************************************/
+GLuint ShaderVariants::GetProgram(int variantIndex) const
+{
+	if ((variantIndex < 0) || (variantIndex >= (int)m_variants.size()))
+	{
+		return(0);
+	}
+
+	return(m_variants[variantIndex].programID);
+}
+
+/***********************************************************
+ *  GetFlags()
+ *
+ *  This method is used for getting the flags that a variant
+ *  was compiled with.
+ ***********************************************************/
+unsigned int ShaderVariants::GetFlags(int variantIndex) const
+{
+	if ((variantIndex < 0) || (variantIndex >= (int)m_variants.size()))
+	{
+		return(0);
+	}
+
+	return(m_variants[variantIndex].flags);
+}
+
+/***********************************************************
+ *  GetVariantCount()
+ *
+ *  This method is used for getting the number of compiled
+ *  variants.
+ ***********************************************************/
+int ShaderVariants::GetVariantCount() const
+{
+	return((int)m_variants.size());
+}
+
+/***********************************************************
+ *  GetProgramCache()
+ *
+ *  This method is used for getting the program binary cache
+ *  the variants are saved in.
+ ***********************************************************/
+const ProgramCache& ShaderVariants::GetProgramCache() const
+{
+	return(m_programCache);
+}
+
+/***********************************************************
+ *  DestroyPrograms()
+ *
+ *  This method is used for freeing all of the compiled
+ *  programs.
+ ***********************************************************/
+void ShaderVariants::DestroyPrograms()
+{
+	for (size_t i = 0; i < m_variants.size(); i++)
+	{
+		glDeleteProgram(m_variants[i].programID);
+	}
+
+	m_variants.clear();
+	m_variantLookup.clear();
+}
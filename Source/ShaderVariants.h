@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadervariants.h
+// ============
+// compile and cache specialized variants of the scene shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ProgramCache.h"
+#include "UniformBuffers.h"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  ShaderVariants
+ *
+ *  This class compiles specialized versions of the scene
+ *  shaders.  Each variant is built from the same source
+ *  files with a set of #define flags added after the
+ *  #version line, which turns the lighting, texturing and
+ *  instancing branches into constants so the compiler can
+ *  remove the code that is not used.  Variants are compiled
+ *  the first time they are asked for and are then kept, and
+ *  each is given a small index that the draw order sorts by.
+ *  The linked programs are also saved in the program binary
+ *  cache, so later launches load them instead of compiling.
+ ***********************************************************/
+class ShaderVariants
+{
+public:
+	// constructor
+	ShaderVariants(UniformBufferManager* pUniformBuffers);
+	// destructor
+	~ShaderVariants();
+
+	// the flags that select a variant - each one adds a
+	// #define to the shader source
+	enum VARIANT_FLAGS
+	{
+		VARIANT_LIGHTING = 0x01,
+		VARIANT_TEXTURE = 0x02,
+		VARIANT_INSTANCING = 0x04,
+		VARIANT_DIRECTIONAL_LIGHT = 0x08,
+		VARIANT_POINT_LIGHTS = 0x10,
+		VARIANT_SPOT_LIGHT = 0x20,
+		VARIANT_SHADOWS = 0x40,
+		VARIANT_SHADOW_DISTANCE = 0x80,
+		VARIANT_WEIGHTED_TRANSPARENCY = 0x100,
+		VARIANT_DEPTH_ONLY = 0x200
+	};
+
+	// the largest number of variants, which fits the shader
+	// bits of the draw order sort keys
+	static const int MAX_VARIANTS = 64;
+
+private:
+	struct SHADER_VARIANT
+	{
+		unsigned int flags;
+		GLuint programID;
+	};
+
+	// pointer to the shared uniform buffers
+	UniformBufferManager* m_pUniformBuffers;
+	// the program binaries saved by earlier launches
+	ProgramCache m_programCache;
+	// the shader source code the variants are built from
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	// the compiled variants, and their indices by flags
+	std::vector<SHADER_VARIANT> m_variants;
+	std::unordered_map<unsigned int, int> m_variantLookup;
+
+	// read the contents of a text file
+	static bool ReadSource(const char* filePath, std::string& source);
+	// build the #define lines for a set of flags
+	static std::string BuildDefines(unsigned int flags);
+	// add the #define lines after the #version line
+	static std::string InsertDefines(const std::string& source, const std::string& defines);
+	// compile one shader stage
+	static GLuint CompileShader(GLenum shaderType, const std::string& source);
+	// compile and link a program from its sources
+	GLuint LinkProgram(const std::string& vertexSource, const std::string& fragmentSource);
+	// load the program of a variant from the cache, or
+	// compile it and add it to the cache
+	GLuint CompileProgram(unsigned int flags);
+
+public:
+	// load the shader source files the variants are built from
+	bool LoadSources(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// build every compiled variant again from changed source
+	// files - the variants keep their indices, and the old
+	// programs are kept when any variant fails to compile
+	bool ReloadSources(const char* vertexShaderPath, const char* fragmentShaderPath);
+
+	// get the index of the variant for a set of flags, which
+	// is compiled the first time - -1 is returned when the
+	// variant could not be compiled
+	int GetVariant(unsigned int flags);
+	// get the linked program of a variant
+	GLuint GetProgram(int variantIndex) const;
+	// get the flags a variant was compiled with
+	unsigned int GetFlags(int variantIndex) const;
+	// the number of compiled variants
+	int GetVariantCount() const;
+	// the program binary cache the variants are saved in
+	const ProgramCache& GetProgramCache() const;
+
+	// free all of the compiled programs
+	void DestroyPrograms();
+};
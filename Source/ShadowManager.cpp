@@ -0,0 +1,798 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.cpp
+// ============
+// manage the shadow maps of the directional light and the point lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowManager.h"
+#include "LightManager.h"
+#include "FrameProfiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const char* g_LightSpaceMatrixName = "lightSpaceMatrix";
+	const char* g_LightPositionName = "lightPosition";
+	const char* g_FarPlaneName = "farPlane";
+
+	// the distance behind each cascade that objects still cast
+	// shadows into it from
+	const float g_CasterMargin = 50.0f;
+	// the near plane of the point shadow cube faces
+	const float g_PointShadowNear = 0.05f;
+
+	// the view direction and up vector of each cube map face,
+	// in the order of the GL_TEXTURE_CUBE_MAP_* face targets
+	const glm::vec3 g_CubeFaceDirections[ShadowManager::CUBE_FACES] =
+	{
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 g_CubeFaceUps[ShadowManager::CUBE_FACES] =
+	{
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+
+	// an up vector that is not parallel to the light direction
+	glm::vec3 GetLightUp(const glm::vec3& lightDirection)
+	{
+		if (fabsf(lightDirection.y) > 0.99f)
+		{
+			return(glm::vec3(0.0f, 0.0f, 1.0f));
+		}
+		return(glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+}
+
+/***********************************************************
+ *  ShadowManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowManager::ShadowManager(UniformBufferManager* pUniformBuffers)
+	: m_shaderVariants(pUniformBuffers)
+{
+	m_pUniformBuffers = pUniformBuffers;
+	m_cascadeVariant = -1;
+	m_pointVariant = -1;
+	m_cascadeMatrixHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_pointMatrixHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_lightPositionHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_farPlaneHandle = ShaderUniformCache::INVALID_HANDLE;
+
+	m_settings.cascadeCount = MAX_CASCADES;
+	m_settings.cascadeResolution = 2048;
+	m_settings.shadowDistance = 60.0f;
+	m_settings.splitLambda = 0.75f;
+	m_settings.farCascadeInterval = 2;
+	m_settings.pointShadowResolution = 512;
+
+	m_cascadeTexture = 0;
+	for (int i = 0; i < MAX_CASCADES; i++)
+	{
+		m_cascades[i] = SHADOW_CASCADE();
+	}
+	for (int i = 0; i < MAX_POINT_SHADOWS; i++)
+	{
+		m_pointShadows[i] = POINT_SHADOW();
+	}
+	m_pointShadowCount = 0;
+	m_framebuffer = 0;
+
+	m_lightDirection = glm::vec3(0.0f);
+	m_frameCount = 0;
+	m_renderedPassCount = 0;
+	m_savedViewport[0] = 0;
+	m_savedViewport[1] = 0;
+	m_savedViewport[2] = 0;
+	m_savedViewport[3] = 0;
+	m_savedFramebuffer = 0;
+	m_bPassesActive = false;
+
+	CreateTextures();
+}
+
+/***********************************************************
+ *  ~ShadowManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowManager::~ShadowManager()
+{
+	DestroyTextures();
+	m_pUniformBuffers = NULL;
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for compiling the programs that the
+ *  shadow casters are drawn with.  The cascades store the
+ *  projected depth, and the point shadows store the
+ *  distance to the light.
+ ***********************************************************/
+bool ShadowManager::LoadShaders(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	if (m_shaderVariants.LoadSources(vertexShaderPath, fragmentShaderPath) == false)
+	{
+		return(false);
+	}
+
+	m_cascadeVariant = m_shaderVariants.GetVariant(
+		ShaderVariants::VARIANT_INSTANCING);
+	m_pointVariant = m_shaderVariants.GetVariant(
+		ShaderVariants::VARIANT_INSTANCING |
+		ShaderVariants::VARIANT_SHADOW_DISTANCE);
+
+	if ((m_cascadeVariant < 0) || (m_pointVariant < 0))
+	{
+		return(false);
+	}
+
+	ResolveShaderHandles();
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadShaders()
+ *
+ *  This method is used for building the shadow programs
+ *  again after their source files were changed.  When the
+ *  programs were never built, they are loaded from scratch.
+ *  The shadow maps are drawn again once the casters are
+ *  marked as moved.
+ ***********************************************************/
+bool ShadowManager::ReloadShaders(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	if ((m_cascadeVariant < 0) || (m_pointVariant < 0))
+	{
+		return(LoadShaders(vertexShaderPath, fragmentShaderPath));
+	}
+
+	if (m_shaderVariants.ReloadSources(vertexShaderPath, fragmentShaderPath) == false)
+	{
+		return(false);
+	}
+
+	ResolveShaderHandles();
+
+	return(true);
+}
+
+/***********************************************************
+ *  ResolveShaderHandles()
+ *
+ *  This method is used for looking up the uniforms of the
+ *  programs the shadow casters are drawn with.
+ ***********************************************************/
+void ShadowManager::ResolveShaderHandles()
+{
+	m_cascadeUniforms.SetProgram(m_shaderVariants.GetProgram(m_cascadeVariant));
+	m_cascadeMatrixHandle = m_cascadeUniforms.GetHandle(g_LightSpaceMatrixName);
+
+	m_pointUniforms.SetProgram(m_shaderVariants.GetProgram(m_pointVariant));
+	m_pointMatrixHandle = m_pointUniforms.GetHandle(g_LightSpaceMatrixName);
+	m_lightPositionHandle = m_pointUniforms.GetHandle(g_LightPositionName);
+	m_farPlaneHandle = m_pointUniforms.GetHandle(g_FarPlaneName);
+}
+
+/***********************************************************
+ *  CreateTextures()
+ *
+ *  This method is used for creating the shadow maps for the
+ *  current settings.  The maps compare a depth against the
+ *  stored one when they are sampled, and linear filtering
+ *  blends four of those comparisons, which softens the
+ *  shadow edges for free on most hardware.  Outside of the
+ *  cascade maps the border reads as fully lit.
+ ***********************************************************/
+void ShadowManager::CreateTextures()
+{
+	DestroyTextures();
+
+	float borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	glGenTextures(1, &m_cascadeTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_cascadeTexture);
+	glTexImage3D(
+		GL_TEXTURE_2D_ARRAY,
+		0,
+		GL_DEPTH_COMPONENT24,
+		m_settings.cascadeResolution,
+		m_settings.cascadeResolution,
+		m_settings.cascadeCount,
+		0,
+		GL_DEPTH_COMPONENT,
+		GL_FLOAT,
+		NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	for (int i = 0; i < m_pointShadowCount; i++)
+	{
+		m_pointShadows[i].textureID = CreateCubeTexture(m_settings.pointShadowResolution);
+		m_pointShadows[i].bDirty = true;
+	}
+
+	// only depth is written, so the framebuffer has no color
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	for (int i = 0; i < MAX_CASCADES; i++)
+	{
+		m_cascades[i].bDirty = true;
+		m_cascades[i].bValid = false;
+	}
+}
+
+/***********************************************************
+ *  CreateCubeTexture()
+ *
+ *  This method is used for creating a depth cube map for a
+ *  point shadow.
+ ***********************************************************/
+GLuint ShadowManager::CreateCubeTexture(int resolution)
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	for (int face = 0; face < CUBE_FACES; face++)
+	{
+		glTexImage2D(
+			GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+			0,
+			GL_DEPTH_COMPONENT24,
+			resolution,
+			resolution,
+			0,
+			GL_DEPTH_COMPONENT,
+			GL_FLOAT,
+			NULL);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	return(textureID);
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing the shadow maps and the
+ *  framebuffer they are rendered with.
+ ***********************************************************/
+void ShadowManager::DestroyTextures()
+{
+	if (m_cascadeTexture != 0)
+	{
+		glDeleteTextures(1, &m_cascadeTexture);
+		m_cascadeTexture = 0;
+	}
+	for (int i = 0; i < MAX_POINT_SHADOWS; i++)
+	{
+		if (m_pointShadows[i].textureID != 0)
+		{
+			glDeleteTextures(1, &m_pointShadows[i].textureID);
+			m_pointShadows[i].textureID = 0;
+		}
+	}
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  SetSettings()
+ *
+ *  This method is used for changing the shadow settings.
+ *  The cascade count is kept within the shadow block, and
+ *  the shadow maps are created again for the new sizes.
+ ***********************************************************/
+void ShadowManager::SetSettings(const SHADOW_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_settings.cascadeCount = glm::clamp(m_settings.cascadeCount, 1, (int)MAX_CASCADES);
+	m_settings.cascadeResolution = glm::max(m_settings.cascadeResolution, 16);
+	m_settings.pointShadowResolution = glm::max(m_settings.pointShadowResolution, 16);
+	m_settings.farCascadeInterval = glm::max(m_settings.farCascadeInterval, 1);
+	m_settings.splitLambda = glm::clamp(m_settings.splitLambda, 0.0f, 1.0f);
+
+	CreateTextures();
+}
+
+/***********************************************************
+ *  GetSettings()
+ *
+ *  This method is used for getting the shadow settings.
+ ***********************************************************/
+const ShadowManager::SHADOW_SETTINGS& ShadowManager::GetSettings() const
+{
+	return(m_settings);
+}
+
+/***********************************************************
+ *  SetPointShadowCount()
+ *
+ *  This method is used for setting the number of point
+ *  shadows in use.  The cube maps are created the first
+ *  time a shadow is used.
+ ***********************************************************/
+void ShadowManager::SetPointShadowCount(int shadowCount)
+{
+	shadowCount = glm::clamp(shadowCount, 0, (int)MAX_POINT_SHADOWS);
+
+	for (int i = m_pointShadowCount; i < shadowCount; i++)
+	{
+		if (m_pointShadows[i].textureID == 0)
+		{
+			m_pointShadows[i].textureID = CreateCubeTexture(m_settings.pointShadowResolution);
+		}
+		m_pointShadows[i].bDirty = true;
+	}
+
+	m_pointShadowCount = shadowCount;
+}
+
+/***********************************************************
+ *  GetPointShadowCount()
+ *
+ *  This method is used for getting the number of point
+ *  shadows in use.
+ ***********************************************************/
+int ShadowManager::GetPointShadowCount() const
+{
+	return(m_pointShadowCount);
+}
+
+/***********************************************************
+ *  SetPointShadow()
+ *
+ *  This method is used for setting the light position and
+ *  the range of a point shadow.  The cube map is only
+ *  rendered again when either of them changed.
+ ***********************************************************/
+void ShadowManager::SetPointShadow(int shadowIndex, glm::vec3 position, float farPlane)
+{
+	if ((shadowIndex < 0) || (shadowIndex >= m_pointShadowCount))
+	{
+		return;
+	}
+
+	POINT_SHADOW& pointShadow = m_pointShadows[shadowIndex];
+
+	if ((pointShadow.position != position) || (pointShadow.farPlane != farPlane))
+	{
+		pointShadow.position = position;
+		pointShadow.farPlane = farPlane;
+		pointShadow.bDirty = true;
+	}
+}
+
+/***********************************************************
+ *  GetPointShadow()
+ *
+ *  This method is used for getting the light position and
+ *  the range of a point shadow that is in use.
+ ***********************************************************/
+bool ShadowManager::GetPointShadow(int shadowIndex, glm::vec3& position, float& farPlane) const
+{
+	if ((shadowIndex < 0) || (shadowIndex >= m_pointShadowCount))
+	{
+		return(false);
+	}
+
+	position = m_pointShadows[shadowIndex].position;
+	farPlane = m_pointShadows[shadowIndex].farPlane;
+	return(true);
+}
+
+/***********************************************************
+ *  MarkPointShadowDirty()
+ *
+ *  This method is used for rendering a point shadow again
+ *  on the next frame.  The caller finds the point shadows
+ *  whose casters moved, so objects that move outside of the
+ *  range of a light do not render its cube map again.
+ ***********************************************************/
+void ShadowManager::MarkPointShadowDirty(int shadowIndex)
+{
+	if ((shadowIndex < 0) || (shadowIndex >= m_pointShadowCount))
+	{
+		return;
+	}
+
+	m_pointShadows[shadowIndex].bDirty = true;
+}
+
+/***********************************************************
+ *  FitCascade()
+ *
+ *  This method is used for building the light space matrix
+ *  of a cascade.  The corners of the slice of the view
+ *  frustum are found along the edges of the frustum, and a
+ *  sphere around them is rendered from the light.  The
+ *  sphere keeps the same size as the camera turns, and its
+ *  center is moved in whole texels of the map, so the map
+ *  does not shimmer and stays exactly the same until the
+ *  camera moves by at least one texel.
+ ***********************************************************/
+glm::mat4 ShadowManager::FitCascade(
+	const glm::mat4& inverseViewProjection,
+	float zNear,
+	float zFar,
+	float sliceNear,
+	float sliceFar) const
+{
+	glm::vec3 corners[8];
+	glm::vec3 center(0.0f);
+	float nearBlend = (sliceNear - zNear) / (zFar - zNear);
+	float farBlend = (sliceFar - zNear) / (zFar - zNear);
+	int cornerIndex = 0;
+
+	for (int x = -1; x <= 1; x += 2)
+	{
+		for (int y = -1; y <= 1; y += 2)
+		{
+			glm::vec4 nearCorner = inverseViewProjection * glm::vec4((float)x, (float)y, -1.0f, 1.0f);
+			glm::vec4 farCorner = inverseViewProjection * glm::vec4((float)x, (float)y, 1.0f, 1.0f);
+			glm::vec3 nearPoint = glm::vec3(nearCorner) / nearCorner.w;
+			glm::vec3 farPoint = glm::vec3(farCorner) / farCorner.w;
+
+			corners[cornerIndex++] = nearPoint + (farPoint - nearPoint) * nearBlend;
+			corners[cornerIndex++] = nearPoint + (farPoint - nearPoint) * farBlend;
+		}
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		center += corners[i];
+	}
+	center /= 8.0f;
+
+	float radius = 0.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		radius = glm::max(radius, glm::length(corners[i] - center));
+	}
+	// round the radius up so small changes keep the same size
+	radius = ceilf(radius * 16.0f) / 16.0f;
+
+	// move the center in whole texels of the light's view
+	glm::vec3 lightUp = GetLightUp(m_lightDirection);
+	glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), m_lightDirection, lightUp);
+	float texelSize = (radius * 2.0f) / (float)m_settings.cascadeResolution;
+	glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+
+	lightCenter = glm::floor(lightCenter / texelSize) * texelSize;
+	center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightCenter, 1.0f));
+
+	glm::vec3 eye = center - m_lightDirection * (radius + g_CasterMargin);
+	glm::mat4 lightView = glm::lookAt(eye, center, lightUp);
+	glm::mat4 lightProjection = glm::ortho(
+		-radius, radius,
+		-radius, radius,
+		0.0f, radius * 2.0f + g_CasterMargin);
+
+	return(lightProjection * lightView);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for fitting the cascades to the
+ *  current view and deciding which shadow maps are rendered
+ *  this frame.  A cascade is rendered when the objects or
+ *  the light moved, or when it moved by a texel.  The
+ *  first cascade is rendered whenever it is needed, and the
+ *  farther cascades, whose texels cover more of the scene,
+ *  are spread over the update interval.  A cascade that is
+ *  not rendered keeps the matrix its map was rendered with.
+ *  The point shadows are left to MarkPointShadowDirty().
+ ***********************************************************/
+void ShadowManager::BeginFrame(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3 lightDirection,
+	bool bCastersMoved)
+{
+	float zNear = 0.0f;
+	float zFar = 0.0f;
+	float shadowFar = 0.0f;
+	bool bLightChanged = false;
+
+	m_frameCount++;
+	m_renderedPassCount = 0;
+
+	lightDirection = glm::normalize(lightDirection);
+	if (lightDirection != m_lightDirection)
+	{
+		m_lightDirection = lightDirection;
+		bLightChanged = true;
+	}
+
+	LightManager::GetDepthRange(projection, zNear, zFar);
+	zNear = glm::max(zNear, 0.01f);
+	shadowFar = glm::clamp(m_settings.shadowDistance, zNear * 2.0f, zFar);
+
+	glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+	float sliceNear = zNear;
+
+	for (int i = 0; i < m_settings.cascadeCount; i++)
+	{
+		SHADOW_CASCADE& cascade = m_cascades[i];
+
+		// the practical split scheme blends logarithmic splits,
+		// which match the perspective, with even ones, which
+		// keep the near cascades from getting too thin
+		float fraction = (float)(i + 1) / (float)m_settings.cascadeCount;
+		float logSplit = zNear * powf(shadowFar / zNear, fraction);
+		float evenSplit = zNear + (shadowFar - zNear) * fraction;
+		float sliceFar = m_settings.splitLambda * logSplit + (1.0f - m_settings.splitLambda) * evenSplit;
+
+		cascade.fittedMatrix = FitCascade(inverseViewProjection, zNear, zFar, sliceNear, sliceFar);
+		cascade.splitDistance = sliceFar;
+		sliceNear = sliceFar;
+
+		if ((bCastersMoved == true) ||
+			(bLightChanged == true) ||
+			(cascade.fittedMatrix != cascade.renderedMatrix))
+		{
+			cascade.bDirty = true;
+		}
+
+		cascade.bRender = false;
+		if (cascade.bDirty == true)
+		{
+			cascade.bRender =
+				(i == 0) ||
+				(cascade.bValid == false) ||
+				(((m_frameCount + i) % (unsigned int)m_settings.farCascadeInterval) == 0);
+		}
+	}
+
+	UpdateShadowBlock();
+}
+
+/***********************************************************
+ *  UpdateShadowBlock()
+ *
+ *  This method is used for passing the light space matrices
+ *  of the maps into the shadow block.  Each cascade uses
+ *  the matrix that its map holds at the end of this frame.
+ ***********************************************************/
+void ShadowManager::UpdateShadowBlock()
+{
+	if (NULL == m_pUniformBuffers)
+	{
+		return;
+	}
+
+	UniformBufferManager::SHADOW_BLOCK shadows = UniformBufferManager::SHADOW_BLOCK();
+	float splits[MAX_CASCADES] = { 0.0f };
+
+	for (int i = 0; i < m_settings.cascadeCount; i++)
+	{
+		const SHADOW_CASCADE& cascade = m_cascades[i];
+
+		shadows.cascadeMatrices[i] = (cascade.bRender == true) ? cascade.fittedMatrix : cascade.renderedMatrix;
+		splits[i] = cascade.splitDistance;
+	}
+	shadows.cascadeSplits = glm::vec4(splits[0], splits[1], splits[2], splits[3]);
+
+	for (int i = 0; i < m_pointShadowCount; i++)
+	{
+		shadows.pointShadows[i] = glm::vec4(m_pointShadows[i].position, m_pointShadows[i].farPlane);
+	}
+
+	shadows.cascadeCount = m_settings.cascadeCount;
+	shadows.pointShadowCount = m_pointShadowCount;
+
+	m_pUniformBuffers->SetShadows(shadows);
+}
+
+/***********************************************************
+ *  GetPassCount()
+ *
+ *  This method is used for getting the number of shadow
+ *  passes - one for each cascade and one for each face of
+ *  each point shadow.
+ ***********************************************************/
+int ShadowManager::GetPassCount() const
+{
+	return(m_settings.cascadeCount + m_pointShadowCount * CUBE_FACES);
+}
+
+/***********************************************************
+ *  BeginPasses()
+ *
+ *  This method is used for saving the viewport and the
+ *  framebuffer before the first rendered shadow pass.  The
+ *  depth of the shadow casters is pushed away from the
+ *  light a little, so surfaces do not shadow themselves.
+ ***********************************************************/
+void ShadowManager::BeginPasses()
+{
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	m_bPassesActive = true;
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for setting up a shadow pass.  The
+ *  map of the pass is attached to the framebuffer and
+ *  cleared, and the shadow program is set up with the view
+ *  of the pass.  Passes whose maps are still valid return
+ *  false, and nothing should be drawn for them.
+ ***********************************************************/
+bool ShadowManager::BeginPass(int passIndex)
+{
+	if ((passIndex < 0) || (passIndex >= GetPassCount()))
+	{
+		return(false);
+	}
+
+	if (passIndex < m_settings.cascadeCount)
+	{
+		SHADOW_CASCADE& cascade = m_cascades[passIndex];
+
+		if ((cascade.bRender == false) || (m_cascadeVariant < 0))
+		{
+			return(false);
+		}
+
+		if (m_bPassesActive == false)
+		{
+			BeginPasses();
+		}
+
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_cascadeTexture, 0, passIndex);
+		glViewport(0, 0, m_settings.cascadeResolution, m_settings.cascadeResolution);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		glUseProgram(m_shaderVariants.GetProgram(m_cascadeVariant));
+		m_cascadeUniforms.SetMat4(m_cascadeMatrixHandle, cascade.fittedMatrix);
+
+		cascade.renderedMatrix = cascade.fittedMatrix;
+		cascade.bDirty = false;
+		cascade.bValid = true;
+	}
+	else
+	{
+		int shadowIndex = (passIndex - m_settings.cascadeCount) / CUBE_FACES;
+		int face = (passIndex - m_settings.cascadeCount) % CUBE_FACES;
+		POINT_SHADOW& pointShadow = m_pointShadows[shadowIndex];
+
+		if ((pointShadow.bDirty == false) || (m_pointVariant < 0))
+		{
+			return(false);
+		}
+
+		if (m_bPassesActive == false)
+		{
+			BeginPasses();
+		}
+
+		glFramebufferTexture2D(
+			GL_FRAMEBUFFER,
+			GL_DEPTH_ATTACHMENT,
+			GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+			pointShadow.textureID,
+			0);
+		glViewport(0, 0, m_settings.pointShadowResolution, m_settings.pointShadowResolution);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		glm::mat4 faceProjection = glm::perspective(
+			glm::radians(90.0f),
+			1.0f,
+			g_PointShadowNear,
+			pointShadow.farPlane);
+		glm::mat4 faceView = glm::lookAt(
+			pointShadow.position,
+			pointShadow.position + g_CubeFaceDirections[face],
+			g_CubeFaceUps[face]);
+
+		glUseProgram(m_shaderVariants.GetProgram(m_pointVariant));
+		m_pointUniforms.SetMat4(m_pointMatrixHandle, faceProjection * faceView);
+		m_pointUniforms.SetVec3(m_lightPositionHandle, pointShadow.position);
+		m_pointUniforms.SetFloat(m_farPlaneHandle, pointShadow.farPlane);
+
+		// the cube map is complete after its last face
+		if (face == CUBE_FACES - 1)
+		{
+			pointShadow.bDirty = false;
+		}
+	}
+
+	m_renderedPassCount++;
+	return(true);
+}
+
+/***********************************************************
+ *  EndPasses()
+ *
+ *  This method is used for going back to the viewport and
+ *  the framebuffer that were in use before the passes.
+ ***********************************************************/
+void ShadowManager::EndPasses()
+{
+	if (m_bPassesActive == false)
+	{
+		return;
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)m_savedFramebuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+
+	m_bPassesActive = false;
+}
+
+/***********************************************************
+ *  BindTextures()
+ *
+ *  This method is used for binding the shadow maps to their
+ *  texture units.
+ ***********************************************************/
+void ShadowManager::BindTextures()
+{
+	glActiveTexture(GL_TEXTURE0 + CASCADE_SHADOW_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_cascadeTexture);
+	for (int i = 0; i < MAX_POINT_SHADOWS; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + POINT_SHADOW_UNIT + i);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, m_pointShadows[i].textureID);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_TEXTURE_BINDS, 1 + MAX_POINT_SHADOWS);
+}
+
+/***********************************************************
+ *  GetRenderedPassCount()
+ *
+ *  This method is used for getting the number of shadow
+ *  passes that were rendered on the last frame, which is 0
+ *  while nothing in the scene moves.
+ ***********************************************************/
+int ShadowManager::GetRenderedPassCount() const
+{
+	return(m_renderedPassCount);
+}
@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmanager.h
+// ============
+// manage the shadow maps of the directional light and the point lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderVariants.h"
+#include "UniformBuffers.h"
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ShadowManager
+ *
+ *  This class renders the depth maps that the scene shader
+ *  reads to find which fragments are hidden from the lights.
+ *  The view frustum is split into cascades by distance, and
+ *  each cascade gets its own layer of a depth texture array
+ *  rendered from the directional light, so the shadows near
+ *  the camera get most of the resolution.  Point lights get
+ *  a depth cube map each.
+ *
+ *  A shadow map is kept until the objects that cast shadows
+ *  move, the light changes, or the cascade it covers moves
+ *  by at least one of its texels, so a still scene renders
+ *  no shadow passes at all.  The passes are handed out one
+ *  at a time, and the caller draws the shadow casters into
+ *  each pass that needs to be rendered.
+ ***********************************************************/
+class ShadowManager
+{
+public:
+	// constructor
+	ShadowManager(UniformBufferManager* pUniformBuffers);
+	// destructor
+	~ShadowManager();
+
+	// the texture units the shadow maps are bound to, after
+	// the units used by the light buffers
+	static const int CASCADE_SHADOW_UNIT = 11;
+	static const int POINT_SHADOW_UNIT = 12;
+
+	// the largest number of cascades and point shadow maps,
+	// which must match the shadow block of the shader
+	static const int MAX_CASCADES = UniformBufferManager::MAX_SHADOW_CASCADES;
+	static const int MAX_POINT_SHADOWS = UniformBufferManager::MAX_POINT_SHADOWS;
+
+	// the number of faces that are rendered for a point shadow
+	static const int CUBE_FACES = 6;
+
+	// the settings that trade shadow quality for speed
+	struct SHADOW_SETTINGS
+	{
+		// the number of cascades the view is split into
+		int cascadeCount;
+		// the width and height of each cascade map
+		int cascadeResolution;
+		// the view distance the cascades reach to
+		float shadowDistance;
+		// the blend between even (0) and logarithmic (1)
+		// cascade splits
+		float splitLambda;
+		// the cascades after the first one are rendered at most
+		// once every this many frames
+		int farCascadeInterval;
+		// the width and height of each point shadow cube face
+		int pointShadowResolution;
+	};
+
+private:
+	// one cascade of the directional light shadow
+	struct SHADOW_CASCADE
+	{
+		// the light space matrix the map was rendered with
+		glm::mat4 renderedMatrix;
+		// the light space matrix that fits the cascade this frame
+		glm::mat4 fittedMatrix;
+		// the view distance the cascade reaches to
+		float splitDistance;
+		// set when the map needs to be rendered again
+		bool bDirty;
+		// set when the map is rendered this frame
+		bool bRender;
+		// set once the map has been rendered
+		bool bValid;
+	};
+
+	// a point light shadow cube map
+	struct POINT_SHADOW
+	{
+		GLuint textureID;
+		glm::vec3 position;
+		float farPlane;
+		bool bDirty;
+	};
+
+	// pointer to the shared uniform buffers
+	UniformBufferManager* m_pUniformBuffers;
+	// the programs the shadow casters are drawn with
+	ShaderVariants m_shaderVariants;
+	int m_cascadeVariant;
+	int m_pointVariant;
+	ShaderUniformCache m_cascadeUniforms;
+	ShaderUniformCache m_pointUniforms;
+	int m_cascadeMatrixHandle;
+	int m_pointMatrixHandle;
+	int m_lightPositionHandle;
+	int m_farPlaneHandle;
+
+	SHADOW_SETTINGS m_settings;
+	// the cascade depth texture array and its cascades
+	GLuint m_cascadeTexture;
+	SHADOW_CASCADE m_cascades[MAX_CASCADES];
+	// the point shadow cube maps
+	POINT_SHADOW m_pointShadows[MAX_POINT_SHADOWS];
+	int m_pointShadowCount;
+	// the framebuffer the shadow maps are attached to
+	GLuint m_framebuffer;
+
+	// the light direction the cascades were fitted for
+	glm::vec3 m_lightDirection;
+	// the number of frames that were started
+	unsigned int m_frameCount;
+	// the number of shadow passes rendered last frame
+	int m_renderedPassCount;
+
+	// the viewport and framebuffer that are restored after
+	// the shadow passes
+	GLint m_savedViewport[4];
+	GLint m_savedFramebuffer;
+	bool m_bPassesActive;
+
+	// create the shadow textures for the current settings
+	void CreateTextures();
+	// create a depth cube map
+	GLuint CreateCubeTexture(int resolution);
+	// fit the light space matrix of a cascade around a slice
+	// of the view frustum
+	glm::mat4 FitCascade(
+		const glm::mat4& inverseViewProjection,
+		float zNear,
+		float zFar,
+		float sliceNear,
+		float sliceFar) const;
+	// pass the light space matrices into the shadow block
+	void UpdateShadowBlock();
+	// start the first shadow pass
+	void BeginPasses();
+	// look up the uniforms of the shadow programs
+	void ResolveShaderHandles();
+
+public:
+	// load the shaders the shadow casters are drawn with
+	bool LoadShaders(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// build the shadow programs again from changed source
+	// files, keeping the old ones when they do not compile
+	bool ReloadShaders(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// free the shadow maps and the framebuffer
+	void DestroyTextures();
+
+	// change the shadow settings - the shadow maps are
+	// created again and rendered on the next frame
+	void SetSettings(const SHADOW_SETTINGS& settings);
+	const SHADOW_SETTINGS& GetSettings() const;
+
+	// set the position and range of a point shadow, which
+	// are rendered again only when they change
+	void SetPointShadow(int shadowIndex, glm::vec3 position, float farPlane);
+	// set the number of point shadows in use, or 0 for none
+	void SetPointShadowCount(int shadowCount);
+	int GetPointShadowCount() const;
+	// get the position and range of a point shadow - false is
+	// returned for a shadow that is not in use
+	bool GetPointShadow(int shadowIndex, glm::vec3& position, float& farPlane) const;
+	// render a point shadow again on the next frame, such as
+	// when a shadow caster in its range moved
+	void MarkPointShadowDirty(int shadowIndex);
+
+	// fit the cascades to the current view and find the
+	// cascades that need to be rendered this frame - the point
+	// shadows are only rendered when they were marked dirty
+	void BeginFrame(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3 lightDirection,
+		bool bCastersMoved);
+	// the number of shadow passes, some of which may not need
+	// to be rendered this frame
+	int GetPassCount() const;
+	// set up a shadow pass for drawing the shadow casters -
+	// false is returned when the pass is not rendered this
+	// frame and nothing should be drawn
+	bool BeginPass(int passIndex);
+	// restore the viewport and framebuffer after the passes
+	void EndPasses();
+
+	// bind the shadow maps to their texture units
+	void BindTextures();
+	// the number of passes rendered on the last frame
+	int GetRenderedPassCount() const;
+};
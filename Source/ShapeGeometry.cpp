@@ -0,0 +1,443 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.cpp
+// ============
+// generate the vertex and index data for the basic 3D shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeGeometry.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	// the segments of each tessellation level - the first
+	// level matches the default arguments of the builders
+	const int g_LevelSides[ShapeGeometry::LOD_COUNT] = { 36, 16, 8 };
+	const int g_LevelSphereStacks[ShapeGeometry::LOD_COUNT] = { 30, 16, 8 };
+	const int g_LevelSphereSlices[ShapeGeometry::LOD_COUNT] = { 30, 16, 8 };
+	const int g_LevelTorusMainSegments[ShapeGeometry::LOD_COUNT] = { 30, 16, 8 };
+	const int g_LevelTorusTubeSegments[ShapeGeometry::LOD_COUNT] = { 30, 12, 6 };
+
+	// add a single vertex to the mesh data
+	void AddVertex(
+		ShapeGeometry::MESH_DATA& data,
+		glm::vec3 position,
+		glm::vec3 normal,
+		glm::vec2 textureCoordinate)
+	{
+		ShapeGeometry::SHAPE_VERTEX vertex;
+
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.textureCoordinate = textureCoordinate;
+		data.vertices.push_back(vertex);
+	}
+
+	// add two triangles for the quad made by the four indices
+	void AddQuad(
+		ShapeGeometry::MESH_DATA& data,
+		uint32_t a,
+		uint32_t b,
+		uint32_t c,
+		uint32_t d)
+	{
+		data.indices.push_back(a);
+		data.indices.push_back(b);
+		data.indices.push_back(c);
+		data.indices.push_back(a);
+		data.indices.push_back(c);
+		data.indices.push_back(d);
+	}
+}
+
+/***********************************************************
+ *  BuildMesh()
+ *
+ *  This method is used for building the default tessellation
+ *  of the passed in basic shape.
+ ***********************************************************/
+void ShapeGeometry::BuildMesh(MESH_TYPE mesh, MESH_DATA& data)
+{
+	BuildMesh(mesh, 0, data);
+}
+
+/***********************************************************
+ *  BuildMesh()
+ *
+ *  This method is used for building one of the tessellation
+ *  levels of the passed in basic shape.  The flat shapes
+ *  are the same at every level.
+ ***********************************************************/
+void ShapeGeometry::BuildMesh(MESH_TYPE mesh, int level, MESH_DATA& data)
+{
+	if (level < 0)
+	{
+		level = 0;
+	}
+	if (level >= LOD_COUNT)
+	{
+		level = LOD_COUNT - 1;
+	}
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		BuildPlane(data);
+		break;
+	case MESH_BOX:
+		BuildBox(data);
+		break;
+	case MESH_CYLINDER:
+		BuildCylinder(data, g_LevelSides[level]);
+		break;
+	case MESH_TAPERED_CYLINDER:
+		BuildTaperedCylinder(data, g_LevelSides[level]);
+		break;
+	case MESH_CONE:
+		BuildCone(data, g_LevelSides[level]);
+		break;
+	case MESH_SPHERE:
+		BuildSphere(data, g_LevelSphereStacks[level], g_LevelSphereSlices[level]);
+		break;
+	case MESH_TORUS:
+		BuildTorus(data, g_LevelTorusMainSegments[level], g_LevelTorusTubeSegments[level]);
+		break;
+	default:
+		data.vertices.clear();
+		data.indices.clear();
+		CalculateBounds(data);
+		break;
+	}
+}
+
+/***********************************************************
+ *  GetLevelCount()
+ *
+ *  This method is used for getting the number of
+ *  tessellation levels of a basic shape.
+ ***********************************************************/
+int ShapeGeometry::GetLevelCount(MESH_TYPE mesh)
+{
+	if ((mesh == MESH_PLANE) || (mesh == MESH_BOX))
+	{
+		return(1);
+	}
+	return(LOD_COUNT);
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for building a flat plane that faces
+ *  up along the Y axis.
+ ***********************************************************/
+void ShapeGeometry::BuildPlane(MESH_DATA& data)
+{
+	data.vertices.clear();
+	data.indices.clear();
+
+	glm::vec3 normal(0.0f, 1.0f, 0.0f);
+	AddVertex(data, glm::vec3(-1.0f, 0.0f, 1.0f), normal, glm::vec2(0.0f, 0.0f));
+	AddVertex(data, glm::vec3(1.0f, 0.0f, 1.0f), normal, glm::vec2(1.0f, 0.0f));
+	AddVertex(data, glm::vec3(1.0f, 0.0f, -1.0f), normal, glm::vec2(1.0f, 1.0f));
+	AddVertex(data, glm::vec3(-1.0f, 0.0f, -1.0f), normal, glm::vec2(0.0f, 1.0f));
+	AddQuad(data, 0, 1, 2, 3);
+
+	CalculateBounds(data);
+}
+
+/***********************************************************
+ *  BuildBox()
+ *
+ *  This method is used for building a unit box with its own
+ *  normals and texture coordinates for each of the six faces.
+ ***********************************************************/
+void ShapeGeometry::BuildBox(MESH_DATA& data)
+{
+	data.vertices.clear();
+	data.indices.clear();
+
+	// the normal, tangent and bitangent of each face
+	const glm::vec3 faces[6][3] =
+	{
+		{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+		{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) }
+	};
+
+	for (int face = 0; face < 6; face++)
+	{
+		glm::vec3 normal = faces[face][0];
+		glm::vec3 tangent = faces[face][1];
+		glm::vec3 bitangent = faces[face][2];
+		uint32_t first = (uint32_t)data.vertices.size();
+
+		AddVertex(data, (normal - tangent - bitangent) * 0.5f, normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(data, (normal + tangent - bitangent) * 0.5f, normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(data, (normal + tangent + bitangent) * 0.5f, normal, glm::vec2(1.0f, 1.0f));
+		AddVertex(data, (normal - tangent + bitangent) * 0.5f, normal, glm::vec2(0.0f, 1.0f));
+		AddQuad(data, first, first + 1, first + 2, first + 3);
+	}
+
+	CalculateBounds(data);
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for building a capped cylinder.
+ ***********************************************************/
+void ShapeGeometry::BuildCylinder(MESH_DATA& data, int sides)
+{
+	BuildFrustum(data, sides, 1.0f, 1.0f);
+}
+
+/***********************************************************
+ *  BuildTaperedCylinder()
+ *
+ *  This method is used for building a capped cylinder whose
+ *  top is half the size of its base.
+ ***********************************************************/
+void ShapeGeometry::BuildTaperedCylinder(MESH_DATA& data, int sides)
+{
+	BuildFrustum(data, sides, 1.0f, 0.5f);
+}
+
+/***********************************************************
+ *  BuildCone()
+ *
+ *  This method is used for building a cone with a capped base.
+ ***********************************************************/
+void ShapeGeometry::BuildCone(MESH_DATA& data, int sides)
+{
+	BuildFrustum(data, sides, 1.0f, 0.0f);
+}
+
+/***********************************************************
+ *  BuildFrustum()
+ *
+ *  This method is used for building a cylinder with separate
+ *  bottom and top radius values.  A top radius of zero makes
+ *  a cone, in which case no top cap is generated.
+ ***********************************************************/
+void ShapeGeometry::BuildFrustum(
+	MESH_DATA& data,
+	int sides,
+	float bottomRadius,
+	float topRadius)
+{
+	data.vertices.clear();
+	data.indices.clear();
+
+	if (sides < 3)
+	{
+		sides = 3;
+	}
+
+	// the side normals lean outward by the slope of the sides
+	float slope = bottomRadius - topRadius;
+
+	// side vertices - the first column is repeated at the end
+	// so the texture wraps around the shape without a seam
+	for (int i = 0; i <= sides; i++)
+	{
+		float u = (float)i / (float)sides;
+		float angle = u * 2.0f * g_Pi;
+		float c = std::cos(angle);
+		float s = std::sin(angle);
+		glm::vec3 normal = glm::normalize(glm::vec3(c, slope, s));
+
+		AddVertex(data, glm::vec3(c * bottomRadius, 0.0f, s * bottomRadius), normal, glm::vec2(u, 0.0f));
+		AddVertex(data, glm::vec3(c * topRadius, 1.0f, s * topRadius), normal, glm::vec2(u, 1.0f));
+	}
+	for (int i = 0; i < sides; i++)
+	{
+		uint32_t bottom = (uint32_t)(i * 2);
+		AddQuad(data, bottom, bottom + 1, bottom + 3, bottom + 2);
+	}
+
+	// bottom cap, and a top cap when the top is not a point
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float radius = (cap == 0) ? bottomRadius : topRadius;
+		float height = (cap == 0) ? 0.0f : 1.0f;
+		glm::vec3 normal(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+
+		if (radius <= 0.0f)
+		{
+			continue;
+		}
+
+		uint32_t center = (uint32_t)data.vertices.size();
+		AddVertex(data, glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+		for (int i = 0; i <= sides; i++)
+		{
+			float angle = ((float)i / (float)sides) * 2.0f * g_Pi;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			AddVertex(
+				data,
+				glm::vec3(c * radius, height, s * radius),
+				normal,
+				glm::vec2(0.5f + 0.5f * c, 0.5f + 0.5f * s));
+		}
+		for (int i = 0; i < sides; i++)
+		{
+			uint32_t edge = center + 1 + (uint32_t)i;
+			data.indices.push_back(center);
+			if (cap == 0)
+			{
+				data.indices.push_back(edge);
+				data.indices.push_back(edge + 1);
+			}
+			else
+			{
+				data.indices.push_back(edge + 1);
+				data.indices.push_back(edge);
+			}
+		}
+	}
+
+	CalculateBounds(data);
+}
+
+/***********************************************************
+ *  BuildSphere()
+ *
+ *  This method is used for building a sphere from rings of
+ *  latitude and longitude.
+ ***********************************************************/
+void ShapeGeometry::BuildSphere(MESH_DATA& data, int stacks, int slices)
+{
+	data.vertices.clear();
+	data.indices.clear();
+
+	if (stacks < 2)
+	{
+		stacks = 2;
+	}
+	if (slices < 3)
+	{
+		slices = 3;
+	}
+
+	for (int i = 0; i <= stacks; i++)
+	{
+		float v = (float)i / (float)stacks;
+		float phi = v * g_Pi;
+		for (int j = 0; j <= slices; j++)
+		{
+			float u = (float)j / (float)slices;
+			float theta = u * 2.0f * g_Pi;
+			glm::vec3 normal(
+				std::sin(phi) * std::cos(theta),
+				std::cos(phi),
+				std::sin(phi) * std::sin(theta));
+
+			AddVertex(data, normal, normal, glm::vec2(u, 1.0f - v));
+		}
+	}
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < slices; j++)
+		{
+			uint32_t first = (uint32_t)(i * (slices + 1) + j);
+			uint32_t second = first + (uint32_t)(slices + 1);
+			AddQuad(data, first, first + 1, second + 1, second);
+		}
+	}
+
+	CalculateBounds(data);
+}
+
+/***********************************************************
+ *  BuildTorus()
+ *
+ *  This method is used for building a torus that lies in
+ *  the XY plane.
+ ***********************************************************/
+void ShapeGeometry::BuildTorus(
+	MESH_DATA& data,
+	int mainSegments,
+	int tubeSegments,
+	float mainRadius,
+	float tubeRadius)
+{
+	data.vertices.clear();
+	data.indices.clear();
+
+	if (mainSegments < 3)
+	{
+		mainSegments = 3;
+	}
+	if (tubeSegments < 3)
+	{
+		tubeSegments = 3;
+	}
+
+	for (int i = 0; i <= mainSegments; i++)
+	{
+		float u = (float)i / (float)mainSegments;
+		float mainAngle = u * 2.0f * g_Pi;
+		float cu = std::cos(mainAngle);
+		float su = std::sin(mainAngle);
+		for (int j = 0; j <= tubeSegments; j++)
+		{
+			float v = (float)j / (float)tubeSegments;
+			float tubeAngle = v * 2.0f * g_Pi;
+			float cv = std::cos(tubeAngle);
+			float sv = std::sin(tubeAngle);
+			glm::vec3 normal(cv * cu, cv * su, sv);
+
+			AddVertex(
+				data,
+				glm::vec3(
+					(mainRadius + tubeRadius * cv) * cu,
+					(mainRadius + tubeRadius * cv) * su,
+					tubeRadius * sv),
+				normal,
+				glm::vec2(u, v));
+		}
+	}
+	for (int i = 0; i < mainSegments; i++)
+	{
+		for (int j = 0; j < tubeSegments; j++)
+		{
+			uint32_t first = (uint32_t)(i * (tubeSegments + 1) + j);
+			uint32_t second = first + (uint32_t)(tubeSegments + 1);
+			AddQuad(data, first, second, second + 1, first + 1);
+		}
+	}
+
+	CalculateBounds(data);
+}
+
+/***********************************************************
+ *  CalculateBounds()
+ *
+ *  This method is used for calculating the local space
+ *  bounding box of the generated vertices.
+ ***********************************************************/
+void ShapeGeometry::CalculateBounds(MESH_DATA& data)
+{
+	if (data.vertices.size() == 0)
+	{
+		data.boundsMin = glm::vec3(0.0f, 0.0f, 0.0f);
+		data.boundsMax = glm::vec3(0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	data.boundsMin = data.vertices[0].position;
+	data.boundsMax = data.vertices[0].position;
+	for (size_t i = 1; i < data.vertices.size(); i++)
+	{
+		data.boundsMin = glm::min(data.boundsMin, data.vertices[i].position);
+		data.boundsMax = glm::max(data.boundsMax, data.vertices[i].position);
+	}
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.h
+// ============
+// generate the vertex and index data for the basic 3D shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// identifiers for the basic 3D shapes
+enum MESH_TYPE
+{
+	MESH_PLANE,
+	MESH_BOX,
+	MESH_CYLINDER,
+	MESH_TAPERED_CYLINDER,
+	MESH_CONE,
+	MESH_SPHERE,
+	MESH_TORUS,
+	MESH_COUNT
+};
+
+/***********************************************************
+ *  ShapeGeometry
+ *
+ *  This class contains the code for generating the vertex
+ *  and index data of the basic 3D shapes on the CPU.  The
+ *  shapes use the same dimensions as the ShapeMeshes class:
+ *  the plane spans -1 to 1 on X and Z, the box spans -0.5
+ *  to 0.5, the cylinder, cone and tapered cylinder stand on
+ *  Y = 0 with a height of 1 and a base radius of 1, and the
+ *  sphere has a radius of 1.
+ ***********************************************************/
+class ShapeGeometry
+{
+public:
+	struct SHAPE_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	struct MESH_DATA
+	{
+		std::vector<SHAPE_VERTEX> vertices;
+		std::vector<uint32_t> indices;
+		// local space bounding box of the vertices
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// the number of tessellation levels of the curved shapes -
+	// level 0 is the default tessellation, and each level
+	// after it has about half of the segments
+	static const int LOD_COUNT = 3;
+
+	// build the default tessellation of a basic shape
+	static void BuildMesh(MESH_TYPE mesh, MESH_DATA& data);
+	// build one of the tessellation levels of a basic shape
+	static void BuildMesh(MESH_TYPE mesh, int level, MESH_DATA& data);
+	// the number of tessellation levels of a basic shape, which
+	// is 1 for the flat shapes
+	static int GetLevelCount(MESH_TYPE mesh);
+
+	static void BuildPlane(MESH_DATA& data);
+	static void BuildBox(MESH_DATA& data);
+	static void BuildCylinder(MESH_DATA& data, int sides = 36);
+	static void BuildTaperedCylinder(MESH_DATA& data, int sides = 36);
+	static void BuildCone(MESH_DATA& data, int sides = 36);
+	static void BuildSphere(MESH_DATA& data, int stacks = 30, int slices = 30);
+	static void BuildTorus(
+		MESH_DATA& data,
+		int mainSegments = 30,
+		int tubeSegments = 30,
+		float mainRadius = 1.0f,
+		float tubeRadius = 0.1f);
+
+private:
+	// build a capped cylinder with separate top and bottom radius
+	static void BuildFrustum(
+		MESH_DATA& data,
+		int sides,
+		float bottomRadius,
+		float topRadius);
+	// calculate the bounding box of the generated vertices
+	static void CalculateBounds(MESH_DATA& data);
+};
@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.cpp
+// ============
+// stream the per-frame buffer contents to the GPU through a persistently
+// mapped ring
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StreamBuffer.h"
+#include "FrameProfiler.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the alignment of each upload in the ring
+	const GLsizeiptr g_UploadAlignment = 16;
+	// the longest a region is waited for, in nanoseconds
+	const GLuint64 g_FenceTimeout = 100000000;
+}
+
+/***********************************************************
+ *  StreamBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StreamBuffer::StreamBuffer()
+{
+	m_ringBuffer = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_region = 0;
+	m_regionUsed = 0;
+	m_waitCount = 0;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		m_regionFences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~StreamBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StreamBuffer::~StreamBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  make buffer storage that stays mapped, which is part of
+ *  OpenGL 4.4.
+ ***********************************************************/
+bool StreamBuffer::IsSupported()
+{
+	return((GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) ? true : false);
+}
+
+/***********************************************************
+ *  CreateRing()
+ *
+ *  This method is used for creating the ring buffer with
+ *  room for every region, and mapping it once for as long
+ *  as it lives.  The mapping is coherent, so what the CPU
+ *  writes is seen by the copies without flushing it.
+ ***********************************************************/
+bool StreamBuffer::CreateRing(GLsizeiptr regionSize)
+{
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr ringSize = regionSize * REGION_COUNT;
+
+	glGenBuffers(1, &m_ringBuffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_ringBuffer);
+	glBufferStorage(GL_COPY_READ_BUFFER, ringSize, NULL, flags);
+	m_pMapped = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, ringSize, flags);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	if (NULL == m_pMapped)
+	{
+		std::cout << "Could not map the stream buffer of " << ringSize << " bytes" << std::endl;
+		glDeleteBuffers(1, &m_ringBuffer);
+		m_ringBuffer = 0;
+		return(false);
+	}
+
+	m_regionSize = regionSize;
+	m_region = 0;
+	m_regionUsed = 0;
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyRing()
+ *
+ *  This method is used for freeing the ring buffer and the
+ *  fences of its regions.  A copy that still reads the ring
+ *  keeps working, since OpenGL only frees the storage once
+ *  the GPU is done with it.
+ ***********************************************************/
+void StreamBuffer::DestroyRing()
+{
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		if (NULL != m_regionFences[i])
+		{
+			glDeleteSync(m_regionFences[i]);
+			m_regionFences[i] = NULL;
+		}
+	}
+
+	if (m_ringBuffer != 0)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, m_ringBuffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &m_ringBuffer);
+		m_ringBuffer = 0;
+	}
+	m_pMapped = NULL;
+	m_regionUsed = 0;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the ring.  It needs an
+ *  OpenGL context, and leaves the uploads writing directly
+ *  into their buffers when the ring can not be made.
+ ***********************************************************/
+bool StreamBuffer::Create(GLsizeiptr regionSize)
+{
+	if ((m_ringBuffer != 0) || (IsSupported() == false) || (regionSize <= 0))
+	{
+		return(m_ringBuffer != 0);
+	}
+
+	return(CreateRing(regionSize));
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the ring.
+ ***********************************************************/
+void StreamBuffer::Destroy()
+{
+	DestroyRing();
+	m_regionSize = 0;
+}
+
+/***********************************************************
+ *  IsPersistent()
+ *
+ *  This method is used for checking whether the uploads go
+ *  through the mapped ring.
+ ***********************************************************/
+bool StreamBuffer::IsPersistent() const
+{
+	return(NULL != m_pMapped);
+}
+
+/***********************************************************
+ *  NextRegion()
+ *
+ *  This method is used for moving the uploads on to the
+ *  next region.  A fence is placed after the copies out of
+ *  the region that is done, and the next region is waited
+ *  for when the GPU has not passed its fence yet, which is
+ *  timed so any wait shows up in the profiler.
+ ***********************************************************/
+void StreamBuffer::NextRegion()
+{
+	m_regionFences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_region = (m_region + 1) % REGION_COUNT;
+	m_regionUsed = 0;
+
+	GLsync fence = m_regionFences[m_region];
+	if (NULL == fence)
+	{
+		return;
+	}
+
+	if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+	{
+		ProfileScope scope("StreamBufferWait");
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		m_waitCount++;
+	}
+	glDeleteSync(fence);
+	m_regionFences[m_region] = NULL;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking room for an upload in the
+ *  region in use, or in the next region when it does not
+ *  fit.  An upload that is larger than a whole region makes
+ *  a new ring, with the region size doubled until it fits,
+ *  so this only happens when the scene grows.
+ ***********************************************************/
+GLintptr StreamBuffer::Allocate(GLsizeiptr size)
+{
+	GLsizeiptr alignedSize = (size + g_UploadAlignment - 1) & ~(g_UploadAlignment - 1);
+
+	if (alignedSize > m_regionSize)
+	{
+		GLsizeiptr regionSize = m_regionSize;
+
+		while (regionSize < alignedSize)
+		{
+			regionSize *= 2;
+		}
+		DestroyRing();
+		if (CreateRing(regionSize) == false)
+		{
+			m_regionSize = 0;
+			return(-1);
+		}
+	}
+
+	if (m_regionUsed + alignedSize > m_regionSize)
+	{
+		NextRegion();
+	}
+
+	GLintptr offset = (GLintptr)m_region * m_regionSize + m_regionUsed;
+	m_regionUsed += alignedSize;
+	return(offset);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing bytes into a buffer.
+ *  The bytes are copied into the ring, and the GPU copies
+ *  them from there into the buffer, so the CPU never waits
+ *  for the draws that still read the old contents.  Without
+ *  the ring they are written with glBufferSubData().
+ ***********************************************************/
+void StreamBuffer::Upload(GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size)
+{
+	if ((buffer == 0) || (NULL == data) || (size <= 0))
+	{
+		return;
+	}
+
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UPLOAD_BYTES, (int)size);
+
+	GLintptr ringOffset = (NULL != m_pMapped) ? Allocate(size) : -1;
+	if (ringOffset < 0)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return;
+	}
+
+	memcpy(m_pMapped + ringOffset, data, (size_t)size);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, m_ringBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, ringOffset, offset, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  GetRegionSize()
+ *
+ *  This method is used for getting the size of each region
+ *  of the ring, which is 0 without a ring.
+ ***********************************************************/
+GLsizeiptr StreamBuffer::GetRegionSize() const
+{
+	return(m_regionSize);
+}
+
+/***********************************************************
+ *  GetWaitCount()
+ *
+ *  This method is used for getting the number of times the
+ *  uploads had to wait for the GPU to finish a region.
+ ***********************************************************/
+int StreamBuffer::GetWaitCount() const
+{
+	return(m_waitCount);
+}
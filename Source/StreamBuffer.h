@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.h
+// ============
+// stream the per-frame buffer contents to the GPU through a persistently
+// mapped ring
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  StreamBuffer
+ *
+ *  This class is the one path the changing buffer contents
+ *  of each frame are uploaded through.  A ring buffer is
+ *  mapped once, persistently and coherently, and split into
+ *  three regions.  Each upload is copied into the next free
+ *  part of the ring on the CPU, and the GPU copies it from
+ *  there into the buffer it belongs to, in order with the
+ *  draws around it.  Writing into a buffer the GPU may still
+ *  be reading makes the driver wait, or make a copy of the
+ *  buffer, and this way neither happens.
+ *
+ *  A fence is placed when the uploads move on from a region,
+ *  and the region is only written again once its fence has
+ *  passed, which with three regions is normally long ago.
+ *  A single upload that does not fit in a region makes the
+ *  ring larger.  When the driver has no buffer storage, the
+ *  uploads are written with glBufferSubData() instead.
+ ***********************************************************/
+class StreamBuffer
+{
+public:
+	// constructor
+	StreamBuffer();
+	// destructor
+	~StreamBuffer();
+
+	// the number of regions the ring is split into
+	static const int REGION_COUNT = 3;
+	// the starting size of each region in bytes
+	static const GLsizeiptr DEFAULT_REGION_SIZE = 4 * 1024 * 1024;
+
+private:
+	// the ring buffer, where it is mapped, and the size of
+	// each of its regions
+	GLuint m_ringBuffer;
+	unsigned char* m_pMapped;
+	GLsizeiptr m_regionSize;
+	// the region the uploads are written into, and how much
+	// of it is used
+	int m_region;
+	GLsizeiptr m_regionUsed;
+	// the fence placed after the last copy out of each region,
+	// or NULL when the region is free
+	GLsync m_regionFences[REGION_COUNT];
+	// the number of times a region was still in use by the GPU
+	int m_waitCount;
+
+	// create and free the mapped ring
+	bool CreateRing(GLsizeiptr regionSize);
+	void DestroyRing();
+	// fence the region in use and move on to the next one,
+	// waiting until the GPU is done with it
+	void NextRegion();
+	// take room for an upload in the ring and return its
+	// offset, or -1 to write the upload another way
+	GLintptr Allocate(GLsizeiptr size);
+
+public:
+	// whether the driver can map a buffer persistently
+	static bool IsSupported();
+
+	// create the ring - false is returned when it could not be
+	// made, and the uploads are then written directly
+	bool Create(GLsizeiptr regionSize = DEFAULT_REGION_SIZE);
+	// free the ring and its fences
+	void Destroy();
+	// whether the uploads go through the mapped ring
+	bool IsPersistent() const;
+
+	// write bytes into a buffer at an offset - the buffer needs
+	// to be large enough for them
+	void Upload(GLuint buffer, GLintptr offset, const void* data, GLsizeiptr size);
+
+	// the size of each region of the ring
+	GLsizeiptr GetRegionSize() const;
+	// the number of uploads that waited for the GPU
+	int GetWaitCount() const;
+};
@@ -0,0 +1,549 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture image files on worker threads and upload them to OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+#include "stb_image.h"
+
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader(TextureManager* pTextureManager, int workerCount)
+{
+	m_pTextureManager = pTextureManager;
+	m_decodingCount = 0;
+	m_bStopping = false;
+	m_pixelBuffers[0] = 0;
+	m_pixelBuffers[1] = 0;
+	m_pixelBufferSizes[0] = 0;
+	m_pixelBufferSizes[1] = 0;
+	m_nextPixelBuffer = 0;
+	m_bSupportsS3TC = (GLEW_EXT_texture_compression_s3tc == GL_TRUE);
+	m_bSupportsBPTC = ((GLEW_VERSION_4_2 == GL_TRUE) || (GLEW_ARB_texture_compression_bptc == GL_TRUE));
+
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+		if (workerCount < 1)
+		{
+			workerCount = 1;
+		}
+	}
+
+	// indicate to always flip images vertically when loaded -
+	// this is set before the workers start, since the setting
+	// is shared by all of the threads
+	stbi_set_flip_vertically_on_load(true);
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_requestReady.notify_all();
+	m_uploadDone.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	// free any decoded images that were never uploaded
+	for (size_t i = 0; i < m_decodedRequests.size(); i++)
+	{
+		FreeRequest(m_decodedRequests[i]);
+	}
+	m_decodedRequests.clear();
+	m_pendingRequests.clear();
+
+	glDeleteBuffers(2, m_pixelBuffers);
+	m_pTextureManager = NULL;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by each of the worker threads.  It
+ *  takes the next requested file off the queue and decodes
+ *  it.  The workers wait whenever too many decoded images
+ *  are waiting to be uploaded, so that a scene with many
+ *  large textures does not hold all of them in memory.
+ ***********************************************************/
+void TextureLoader::WorkerLoop()
+{
+	while (true)
+	{
+		TEXTURE_REQUEST request;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_requestReady.wait(lock, [this]()
+				{
+					return((m_bStopping == true) || (m_pendingRequests.empty() == false));
+				});
+			if (m_bStopping == true)
+			{
+				return;
+			}
+
+			request = m_pendingRequests.front();
+			m_pendingRequests.pop_front();
+			m_decodingCount++;
+		}
+
+		// the file is read and decoded without holding the lock -
+		// a cooked file is used when there is one
+		request.compressed = LoadCookedImage(request.filename);
+		if (NULL == request.compressed)
+		{
+			request.image = stbi_load(
+				request.filename.c_str(),
+				&request.width,
+				&request.height,
+				&request.colorChannels,
+				0);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_uploadDone.wait(lock, [this]()
+				{
+					return((m_bStopping == true) ||
+						((int)m_decodedRequests.size() < MAX_DECODED_IMAGES));
+				});
+
+			m_decodingCount--;
+			if (m_bStopping == true)
+			{
+				FreeRequest(request);
+				return;
+			}
+			m_decodedRequests.push_back(request);
+		}
+		// wake up FinishAll() if it is waiting
+		m_uploadDone.notify_all();
+	}
+}
+
+/***********************************************************
+ *  LoadCookedImage()
+ *
+ *  This method is used for reading the cooked DDS file that
+ *  belongs to an image file.  The cooked file has the same
+ *  name with a .dds extension.  NULL is returned when there
+ *  is no cooked file, or when the driver cannot use its
+ *  format, so the image file is decoded instead.
+ ***********************************************************/
+DDSTexture::DDS_IMAGE* TextureLoader::LoadCookedImage(const std::string& filename)
+{
+	std::string cookedName = filename;
+	size_t extension = cookedName.find_last_of("./\\");
+
+	if ((extension != std::string::npos) && (cookedName[extension] == '.'))
+	{
+		cookedName.erase(extension);
+	}
+	cookedName += ".dds";
+
+	DDSTexture::DDS_IMAGE* image = NULL;
+	{
+		std::lock_guard<std::mutex> lock(m_imagePoolMutex);
+		image = m_imagePool.Create();
+	}
+
+	if (DDSTexture::LoadFile(cookedName, *image) == true)
+	{
+		if ((((image->format == DDSTexture::DDS_FORMAT_BC1) ||
+			(image->format == DDSTexture::DDS_FORMAT_BC3)) && (m_bSupportsS3TC == true)) ||
+			((image->format == DDSTexture::DDS_FORMAT_BC7) && (m_bSupportsBPTC == true)))
+		{
+			return(image);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_imagePoolMutex);
+	m_imagePool.Destroy(image);
+	return(NULL);
+}
+
+/***********************************************************
+ *  FreeRequest()
+ *
+ *  This method is used for freeing the decoded pixels or
+ *  cooked levels that are held by a request.
+ ***********************************************************/
+void TextureLoader::FreeRequest(TEXTURE_REQUEST& request)
+{
+	if (NULL != request.image)
+	{
+		// free the image data from local memory
+		stbi_image_free(request.image);
+		request.image = NULL;
+	}
+	if (NULL != request.compressed)
+	{
+		std::lock_guard<std::mutex> lock(m_imagePoolMutex);
+		m_imagePool.Destroy(request.compressed);
+		request.compressed = NULL;
+	}
+}
+
+/***********************************************************
+ *  FillPixelBuffer()
+ *
+ *  This method is used for copying data into a pixel buffer
+ *  object, which lets the driver copy it to a texture
+ *  without stalling the OpenGL thread.  The two pixel
+ *  buffers are used in turn, and each one is orphaned
+ *  before it is written, so a copy that is still running is
+ *  never waited for.  The buffer is left bound.
+ ***********************************************************/
+bool TextureLoader::FillPixelBuffer(const void* data, size_t dataSize)
+{
+	int bufferIndex = m_nextPixelBuffer;
+	m_nextPixelBuffer = (m_nextPixelBuffer + 1) % 2;
+
+	if (m_pixelBuffers[bufferIndex] == 0)
+	{
+		glGenBuffers(1, &m_pixelBuffers[bufferIndex]);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffers[bufferIndex]);
+	if ((GLsizeiptr)dataSize > m_pixelBufferSizes[bufferIndex])
+	{
+		m_pixelBufferSizes[bufferIndex] = (GLsizeiptr)dataSize;
+	}
+	// orphan the old storage so the write does not wait on it
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, m_pixelBufferSizes[bufferIndex], NULL, GL_STREAM_DRAW);
+
+	void* pixels = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER,
+		0,
+		(GLsizeiptr)dataSize,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (NULL == pixels)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return(false);
+	}
+	memcpy(pixels, data, dataSize);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadImage()
+ *
+ *  This method is used for copying the decoded pixels of a
+ *  request into a layer of a texture array through a pixel
+ *  buffer.
+ ***********************************************************/
+bool TextureLoader::UploadImage(const TEXTURE_REQUEST& request)
+{
+	GLenum pixelFormat = GL_RGBA;
+	int layer = 0;
+
+	// if the loaded image is in RGB format
+	if (request.colorChannels == 3)
+	{
+		pixelFormat = GL_RGB;
+	}
+	// if the loaded image is in RGBA format - it supports transparency
+	else if (request.colorChannels == 4)
+	{
+		pixelFormat = GL_RGBA;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle image with " << request.colorChannels << " channels" << std::endl;
+		return(false);
+	}
+
+	// RGB images are stored in RGBA arrays, so they can share
+	// an array with RGBA images of the same size
+	if (m_pTextureManager->AllocateLayer(
+		request.textureIndex,
+		request.width,
+		request.height,
+		GL_RGBA8,
+		false,
+		0,
+		layer) == false)
+	{
+		return(false);
+	}
+
+	size_t imageSize = (size_t)request.width * request.height * request.colorChannels;
+	if (FillPixelBuffer(request.image, imageSize) == false)
+	{
+		return(false);
+	}
+
+	// the rows of RGB images are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	// the pixels are read from offset 0 of the bound pixel buffer -
+	// the mip levels are built once all of the uploads are done
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, request.width, request.height, 1, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadCompressedImage()
+ *
+ *  This method is used for copying the cooked levels of a
+ *  request into a layer of a texture array through a pixel
+ *  buffer.  The
+ *  levels were built when the texture was cooked, so no
+ *  mipmaps are generated.
+ ***********************************************************/
+bool TextureLoader::UploadCompressedImage(const TEXTURE_REQUEST& request)
+{
+	const DDSTexture::DDS_IMAGE& image = *request.compressed;
+	GLenum internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	int layer = 0;
+
+	switch (image.format)
+	{
+	case DDSTexture::DDS_FORMAT_BC1:
+		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		break;
+	case DDSTexture::DDS_FORMAT_BC3:
+		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		break;
+	case DDSTexture::DDS_FORMAT_BC7:
+		internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+		break;
+	default:
+		return(false);
+	}
+
+	if (m_pTextureManager->AllocateLayer(
+		request.textureIndex,
+		image.width,
+		image.height,
+		internalFormat,
+		true,
+		image.mipCount,
+		layer) == false)
+	{
+		return(false);
+	}
+
+	if (FillPixelBuffer(image.data.data(), image.data.size()) == false)
+	{
+		return(false);
+	}
+
+	int width = image.width;
+	int height = image.height;
+	for (int level = 0; level < image.mipCount; level++)
+	{
+		// each level is read from its offset in the bound pixel buffer
+		glCompressedTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY,
+			level,
+			0,
+			0,
+			layer,
+			width,
+			height,
+			1,
+			internalFormat,
+			(GLsizei)image.levelSizes[level],
+			(const void*)image.levelOffsets[level]);
+
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RequestTexture()
+ *
+ *  This method is used for requesting a texture to be
+ *  loaded from an image file.  The index of the texture in
+ *  the texture table is returned, and the texture shows
+ *  the placeholder image until the file has been loaded.
+ ***********************************************************/
+int TextureLoader::RequestTexture(const std::string& filename)
+{
+	int textureIndex = m_pTextureManager->CreateTexture();
+
+	if (textureIndex < 0)
+	{
+		return(-1);
+	}
+	QueueRequest(textureIndex, filename);
+
+	return(textureIndex);
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for loading the image file of a
+ *  texture again.  The file is decoded in the background
+ *  like any other request, and the texture keeps showing
+ *  its old image until the new one is uploaded.
+ ***********************************************************/
+void TextureLoader::ReloadTexture(int textureIndex, const std::string& filename)
+{
+	if ((textureIndex < 0) || (textureIndex >= m_pTextureManager->GetTextureCount()))
+	{
+		return;
+	}
+	QueueRequest(textureIndex, filename);
+}
+
+/***********************************************************
+ *  QueueRequest()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded into a texture by the worker threads.
+ ***********************************************************/
+void TextureLoader::QueueRequest(int textureIndex, const std::string& filename)
+{
+	TEXTURE_REQUEST request;
+
+	request.filename = filename;
+	request.textureIndex = textureIndex;
+	request.image = NULL;
+	request.width = 0;
+	request.height = 0;
+	request.colorChannels = 0;
+	request.compressed = NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingRequests.push_back(request);
+	}
+	m_requestReady.notify_one();
+}
+
+/***********************************************************
+ *  ProcessUploads()
+ *
+ *  This method is used for uploading the images that the
+ *  workers have decoded.  The byte budget limits how much
+ *  is uploaded in one call, so that large textures are
+ *  spread over several frames.  The number of uploaded
+ *  images is returned.
+ ***********************************************************/
+int TextureLoader::ProcessUploads(size_t maxBytes)
+{
+	int uploadCount = 0;
+	size_t uploadedBytes = 0;
+
+	while ((uploadCount == 0) || (uploadedBytes < maxBytes))
+	{
+		TEXTURE_REQUEST request;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_decodedRequests.empty() == true)
+			{
+				break;
+			}
+			request = m_decodedRequests.front();
+			m_decodedRequests.pop_front();
+		}
+		// a worker may be waiting for room for its decoded image
+		m_uploadDone.notify_all();
+
+		if (NULL != request.compressed)
+		{
+			if (UploadCompressedImage(request) == true)
+			{
+				std::cout << "Successfully loaded cooked image:" << request.filename << ", width:" << request.compressed->width << ", height:" << request.compressed->height << ", levels:" << request.compressed->mipCount << std::endl;
+			}
+			uploadedBytes += request.compressed->data.size();
+			FreeRequest(request);
+		}
+		else if (NULL != request.image)
+		{
+			if (UploadImage(request) == true)
+			{
+				std::cout << "Successfully loaded image:" << request.filename << ", width:" << request.width << ", height:" << request.height << ", channels:" << request.colorChannels << std::endl;
+			}
+			uploadedBytes += (size_t)request.width * request.height * request.colorChannels;
+			FreeRequest(request);
+		}
+		else
+		{
+			std::cout << "Could not load image:" << request.filename << std::endl;
+		}
+		uploadCount++;
+	}
+
+	if (uploadCount > 0)
+	{
+		m_pTextureManager->FinishUploads();
+	}
+
+	return(uploadCount);
+}
+
+/***********************************************************
+ *  FinishAll()
+ *
+ *  This method is used for uploading all of the requested
+ *  textures, waiting for the workers where needed.
+ ***********************************************************/
+void TextureLoader::FinishAll()
+{
+	while (GetPendingCount() > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_uploadDone.wait(lock, [this]()
+				{
+					return((m_bStopping == true) || (m_decodedRequests.empty() == false));
+				});
+			if (m_bStopping == true)
+			{
+				return;
+			}
+		}
+		ProcessUploads();
+	}
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of requested
+ *  textures that have not been uploaded yet.
+ ***********************************************************/
+int TextureLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return((int)(m_pendingRequests.size() + m_decodedRequests.size()) + m_decodingCount);
+}
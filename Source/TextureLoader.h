@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture image files on worker threads and upload them to OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "DDSTexture.h"
+#include "MemoryArena.h"
+#include "TextureManager.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class loads texture image files in the background.
+ *  The texture is added to the texture manager right away
+ *  and shows the placeholder image, so objects can use its
+ *  index before the file has been read.  The image files
+ *  are decoded on a pool of worker threads, and the decoded
+ *  pixels are uploaded into a texture array layer through
+ *  pixel buffer objects when ProcessUploads() is called
+ *  from the OpenGL thread.
+ *
+ *  When a cooked DDS file with the same name is found next
+ *  to an image file, and the driver supports its format,
+ *  the compressed levels in it are uploaded instead, so no
+ *  image is decoded and no mipmaps are generated.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor - a worker count of 0 uses one thread
+	// less than the number of hardware threads
+	TextureLoader(TextureManager* pTextureManager, int workerCount = 0);
+	// destructor
+	~TextureLoader();
+
+private:
+	struct TEXTURE_REQUEST
+	{
+		std::string filename;
+		// index of the texture in the texture table
+		int textureIndex;
+		// decoded pixels, owned by the request until uploaded
+		unsigned char* image;
+		int width;
+		int height;
+		int colorChannels;
+		// cooked levels, used instead of the decoded pixels
+		DDSTexture::DDS_IMAGE* compressed;
+	};
+
+	// pointer to the manager the textures are stored in
+	TextureManager* m_pTextureManager;
+	// worker threads that decode the image files
+	std::vector<std::thread> m_workers;
+	// guards the request queues and the flags below
+	std::mutex m_mutex;
+	// signalled when a request is queued or the loader stops
+	std::condition_variable m_requestReady;
+	// signalled when a decoded image has been uploaded
+	std::condition_variable m_uploadDone;
+	// requests waiting to be decoded
+	std::deque<TEXTURE_REQUEST> m_pendingRequests;
+	// decoded requests waiting to be uploaded
+	std::deque<TEXTURE_REQUEST> m_decodedRequests;
+	// number of requests that are being decoded
+	int m_decodingCount;
+	bool m_bStopping;
+	// pixel buffer objects used for the uploads in turn
+	GLuint m_pixelBuffers[2];
+	GLsizeiptr m_pixelBufferSizes[2];
+	int m_nextPixelBuffer;
+	// the compressed formats the driver supports - these are
+	// checked on the OpenGL thread before the workers start
+	bool m_bSupportsS3TC;
+	bool m_bSupportsBPTC;
+	// the cooked images are made in a pool, since they are made
+	// and freed again each time a texture is loaded or reloaded -
+	// the pool has its own lock, as requests are freed both with
+	// and without the lock of the queues
+	BlockPool<DDSTexture::DDS_IMAGE, 8> m_imagePool;
+	std::mutex m_imagePoolMutex;
+
+	// the number of decoded images that are held in memory
+	// before the workers wait for them to be uploaded
+	static const int MAX_DECODED_IMAGES = 4;
+
+	// the loop run by each of the worker threads
+	void WorkerLoop();
+	// try to read the cooked DDS file of an image file
+	DDSTexture::DDS_IMAGE* LoadCookedImage(const std::string& filename);
+	// copy data into the next pixel buffer and leave it bound
+	bool FillPixelBuffer(const void* data, size_t dataSize);
+	// copy decoded pixels into the texture through a pixel buffer
+	bool UploadImage(const TEXTURE_REQUEST& request);
+	// copy cooked levels into the texture through a pixel buffer
+	bool UploadCompressedImage(const TEXTURE_REQUEST& request);
+	// free the image data held by a request
+	void FreeRequest(TEXTURE_REQUEST& request);
+	// queue an image file to be decoded into a texture
+	void QueueRequest(int textureIndex, const std::string& filename);
+
+public:
+	// add a texture that shows the placeholder, and queue
+	// the image file to be decoded into it - the index of
+	// the texture in the texture table is returned
+	int RequestTexture(const std::string& filename);
+	// queue an image file to be decoded into a texture that
+	// was already requested, such as after the file changed -
+	// the texture shows its old image until the upload
+	void ReloadTexture(int textureIndex, const std::string& filename);
+
+	// upload the decoded images - this needs to be called
+	// on the OpenGL thread, and uploads images until the
+	// byte budget is used up, but always at least one
+	int ProcessUploads(size_t maxBytes = 64 * 1024 * 1024);
+
+	// upload all of the requested textures, blocking until
+	// the last one has been decoded
+	void FinishAll();
+
+	// the number of requested textures that are not uploaded
+	int GetPendingCount();
+};
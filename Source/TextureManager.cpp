@@ -0,0 +1,495 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturemanager.cpp
+// ============
+// manage the scene textures as layers of OpenGL texture arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureManager.h"
+#include "DDSTexture.h"
+#include "FrameProfiler.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the number of layers a new array is created with
+	const int INITIAL_ARRAY_LAYERS = 4;
+
+	// get the DDS format that matches a compressed OpenGL format
+	DDSTexture::DDS_FORMAT GetBlockFormat(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+			return(DDSTexture::DDS_FORMAT_BC1);
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return(DDSTexture::DDS_FORMAT_BC3);
+		case GL_COMPRESSED_RGBA_BPTC_UNORM:
+			return(DDSTexture::DDS_FORMAT_BC7);
+		default:
+			return(DDSTexture::DDS_FORMAT_UNKNOWN);
+		}
+	}
+}
+
+/***********************************************************
+ *  TextureManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureManager::TextureManager(UniformBufferManager* pUniformBuffers)
+{
+	m_pUniformBuffers = pUniformBuffers;
+	m_textureCount = 0;
+	m_bCopyImageSupported = ((GLEW_VERSION_4_3 == GL_TRUE) || (GLEW_ARB_copy_image == GL_TRUE));
+
+	CreatePlaceholder();
+}
+
+/***********************************************************
+ *  ~TextureManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureManager::~TextureManager()
+{
+	DestroyTextures();
+	m_pUniformBuffers = NULL;
+}
+
+/***********************************************************
+ *  BindArray()
+ *
+ *  This method is used for binding an array to the texture
+ *  unit it is used from.
+ ***********************************************************/
+void TextureManager::BindArray(int arrayIndex)
+{
+	glActiveTexture(GL_TEXTURE0 + arrayIndex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[arrayIndex].textureID);
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_TEXTURE_BINDS, 1);
+}
+
+/***********************************************************
+ *  AllocateArray()
+ *
+ *  This method is used for creating the storage of all of
+ *  the levels of an array, with room for the passed in
+ *  number of layers.  The array needs to be bound.
+ ***********************************************************/
+void TextureManager::AllocateArray(const TEXTURE_ARRAY& textureArray, int capacity)
+{
+	int width = textureArray.width;
+	int height = textureArray.height;
+
+	for (int level = 0; level < textureArray.mipCount; level++)
+	{
+		if (textureArray.bCompressed == true)
+		{
+			GLsizei levelSize = (GLsizei)DDSTexture::GetLevelSize(
+				GetBlockFormat(textureArray.internalFormat), width, height);
+
+			glCompressedTexImage3D(
+				GL_TEXTURE_2D_ARRAY,
+				level,
+				textureArray.internalFormat,
+				width,
+				height,
+				capacity,
+				0,
+				levelSize * capacity,
+				NULL);
+		}
+		else
+		{
+			glTexImage3D(
+				GL_TEXTURE_2D_ARRAY,
+				level,
+				textureArray.internalFormat,
+				width,
+				height,
+				capacity,
+				0,
+				GL_RGBA,
+				GL_UNSIGNED_BYTE,
+				NULL);
+		}
+
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, textureArray.mipCount - 1);
+}
+
+/***********************************************************
+ *  CreatePlaceholder()
+ *
+ *  This method is used for creating the first array, which
+ *  holds a single neutral gray texel.  New textures point
+ *  at it until their image has been uploaded.
+ ***********************************************************/
+void TextureManager::CreatePlaceholder()
+{
+	const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+	TEXTURE_ARRAY textureArray;
+
+	textureArray.textureID = 0;
+	textureArray.width = 1;
+	textureArray.height = 1;
+	textureArray.internalFormat = GL_RGBA8;
+	textureArray.bCompressed = false;
+	textureArray.mipCount = 1;
+	textureArray.layerCount = 1;
+	textureArray.capacity = 1;
+	textureArray.bMipmapsDirty = false;
+
+	glGenTextures(1, &textureArray.textureID);
+	m_textureArrays.push_back(textureArray);
+
+	BindArray(0);
+	AllocateArray(textureArray, 1);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  FindArray()
+ *
+ *  This method is used for finding the array that holds
+ *  images of the passed in size and format.  A new array
+ *  is created when there is none yet.  -1 is returned when
+ *  all of the texture units are used.
+ ***********************************************************/
+int TextureManager::FindArray(int width, int height, GLenum internalFormat, int mipCount)
+{
+	// the placeholder array is never shared
+	for (int i = 1; i < (int)m_textureArrays.size(); i++)
+	{
+		const TEXTURE_ARRAY& textureArray = m_textureArrays[i];
+
+		if ((textureArray.width == width) &&
+			(textureArray.height == height) &&
+			(textureArray.internalFormat == internalFormat) &&
+			(textureArray.mipCount == mipCount))
+		{
+			return(i);
+		}
+	}
+
+	if ((int)m_textureArrays.size() >= MAX_TEXTURE_ARRAYS)
+	{
+		return(-1);
+	}
+
+	TEXTURE_ARRAY textureArray;
+
+	textureArray.textureID = 0;
+	textureArray.width = width;
+	textureArray.height = height;
+	textureArray.internalFormat = internalFormat;
+	textureArray.bCompressed = (internalFormat != GL_RGBA8);
+	textureArray.mipCount = mipCount;
+	textureArray.layerCount = 0;
+	textureArray.capacity = INITIAL_ARRAY_LAYERS;
+	textureArray.bMipmapsDirty = false;
+
+	glGenTextures(1, &textureArray.textureID);
+	m_textureArrays.push_back(textureArray);
+
+	int arrayIndex = (int)m_textureArrays.size() - 1;
+	BindArray(arrayIndex);
+	AllocateArray(textureArray, textureArray.capacity);
+
+	return(arrayIndex);
+}
+
+/***********************************************************
+ *  GrowArray()
+ *
+ *  This method is used for doubling the number of layers of
+ *  a full array.  A new array is allocated and the used
+ *  layers are copied into it, on the GPU when the driver
+ *  supports glCopyImageSubData(), and through local memory
+ *  otherwise.  The array keeps its texture unit.
+ ***********************************************************/
+bool TextureManager::GrowArray(int arrayIndex)
+{
+	TEXTURE_ARRAY& textureArray = m_textureArrays[arrayIndex];
+	GLuint oldTextureID = textureArray.textureID;
+	GLuint newTextureID = 0;
+	int newCapacity = textureArray.capacity * 2;
+	std::vector<std::vector<unsigned char> > levels;
+
+	// without copy image support, the used layers are read
+	// back before the old array is replaced
+	if (m_bCopyImageSupported == false)
+	{
+		int width = textureArray.width;
+		int height = textureArray.height;
+
+		levels.resize(textureArray.mipCount);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		for (int level = 0; level < textureArray.mipCount; level++)
+		{
+			// the whole level of every allocated layer is returned
+			if (textureArray.bCompressed == true)
+			{
+				levels[level].resize(DDSTexture::GetLevelSize(
+					GetBlockFormat(textureArray.internalFormat), width, height) * textureArray.capacity);
+				glGetCompressedTexImage(GL_TEXTURE_2D_ARRAY, level, levels[level].data());
+			}
+			else
+			{
+				levels[level].resize((size_t)width * height * 4 * textureArray.capacity);
+				glGetTexImage(GL_TEXTURE_2D_ARRAY, level, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].data());
+			}
+
+			width = (width > 1) ? (width / 2) : 1;
+			height = (height > 1) ? (height / 2) : 1;
+		}
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	}
+
+	glGenTextures(1, &newTextureID);
+	textureArray.textureID = newTextureID;
+	BindArray(arrayIndex);
+	AllocateArray(textureArray, newCapacity);
+
+	int width = textureArray.width;
+	int height = textureArray.height;
+	for (int level = 0; level < textureArray.mipCount; level++)
+	{
+		if (m_bCopyImageSupported == true)
+		{
+			glCopyImageSubData(
+				oldTextureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+				newTextureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+				width, height, textureArray.layerCount);
+		}
+		else if (textureArray.bCompressed == true)
+		{
+			GLsizei levelSize = (GLsizei)DDSTexture::GetLevelSize(
+				GetBlockFormat(textureArray.internalFormat), width, height);
+
+			glCompressedTexSubImage3D(
+				GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+				width, height, textureArray.layerCount,
+				textureArray.internalFormat,
+				levelSize * textureArray.layerCount,
+				levels[level].data());
+		}
+		else
+		{
+			glTexSubImage3D(
+				GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+				width, height, textureArray.layerCount,
+				GL_RGBA, GL_UNSIGNED_BYTE,
+				levels[level].data());
+		}
+
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+
+	glDeleteTextures(1, &oldTextureID);
+	textureArray.capacity = newCapacity;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for adding a texture to the texture
+ *  table.  The texture shows the placeholder image until a
+ *  layer is allocated for its image.
+ ***********************************************************/
+int TextureManager::CreateTexture()
+{
+	if (m_textureCount >= MAX_TEXTURES)
+	{
+		std::cout << "Texture table is full, the limit is " << MAX_TEXTURES << " textures" << std::endl;
+		return(-1);
+	}
+
+	int textureIndex = m_textureCount;
+	m_textureCount++;
+
+	TEXTURE_LOCATION location;
+	location.arrayIndex = 0;
+	location.layer = 0;
+	m_textureLocations.push_back(location);
+
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->SetTextureLocation(textureIndex, 0, 0);
+	}
+
+	return(textureIndex);
+}
+
+/***********************************************************
+ *  AllocateLayer()
+ *
+ *  This method is used for finding a layer for the image of
+ *  a texture.  Uncompressed images are stored as GL_RGBA8
+ *  with a full mip chain that is built in FinishUploads(),
+ *  and compressed images keep their format and the levels
+ *  they were cooked with.  The array of the layer is left
+ *  bound, so the image can be uploaded with
+ *  glTexSubImage3D() or glCompressedTexSubImage3D().
+ ***********************************************************/
+bool TextureManager::AllocateLayer(
+	int textureIndex,
+	int width,
+	int height,
+	GLenum internalFormat,
+	bool bCompressed,
+	int mipCount,
+	int& layer)
+{
+	if ((textureIndex < 0) || (textureIndex >= m_textureCount) ||
+		(width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	if (bCompressed == false)
+	{
+		int largest = (width > height) ? width : height;
+
+		internalFormat = GL_RGBA8;
+		mipCount = 1;
+		while ((largest > 1) && (mipCount < DDSTexture::MAX_MIP_LEVELS))
+		{
+			largest /= 2;
+			mipCount++;
+		}
+	}
+
+	int arrayIndex = FindArray(width, height, internalFormat, mipCount);
+	if (arrayIndex < 0)
+	{
+		std::cout << "No texture unit left for a " << width << "x" << height << " texture array" << std::endl;
+		return(false);
+	}
+
+	// an image that is loaded again into the same array is
+	// written over the old one - otherwise the old layer is
+	// left unused and the texture moves to a new layer
+	TEXTURE_LOCATION& location = m_textureLocations[textureIndex];
+	if (location.arrayIndex != arrayIndex)
+	{
+		if (m_textureArrays[arrayIndex].layerCount >= m_textureArrays[arrayIndex].capacity)
+		{
+			GrowArray(arrayIndex);
+		}
+		location.arrayIndex = arrayIndex;
+		location.layer = m_textureArrays[arrayIndex].layerCount;
+		m_textureArrays[arrayIndex].layerCount++;
+	}
+
+	TEXTURE_ARRAY& textureArray = m_textureArrays[arrayIndex];
+
+	layer = location.layer;
+	if (bCompressed == false)
+	{
+		textureArray.bMipmapsDirty = true;
+	}
+	BindArray(arrayIndex);
+
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->SetTextureLocation(textureIndex, arrayIndex, layer);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishUploads()
+ *
+ *  This method is used for building the mip levels of the
+ *  arrays that had uncompressed layers uploaded, and for
+ *  writing the changed texture table entries.
+ ***********************************************************/
+void TextureManager::FinishUploads()
+{
+	for (int i = 0; i < (int)m_textureArrays.size(); i++)
+	{
+		if (m_textureArrays[i].bMipmapsDirty == true)
+		{
+			BindArray(i);
+			// generate the texture mipmaps for mapping textures to lower resolutions
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			m_textureArrays[i].bMipmapsDirty = false;
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->UpdateBuffers();
+	}
+}
+
+/***********************************************************
+ *  BindTextures()
+ *
+ *  This method is used for binding all of the arrays to
+ *  their texture units.
+ ***********************************************************/
+void TextureManager::BindTextures()
+{
+	for (int i = 0; i < (int)m_textureArrays.size(); i++)
+	{
+		BindArray(i);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing all of the arrays.
+ ***********************************************************/
+void TextureManager::DestroyTextures()
+{
+	for (size_t i = 0; i < m_textureArrays.size(); i++)
+	{
+		glDeleteTextures(1, &m_textureArrays[i].textureID);
+	}
+	m_textureArrays.clear();
+	m_textureLocations.clear();
+	m_textureCount = 0;
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures
+ *  in the texture table.
+ ***********************************************************/
+int TextureManager::GetTextureCount() const
+{
+	return(m_textureCount);
+}
+
+/***********************************************************
+ *  GetArrayCount()
+ *
+ *  This method is used for getting the number of texture
+ *  arrays being used.
+ ***********************************************************/
+int TextureManager::GetArrayCount() const
+{
+	return((int)m_textureArrays.size());
+}
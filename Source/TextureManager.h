@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturemanager.h
+// ============
+// manage the scene textures as layers of OpenGL texture arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "UniformBuffers.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureManager
+ *
+ *  This class stores the scene textures as layers of
+ *  GL_TEXTURE_2D_ARRAY textures.  Textures with the same
+ *  size and format share an array, and each array stays
+ *  bound to its own texture unit, so no textures are bound
+ *  between draws.  Objects select a texture by its index,
+ *  and the shader looks up the array and layer of the index
+ *  in the texture table uniform block.  The arrays grow as
+ *  textures are added, so the number of textures is only
+ *  limited by the size of the texture table.
+ *
+ *  The first array holds the placeholder image, which new
+ *  textures show until their image has been uploaded.
+ ***********************************************************/
+class TextureManager
+{
+public:
+	// constructor
+	TextureManager(UniformBufferManager* pUniformBuffers);
+	// destructor
+	~TextureManager();
+
+	// the number of texture arrays, which are bound to the
+	// texture units 0 and up - this must match the define in
+	// fragmentShader.glsl
+	static const int MAX_TEXTURE_ARRAYS = 8;
+	// the largest number of textures in the texture table
+	static const int MAX_TEXTURES = UniformBufferManager::MAX_TEXTURES;
+
+private:
+	struct TEXTURE_ARRAY
+	{
+		GLuint textureID;
+		int width;
+		int height;
+		// GL_RGBA8, or one of the compressed formats
+		GLenum internalFormat;
+		bool bCompressed;
+		int mipCount;
+		// the number of used and allocated layers
+		int layerCount;
+		int capacity;
+		// set when a layer was uploaded without mip levels
+		bool bMipmapsDirty;
+	};
+
+	// the array and layer that hold the image of a texture
+	struct TEXTURE_LOCATION
+	{
+		int arrayIndex;
+		int layer;
+	};
+
+	// pointer to the shared uniform buffers
+	UniformBufferManager* m_pUniformBuffers;
+	// the texture arrays, the first one holds the placeholder
+	std::vector<TEXTURE_ARRAY> m_textureArrays;
+	// the location of each texture in the texture table
+	std::vector<TEXTURE_LOCATION> m_textureLocations;
+	// the number of textures in the texture table
+	int m_textureCount;
+	// whether glCopyImageSubData() can be used to grow arrays
+	bool m_bCopyImageSupported;
+
+	// create the array that holds the placeholder image
+	void CreatePlaceholder();
+	// find an array for images of a size and format
+	int FindArray(int width, int height, GLenum internalFormat, int mipCount);
+	// allocate the storage of an array with a layer count
+	void AllocateArray(const TEXTURE_ARRAY& textureArray, int capacity);
+	// give an array room for more layers, keeping the old ones
+	bool GrowArray(int arrayIndex);
+	// bind an array to its texture unit
+	void BindArray(int arrayIndex);
+
+public:
+	// add a texture that shows the placeholder image, and
+	// return its index into the texture table, or -1 if the
+	// table is full
+	int CreateTexture();
+
+	// find or make a layer for the image of a texture, and
+	// point the texture table entry at it - the array is left
+	// bound so the image can be uploaded into the layer, and
+	// a texture that is loaded again keeps its layer when the
+	// new image has the same size and format
+	bool AllocateLayer(
+		int textureIndex,
+		int width,
+		int height,
+		GLenum internalFormat,
+		bool bCompressed,
+		int mipCount,
+		int& layer);
+
+	// build the mip levels of the arrays that had layers
+	// uploaded, and write the texture table
+	void FinishUploads();
+
+	// bind all of the arrays to their texture units
+	void BindTextures();
+	// free all of the arrays and textures
+	void DestroyTextures();
+
+	// the number of textures in the texture table
+	int GetTextureCount() const;
+	// the number of texture arrays being used
+	int GetArrayCount() const;
+};
@@ -0,0 +1,338 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformhierarchy.cpp
+// ============
+// manage the cached transformations of the objects in a 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformHierarchy.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// the fewest nodes each job builds the local matrices of
+	const int g_LocalMatrixBatch = 512;
+}
+
+/***********************************************************
+ *  TransformHierarchy()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformHierarchy::TransformHierarchy()
+{
+	m_bAnyDirty = false;
+}
+
+/***********************************************************
+ *  ~TransformHierarchy()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TransformHierarchy::~TransformHierarchy()
+{
+	m_nodes.clear();
+}
+
+/***********************************************************
+ *  BuildLocalMatrix()
+ *
+ *  This method is used for calculating the local matrix of
+ *  a node.  The result is the same as
+ *  translation * rotationZ * rotationY * rotationX * scale
+ *  but it is written out directly instead of building and
+ *  multiplying five separate matrices.
+ ***********************************************************/
+void TransformHierarchy::BuildLocalMatrix(TRANSFORM_NODE& node)
+{
+	float radiansX = glm::radians(node.rotationDegrees.x);
+	float radiansY = glm::radians(node.rotationDegrees.y);
+	float radiansZ = glm::radians(node.rotationDegrees.z);
+
+	float cx = std::cos(radiansX);
+	float sx = std::sin(radiansX);
+	float cy = std::cos(radiansY);
+	float sy = std::sin(radiansY);
+	float cz = std::cos(radiansZ);
+	float sz = std::sin(radiansZ);
+
+	glm::mat4& m = node.localMatrix;
+
+	m[0][0] = cz * cy * node.scaleXYZ.x;
+	m[0][1] = sz * cy * node.scaleXYZ.x;
+	m[0][2] = -sy * node.scaleXYZ.x;
+	m[0][3] = 0.0f;
+
+	m[1][0] = (cz * sy * sx - sz * cx) * node.scaleXYZ.y;
+	m[1][1] = (sz * sy * sx + cz * cx) * node.scaleXYZ.y;
+	m[1][2] = cy * sx * node.scaleXYZ.y;
+	m[1][3] = 0.0f;
+
+	m[2][0] = (cz * sy * cx + sz * sx) * node.scaleXYZ.z;
+	m[2][1] = (sz * sy * cx - cz * sx) * node.scaleXYZ.z;
+	m[2][2] = cy * cx * node.scaleXYZ.z;
+	m[2][3] = 0.0f;
+
+	m[3][0] = node.positionXYZ.x;
+	m[3][1] = node.positionXYZ.y;
+	m[3][2] = node.positionXYZ.z;
+	m[3][3] = 1.0f;
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a new node to the
+ *  hierarchy.  A parent must be added before its children.
+ ***********************************************************/
+int TransformHierarchy::AddNode(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	int parent)
+{
+	TRANSFORM_NODE node;
+
+	node.scaleXYZ = scaleXYZ;
+	node.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	node.positionXYZ = positionXYZ;
+	node.parent = -1;
+	if ((parent >= 0) && (parent < (int)m_nodes.size()))
+	{
+		node.parent = parent;
+	}
+	node.bLocalDirty = true;
+	node.worldVersion = 0;
+	node.parentVersion = 0;
+
+	m_nodes.push_back(node);
+	m_bAnyDirty = true;
+
+	return((int)m_nodes.size() - 1);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the nodes.
+ ***********************************************************/
+void TransformHierarchy::Clear()
+{
+	m_nodes.clear();
+	m_bAnyDirty = false;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for making room for a number of
+ *  nodes before they are added.
+ ***********************************************************/
+void TransformHierarchy::Reserve(int nodeCount)
+{
+	if (nodeCount > 0)
+	{
+		m_nodes.reserve((size_t)nodeCount);
+	}
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for changing the position of a node.
+ ***********************************************************/
+void TransformHierarchy::SetPosition(int node, glm::vec3 positionXYZ)
+{
+	if (m_nodes[node].positionXYZ != positionXYZ)
+	{
+		m_nodes[node].positionXYZ = positionXYZ;
+		m_nodes[node].bLocalDirty = true;
+		m_bAnyDirty = true;
+	}
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for changing the rotation of a node.
+ ***********************************************************/
+void TransformHierarchy::SetRotation(
+	int node,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	glm::vec3 rotationDegrees(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+
+	if (m_nodes[node].rotationDegrees != rotationDegrees)
+	{
+		m_nodes[node].rotationDegrees = rotationDegrees;
+		m_nodes[node].bLocalDirty = true;
+		m_bAnyDirty = true;
+	}
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for changing the scale of a node.
+ ***********************************************************/
+void TransformHierarchy::SetScale(int node, glm::vec3 scaleXYZ)
+{
+	if (m_nodes[node].scaleXYZ != scaleXYZ)
+	{
+		m_nodes[node].scaleXYZ = scaleXYZ;
+		m_nodes[node].bLocalDirty = true;
+		m_bAnyDirty = true;
+	}
+}
+
+/***********************************************************
+ *  GetPosition()
+ *
+ *  This method is used for getting the position of a node.
+ ***********************************************************/
+glm::vec3 TransformHierarchy::GetPosition(int node) const
+{
+	return(m_nodes[node].positionXYZ);
+}
+
+/***********************************************************
+ *  GetRotation()
+ *
+ *  This method is used for getting the rotation of a node.
+ ***********************************************************/
+glm::vec3 TransformHierarchy::GetRotation(int node) const
+{
+	return(m_nodes[node].rotationDegrees);
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used for getting the scale of a node.
+ ***********************************************************/
+glm::vec3 TransformHierarchy::GetScale(int node) const
+{
+	return(m_nodes[node].scaleXYZ);
+}
+
+/***********************************************************
+ *  GetParent()
+ *
+ *  This method is used for getting the parent of a node.
+ ***********************************************************/
+int TransformHierarchy::GetParent(int node) const
+{
+	return(m_nodes[node].parent);
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for recalculating the matrices of
+ *  the nodes that have changed.  When nothing has changed
+ *  since the last update no matrix math is done at all.
+ *  The local matrices of the nodes do not depend on each
+ *  other, so with a job system they are built in parallel
+ *  first, and the pass that multiplies them into the world
+ *  matrices of the children stays in parent order.
+ ***********************************************************/
+int TransformHierarchy::UpdateTransforms(JobSystem* pJobSystem)
+{
+	int updatedCount = 0;
+	bool bLocalBuilt = false;
+
+	if (m_bAnyDirty == false)
+	{
+		return(0);
+	}
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor((int)m_nodes.size(), g_LocalMatrixBatch, [this](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+				{
+					if (m_nodes[i].bLocalDirty == true)
+					{
+						BuildLocalMatrix(m_nodes[i]);
+					}
+				}
+			});
+		bLocalBuilt = true;
+	}
+
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		TRANSFORM_NODE& node = m_nodes[i];
+		bool bParentChanged = false;
+
+		if ((node.parent >= 0) &&
+			(m_nodes[node.parent].worldVersion != node.parentVersion))
+		{
+			bParentChanged = true;
+		}
+
+		if ((node.bLocalDirty == true) && (bLocalBuilt == false))
+		{
+			BuildLocalMatrix(node);
+		}
+
+		if ((node.bLocalDirty == true) || (bParentChanged == true))
+		{
+			if (node.parent >= 0)
+			{
+				node.worldMatrix = m_nodes[node.parent].worldMatrix * node.localMatrix;
+				node.parentVersion = m_nodes[node.parent].worldVersion;
+			}
+			else
+			{
+				node.worldMatrix = node.localMatrix;
+			}
+			node.worldVersion++;
+			node.bLocalDirty = false;
+			updatedCount++;
+		}
+	}
+
+	m_bAnyDirty = false;
+
+	return(updatedCount);
+}
+
+/***********************************************************
+ *  GetWorldMatrix()
+ *
+ *  This method is used for getting the cached world matrix
+ *  of a node.
+ ***********************************************************/
+const glm::mat4& TransformHierarchy::GetWorldMatrix(int node) const
+{
+	return(m_nodes[node].worldMatrix);
+}
+
+/***********************************************************
+ *  GetWorldVersion()
+ *
+ *  This method is used for getting the version of the world
+ *  matrix of a node, which changes every time the matrix
+ *  is rebuilt.
+ ***********************************************************/
+unsigned int TransformHierarchy::GetWorldVersion(int node) const
+{
+	return(m_nodes[node].worldVersion);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the total number of nodes.
+ ***********************************************************/
+int TransformHierarchy::GetNodeCount() const
+{
+	return((int)m_nodes.size());
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformhierarchy.h
+// ============
+// manage the cached transformations of the objects in a 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  TransformHierarchy
+ *
+ *  This class contains the transform component for the
+ *  objects in a 3D scene.  Model matrices are only rebuilt
+ *  when the position, rotation or scale of a node, or of
+ *  one of its parents, has actually changed.
+ ***********************************************************/
+class TransformHierarchy
+{
+public:
+	// constructor
+	TransformHierarchy();
+	// destructor
+	~TransformHierarchy();
+
+	struct TRANSFORM_NODE
+	{
+		glm::vec3 scaleXYZ;
+		// rotation around the X, Y and Z axis in degrees
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		// index of the parent node, or -1 for a root node
+		int parent;
+		// transformation relative to the parent node
+		glm::mat4 localMatrix;
+		// transformation relative to the world
+		glm::mat4 worldMatrix;
+		// set when the local values have been changed
+		bool bLocalDirty;
+		// incremented every time the world matrix changes
+		unsigned int worldVersion;
+		// parent world version the world matrix was built from
+		unsigned int parentVersion;
+	};
+
+private:
+	// all of the nodes - parents are always stored before
+	// their children so one forward pass updates the tree
+	std::vector<TRANSFORM_NODE> m_nodes;
+	// set when any node needs to be recalculated
+	bool m_bAnyDirty;
+
+	// calculate a local matrix from the node values
+	void BuildLocalMatrix(TRANSFORM_NODE& node);
+
+public:
+	// add a new node and return its handle
+	int AddNode(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		int parent = -1);
+	// remove all of the nodes
+	void Clear();
+	// make room for a number of nodes so adding them does not
+	// reallocate the node list
+	void Reserve(int nodeCount);
+
+	// change the values of a node - the node is only marked
+	// as dirty when a value is different from the current one
+	void SetPosition(int node, glm::vec3 positionXYZ);
+	void SetRotation(
+		int node,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees);
+	void SetScale(int node, glm::vec3 scaleXYZ);
+
+	glm::vec3 GetPosition(int node) const;
+	glm::vec3 GetRotation(int node) const;
+	glm::vec3 GetScale(int node) const;
+	int GetParent(int node) const;
+
+	// recalculate the matrices of the dirty nodes and return
+	// the number of world matrices that were rebuilt - the
+	// local matrices are built on the job system when one is
+	// passed in
+	int UpdateTransforms(JobSystem* pJobSystem = NULL);
+
+	// get the cached world matrix of a node
+	const glm::mat4& GetWorldMatrix(int node) const;
+	// get the version of the world matrix of a node
+	unsigned int GetWorldVersion(int node) const;
+	// get the total number of nodes
+	int GetNodeCount() const;
+};
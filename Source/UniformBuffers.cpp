@@ -0,0 +1,425 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffers.cpp
+// ============
+// manage the uniform buffer objects shared by all of the shader programs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformBuffers.h"
+#include "FrameProfiler.h"
+
+#include <cstring>
+#include <iostream>
+
+// the local copies must match the std140 sizes in the shader code
+static_assert(sizeof(UniformBufferManager::CAMERA_BLOCK) == 144, "CameraBlock layout");
+static_assert(sizeof(UniformBufferManager::DIRECTIONAL_LIGHT) == 64, "DirectionalLight layout");
+static_assert(sizeof(UniformBufferManager::SPOT_LIGHT) == 96, "SpotLight layout");
+static_assert(sizeof(UniformBufferManager::MATERIAL_DATA) == 32, "Material layout");
+static_assert(sizeof(UniformBufferManager::TEXTURE_LOCATION) == 16, "TextureBlock layout");
+static_assert(sizeof(UniformBufferManager::CLUSTER_BLOCK) == 32, "ClusterBlock layout");
+static_assert(sizeof(UniformBufferManager::SHADOW_BLOCK) == 352, "ShadowBlock layout");
+
+// declaration of global variables
+namespace
+{
+	const char* g_CameraBlockName = "CameraBlock";
+	const char* g_LightBlockName = "LightBlock";
+	const char* g_MaterialBlockName = "MaterialBlock";
+	const char* g_TextureBlockName = "TextureBlock";
+	const char* g_ClusterBlockName = "ClusterBlock";
+	const char* g_ShadowBlockName = "ShadowBlock";
+}
+
+/***********************************************************
+ *  UniformBufferManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformBufferManager::UniformBufferManager()
+{
+	m_cameraBuffer = 0;
+	m_lightBuffer = 0;
+	m_materialBuffer = 0;
+	m_textureBuffer = 0;
+	m_clusterBuffer = 0;
+	m_shadowBuffer = 0;
+
+	m_cameraBlock = CAMERA_BLOCK();
+	m_lightBlock = LIGHT_BLOCK();
+	m_materialBlock = MATERIAL_BLOCK();
+	m_textureBlock = TEXTURE_BLOCK();
+	m_clusterBlock = CLUSTER_BLOCK();
+	m_shadowBlock = SHADOW_BLOCK();
+	m_cameraBlock.view = glm::mat4(1.0f);
+	m_cameraBlock.projection = glm::mat4(1.0f);
+
+	m_bCameraDirty = false;
+	m_bLightsDirty = false;
+	m_bMaterialsDirty = false;
+	m_bTexturesDirty = false;
+	m_bClustersDirty = false;
+	m_bShadowsDirty = false;
+}
+
+/***********************************************************
+ *  ~UniformBufferManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBufferManager::~UniformBufferManager()
+{
+	DestroyBuffers();
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating a uniform buffer object
+ *  with the passed in initial values and binding it to its
+ *  binding point.
+ ***********************************************************/
+GLuint UniformBufferManager::CreateBuffer(GLuint binding, GLsizeiptr size, const void* data)
+{
+	GLuint buffer = 0;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+
+	return(buffer);
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the uniform buffer
+ *  objects.  It needs to be called after GLEW is
+ *  initialized.
+ ***********************************************************/
+void UniformBufferManager::CreateBuffers()
+{
+	if (m_cameraBuffer != 0)
+	{
+		return;
+	}
+
+	m_cameraBuffer = CreateBuffer(CAMERA_BLOCK_BINDING, sizeof(CAMERA_BLOCK), &m_cameraBlock);
+	m_lightBuffer = CreateBuffer(LIGHT_BLOCK_BINDING, sizeof(LIGHT_BLOCK), &m_lightBlock);
+	m_materialBuffer = CreateBuffer(MATERIAL_BLOCK_BINDING, sizeof(MATERIAL_BLOCK), &m_materialBlock);
+	m_textureBuffer = CreateBuffer(TEXTURE_BLOCK_BINDING, sizeof(TEXTURE_BLOCK), &m_textureBlock);
+	m_clusterBuffer = CreateBuffer(CLUSTER_BLOCK_BINDING, sizeof(CLUSTER_BLOCK), &m_clusterBlock);
+	m_shadowBuffer = CreateBuffer(SHADOW_BLOCK_BINDING, sizeof(SHADOW_BLOCK), &m_shadowBlock);
+	if (m_streamBuffer.Create() == false)
+	{
+		std::cout << "Persistent buffer mapping is not supported, uploading buffers directly" << std::endl;
+	}
+
+	m_bCameraDirty = false;
+	m_bLightsDirty = false;
+	m_bMaterialsDirty = false;
+	m_bTexturesDirty = false;
+	m_bClustersDirty = false;
+	m_bShadowsDirty = false;
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the uniform buffer objects.
+ ***********************************************************/
+void UniformBufferManager::DestroyBuffers()
+{
+	if (m_cameraBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_cameraBuffer);
+		glDeleteBuffers(1, &m_lightBuffer);
+		glDeleteBuffers(1, &m_materialBuffer);
+		glDeleteBuffers(1, &m_textureBuffer);
+		glDeleteBuffers(1, &m_clusterBuffer);
+		glDeleteBuffers(1, &m_shadowBuffer);
+		m_cameraBuffer = 0;
+		m_lightBuffer = 0;
+		m_materialBuffer = 0;
+		m_textureBuffer = 0;
+		m_clusterBuffer = 0;
+		m_shadowBuffer = 0;
+	}
+	m_streamBuffer.Destroy();
+}
+
+/***********************************************************
+ *  GetStreamBuffer()
+ *
+ *  This method is used for getting the ring that the
+ *  changing buffers of each frame are uploaded through.
+ ***********************************************************/
+StreamBuffer* UniformBufferManager::GetStreamBuffer()
+{
+	return(&m_streamBuffer);
+}
+
+/***********************************************************
+ *  BindBlock()
+ *
+ *  This method is used for connecting a uniform block of a
+ *  program to a binding point.  Blocks that are not used by
+ *  the program are skipped.
+ ***********************************************************/
+void UniformBufferManager::BindBlock(GLuint programID, const char* blockName, GLuint binding)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(programID, blockName);
+
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programID, blockIndex, binding);
+	}
+}
+
+/***********************************************************
+ *  BindProgram()
+ *
+ *  This method is used for connecting the uniform blocks of
+ *  a linked shader program to the binding points of the
+ *  buffers.  It only needs to be called once per program.
+ ***********************************************************/
+void UniformBufferManager::BindProgram(GLuint programID)
+{
+	if (programID == 0)
+	{
+		return;
+	}
+
+	BindBlock(programID, g_CameraBlockName, CAMERA_BLOCK_BINDING);
+	BindBlock(programID, g_LightBlockName, LIGHT_BLOCK_BINDING);
+	BindBlock(programID, g_MaterialBlockName, MATERIAL_BLOCK_BINDING);
+	BindBlock(programID, g_TextureBlockName, TEXTURE_BLOCK_BINDING);
+	BindBlock(programID, g_ClusterBlockName, CLUSTER_BLOCK_BINDING);
+	BindBlock(programID, g_ShadowBlockName, SHADOW_BLOCK_BINDING);
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for setting the per-frame camera
+ *  values.
+ ***********************************************************/
+void UniformBufferManager::SetCamera(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3 viewPosition)
+{
+	m_cameraBlock.view = view;
+	m_cameraBlock.projection = projection;
+	m_cameraBlock.viewPosition = glm::vec4(viewPosition, 1.0f);
+	m_bCameraDirty = true;
+}
+
+/***********************************************************
+ *  GetCamera()
+ *
+ *  This method is used for getting the current camera values.
+ ***********************************************************/
+const UniformBufferManager::CAMERA_BLOCK& UniformBufferManager::GetCamera() const
+{
+	return(m_cameraBlock);
+}
+
+/***********************************************************
+ *  SetDirectionalLight()
+ *
+ *  This method is used for setting the directional light.
+ ***********************************************************/
+void UniformBufferManager::SetDirectionalLight(
+	glm::vec3 direction,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular,
+	bool bActive)
+{
+	DIRECTIONAL_LIGHT& light = m_lightBlock.directionalLight;
+
+	light.direction = direction;
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	light.bActive = (bActive == true) ? 1 : 0;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  SetSpotLight()
+ *
+ *  This method is used for setting the spot light.
+ ***********************************************************/
+void UniformBufferManager::SetSpotLight(const SPOT_LIGHT& spotLight)
+{
+	m_lightBlock.spotLight = spotLight;
+	m_bLightsDirty = true;
+}
+
+/***********************************************************
+ *  GetLights()
+ *
+ *  This method is used for getting the current scene lights.
+ ***********************************************************/
+const UniformBufferManager::LIGHT_BLOCK& UniformBufferManager::GetLights() const
+{
+	return(m_lightBlock);
+}
+
+/***********************************************************
+ *  SetMaterial()
+ *
+ *  This method is used for setting an entry of the material
+ *  table that the instanced draws select by index.
+ ***********************************************************/
+void UniformBufferManager::SetMaterial(
+	int index,
+	glm::vec3 diffuseColor,
+	glm::vec3 specularColor,
+	float shininess)
+{
+	if ((index < 0) || (index >= MAX_MATERIALS))
+	{
+		return;
+	}
+
+	MATERIAL_DATA& material = m_materialBlock.materials[index];
+
+	material.diffuseColor = diffuseColor;
+	material.specularColor = specularColor;
+	material.shininess = shininess;
+	m_bMaterialsDirty = true;
+}
+
+/***********************************************************
+ *  SetTextureLocation()
+ *
+ *  This method is used for setting the texture array and
+ *  layer that an entry of the texture table is stored in.
+ ***********************************************************/
+void UniformBufferManager::SetTextureLocation(
+	int index,
+	int arrayIndex,
+	int layer)
+{
+	if ((index < 0) || (index >= MAX_TEXTURES))
+	{
+		return;
+	}
+
+	TEXTURE_LOCATION& location = m_textureBlock.textures[index];
+
+	if ((location.arrayIndex != arrayIndex) || (location.layer != layer))
+	{
+		location.arrayIndex = arrayIndex;
+		location.layer = layer;
+		m_bTexturesDirty = true;
+	}
+}
+
+/***********************************************************
+ *  SetClusterGrid()
+ *
+ *  This method is used for setting the size of the light
+ *  cluster grid and how view space distances map onto its
+ *  depth slices.  The block is only marked as changed when
+ *  the values are different, such as after the projection
+ *  has changed.
+ ***********************************************************/
+void UniformBufferManager::SetClusterGrid(
+	int gridX,
+	int gridY,
+	int gridZ,
+	float zNear,
+	float zFar,
+	float sliceScale,
+	float sliceBias)
+{
+	if ((m_clusterBlock.gridX != gridX) ||
+		(m_clusterBlock.gridY != gridY) ||
+		(m_clusterBlock.gridZ != gridZ) ||
+		(m_clusterBlock.zNear != zNear) ||
+		(m_clusterBlock.zFar != zFar) ||
+		(m_clusterBlock.sliceScale != sliceScale) ||
+		(m_clusterBlock.sliceBias != sliceBias))
+	{
+		m_clusterBlock.gridX = gridX;
+		m_clusterBlock.gridY = gridY;
+		m_clusterBlock.gridZ = gridZ;
+		m_clusterBlock.zNear = zNear;
+		m_clusterBlock.zFar = zFar;
+		m_clusterBlock.sliceScale = sliceScale;
+		m_clusterBlock.sliceBias = sliceBias;
+		m_bClustersDirty = true;
+	}
+}
+
+/***********************************************************
+ *  UpdateBuffers()
+ *
+ *  This method is used for writing every changed block to
+ *  its buffer with a single upload each.
+ ***********************************************************/
+void UniformBufferManager::UpdateBuffers()
+{
+	int uploadCount = 0;
+
+	if ((m_bCameraDirty == true) && (m_cameraBuffer != 0))
+	{
+		m_streamBuffer.Upload(m_cameraBuffer, 0, &m_cameraBlock, sizeof(CAMERA_BLOCK));
+		m_bCameraDirty = false;
+		uploadCount++;
+	}
+	if ((m_bLightsDirty == true) && (m_lightBuffer != 0))
+	{
+		m_streamBuffer.Upload(m_lightBuffer, 0, &m_lightBlock, sizeof(LIGHT_BLOCK));
+		m_bLightsDirty = false;
+		uploadCount++;
+	}
+	if ((m_bMaterialsDirty == true) && (m_materialBuffer != 0))
+	{
+		m_streamBuffer.Upload(m_materialBuffer, 0, &m_materialBlock, sizeof(MATERIAL_BLOCK));
+		m_bMaterialsDirty = false;
+		uploadCount++;
+	}
+	if ((m_bTexturesDirty == true) && (m_textureBuffer != 0))
+	{
+		m_streamBuffer.Upload(m_textureBuffer, 0, &m_textureBlock, sizeof(TEXTURE_BLOCK));
+		m_bTexturesDirty = false;
+		uploadCount++;
+	}
+	if ((m_bClustersDirty == true) && (m_clusterBuffer != 0))
+	{
+		m_streamBuffer.Upload(m_clusterBuffer, 0, &m_clusterBlock, sizeof(CLUSTER_BLOCK));
+		m_bClustersDirty = false;
+		uploadCount++;
+	}
+	if ((m_bShadowsDirty == true) && (m_shadowBuffer != 0))
+	{
+		m_streamBuffer.Upload(m_shadowBuffer, 0, &m_shadowBlock, sizeof(SHADOW_BLOCK));
+		m_bShadowsDirty = false;
+		uploadCount++;
+	}
+
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_UPLOADS, uploadCount);
+}
+
+/***********************************************************
+ *  SetShadows()
+ *
+ *  This method is used for setting the light space matrices
+ *  of the shadow cascades and the point light shadows.  The
+ *  block is only marked as changed when the values differ,
+ *  which is the case when a shadow map was rendered again.
+ ***********************************************************/
+void UniformBufferManager::SetShadows(const SHADOW_BLOCK& shadows)
+{
+	if (memcmp(&m_shadowBlock, &shadows, sizeof(SHADOW_BLOCK)) != 0)
+	{
+		m_shadowBlock = shadows;
+		m_bShadowsDirty = true;
+	}
+}
@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffers.h
+// ============
+// manage the uniform buffer objects shared by all of the shader programs
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  UniformBufferManager
+ *
+ *  This class contains the std140 uniform blocks for the
+ *  per-frame camera values, the scene lights, the table
+ *  of object materials, the table of texture locations, the
+ *  light cluster grid and the shadow maps.  Each block is
+ *  kept in a local copy and written to its buffer through
+ *  the stream buffer only when it has changed.  The stream
+ *  buffer is shared with the other managers, so every
+ *  buffer that changes while the scene is drawn is uploaded
+ *  the same way.  The buffers stay bound to fixed binding
+ *  points, so switching between shader programs does not
+ *  lose any of the values.
+ ***********************************************************/
+class UniformBufferManager
+{
+public:
+	// constructor
+	UniformBufferManager();
+	// destructor
+	~UniformBufferManager();
+
+	// binding points of the uniform blocks
+	static const GLuint CAMERA_BLOCK_BINDING = 0;
+	static const GLuint LIGHT_BLOCK_BINDING = 1;
+	static const GLuint MATERIAL_BLOCK_BINDING = 2;
+	static const GLuint TEXTURE_BLOCK_BINDING = 3;
+	static const GLuint CLUSTER_BLOCK_BINDING = 4;
+	static const GLuint SHADOW_BLOCK_BINDING = 5;
+
+	// these sizes must match the defines in fragmentShader.glsl
+	static const int MAX_MATERIALS = 16;
+	static const int MAX_TEXTURES = 256;
+	static const int MAX_SHADOW_CASCADES = 4;
+	static const int MAX_POINT_SHADOWS = 4;
+
+	// the following structures follow the std140 layout of
+	// the matching blocks and structures in the shader code
+	struct CAMERA_BLOCK
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		// xyz is the camera position, w is unused
+		glm::vec4 viewPosition;
+	};
+
+	struct DIRECTIONAL_LIGHT
+	{
+		glm::vec3 direction;
+		float pad0;
+		glm::vec3 ambient;
+		float pad1;
+		glm::vec3 diffuse;
+		float pad2;
+		glm::vec3 specular;
+		int bActive;
+	};
+
+	struct SPOT_LIGHT
+	{
+		glm::vec3 position;
+		float pad0;
+		glm::vec3 direction;
+		float cutOff;
+		float outerCutOff;
+		float constant;
+		float linear;
+		float quadratic;
+		glm::vec3 ambient;
+		float pad1;
+		glm::vec3 diffuse;
+		float pad2;
+		glm::vec3 specular;
+		int bActive;
+	};
+
+	// the point lights are sorted into clusters by the
+	// LightManager and are not part of this block
+	struct LIGHT_BLOCK
+	{
+		DIRECTIONAL_LIGHT directionalLight;
+		SPOT_LIGHT spotLight;
+	};
+
+	struct MATERIAL_DATA
+	{
+		glm::vec3 diffuseColor;
+		float pad0;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	struct MATERIAL_BLOCK
+	{
+		MATERIAL_DATA materials[MAX_MATERIALS];
+	};
+
+	// where a scene texture is stored - an ivec4 in the shader
+	struct TEXTURE_LOCATION
+	{
+		int arrayIndex;
+		int layer;
+		int pad0;
+		int pad1;
+	};
+
+	struct TEXTURE_BLOCK
+	{
+		TEXTURE_LOCATION textures[MAX_TEXTURES];
+	};
+
+	// the size of the light cluster grid and how view space
+	// distances map onto its depth slices
+	struct CLUSTER_BLOCK
+	{
+		int gridX;
+		int gridY;
+		int gridZ;
+		int pad0;
+		float zNear;
+		float zFar;
+		// slice = log(distance) * sliceScale + sliceBias
+		float sliceScale;
+		float sliceBias;
+	};
+
+	// the light space matrices of the shadow cascades and the
+	// point lights that cast shadows
+	struct SHADOW_BLOCK
+	{
+		glm::mat4 cascadeMatrices[MAX_SHADOW_CASCADES];
+		// the view space distance each cascade reaches to
+		glm::vec4 cascadeSplits;
+		// xyz is the light position, w is the far plane
+		glm::vec4 pointShadows[MAX_POINT_SHADOWS];
+		int cascadeCount;
+		int pointShadowCount;
+		int pad0;
+		int pad1;
+	};
+
+private:
+	// the uniform buffer objects
+	GLuint m_cameraBuffer;
+	GLuint m_lightBuffer;
+	GLuint m_materialBuffer;
+	GLuint m_textureBuffer;
+	GLuint m_clusterBuffer;
+	GLuint m_shadowBuffer;
+
+	// local copies of the block values
+	CAMERA_BLOCK m_cameraBlock;
+	LIGHT_BLOCK m_lightBlock;
+	MATERIAL_BLOCK m_materialBlock;
+	TEXTURE_BLOCK m_textureBlock;
+	CLUSTER_BLOCK m_clusterBlock;
+	SHADOW_BLOCK m_shadowBlock;
+
+	// set when a local copy differs from its buffer
+	bool m_bCameraDirty;
+	bool m_bLightsDirty;
+	bool m_bMaterialsDirty;
+	bool m_bTexturesDirty;
+	bool m_bClustersDirty;
+	bool m_bShadowsDirty;
+
+	// the ring every changing buffer is uploaded through
+	StreamBuffer m_streamBuffer;
+
+	// create a buffer and bind it to its binding point
+	GLuint CreateBuffer(GLuint binding, GLsizeiptr size, const void* data);
+	// connect a uniform block of a program to a binding point
+	void BindBlock(GLuint programID, const char* blockName, GLuint binding);
+
+public:
+	// create the uniform buffer objects
+	void CreateBuffers();
+	// free the uniform buffer objects
+	void DestroyBuffers();
+	// the ring the changing buffers of each frame are uploaded
+	// through
+	StreamBuffer* GetStreamBuffer();
+	// connect the uniform blocks of a linked program to the
+	// binding points of the buffers
+	void BindProgram(GLuint programID);
+
+	// set the per-frame camera values
+	void SetCamera(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3 viewPosition);
+	const CAMERA_BLOCK& GetCamera() const;
+
+	// set the scene lights
+	void SetDirectionalLight(
+		glm::vec3 direction,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular,
+		bool bActive);
+	void SetSpotLight(const SPOT_LIGHT& spotLight);
+	const LIGHT_BLOCK& GetLights() const;
+
+	// set an entry of the material table
+	void SetMaterial(
+		int index,
+		glm::vec3 diffuseColor,
+		glm::vec3 specularColor,
+		float shininess);
+
+	// set where an entry of the texture table is stored
+	void SetTextureLocation(
+		int index,
+		int arrayIndex,
+		int layer);
+
+	// set the size and depth mapping of the light cluster grid
+	void SetClusterGrid(
+		int gridX,
+		int gridY,
+		int gridZ,
+		float zNear,
+		float zFar,
+		float sliceScale,
+		float sliceBias);
+
+	// set the shadow cascades and point light shadows
+	void SetShadows(const SHADOW_BLOCK& shadows);
+
+	// write every changed block to its buffer
+	void UpdateBuffers();
+};
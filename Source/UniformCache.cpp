@@ -0,0 +1,306 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.cpp
+// ============
+// cache the uniform locations and values of a linked shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformCache.h"
+#include "FrameProfiler.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+/***********************************************************
+ *  ShaderUniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderUniformCache::ShaderUniformCache()
+{
+	m_programID = 0;
+	m_uploadCount = 0;
+	m_skippedCount = 0;
+}
+
+/***********************************************************
+ *  ~ShaderUniformCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderUniformCache::~ShaderUniformCache()
+{
+	m_uniforms.clear();
+	m_handleLookup.clear();
+}
+
+/***********************************************************
+ *  SetProgram()
+ *
+ *  This method is used for setting the linked program that
+ *  the uniforms belong to.  The locations of the handles
+ *  that were already handed out are resolved again, so the
+ *  handles stay valid after a program has been relinked.
+ ***********************************************************/
+void ShaderUniformCache::SetProgram(GLuint programID)
+{
+	m_programID = programID;
+
+	for (size_t i = 0; i < m_uniforms.size(); i++)
+	{
+		m_uniforms[i].location = -1;
+		if (m_programID != 0)
+		{
+			m_uniforms[i].location = glGetUniformLocation(
+				m_programID,
+				m_uniforms[i].name.c_str());
+		}
+	}
+
+	Invalidate();
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the linked program that
+ *  the uniforms belong to.
+ ***********************************************************/
+GLuint ShaderUniformCache::GetProgram() const
+{
+	return(m_programID);
+}
+
+/***********************************************************
+ *  GetHandle()
+ *
+ *  This method is used for getting the handle of a uniform.
+ *  The location is only looked up the first time a name is
+ *  passed in.
+ ***********************************************************/
+int ShaderUniformCache::GetHandle(const std::string& name)
+{
+	std::unordered_map<std::string, int>::const_iterator found =
+		m_handleLookup.find(name);
+	if (found != m_handleLookup.end())
+	{
+		return(found->second);
+	}
+
+	UNIFORM_ENTRY entry;
+	entry.name = name;
+	entry.location = -1;
+	if (m_programID != 0)
+	{
+		entry.location = glGetUniformLocation(m_programID, name.c_str());
+	}
+	memset(entry.value, 0, sizeof(entry.value));
+	entry.bValid = false;
+
+	int handle = (int)m_uniforms.size();
+	m_uniforms.push_back(entry);
+	m_handleLookup[name] = handle;
+
+	return(handle);
+}
+
+/***********************************************************
+ *  IsActive()
+ *
+ *  This method is used for checking whether the uniform of
+ *  a handle is used by the linked program.
+ ***********************************************************/
+bool ShaderUniformCache::IsActive(int handle) const
+{
+	if ((handle < 0) || (handle >= (int)m_uniforms.size()))
+	{
+		return(false);
+	}
+
+	return(m_uniforms[handle].location >= 0);
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting the local copies of
+ *  the uploaded values.
+ ***********************************************************/
+void ShaderUniformCache::Invalidate()
+{
+	for (size_t i = 0; i < m_uniforms.size(); i++)
+	{
+		m_uniforms[i].bValid = false;
+	}
+}
+
+/***********************************************************
+ *  StoreValue()
+ *
+ *  This method is used for comparing a value against the
+ *  local copy of the last uploaded value.  It returns true
+ *  when the value has changed and needs to be uploaded.
+ ***********************************************************/
+bool ShaderUniformCache::StoreValue(int handle, const float* value, int count)
+{
+	if ((handle < 0) || (handle >= (int)m_uniforms.size()) ||
+		(m_uniforms[handle].location < 0))
+	{
+		return(false);
+	}
+
+	UNIFORM_ENTRY& entry = m_uniforms[handle];
+	if ((entry.bValid == true) &&
+		(memcmp(entry.value, value, count * sizeof(float)) == 0))
+	{
+		m_skippedCount++;
+		return(false);
+	}
+
+	memcpy(entry.value, value, count * sizeof(float));
+	entry.bValid = true;
+	m_uploadCount++;
+	FrameProfiler::AddCount(FrameProfiler::COUNTER_UNIFORM_UPLOADS, 1);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetBool()
+ *
+ *  This method is used for setting a bool uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetBool(int handle, bool value)
+{
+	SetInt(handle, (value == true) ? 1 : 0);
+}
+
+/***********************************************************
+ *  SetInt()
+ *
+ *  This method is used for setting an int or sampler uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetInt(int handle, int value)
+{
+	float stored = 0.0f;
+
+	// the bits of the integer are stored in the local copy
+	memcpy(&stored, &value, sizeof(float));
+	if (StoreValue(handle, &stored, 1) == true)
+	{
+		glUniform1i(m_uniforms[handle].location, value);
+	}
+}
+
+/***********************************************************
+ *  SetFloat()
+ *
+ *  This method is used for setting a float uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetFloat(int handle, float value)
+{
+	if (StoreValue(handle, &value, 1) == true)
+	{
+		glUniform1f(m_uniforms[handle].location, value);
+	}
+}
+
+/***********************************************************
+ *  SetVec2()
+ *
+ *  This method is used for setting a vec2 uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetVec2(int handle, const glm::vec2& value)
+{
+	const float values[2] = { value.x, value.y };
+
+	if (StoreValue(handle, values, 2) == true)
+	{
+		glUniform2fv(m_uniforms[handle].location, 1, values);
+	}
+}
+
+/***********************************************************
+ *  SetVec3()
+ *
+ *  This method is used for setting a vec3 uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetVec3(int handle, const glm::vec3& value)
+{
+	if (StoreValue(handle, glm::value_ptr(value), 3) == true)
+	{
+		glUniform3fv(m_uniforms[handle].location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetVec4()
+ *
+ *  This method is used for setting a vec4 uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetVec4(int handle, const glm::vec4& value)
+{
+	if (StoreValue(handle, glm::value_ptr(value), 4) == true)
+	{
+		glUniform4fv(m_uniforms[handle].location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetMat3()
+ *
+ *  This method is used for setting a mat3 uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetMat3(int handle, const glm::mat3& value)
+{
+	if (StoreValue(handle, glm::value_ptr(value), 9) == true)
+	{
+		glUniformMatrix3fv(m_uniforms[handle].location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetMat4()
+ *
+ *  This method is used for setting a mat4 uniform.
+ ***********************************************************/
+void ShaderUniformCache::SetMat4(int handle, const glm::mat4& value)
+{
+	if (StoreValue(handle, glm::value_ptr(value), 16) == true)
+	{
+		glUniformMatrix4fv(m_uniforms[handle].location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  GetUploadCount()
+ *
+ *  This method is used for getting the number of values
+ *  that were uploaded since the counters were reset.
+ ***********************************************************/
+int ShaderUniformCache::GetUploadCount() const
+{
+	return(m_uploadCount);
+}
+
+/***********************************************************
+ *  GetSkippedCount()
+ *
+ *  This method is used for getting the number of unchanged
+ *  values that were skipped since the counters were reset.
+ ***********************************************************/
+int ShaderUniformCache::GetSkippedCount() const
+{
+	return(m_skippedCount);
+}
+
+/***********************************************************
+ *  ResetCounters()
+ *
+ *  This method is used for resetting the upload counters.
+ ***********************************************************/
+void ShaderUniformCache::ResetCounters()
+{
+	m_uploadCount = 0;
+	m_skippedCount = 0;
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// cache the uniform locations and values of a linked shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  ShaderUniformCache
+ *
+ *  This class resolves the uniform locations of a linked
+ *  shader program once and hands out integer handles for
+ *  them.  The setters take a handle instead of a name, so
+ *  no glGetUniformLocation() string lookup is done while
+ *  rendering.  A local copy of every uploaded value is kept,
+ *  and uploads of unchanged values are skipped.  The program
+ *  needs to be in use when any of the setters are called.
+ ***********************************************************/
+class ShaderUniformCache
+{
+public:
+	// constructor
+	ShaderUniformCache();
+	// destructor
+	~ShaderUniformCache();
+
+	// the handle that is returned for unknown uniforms - the
+	// setters silently ignore it
+	static const int INVALID_HANDLE = -1;
+
+private:
+	struct UNIFORM_ENTRY
+	{
+		std::string name;
+		GLint location;
+		// local copy of the last uploaded value
+		float value[16];
+		bool bValid;
+	};
+
+	// the linked program the locations belong to
+	GLuint m_programID;
+	// the resolved uniforms, indexed by handle
+	std::vector<UNIFORM_ENTRY> m_uniforms;
+	// lookup of handles by uniform name
+	std::unordered_map<std::string, int> m_handleLookup;
+	// number of values that were uploaded and skipped
+	int m_uploadCount;
+	int m_skippedCount;
+
+	// compare the passed in value against the local copy and
+	// store it - returns true when it needs to be uploaded
+	bool StoreValue(int handle, const float* value, int count);
+
+public:
+	// set the linked program and resolve the locations of
+	// all the handles that were already handed out again
+	void SetProgram(GLuint programID);
+	GLuint GetProgram() const;
+
+	// get the handle of a uniform by name - this should be
+	// done once and the handle kept for the hot paths
+	int GetHandle(const std::string& name);
+	// check whether the uniform of a handle is used by the program
+	bool IsActive(int handle) const;
+
+	// forget the local copies, so that the next values are
+	// always uploaded - needed when the uniforms may have
+	// been changed outside of this class
+	void Invalidate();
+
+	// the handle based setters
+	void SetBool(int handle, bool value);
+	void SetInt(int handle, int value);
+	void SetFloat(int handle, float value);
+	void SetVec2(int handle, const glm::vec2& value);
+	void SetVec3(int handle, const glm::vec3& value);
+	void SetVec4(int handle, const glm::vec4& value);
+	void SetMat3(int handle, const glm::mat3& value);
+	void SetMat4(int handle, const glm::mat4& value);
+
+	// get and reset the upload counters
+	int GetUploadCount() const;
+	int GetSkippedCount() const;
+	void ResetCounters();
+};
@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "FrameProfiler.h"
+#include "SceneManager.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
@@ -20,8 +22,12 @@ namespace
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
+
+	// the size of the framebuffer of the window in pixels, which
+	// is larger than the window on high DPI displays and follows
+	// the window when it is resized
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,13 +38,40 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
-
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// set while the profiler overlay key is held down, so the
+	// overlay is toggled once per key press
+	bool gOverlayKeyDown = false;
+	// set while the projection keys are held down, so the
+	// projection is switched once per key press
+	bool gPerspectiveKeyDown = false;
+	bool gOrthographicKeyDown = false;
+
+	// set while the culling key is held down, so the culling
+	// mode is switched once per key press
+	bool gCullingKeyDown = false;
+	// set while the transparency key is held down, so the
+	// transparency mode is switched once per key press
+	bool gTransparencyKeyDown = false;
+	// set while the depth pre-pass key is held down, so the
+	// pre-pass is toggled once per key press
+	bool gDepthPrepassKeyDown = false;
+	// set while the pick button is held down, so one object
+	// is picked per click
+	bool gPickButtonDown = false;
+	// the farthest an object can be picked from the camera
+	const float g_PickDistance = 1000.0f;
+
+	// set while the path recording keys are held down, so a
+	// key is added or the path is saved once per key press
+	bool gRecordKeyDown = false;
+	bool gSaveKeyDown = false;
+
+	// the file the recorded camera path is saved into
+	const char* g_RecordedPathFile = "camera_path.txt";
 }
 
 /***********************************************************
@@ -51,7 +84,12 @@ ViewManager::ViewManager(
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pUniformBuffers = NULL;
+	m_pSceneManager = NULL;
 	m_pWindow = NULL;
+	m_pCameraPath = NULL;
+	m_playbackTime = 0.0f;
+	m_recordStartTime = 0.0f;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -59,6 +97,8 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+	m_lastStepPosition = g_pCamera->Position;
+	m_interpolation = 1.0f;
 }
 
 /***********************************************************
@@ -70,7 +110,10 @@ ViewManager::~ViewManager()
 {
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pUniformBuffers = NULL;
+	m_pSceneManager = NULL;
 	m_pWindow = NULL;
+	m_pCameraPath = NULL;
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -110,15 +153,82 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to receive mouse scrolling events
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// this callback is used to receive the new size of the
+	// framebuffer when the window is resized
+	glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+
+	// blending is left off - the scene manager only turns it
+	// on while the transparent objects are drawn
+
+	// enable z-depth and set the color the frames are cleared
+	// to - nothing changes these, so they are only set once
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
 	m_pWindow = window;
 
 	return(window);
 }
 
+/***********************************************************
+ *  SetUniformBuffers()
+ *
+ *  This method is used for setting the uniform buffers that
+ *  receive the per-frame camera values.
+ ***********************************************************/
+void ViewManager::SetUniformBuffers(UniformBufferManager* pUniformBuffers)
+{
+	m_pUniformBuffers = pUniformBuffers;
+}
+
+/***********************************************************
+ *  SetSceneManager()
+ *
+ *  This method is used for setting the scene whose settings
+ *  are switched with the keyboard.
+ ***********************************************************/
+void ViewManager::SetSceneManager(SceneManager* pSceneManager)
+{
+	m_pSceneManager = pSceneManager;
+}
+
+/***********************************************************
+ *  SetCameraPath()
+ *
+ *  This method is used for setting the camera path that is
+ *  played back.  While a path is set, the camera follows it
+ *  and the keyboard and mouse do not move the camera.
+ ***********************************************************/
+void ViewManager::SetCameraPath(CameraPath* pCameraPath)
+{
+	m_pCameraPath = pCameraPath;
+	m_playbackTime = 0.0f;
+}
+
+/***********************************************************
+ *  SetPlaybackTime()
+ *
+ *  This method is used for setting the time on the camera
+ *  path that the next frame is rendered at.
+ ***********************************************************/
+void ViewManager::SetPlaybackTime(float playbackTime)
+{
+	m_playbackTime = playbackTime;
+}
+
+/***********************************************************
+ *  SetInterpolation()
+ *
+ *  This method is used for setting how far the next frame
+ *  is between the last camera step and the next one, which
+ *  places the rendered camera between the two steps.
+ ***********************************************************/
+void ViewManager::SetInterpolation(float interpolation)
+{
+	m_interpolation = glm::clamp(interpolation, 0.0f, 1.0f);
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -161,64 +271,231 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, doub
 	g_pCamera->ProcessMouseScroll(static_cast<float>(yOffset));
 }
 
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the active GLFW display window changes
+ *  size, such as when the window is resized or moved to a
+ *  display with a different pixel density.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+}
+
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used for getting the size of the
+ *  framebuffer of the display window in pixels.  The size
+ *  is zero while the window is minimized.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = gFramebufferWidth;
+	height = gFramebufferHeight;
+}
+
 
 /***********************************************************
- *  ProcessKeyboardEvents()
+ *  ProcessInput()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is called once per frame, after the events
+ *  were polled, to handle the keys that switch settings or
+ *  start actions.  Each of these acts once when its key goes
+ *  down, no matter how many frames the key is held for.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::ProcessInput()
 {
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
+
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
+	// Toggle to Perspective Projection when 'P' is pressed
+	bool bPerspectiveKey = (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS);
+	if ((bPerspectiveKey == true) && (gPerspectiveKeyDown == false))
+	{
+		bOrthographicProjection = false;
+		std::cout << "Switched to Perspective Projection" << std::endl;
+	}
+	gPerspectiveKeyDown = bPerspectiveKey;
+
+	// Toggle to Orthographic Projection when 'O' is pressed
+	bool bOrthographicKey = (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS);
+	if ((bOrthographicKey == true) && (gOrthographicKeyDown == false))
+	{
+		bOrthographicProjection = true;
+		std::cout << "Switched to Orthographic Projection" << std::endl;
+	}
+	gOrthographicKeyDown = bOrthographicKey;
+
+	// Toggle the profiler overlay when 'F1' is pressed
+	bool bOverlayKey = (glfwGetKey(m_pWindow, GLFW_KEY_F1) == GLFW_PRESS);
+	FrameProfiler* pProfiler = FrameProfiler::GetActive();
+	if ((bOverlayKey == true) && (gOverlayKeyDown == false) && (NULL != pProfiler))
+	{
+		pProfiler->SetOverlayVisible(!pProfiler->IsOverlayVisible());
+	}
+	gOverlayKeyDown = bOverlayKey;
+
+	// Switch to the next culling mode when 'G' is pressed -
+	// a mode the driver cannot run is skipped
+	bool bCullingKey = (glfwGetKey(m_pWindow, GLFW_KEY_G) == GLFW_PRESS);
+	if ((bCullingKey == true) && (gCullingKeyDown == false) && (NULL != m_pSceneManager))
+	{
+		int mode = (int)m_pSceneManager->GetCullingMode();
+		mode = (mode + 1) % SceneManager::CULL_MODE_COUNT;
+		if (m_pSceneManager->SetCullingMode((SceneManager::CULLING_MODE)mode) == false)
+		{
+			m_pSceneManager->SetCullingMode(SceneManager::CULL_CPU);
+		}
+		std::cout << "Switched to " << SceneManager::GetCullingModeName(m_pSceneManager->GetCullingMode())
+			<< " culling" << std::endl;
+	}
+	gCullingKeyDown = bCullingKey;
+
+	// Switch to the next transparency mode when 'T' is pressed
+	bool bTransparencyKey = (glfwGetKey(m_pWindow, GLFW_KEY_T) == GLFW_PRESS);
+	if ((bTransparencyKey == true) && (gTransparencyKeyDown == false) && (NULL != m_pSceneManager))
+	{
+		int mode = (int)m_pSceneManager->GetTransparencyMode();
+		mode = (mode + 1) % SceneManager::TRANSPARENCY_MODE_COUNT;
+		if (m_pSceneManager->SetTransparencyMode((SceneManager::TRANSPARENCY_MODE)mode) == false)
+		{
+			m_pSceneManager->SetTransparencyMode(SceneManager::TRANSPARENCY_SORTED);
+		}
+		std::cout << "Switched to " << SceneManager::GetTransparencyModeName(m_pSceneManager->GetTransparencyMode())
+			<< " transparency" << std::endl;
+	}
+	gTransparencyKeyDown = bTransparencyKey;
+
+	// Toggle the depth pre-pass when 'Z' is pressed
+	bool bDepthPrepassKey = (glfwGetKey(m_pWindow, GLFW_KEY_Z) == GLFW_PRESS);
+	if ((bDepthPrepassKey == true) && (gDepthPrepassKeyDown == false) && (NULL != m_pSceneManager))
+	{
+		m_pSceneManager->SetDepthPrepass(m_pSceneManager->IsDepthPrepassEnabled() == false);
+		std::cout << "Switched the depth pre-pass " << ((m_pSceneManager->IsDepthPrepassEnabled() == true) ? "on" : "off")
+			<< std::endl;
+	}
+	gDepthPrepassKeyDown = bDepthPrepassKey;
+
+	// Pick the object in the middle of the view when the left
+	// mouse button is clicked - the cursor is captured by the
+	// camera, so the ray goes straight out of the camera
+	bool bPickButton = (glfwGetMouseButton(m_pWindow, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
+	if ((bPickButton == true) && (gPickButtonDown == false) && (NULL != m_pSceneManager))
+	{
+		int item = m_pSceneManager->PickRenderItem(
+			g_pCamera->Position,
+			glm::normalize(g_pCamera->Front),
+			g_PickDistance);
+		if (item >= 0)
+		{
+			std::cout << "Picked render item " << item << std::endl;
+		}
+		else
+		{
+			std::cout << "Nothing was picked" << std::endl;
+		}
+	}
+	gPickButtonDown = bPickButton;
+
+	ProcessRecordingEvents();
+}
+
+/***********************************************************
+ *  UpdateCamera()
+ *
+ *  This method is called for each simulation step to move
+ *  the camera with the keys that are held down.  The step
+ *  length is fixed, so the camera moves the same distance
+ *  each second at any frame rate.  The position before the
+ *  step is kept, so the frames can be drawn in between.
+ ***********************************************************/
+void ViewManager::UpdateCamera(float deltaTime)
+{
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
+
+	m_lastStepPosition = g_pCamera->Position;
+
 	// process camera zooming in and out
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(FORWARD, deltaTime);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
 	}
 
 	// process camera panning left and right
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(LEFT, deltaTime);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(RIGHT, deltaTime);
 	}
 
 	// process camera up and down
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		g_pCamera->ProcessKeyboard(UP, deltaTime);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		g_pCamera->ProcessKeyboard(DOWN, deltaTime);
 	}
+}
 
-	// Toggle to Perspective Projection when 'P' is pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
+/***********************************************************
+ *  ProcessRecordingEvents()
+ *
+ *  This method is used for recording a camera path from the
+ *  live camera.  Each press of 'K' adds the camera as a key
+ *  at the time since the first key, and 'L' saves the keys
+ *  so that a benchmark run can play them back.
+ ***********************************************************/
+void ViewManager::ProcessRecordingEvents()
+{
+	bool bRecordKey = (glfwGetKey(m_pWindow, GLFW_KEY_K) == GLFW_PRESS);
+	if ((bRecordKey == true) && (gRecordKeyDown == false))
 	{
-		bOrthographicProjection = false;
-		std::cout << "Switched to Perspective Projection" << std::endl;
+		float currentTime = glfwGetTime();
+		if (m_recordedPath.GetKeyCount() == 0)
+		{
+			m_recordStartTime = currentTime;
+		}
+		m_recordedPath.AddKey(
+			currentTime - m_recordStartTime,
+			g_pCamera->Position,
+			g_pCamera->Front);
+		std::cout << "Added camera path key " << m_recordedPath.GetKeyCount() << std::endl;
 	}
+	gRecordKeyDown = bRecordKey;
 
-	// Toggle to Orthographic Projection when 'O' is pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	bool bSaveKey = (glfwGetKey(m_pWindow, GLFW_KEY_L) == GLFW_PRESS);
+	if ((bSaveKey == true) && (gSaveKeyDown == false) && (m_recordedPath.GetKeyCount() > 0))
 	{
-		bOrthographicProjection = true;
-		std::cout << "Switched to Orthographic Projection" << std::endl;
+		if (m_recordedPath.SaveToFile(g_RecordedPathFile))
+		{
+			std::cout << "Saved the camera path to " << g_RecordedPathFile << std::endl;
+		}
 	}
+	gSaveKeyDown = bSaveKey;
 }
 
 /***********************************************************
@@ -233,14 +510,29 @@ void ViewManager::PrepareSceneView()
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// a camera path that is being played back places the camera
+	if (NULL != m_pCameraPath)
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		if (m_pCameraPath->Evaluate(m_playbackTime, position, front))
+		{
+			g_pCamera->Position = position;
+			g_pCamera->Front = front;
+		}
+	}
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// the keys move the camera in fixed steps, and a frame can
+	// run no steps or several, so the camera is drawn between
+	// the last two steps by how far the frame is into the next
+	// one, which keeps it moving smoothly at any refresh rate -
+	// a camera path or the orthographic view place it directly
+	glm::vec3 steppedPosition = g_pCamera->Position;
+	bool bInterpolated = (NULL == m_pCameraPath) && (bOrthographicProjection == false);
+	if (bInterpolated == true)
+	{
+		g_pCamera->Position = glm::mix(m_lastStepPosition, steppedPosition, m_interpolation);
+	}
 
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix();
@@ -259,18 +551,29 @@ void ViewManager::PrepareSceneView()
 	}
 	else
 	{
-		// Perspective Projection (3D view)
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		// Perspective Projection (3D view) - the aspect follows
+		// the framebuffer while the window is not minimized
+		GLfloat aspect = (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
+		if ((gFramebufferWidth > 0) && (gFramebufferHeight > 0))
+		{
+			aspect = (GLfloat)gFramebufferWidth / (GLfloat)gFramebufferHeight;
+		}
+		projection = glm::perspective(glm::radians(g_pCamera->Zoom), aspect, 0.1f, 100.0f);
+	}
+
+	// if the uniform buffers object is valid
+	if (NULL != m_pUniformBuffers)
+	{
+		// set the view matrix, projection matrix and the view
+		// position of the camera into the camera uniform buffer,
+		// which is written with a single buffer update
+		m_pUniformBuffers->SetCamera(view, projection, g_pCamera->Position);
+		m_pUniformBuffers->UpdateBuffers();
 	}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	// the next steps move on from the stepped position
+	if (bInterpolated == true)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		g_pCamera->Position = steppedPosition;
 	}
 }
\ No newline at end of file
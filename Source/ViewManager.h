@@ -9,12 +9,16 @@
 
 #pragma once
 
+#include "CameraPath.h"
 #include "ShaderManager.h"
+#include "UniformBuffers.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+class SceneManager;
+
 class ViewManager
 {
 public:
@@ -27,20 +31,61 @@ public:
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset);
+	// framebuffer size callback for resizing the window
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the shared uniform buffers
+	UniformBufferManager* m_pUniformBuffers;
+	// pointer to the scene whose settings the keys switch
+	SceneManager* m_pSceneManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// the camera path that is played back instead of the
+	// keyboard and mouse, and the time on it
+	CameraPath* m_pCameraPath;
+	float m_playbackTime;
+	// the camera position before the last simulation step, and
+	// how far the frame is between that step and the next
+	glm::vec3 m_lastStepPosition;
+	float m_interpolation;
+	// the path being recorded from the live camera, and the
+	// time its first key was added at
+	CameraPath m_recordedPath;
+	float m_recordStartTime;
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// add keys to the recorded path and save it
+	void ProcessRecordingEvents();
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// the size of the framebuffer of the window in pixels
+	void GetFramebufferSize(int& width, int& height) const;
+
+	// set the uniform buffers that receive the camera values
+	void SetUniformBuffers(UniformBufferManager* pUniformBuffers);
+	// set the scene whose settings the keys switch
+	void SetSceneManager(SceneManager* pSceneManager);
+
+	// play back a camera path, or pass NULL to give the camera
+	// back to the keyboard and mouse
+	void SetCameraPath(CameraPath* pCameraPath);
+	// set the time on the camera path for the next frame
+	void SetPlaybackTime(float playbackTime);
+	// set how far the next frame is between the last camera
+	// step and the next one, from 0 to 1
+	void SetInterpolation(float interpolation);
 	
+	// handle the key presses that switch settings or start
+	// actions - call once per frame after polling the events
+	void ProcessInput();
+	// move the camera with the keys that are held down for
+	// one simulation step
+	void UpdateCamera(float deltaTime);
+
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
 };
\ No newline at end of file
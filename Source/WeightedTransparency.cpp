@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////////
+// weightedtransparency.cpp
+// ============
+// composite the transparent objects without sorting them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WeightedTransparency.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the samplers and the uniform of the composite program
+	const char* g_AccumulationName = "accumulationTexture";
+	const char* g_RevealageName = "revealageTexture";
+	const char* g_ViewportOriginName = "viewportOrigin";
+
+	// the values the targets are cleared to - nothing added to
+	// the color, and all of the background showing through
+	const GLfloat g_AccumulationClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat g_RevealageClear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+}
+
+/***********************************************************
+ *  WeightedTransparency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WeightedTransparency::WeightedTransparency(UniformBufferManager* pUniformBuffers)
+	: m_shaderVariants(pUniformBuffers)
+{
+	m_compositeVariant = -1;
+	m_accumulationHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_revealageHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_viewportOriginHandle = ShaderUniformCache::INVALID_HANDLE;
+	m_framebuffer = 0;
+	m_accumulationTexture = 0;
+	m_revealageTexture = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	m_vertexArray = 0;
+	m_sceneFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_sceneViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~WeightedTransparency()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WeightedTransparency::~WeightedTransparency()
+{
+	DestroyResources();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  set a blend function for each target of a framebuffer.
+ ***********************************************************/
+bool WeightedTransparency::IsSupported()
+{
+	return((GLEW_VERSION_4_0 || GLEW_ARB_draw_buffers_blend) ? true : false);
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for compiling the program that
+ *  blends the targets over the scene.
+ ***********************************************************/
+bool WeightedTransparency::LoadShaders(const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+	if (m_shaderVariants.LoadSources(vertexShaderPath, fragmentShaderPath) == false)
+	{
+		return(false);
+	}
+
+	m_compositeVariant = m_shaderVariants.GetVariant(0);
+	if (m_compositeVariant < 0)
+	{
+		return(false);
+	}
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_shaderVariants.GetProgram(m_compositeVariant));
+	m_compositeUniforms.SetProgram(m_shaderVariants.GetProgram(m_compositeVariant));
+	m_accumulationHandle = m_compositeUniforms.GetHandle(g_AccumulationName);
+	m_revealageHandle = m_compositeUniforms.GetHandle(g_RevealageName);
+	m_viewportOriginHandle = m_compositeUniforms.GetHandle(g_ViewportOriginName);
+	m_compositeUniforms.SetInt(m_accumulationHandle, ACCUMULATION_UNIT);
+	m_compositeUniforms.SetInt(m_revealageHandle, REVEALAGE_UNIT);
+	glUseProgram((GLuint)previousProgram);
+
+	if (m_vertexArray == 0)
+	{
+		glGenVertexArrays(1, &m_vertexArray);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyResources()
+ *
+ *  This method is used for freeing the program, the targets
+ *  and the vertex array.
+ ***********************************************************/
+void WeightedTransparency::DestroyResources()
+{
+	DestroyTargets();
+	m_shaderVariants.DestroyPrograms();
+	m_compositeVariant = -1;
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the targets for a size.
+ *  The color sum needs the range of half floats, since the
+ *  weights of near fragments are large, and the background
+ *  that shows through only needs one channel.
+ ***********************************************************/
+bool WeightedTransparency::CreateTargets(int width, int height)
+{
+	DestroyTargets();
+
+	glGenTextures(1, &m_accumulationTexture);
+	glBindTexture(GL_TEXTURE_2D, m_accumulationTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &m_revealageTexture);
+	glBindTexture(GL_TEXTURE_2D, m_revealageTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_accumulationTexture, 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_revealageTexture, 0);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	glDrawBuffers(2, drawBuffers);
+	bool bComplete = (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)previousFramebuffer);
+
+	if (bComplete == false)
+	{
+		std::cout << "ERROR::WEIGHTED_TRANSPARENCY::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		DestroyTargets();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTargets()
+ *
+ *  This method is used for freeing the framebuffer and the
+ *  targets.
+ ***********************************************************/
+void WeightedTransparency::DestroyTargets()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_accumulationTexture != 0)
+	{
+		glDeleteTextures(1, &m_accumulationTexture);
+		m_accumulationTexture = 0;
+	}
+	if (m_revealageTexture != 0)
+	{
+		glDeleteTextures(1, &m_revealageTexture);
+		m_revealageTexture = 0;
+	}
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  BeginTransparency()
+ *
+ *  This method is used for switching to the targets once
+ *  the opaque objects were drawn.  The depth of the scene
+ *  is copied into the targets, since the depth buffer of
+ *  the window can not be attached to another framebuffer,
+ *  and the transparent objects are then tested against it
+ *  without writing to it.  The color sum adds up, and the
+ *  background that shows through is multiplied down.
+ ***********************************************************/
+bool WeightedTransparency::BeginTransparency()
+{
+	if (m_compositeVariant < 0)
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_VIEWPORT, m_sceneViewport);
+	if ((m_sceneViewport[2] <= 0) || (m_sceneViewport[3] <= 0))
+	{
+		return(false);
+	}
+	if (((m_sceneViewport[2] != m_width) || (m_sceneViewport[3] != m_height)) &&
+		(CreateTargets(m_sceneViewport[2], m_sceneViewport[3]) == false))
+	{
+		return(false);
+	}
+
+	// copy the depth of the framebuffer the scene was drawn into
+	GLint readFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_sceneFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)m_sceneFramebuffer);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glCopyTexSubImage2D(
+		GL_TEXTURE_2D, 0, 0, 0,
+		m_sceneViewport[0], m_sceneViewport[1], m_sceneViewport[2], m_sceneViewport[3]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)readFramebuffer);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+	glClearBufferfv(GL_COLOR, 0, g_AccumulationClear);
+	glClearBufferfv(GL_COLOR, 1, g_RevealageClear);
+
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+
+	return(true);
+}
+
+/***********************************************************
+ *  EndTransparency()
+ *
+ *  This method is used for blending the transparent objects
+ *  over the scene.  A full screen triangle divides the
+ *  color sum by the sum of the weights, and blends that
+ *  average color over the scene by how much of the
+ *  background was covered.  Pixels without transparent
+ *  objects are left alone.
+ ***********************************************************/
+void WeightedTransparency::EndTransparency()
+{
+	if (m_framebuffer == 0)
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)m_sceneFramebuffer);
+	glViewport(m_sceneViewport[0], m_sceneViewport[1], m_sceneViewport[2], m_sceneViewport[3]);
+
+	GLint previousProgram = 0;
+	GLint previousVertexArray = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+
+	glUseProgram(m_shaderVariants.GetProgram(m_compositeVariant));
+	m_compositeUniforms.SetVec2(
+		m_viewportOriginHandle,
+		glm::vec2((float)m_sceneViewport[0], (float)m_sceneViewport[1]));
+	glActiveTexture(GL_TEXTURE0 + ACCUMULATION_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_accumulationTexture);
+	glActiveTexture(GL_TEXTURE0 + REVEALAGE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_revealageTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glDisable(GL_DEPTH_TEST);
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray((GLuint)previousVertexArray);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glUseProgram((GLuint)previousProgram);
+}
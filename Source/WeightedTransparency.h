@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// weightedtransparency.h
+// ============
+// composite the transparent objects without sorting them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderVariants.h"
+#include "UniformBuffers.h"
+#include "UniformCache.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  WeightedTransparency
+ *
+ *  This class draws the transparent objects with weighted
+ *  blended order independent transparency.  The objects are
+ *  drawn in any order into two targets - the sum of their
+ *  premultiplied colors, weighted by how near and how opaque
+ *  each fragment is, and the product of how much of the
+ *  background each fragment lets through.  The weighted
+ *  average color is then blended over the opaque scene with
+ *  the background that shows through, so the transparent
+ *  objects never have to be sorted.
+ *
+ *  The targets share a copy of the depth of the opaque
+ *  scene, so the transparent objects are still hidden by the
+ *  opaque ones.  The blending needs a separate blend
+ *  function for each target, which is part of OpenGL 4.0.
+ ***********************************************************/
+class WeightedTransparency
+{
+public:
+	// constructor
+	WeightedTransparency(UniformBufferManager* pUniformBuffers);
+	// destructor
+	~WeightedTransparency();
+
+	// the texture units the targets are read from by the
+	// composite pass, after the units used by the depth pyramid
+	static const int ACCUMULATION_UNIT = 14;
+	static const int REVEALAGE_UNIT = 15;
+
+private:
+	// the program that blends the targets over the scene
+	ShaderVariants m_shaderVariants;
+	int m_compositeVariant;
+	ShaderUniformCache m_compositeUniforms;
+	int m_accumulationHandle;
+	int m_revealageHandle;
+	int m_viewportOriginHandle;
+	// the framebuffer of the targets, and the targets - the
+	// color sum, the background that shows through, and the
+	// copy of the scene depth
+	GLuint m_framebuffer;
+	GLuint m_accumulationTexture;
+	GLuint m_revealageTexture;
+	GLuint m_depthTexture;
+	int m_width;
+	int m_height;
+	// the empty vertex array the full screen triangle of the
+	// composite pass is drawn with
+	GLuint m_vertexArray;
+	// the framebuffer and viewport the scene was drawn into
+	GLint m_sceneFramebuffer;
+	GLint m_sceneViewport[4];
+
+	// create the targets for a size
+	bool CreateTargets(int width, int height);
+	void DestroyTargets();
+
+public:
+	// whether the driver has a blend function for each target
+	static bool IsSupported();
+
+	// load the composite program
+	bool LoadShaders(const char* vertexShaderPath, const char* fragmentShaderPath);
+	// free the program, the targets and the vertex array
+	void DestroyResources();
+
+	// switch to the targets after the opaque objects were drawn
+	// into the bound draw framebuffer - false is returned when
+	// the targets could not be created
+	bool BeginTransparency();
+	// blend the transparent objects over the scene and switch
+	// back to the framebuffer of the scene
+	void EndTransparency();
+};
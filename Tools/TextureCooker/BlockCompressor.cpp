@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompressor.cpp
+// ============
+// compress RGBA images into BC1 and BC3 blocks for the texture cooker
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompressor.h"
+
+// declaration of the helper functions
+namespace
+{
+	// pack an 8 bit color into a 5:6:5 color
+	uint16_t PackColor565(int red, int green, int blue)
+	{
+		return((uint16_t)(((red * 31 + 127) / 255) << 11 |
+			((green * 63 + 127) / 255) << 5 |
+			((blue * 31 + 127) / 255)));
+	}
+
+	// unpack a 5:6:5 color into an 8 bit color
+	void UnpackColor565(uint16_t color, int rgb[3])
+	{
+		int red = (color >> 11) & 31;
+		int green = (color >> 5) & 63;
+		int blue = color & 31;
+
+		rgb[0] = (red << 3) | (red >> 2);
+		rgb[1] = (green << 2) | (green >> 4);
+		rgb[2] = (blue << 3) | (blue >> 2);
+	}
+}
+
+/***********************************************************
+ *  FetchBlock()
+ *
+ *  This method is used for copying a 4x4 block of pixels
+ *  out of an image.
+ ***********************************************************/
+void BlockCompressor::FetchBlock(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int blockX,
+	int blockY,
+	unsigned char block[64])
+{
+	for (int y = 0; y < 4; y++)
+	{
+		int row = blockY * 4 + y;
+		if (row >= height)
+		{
+			row = height - 1;
+		}
+
+		for (int x = 0; x < 4; x++)
+		{
+			int column = blockX * 4 + x;
+			if (column >= width)
+			{
+				column = width - 1;
+			}
+
+			const unsigned char* source = pixels + ((size_t)row * width + column) * 4;
+			unsigned char* destination = block + (y * 4 + x) * 4;
+			destination[0] = source[0];
+			destination[1] = source[1];
+			destination[2] = source[2];
+			destination[3] = source[3];
+		}
+	}
+}
+
+/***********************************************************
+ *  CompressColorBlock()
+ *
+ *  This method is used for compressing the colors of a 4x4
+ *  block.  The end points are the corners of the box around
+ *  the colors, moved in by 1/16th to reduce the error, and
+ *  each pixel picks the nearest of the four palette colors.
+ ***********************************************************/
+void BlockCompressor::CompressColorBlock(const unsigned char block[64], unsigned char output[8])
+{
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			int value = block[i * 4 + c];
+			if (value < minColor[c])
+			{
+				minColor[c] = value;
+			}
+			if (value > maxColor[c])
+			{
+				maxColor[c] = value;
+			}
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (maxColor[c] - minColor[c]) / 16;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+
+	uint16_t color0 = PackColor565(maxColor[0], maxColor[1], maxColor[2]);
+	uint16_t color1 = PackColor565(minColor[0], minColor[1], minColor[2]);
+	uint32_t indices = 0;
+
+	// the four color mode is used when color0 > color1
+	if (color0 < color1)
+	{
+		uint16_t swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	if (color0 != color1)
+	{
+		int palette[4][3];
+
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestDistance = 0x7FFFFFFF;
+
+			for (int p = 0; p < 4; p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int delta = block[i * 4 + c] - palette[p][c];
+					distance += delta * delta;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= (uint32_t)bestIndex << (i * 2);
+		}
+	}
+
+	output[0] = (unsigned char)(color0 & 0xFF);
+	output[1] = (unsigned char)(color0 >> 8);
+	output[2] = (unsigned char)(color1 & 0xFF);
+	output[3] = (unsigned char)(color1 >> 8);
+	output[4] = (unsigned char)(indices & 0xFF);
+	output[5] = (unsigned char)((indices >> 8) & 0xFF);
+	output[6] = (unsigned char)((indices >> 16) & 0xFF);
+	output[7] = (unsigned char)((indices >> 24) & 0xFF);
+}
+
+/***********************************************************
+ *  CompressAlphaBlock()
+ *
+ *  This method is used for compressing the alpha values of
+ *  a 4x4 block, with the eight value mode of BC3.
+ ***********************************************************/
+void BlockCompressor::CompressAlphaBlock(const unsigned char block[64], unsigned char output[8])
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		int value = block[i * 4 + 3];
+		if (value < minAlpha)
+		{
+			minAlpha = value;
+		}
+		if (value > maxAlpha)
+		{
+			maxAlpha = value;
+		}
+	}
+
+	uint64_t indices = 0;
+
+	if (maxAlpha > minAlpha)
+	{
+		int palette[8];
+
+		palette[0] = maxAlpha;
+		palette[1] = minAlpha;
+		for (int p = 1; p < 7; p++)
+		{
+			palette[p + 1] = ((7 - p) * maxAlpha + p * minAlpha) / 7;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestDistance = 256;
+
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = block[i * 4 + 3] - palette[p];
+				if (distance < 0)
+				{
+					distance = -distance;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= (uint64_t)bestIndex << (i * 3);
+		}
+	}
+
+	output[0] = (unsigned char)maxAlpha;
+	output[1] = (unsigned char)minAlpha;
+	for (int i = 0; i < 6; i++)
+	{
+		output[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+	}
+}
+
+/***********************************************************
+ *  CompressBC1()
+ *
+ *  This method is used for compressing an RGBA image into
+ *  BC1 blocks, which are added to the output.
+ ***********************************************************/
+void BlockCompressor::CompressBC1(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	std::vector<unsigned char>& output)
+{
+	unsigned char block[64];
+	unsigned char compressed[8];
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+
+	for (int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			FetchBlock(pixels, width, height, blockX, blockY, block);
+			CompressColorBlock(block, compressed);
+			output.insert(output.end(), compressed, compressed + 8);
+		}
+	}
+}
+
+/***********************************************************
+ *  CompressBC3()
+ *
+ *  This method is used for compressing an RGBA image into
+ *  BC3 blocks, which are added to the output.  Each block
+ *  holds the alpha values followed by the colors.
+ ***********************************************************/
+void BlockCompressor::CompressBC3(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	std::vector<unsigned char>& output)
+{
+	unsigned char block[64];
+	unsigned char compressed[16];
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+
+	for (int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			FetchBlock(pixels, width, height, blockX, blockY, block);
+			CompressAlphaBlock(block, compressed);
+			CompressColorBlock(block, compressed + 8);
+			output.insert(output.end(), compressed, compressed + 16);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildMipLevel()
+ *
+ *  This method is used for building the next smaller mip
+ *  level of an RGBA image.  Each output pixel is the average
+ *  of a 2x2 box of input pixels, and the last row or column
+ *  is repeated for images with odd sizes.
+ ***********************************************************/
+void BlockCompressor::BuildMipLevel(
+	const std::vector<unsigned char>& pixels,
+	int width,
+	int height,
+	std::vector<unsigned char>& output,
+	int& outputWidth,
+	int& outputHeight)
+{
+	outputWidth = (width > 1) ? (width / 2) : 1;
+	outputHeight = (height > 1) ? (height / 2) : 1;
+	output.resize((size_t)outputWidth * outputHeight * 4);
+
+	for (int y = 0; y < outputHeight; y++)
+	{
+		int row0 = y * 2;
+		int row1 = (row0 + 1 < height) ? (row0 + 1) : row0;
+
+		for (int x = 0; x < outputWidth; x++)
+		{
+			int column0 = x * 2;
+			int column1 = (column0 + 1 < width) ? (column0 + 1) : column0;
+
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = pixels[((size_t)row0 * width + column0) * 4 + c] +
+					pixels[((size_t)row0 * width + column1) * 4 + c] +
+					pixels[((size_t)row1 * width + column0) * 4 + c] +
+					pixels[((size_t)row1 * width + column1) * 4 + c];
+				output[((size_t)y * outputWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompressor.h
+// ============
+// compress RGBA images into BC1 and BC3 blocks for the texture cooker
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  BlockCompressor
+ *
+ *  This class compresses 8 bit RGBA images into BC1 and BC3
+ *  blocks, and builds the mip levels that are compressed.
+ *  The end points of each block are fitted to the range of
+ *  its colors, which is fast and good enough for the scene
+ *  textures, though not as exact as a full search.
+ ***********************************************************/
+class BlockCompressor
+{
+public:
+	// compress an RGBA image into BC1 blocks - the alpha of
+	// the image is ignored
+	static void CompressBC1(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		std::vector<unsigned char>& output);
+	// compress an RGBA image into BC3 blocks
+	static void CompressBC3(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		std::vector<unsigned char>& output);
+
+	// build the next smaller mip level of an RGBA image with
+	// a 2x2 box filter
+	static void BuildMipLevel(
+		const std::vector<unsigned char>& pixels,
+		int width,
+		int height,
+		std::vector<unsigned char>& output,
+		int& outputWidth,
+		int& outputHeight);
+
+private:
+	// copy a 4x4 block out of an image, repeating the edge
+	// pixels for blocks that run past the edge
+	static void FetchBlock(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int blockX,
+		int blockY,
+		unsigned char block[64]);
+	// compress the colors of a 4x4 block
+	static void CompressColorBlock(const unsigned char block[64], unsigned char output[8]);
+	// compress the alpha values of a 4x4 block
+	static void CompressAlphaBlock(const unsigned char block[64], unsigned char output[8]);
+};
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecooker.cpp
+// ============
+// convert the scene texture images into compressed DDS files ahead of time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompressor.h"
+#include "DDSTexture.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of the cooker functions
+namespace
+{
+	/***********************************************************
+	 *  IsSourceImage()
+	 *
+	 *  Check whether a file is an image the cooker converts.
+	 ***********************************************************/
+	bool IsSourceImage(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+
+		for (size_t i = 0; i < extension.size(); i++)
+		{
+			extension[i] = (char)tolower((unsigned char)extension[i]);
+		}
+
+		return((extension == ".jpg") || (extension == ".jpeg") ||
+			(extension == ".png") || (extension == ".tga") || (extension == ".bmp"));
+	}
+
+	/***********************************************************
+	 *  CookTexture()
+	 *
+	 *  Convert one image file into a DDS file with a full mip
+	 *  chain.  Images with 4 channels are written as BC3 to
+	 *  keep their alpha, and all others as BC1.  The image is
+	 *  flipped when it is loaded, the same as at run time, so
+	 *  the rows are stored in the order OpenGL expects.
+	 ***********************************************************/
+	bool CookTexture(const std::string& sourceName, const std::string& cookedName)
+	{
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+
+		unsigned char* image = stbi_load(
+			sourceName.c_str(),
+			&width,
+			&height,
+			&colorChannels,
+			4);
+		if (NULL == image)
+		{
+			std::cout << "Could not load image:" << sourceName << std::endl;
+			return(false);
+		}
+
+		DDSTexture::DDS_IMAGE cooked;
+		cooked.format = (colorChannels == 4) ? DDSTexture::DDS_FORMAT_BC3 : DDSTexture::DDS_FORMAT_BC1;
+		cooked.width = width;
+		cooked.height = height;
+		cooked.mipCount = 0;
+
+		std::vector<unsigned char> level(image, image + (size_t)width * height * 4);
+		std::vector<unsigned char> nextLevel;
+		int levelWidth = width;
+		int levelHeight = height;
+
+		stbi_image_free(image);
+
+		while (cooked.mipCount < DDSTexture::MAX_MIP_LEVELS)
+		{
+			if (cooked.format == DDSTexture::DDS_FORMAT_BC3)
+			{
+				BlockCompressor::CompressBC3(level.data(), levelWidth, levelHeight, cooked.data);
+			}
+			else
+			{
+				BlockCompressor::CompressBC1(level.data(), levelWidth, levelHeight, cooked.data);
+			}
+			cooked.mipCount++;
+
+			if ((levelWidth == 1) && (levelHeight == 1))
+			{
+				break;
+			}
+
+			BlockCompressor::BuildMipLevel(level, levelWidth, levelHeight, nextLevel, levelWidth, levelHeight);
+			level.swap(nextLevel);
+		}
+
+		DDSTexture::CalculateLevels(cooked);
+		if (DDSTexture::WriteFile(cookedName, cooked) == false)
+		{
+			std::cout << "Could not write cooked image:" << cookedName << std::endl;
+			return(false);
+		}
+
+		std::cout << "Cooked image:" << cookedName << ", width:" << width << ", height:" << height
+			<< ", levels:" << cooked.mipCount
+			<< ", format:" << ((cooked.format == DDSTexture::DDS_FORMAT_BC3) ? "BC3" : "BC1") << std::endl;
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  main()
+ *
+ *  The texture cooker converts every image in the passed in
+ *  directory, or in the textures directory by default, into
+ *  a DDS file with the same name next to it.  Images whose
+ *  cooked file is newer than the image are skipped.  The
+ *  texture loader picks up the cooked files at run time.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	std::filesystem::path textureDirectory = "textures";
+	bool bForce = false;
+	int cookedCount = 0;
+	int failedCount = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--force")
+		{
+			bForce = true;
+		}
+		else
+		{
+			textureDirectory = argument;
+		}
+	}
+
+	std::error_code error;
+	if (std::filesystem::is_directory(textureDirectory, error) == false)
+	{
+		std::cout << "Texture directory not found:" << textureDirectory.string() << std::endl;
+		std::cout << "Usage: TextureCooker [--force] [texture directory]" << std::endl;
+		return(1);
+	}
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	for (const std::filesystem::directory_entry& entry :
+		std::filesystem::directory_iterator(textureDirectory, error))
+	{
+		if ((entry.is_regular_file() == false) || (IsSourceImage(entry.path()) == false))
+		{
+			continue;
+		}
+
+		std::filesystem::path cookedPath = entry.path();
+		cookedPath.replace_extension(".dds");
+
+		if ((bForce == false) &&
+			(std::filesystem::exists(cookedPath, error) == true) &&
+			(std::filesystem::last_write_time(cookedPath, error) >= entry.last_write_time(error)))
+		{
+			continue;
+		}
+
+		if (CookTexture(entry.path().string(), cookedPath.string()) == true)
+		{
+			cookedCount++;
+		}
+		else
+		{
+			failedCount++;
+		}
+	}
+
+	std::cout << "Cooked " << cookedCount << " textures, " << failedCount << " failed" << std::endl;
+
+	return((failedCount > 0) ? 1 : 0);
+}
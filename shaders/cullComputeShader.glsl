@@ -0,0 +1,211 @@
+#version 430 core
+// one thread for each instance, or for each command in the
+// reset pass - must match the group size of GpuCuller
+layout (local_size_x = 64) in;
+
+// the levels of detail of the shapes, which must match
+// ShapeGeometry::LOD_COUNT
+#define MAX_LEVELS 3
+
+// must match InstancedMeshes::INSTANCE_DATA
+struct Instance
+{
+    mat4 model;
+    vec4 color;
+    vec4 params;
+    vec4 normalMatrix[3];
+};
+
+struct InstanceInfo
+{
+    uint firstCommand;
+    uint levelCount;
+    uint level;
+    uint mesh;
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+// every instance, followed by the ranges the commands draw
+layout (std430, binding = 0) buffer InstanceBuffer
+{
+    Instance instances[];
+};
+
+layout (std430, binding = 1) buffer InstanceInfoBuffer
+{
+    InstanceInfo instanceInfos[];
+};
+
+layout (std430, binding = 2) buffer CommandBuffer
+{
+    DrawCommand commands[];
+};
+
+// the minimum and maximum corner of each shape
+layout (std430, binding = 3) readonly buffer MeshBoundsBuffer
+{
+    vec4 meshBounds[];
+};
+
+// 0 clears the instance counts of the commands, 1 culls
+uniform int cullPass;
+uniform int instanceCount;
+uniform int firstCommand;
+uniform int commandCount;
+
+uniform vec4 frustumPlanes[6];
+uniform vec3 viewPosition;
+uniform float projectionScale;
+uniform bool bPerspective;
+uniform float levelScreenSizes[MAX_LEVELS - 1];
+uniform float levelHysteresis;
+
+// the depth pyramid of the last frame and the view and
+// projection it was rendered with
+uniform bool bUseOcclusion = false;
+uniform mat4 occlusionViewProjection;
+uniform int pyramidLevels;
+uniform sampler2D depthPyramid;
+
+// whether the box is behind the depth of the last frame
+bool IsOccluded(vec3 boxMin, vec3 boxMax)
+{
+    vec2 screenMin = vec2(1.0);
+    vec2 screenMax = vec2(0.0);
+    float nearestDepth = 1.0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = occlusionViewProjection * vec4(corner, 1.0);
+
+        // a box that reaches behind the camera is never hidden
+        if (clip.w <= 0.0)
+        {
+            return false;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        screenMin = min(screenMin, ndc.xy * 0.5 + 0.5);
+        screenMax = max(screenMax, ndc.xy * 0.5 + 0.5);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+
+    screenMin = clamp(screenMin, 0.0, 1.0);
+    screenMax = clamp(screenMax, 0.0, 1.0);
+
+    // the level where the box covers at most two texels each way
+    vec2 baseSize = vec2(textureSize(depthPyramid, 0));
+    vec2 boxSize = (screenMax - screenMin) * baseSize;
+    int level = clamp(int(ceil(log2(max(max(boxSize.x, boxSize.y), 1.0)))), 0, pyramidLevels - 1);
+    ivec2 levelSize = textureSize(depthPyramid, level);
+    ivec2 texelMin = clamp(ivec2(screenMin * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 texelMax = clamp(ivec2(screenMax * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+    float farthestDepth = max(
+        max(texelFetch(depthPyramid, texelMin, level).r,
+            texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+        max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r,
+            texelFetch(depthPyramid, texelMax, level).r));
+
+    return nearestDepth > farthestDepth;
+}
+
+// the level of detail for a projected size, starting from
+// the level the instance was drawn with last frame
+uint SelectDetailLevel(float screenSize, uint currentLevel, uint levelCount)
+{
+    uint level = min(currentLevel, levelCount - 1u);
+
+    while ((level > 0u) &&
+        (screenSize > levelScreenSizes[level - 1u] * (1.0 + levelHysteresis)))
+    {
+        level--;
+    }
+    while ((level < levelCount - 1u) &&
+        (screenSize < levelScreenSizes[level] * (1.0 - levelHysteresis)))
+    {
+        level++;
+    }
+
+    return level;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+
+    if (cullPass == 0)
+    {
+        if (index < uint(commandCount))
+        {
+            commands[uint(firstCommand) + index].instanceCount = 0u;
+        }
+        return;
+    }
+
+    if (index >= uint(instanceCount))
+    {
+        return;
+    }
+
+    mat4 model = instances[index].model;
+    InstanceInfo info = instanceInfos[index];
+
+    // the instance belongs to a shape with no commands
+    if (info.levelCount == 0u)
+    {
+        return;
+    }
+
+    // move the local box of the shape into world space
+    vec3 localMin = meshBounds[info.mesh * 2u].xyz;
+    vec3 localMax = meshBounds[info.mesh * 2u + 1u].xyz;
+    vec3 center = vec3(model * vec4((localMin + localMax) * 0.5, 1.0));
+    mat3 absoluteModel = mat3(abs(model[0].xyz), abs(model[1].xyz), abs(model[2].xyz));
+    vec3 extent = absoluteModel * ((localMax - localMin) * 0.5);
+
+    // a box is outside when it is entirely behind any plane
+    for (int i = 0; i < 6; i++)
+    {
+        vec3 normal = frustumPlanes[i].xyz;
+        if (dot(normal, center) + frustumPlanes[i].w + dot(abs(normal), extent) < 0.0)
+        {
+            return;
+        }
+    }
+
+    if (bUseOcclusion && IsOccluded(center - extent, center + extent))
+    {
+        return;
+    }
+
+    // the same level of detail selection as the CPU culler
+    uint level = 0u;
+    if (info.levelCount > 1u)
+    {
+        float radius = length(extent);
+        float screenSize = radius * projectionScale;
+
+        if (bPerspective)
+        {
+            float distance = length(center - viewPosition);
+            screenSize = (distance > radius) ? screenSize / distance : levelScreenSizes[0] * 2.0;
+        }
+        level = SelectDetailLevel(screenSize, info.level, info.levelCount);
+        instanceInfos[index].level = level;
+    }
+
+    // add the instance to the range its command draws
+    uint command = info.firstCommand + level;
+    uint slot = atomicAdd(commands[command].instanceCount, 1u);
+    instances[commands[command].baseInstance + slot] = instances[index];
+}
@@ -0,0 +1,56 @@
+#version 430 core
+// one thread for each texel of the level being built - must
+// match the group size of GpuCuller
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the level being built and the level before it
+layout (r32f, binding = 0) uniform writeonly image2D destinationLevel;
+layout (r32f, binding = 1) uniform readonly image2D sourceLevel;
+
+// the copy of the depth buffer the first level is read from
+uniform sampler2D depthTexture;
+uniform bool bFromDepth;
+uniform ivec2 sourceSize;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 levelSize = imageSize(destinationLevel);
+
+    if (any(greaterThanEqual(texel, levelSize)))
+    {
+        return;
+    }
+
+    if (bFromDepth)
+    {
+        imageStore(destinationLevel, texel, vec4(texelFetch(depthTexture, texel, 0).r));
+        return;
+    }
+
+    // the farthest depth of the texels this texel covers - the
+    // last row and column also cover the odd texel left over
+    // when the level before it has an odd size
+    ivec2 first = texel * 2;
+    ivec2 last = first + 1;
+    if (texel.x == levelSize.x - 1)
+    {
+        last.x = sourceSize.x - 1;
+    }
+    if (texel.y == levelSize.y - 1)
+    {
+        last.y = sourceSize.y - 1;
+    }
+    last = min(last, sourceSize - 1);
+
+    float farthestDepth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+    {
+        for (int x = first.x; x <= last.x; x++)
+        {
+            farthestDepth = max(farthestDepth, imageLoad(sourceLevel, ivec2(x, y)).r);
+        }
+    }
+
+    imageStore(destinationLevel, texel, vec4(farthestDepth));
+}
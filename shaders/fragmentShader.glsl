@@ -1,9 +1,21 @@
 #version 330 core
+// the depth pre-pass only writes the depth, so its variant is
+// compiled with USE_DEPTH_ONLY and skips all of the shading
+// the transparent objects of the weighted blended pass also
+// write how much of the background they let through
+#ifdef USE_WEIGHTED_TRANSPARENCY
+layout (location = 0) out vec4 fragmentColor;
+layout (location = 1) out vec4 fragmentRevealage;
+#else
 out vec4 fragmentColor;
+#endif
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+in vec4 fragmentObjectColor;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureIndex;
 
 struct Material {
     vec3 diffuseColor;
@@ -23,12 +35,13 @@ struct DirectionalLight {
 
 struct PointLight {
     vec3 position;
+    float radius;
     
     vec3 ambient;
+    // the point shadow map of the light, or -1 for none
+    int shadowIndex;
     vec3 diffuse;
     vec3 specular;
-
-    bool bActive;
 };
 
 struct SpotLight {
@@ -48,32 +61,165 @@ struct SpotLight {
     bool bActive;
 };
 
-#define TOTAL_POINT_LIGHTS 5
+#define MAX_MATERIALS 16
+#define MAX_TEXTURES 256
+#define MAX_TEXTURE_ARRAYS 8
+#define MAX_SHADOW_CASCADES 4
+#define MAX_POINT_SHADOWS 4
 
-uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
-uniform SpotLight spotLight;
+
+// per-frame camera values shared by all of the shader programs
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+};
+
+// scene lights shared by all of the shader programs
+layout (std140) uniform LightBlock
+{
+    DirectionalLight directionalLight;
+    SpotLight spotLight;
+};
+
+// the size of the light cluster grid (xyz) and how view space
+// distances map onto its depth slices (near, far, scale, bias)
+layout (std140) uniform ClusterBlock
+{
+    ivec4 clusterGrid;
+    vec4 clusterDepth;
+};
+
+// the light space matrix and view distance of each shadow
+// cascade, the position (xyz) and range (w) of each point
+// shadow, and the cascade (x) and point shadow (y) counts
+layout (std140) uniform ShadowBlock
+{
+    mat4 cascadeMatrices[MAX_SHADOW_CASCADES];
+    vec4 cascadeSplits;
+    vec4 pointShadows[MAX_POINT_SHADOWS];
+    ivec4 shadowCounts;
+};
+
+// materials selected by index for the instanced draws
+layout (std140) uniform MaterialBlock
+{
+    Material materialTable[MAX_MATERIALS];
+};
+
+// the texture array (x) and layer (y) of each scene texture
+layout (std140) uniform TextureBlock
+{
+    ivec4 textureLocations[MAX_TEXTURES];
+};
+
 uniform Material material;
-uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
+// each array holds the scene textures of one size and format
+uniform sampler2DArray textureArrays[MAX_TEXTURE_ARRAYS];
+// the point lights as four texels each, the first light index
+// and light count of each cluster, and the cluster light lists
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterLightGrid;
+uniform usamplerBuffer clusterLightIndices;
+// the directional light depth of each cascade, and of each
+// point shadow as the distance to the light over its range
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform samplerCubeShadow pointShadowMaps[MAX_POINT_SHADOWS];
+
+// the shader variants are compiled with SHADER_VARIANT and the
+// USE_* flags defined, which turns the branches below into
+// constants so the unused paths are removed - without them the
+// paths are selected at run time by the uniforms
+#ifdef SHADER_VARIANT
+#ifdef USE_LIGHTING
+#define LIGHTING_ENABLED true
+#else
+#define LIGHTING_ENABLED false
+#endif
+#ifdef USE_TEXTURE
+#define TEXTURE_ENABLED true
+#else
+#define TEXTURE_ENABLED false
+#endif
+#ifdef USE_DIRECTIONAL_LIGHT
+#define DIRECTIONAL_LIGHT_ENABLED true
+#else
+#define DIRECTIONAL_LIGHT_ENABLED false
+#endif
+#ifdef USE_POINT_LIGHTS
+#define POINT_LIGHTS_ENABLED true
+#else
+#define POINT_LIGHTS_ENABLED false
+#endif
+#ifdef USE_SPOT_LIGHT
+#define SPOT_LIGHT_ENABLED true
+#else
+#define SPOT_LIGHT_ENABLED false
+#endif
+#ifdef USE_SHADOWS
+#define SHADOWS_ENABLED true
+#else
+#define SHADOWS_ENABLED false
+#endif
+#else
+#define LIGHTING_ENABLED bUseLighting
+#define TEXTURE_ENABLED (fragmentTextureIndex >= 0)
+#define DIRECTIONAL_LIGHT_ENABLED directionalLight.bActive
+#define POINT_LIGHTS_ENABLED true
+#define SPOT_LIGHT_ENABLED spotLight.bActive
+#define SHADOWS_ENABLED false
+#endif
+
+// the material and color used for the current fragment - the
+// color is the texture color for textured objects
+Material objectMaterial;
+vec4 objectColor;
+// the material colors multiplied by the object color, which
+// are the same for every light of the fragment
+vec3 diffuseAlbedo;
+vec3 specularAlbedo;
 
 // function prototypes
+vec4 SampleSceneTexture(int textureIndex, vec2 uv);
+int FindCluster(vec3 fragPos);
+PointLight FetchPointLight(int lightIndex);
+float CalcCascadeShadow(vec3 fragPos, vec3 normal, vec3 lightDirection);
+float CalcPointShadow(int shadowIndex, vec3 fragPos, vec3 normal, vec3 lightDirection);
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {    
-    if(bUseLighting == true)
+#ifdef USE_DEPTH_ONLY
+    // the color writes are masked during the pre-pass
+    fragmentColor = vec4(0.0);
+#else
+    objectColor = fragmentObjectColor;
+    objectMaterial = material;
+    if(fragmentMaterialIndex >= 0)
+    {
+        objectMaterial = materialTable[fragmentMaterialIndex];
+    }
+    if(TEXTURE_ENABLED)
+    {
+        // the alpha of the object makes a texture see-through
+        objectColor = SampleSceneTexture(fragmentTextureIndex, fragmentTextureCoordinate);
+        objectColor.a *= fragmentObjectColor.a;
+    }
+
+    if(LIGHTING_ENABLED)
     {
         vec3 phongResult = vec3(0.0f);
         // properties
         vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
+        vec3 viewDir = normalize(viewPosition.xyz - fragmentPosition);
+        // the texture was sampled once above, and its color is
+        // multiplied into the material colors once for all lights
+        diffuseAlbedo = objectMaterial.diffuseColor * vec3(objectColor);
+        specularAlbedo = objectMaterial.specularColor * vec3(objectColor);
     
         // == =====================================================
         // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
@@ -82,144 +228,257 @@ void main()
         // up for this fragment's final color.
         // == =====================================================
         // phase 1: directional lighting
-        if(directionalLight.bActive == true)
+        if(DIRECTIONAL_LIGHT_ENABLED)
         {
             phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
         }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+        // phase 2: the point lights that reach this fragment's cluster
+        if(POINT_LIGHTS_ENABLED)
         {
-	    if(pointLights[i].bActive == true)
+            uvec2 clusterLights = texelFetch(clusterLightGrid, FindCluster(fragmentPosition)).xy;
+            for(uint i = 0u; i < clusterLights.y; i++)
             {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
+                int lightIndex = int(texelFetch(clusterLightIndices, int(clusterLights.x + i)).x);
+                phongResult += CalcPointLight(FetchPointLight(lightIndex), norm, fragmentPosition, viewDir);
             }
-        } 
+        }
         // phase 3: spot light
-        if(spotLight.bActive == true)
+        if(SPOT_LIGHT_ENABLED)
         {
             phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
         }
     
-        if(bUseTexture == true)
-        {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
-        }
-        else
-        {
-            fragmentColor = vec4(phongResult, objectColor.a);
-        }
+        fragmentColor = vec4(phongResult, objectColor.a);
     }
     else
     {
-        if(bUseTexture == true)
+        fragmentColor = objectColor;
+    }
+
+#ifdef USE_WEIGHTED_TRANSPARENCY
+    // the premultiplied color is weighted so the nearer and
+    // more opaque fragments win in the average, and the
+    // background is covered by the alpha of the fragment
+    float alpha = fragmentColor.a;
+    float weight = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 *
+        pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    fragmentColor = vec4(fragmentColor.rgb * alpha, alpha) * weight;
+    fragmentRevealage = vec4(alpha);
+#endif
+#endif
+}
+
+// reads the color of a scene texture from its texture array layer.
+// the arrays can only be indexed with constants, so the array is
+// picked with a branch, and the gradients are taken outside of it
+vec4 SampleSceneTexture(int textureIndex, vec2 uv)
+{
+    ivec4 location = textureLocations[textureIndex];
+    vec3 coordinate = vec3(uv, float(location.y));
+    vec2 uvDx = dFdx(uv);
+    vec2 uvDy = dFdy(uv);
+
+    if(location.x == 1) return textureGrad(textureArrays[1], coordinate, uvDx, uvDy);
+    if(location.x == 2) return textureGrad(textureArrays[2], coordinate, uvDx, uvDy);
+    if(location.x == 3) return textureGrad(textureArrays[3], coordinate, uvDx, uvDy);
+    if(location.x == 4) return textureGrad(textureArrays[4], coordinate, uvDx, uvDy);
+    if(location.x == 5) return textureGrad(textureArrays[5], coordinate, uvDx, uvDy);
+    if(location.x == 6) return textureGrad(textureArrays[6], coordinate, uvDx, uvDy);
+    if(location.x == 7) return textureGrad(textureArrays[7], coordinate, uvDx, uvDy);
+    return textureGrad(textureArrays[0], coordinate, uvDx, uvDy);
+}
+
+// finds the light cluster of a fragment from its screen position
+// and its view space distance - this must match the cluster
+// ranges that are built in LightManager::AssignLights()
+int FindCluster(vec3 fragPos)
+{
+    vec4 viewSpace = view * vec4(fragPos, 1.0);
+    vec4 clip = projection * viewSpace;
+    vec2 tile = (clip.xy / clip.w * 0.5 + 0.5) * vec2(clusterGrid.xy);
+    ivec2 tileIndex = clamp(ivec2(floor(tile)), ivec2(0), clusterGrid.xy - 1);
+    float slice = log(max(-viewSpace.z, clusterDepth.x)) * clusterDepth.z + clusterDepth.w;
+    int sliceIndex = clamp(int(floor(slice)), 0, clusterGrid.z - 1);
+
+    return (sliceIndex * clusterGrid.y + tileIndex.y) * clusterGrid.x + tileIndex.x;
+}
+
+// reads a point light from the light data texture buffer.
+PointLight FetchPointLight(int lightIndex)
+{
+    PointLight light;
+    vec4 positionRadius = texelFetch(pointLightData, lightIndex * 4);
+
+    light.position = positionRadius.xyz;
+    light.radius = positionRadius.w;
+    vec4 ambientShadow = texelFetch(pointLightData, lightIndex * 4 + 1);
+    light.ambient = ambientShadow.rgb;
+    light.shadowIndex = int(ambientShadow.a);
+    light.diffuse = texelFetch(pointLightData, lightIndex * 4 + 2).rgb;
+    light.specular = texelFetch(pointLightData, lightIndex * 4 + 3).rgb;
+
+    return light;
+}
+
+// finds how much of the directional light reaches a fragment.
+// the cascade is picked by the view distance of the fragment,
+// and nine comparisons around it are averaged to soften the
+// shadow edge - fragments past the last cascade are lit. the
+// shadows are only read for the fragments facing the light, so
+// the neighbouring fragments may not read them, and the
+// comparisons use zero gradients instead of the derivatives
+// that texture() would take, which reads the only level
+float CalcCascadeShadow(vec3 fragPos, vec3 normal, vec3 lightDirection)
+{
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = shadowCounts.x;
+    for(int i = 0; i < shadowCounts.x; i++)
+    {
+        if(viewDepth < cascadeSplits[i])
         {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+            cascade = i;
+            break;
         }
-        else
+    }
+    if(cascade >= shadowCounts.x)
+    {
+        return 1.0;
+    }
+
+    vec4 lightSpace = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+    vec3 coordinate = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(coordinate.z > 1.0)
+    {
+        return 1.0;
+    }
+    // surfaces facing away from the light need a larger bias
+    float bias = max(0.002 * (1.0 - dot(normal, lightDirection)), 0.0005);
+    vec2 texelSize = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+    float shadow = 0.0;
+    for(int x = -1; x <= 1; x++)
+    {
+        for(int y = -1; y <= 1; y++)
         {
-            fragmentColor = objectColor;
+            shadow += textureGrad(cascadeShadowMap, vec4(coordinate.xy + vec2(x, y) * texelSize, float(cascade), coordinate.z - bias), vec2(0.0), vec2(0.0));
         }
     }
+
+    return shadow / 9.0;
+}
+
+// finds how much of a point light reaches a fragment. the cube
+// maps can only be indexed with constants, so the map is picked
+// with a branch like the scene texture arrays, and each map is
+// read with zero gradients like the cascades
+float CalcPointShadow(int shadowIndex, vec3 fragPos, vec3 normal, vec3 lightDirection)
+{
+    vec4 pointShadow = pointShadows[shadowIndex];
+    vec3 toFragment = fragPos - pointShadow.xyz;
+    float bias = max(0.01 * (1.0 - dot(normal, lightDirection)), 0.002);
+    vec4 coordinate = vec4(toFragment, length(toFragment) / pointShadow.w - bias);
+
+    if(shadowIndex == 1) return textureGrad(pointShadowMaps[1], coordinate, vec3(0.0), vec3(0.0));
+    if(shadowIndex == 2) return textureGrad(pointShadowMaps[2], coordinate, vec3(0.0), vec3(0.0));
+    if(shadowIndex == 3) return textureGrad(pointShadowMaps[3], coordinate, vec3(0.0), vec3(0.0));
+    return textureGrad(pointShadowMaps[0], coordinate, vec3(0.0), vec3(0.0));
 }
 
 // calculates the color when using a directional light.
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
     vec3 lightDirection = normalize(-light.direction);
+    vec3 ambient = light.ambient * vec3(objectColor);
     // diffuse shading
     float diff = max(dot(normal, lightDirection), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDirection, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    if(bUseTexture == true)
+    // the fragments facing away from the light only get the
+    // ambient light, so the specular and shadow work is skipped
+    if(diff <= 0.0)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        return ambient;
     }
-    else
+    // specular shading
+    vec3 reflectDir = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), objectMaterial.shininess);
+    // the ambient light still reaches the shadowed fragments
+    float shadow = 1.0;
+    if(SHADOWS_ENABLED)
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
+        shadow = CalcCascadeShadow(fragmentPosition, normal, lightDirection);
     }
+    // combine results
+    vec3 diffuse = light.diffuse * diff * diffuseAlbedo;
+    vec3 specular = light.specular * spec * specularAlbedo;
     
-    return (ambient + diffuse + specular);
+    return (ambient + (diffuse + specular) * shadow);
 }
 
 // calculates the color when using a point light.
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular= vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 toLight = light.position - fragPos;
+    // the light fades out smoothly to nothing at its radius, and
+    // the fragments in the corners of a cluster can be past it
+    float distanceRatio = length(toLight) / light.radius;
+    if(distanceRatio >= 1.0)
+    {
+        return vec3(0.0);
+    }
+    float falloff = 1.0 - distanceRatio * distanceRatio * distanceRatio * distanceRatio;
+    falloff *= falloff;
+    vec3 lightDir = normalize(toLight);
+    vec3 ambient = light.ambient * vec3(objectColor);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
+    if(diff <= 0.0)
+    {
+        return ambient * falloff;
+    }
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     // Calculate specular component
-    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-   
-    // combine results
-    if(bUseTexture == true)
+    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), objectMaterial.shininess);
+    float shadow = 1.0;
+    if(SHADOWS_ENABLED && (light.shadowIndex >= 0))
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
+        shadow = CalcPointShadow(light.shadowIndex, fragPos, normal, lightDir);
     }
+   
+    // combine results
+    vec3 diffuse = light.diffuse * diff * diffuseAlbedo;
+    vec3 specular = light.specular * specularComponent * objectMaterial.specularColor;
     
-    return (ambient + diffuse + specular);
+    return (ambient + (diffuse + specular) * shadow) * falloff;
 }
 
 // calculates the color when using a spot light.
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // spotlight intensity
+    vec3 toLight = light.position - fragPos;
+    vec3 lightDir = normalize(toLight);
+    // spotlight intensity - the fragments outside of the cone
+    // get nothing from the light
     float theta = dot(lightDir, normalize(-light.direction)); 
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // combine results
-    if(bUseTexture == true)
+    if(intensity <= 0.0)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        return vec3(0.0);
     }
-    else
+    // attenuation
+    float distance = length(toLight);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
+    vec3 result = light.ambient * vec3(objectColor);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    if(diff > 0.0)
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
+        // specular shading
+        vec3 reflectDir = reflect(-lightDir, normal);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), objectMaterial.shininess);
+        // combine results
+        result += light.diffuse * diff * diffuseAlbedo;
+        result += light.specular * spec * specularAlbedo;
     }
     
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
+    return result * attenuation * intensity;
 }
@@ -0,0 +1,8 @@
+#version 330 core
+// the full screen passes draw one triangle that covers the
+// whole viewport, with its corners made from the vertex index
+void main()
+{
+   vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+   gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,52 @@
+#version 330 core
+out vec4 fragmentColor;
+
+// the scene that was drawn into the offscreen target
+uniform sampler2D sceneColor;
+// the size of the window, the part of the target the scene
+// covers, the last coordinate inside it, and one texel
+uniform vec2 displaySize;
+uniform vec2 sourceScale;
+uniform vec2 sourceMax;
+uniform vec2 sourceTexel;
+// how much the edges are sharpened, from 0 to 1
+uniform float sharpness;
+
+// reads the scene without going past the part the scene covers
+vec3 SampleScene(vec2 uv)
+{
+    return texture(sceneColor, min(uv, sourceMax)).rgb;
+}
+
+void main()
+{
+    // the filtering of the target scales the scene up
+    vec2 uv = gl_FragCoord.xy / displaySize * sourceScale;
+    vec3 center = SampleScene(uv);
+
+    if (sharpness <= 0.0)
+    {
+        fragmentColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec3 north = SampleScene(uv + vec2(0.0, sourceTexel.y));
+    vec3 south = SampleScene(max(uv - vec2(0.0, sourceTexel.y), vec2(0.0)));
+    vec3 east = SampleScene(uv + vec2(sourceTexel.x, 0.0));
+    vec3 west = SampleScene(max(uv - vec2(sourceTexel.x, 0.0), vec2(0.0)));
+
+    // the sharpening is adapted to the contrast around the
+    // pixel, so edges that already have a lot of contrast are
+    // not pushed past the colors around them
+    vec3 minColor = min(center, min(min(north, south), min(east, west)));
+    vec3 maxColor = max(center, max(max(north, south), max(east, west)));
+    vec3 headroom = min(minColor, 1.0 - maxColor) / max(maxColor, vec3(0.0001));
+    vec3 amount = sqrt(clamp(headroom, 0.0, 1.0)) * sharpness;
+
+    // the difference from the average of the neighbors is
+    // added back to the center
+    vec3 average = (north + south + east + west) * 0.25;
+    vec3 sharpened = center + (center - average) * amount * 2.0;
+
+    fragmentColor = vec4(clamp(sharpened, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+in vec3 fragmentPosition;
+
+// the light position and far plane of the point shadow map
+// being rendered
+uniform vec3 lightPosition;
+uniform float farPlane;
+
+// the point shadow maps store the distance to the light
+// instead of the projected depth, so that all six faces of
+// the cube use the same depth scale
+#ifdef SHADER_VARIANT
+#ifdef USE_SHADOW_DISTANCE
+#define SHADOW_DISTANCE_ENABLED true
+#else
+#define SHADOW_DISTANCE_ENABLED false
+#endif
+#else
+#define SHADOW_DISTANCE_ENABLED false
+#endif
+
+void main()
+{
+    if (SHADOW_DISTANCE_ENABLED)
+    {
+        gl_FragDepth = length(fragmentPosition - lightPosition) / farPlane;
+    }
+    else
+    {
+        gl_FragDepth = gl_FragCoord.z;
+    }
+}
@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 inVertexPosition;
+// per-instance values, only read when bUseInstancing is set
+layout (location = 3) in mat4 inInstanceModel;
+
+out vec3 fragmentPosition;
+
+uniform mat4 model;
+uniform bool bUseInstancing = false;
+// the view and projection of the shadow map being rendered
+uniform mat4 lightSpaceMatrix;
+
+// the shadow variants are compiled with SHADER_VARIANT and the
+// USE_* flags defined, which turns the branch below into a
+// constant - without them the uniform selects the path
+#ifdef SHADER_VARIANT
+#ifdef USE_INSTANCING
+#define INSTANCING_ENABLED true
+#else
+#define INSTANCING_ENABLED false
+#endif
+#else
+#define INSTANCING_ENABLED bUseInstancing
+#endif
+
+void main()
+{
+   mat4 objectModel = model;
+
+   if (INSTANCING_ENABLED)
+   {
+      objectModel = inInstanceModel;
+   }
+
+   fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0));
+   gl_Position = lightSpaceMatrix * vec4(fragmentPosition, 1.0f);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+out vec4 fragmentColor;
+
+// the weighted sum of the premultiplied colors (rgb) and of
+// the weights (a), and how much of the background shows
+// through the transparent objects
+uniform sampler2D accumulationTexture;
+uniform sampler2D revealageTexture;
+// the corner of the viewport the targets line up with
+uniform vec2 viewportOrigin;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy - viewportOrigin);
+    float revealage = texelFetch(revealageTexture, texel, 0).r;
+
+    // no transparent object covers this pixel
+    if (revealage >= 0.9999)
+    {
+        discard;
+    }
+
+    vec4 accumulation = texelFetch(accumulationTexture, texel, 0);
+    vec3 averageColor = accumulation.rgb / max(accumulation.a, 0.00001);
+
+    // blended with the source alpha as the background that
+    // shows through
+    fragmentColor = vec4(averageColor, revealage);
+}
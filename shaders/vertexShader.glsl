@@ -2,19 +2,93 @@
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance values, only read when bUseInstancing is set
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in vec4 inInstanceColor;
+layout (location = 8) in vec4 inInstanceParams;
+layout (location = 9) in mat3 inInstanceNormal;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+out vec4 fragmentObjectColor;
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureIndex;
+
+// the depth pre-pass and the lit pass compile this shader with
+// different flags, and the lit pass only keeps the fragments
+// whose depth equals the pre-pass depth, so both have to
+// calculate the position exactly the same way
+invariant gl_Position;
+
+// per-frame camera values shared by all of the shader programs
+layout (std140) uniform CameraBlock
+{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// inverse transpose of the model matrix, set with the model
+uniform mat3 normalMatrix = mat3(1.0f);
+uniform bool bUseInstancing = false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform bool bUseTexture = false;
+uniform int objectTextureIndex = 0;
+
+// the shader variants are compiled with SHADER_VARIANT and the
+// USE_* flags defined, which turns the branches below into
+// constants - without them the uniforms select the paths
+#ifdef SHADER_VARIANT
+#ifdef USE_INSTANCING
+#define INSTANCING_ENABLED true
+#else
+#define INSTANCING_ENABLED false
+#endif
+#ifdef USE_TEXTURE
+#define TEXTURE_ENABLED true
+#else
+#define TEXTURE_ENABLED false
+#endif
+#else
+#define INSTANCING_ENABLED bUseInstancing
+#define TEXTURE_ENABLED bUseTexture
+#endif
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
-   fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+   mat4 objectModel = model;
+   mat3 objectNormal = normalMatrix;
+   vec2 objectUVscale = UVscale;
+   fragmentObjectColor = objectColor;
+   // a negative index selects the single material uniform
+   fragmentMaterialIndex = -1;
+   // a negative index draws with the solid color
+   fragmentTextureIndex = -1;
+   if (TEXTURE_ENABLED)
+   {
+      fragmentTextureIndex = objectTextureIndex;
+   }
+
+   if (INSTANCING_ENABLED)
+   {
+      objectModel = inInstanceModel;
+      objectNormal = inInstanceNormal;
+      fragmentObjectColor = inInstanceColor;
+      objectUVscale = inInstanceParams.xy;
+      fragmentMaterialIndex = int(inInstanceParams.z);
+      fragmentTextureIndex = int(inInstanceParams.w);
+   }
+
+   fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * objectModel * vec4(inVertexPosition, 1.0f);
+   // the normal is moved into world space with the inverse
+   // transpose of the model matrix, which keeps it at a right
+   // angle to the surface when the object is scaled unevenly,
+   // so the lights and the shadow bias see the real surface -
+   // it is calculated once per object on the CPU
+   fragmentVertexNormal = objectNormal * inVertexNormal;
+   fragmentTextureCoordinate = inTextureCoordinate * objectUVscale;
+}